@@ -158,3 +158,28 @@ db_processing(db_handle_t *handle)
 {
   return handle->flags & DB_HANDLE_FLAG_PROCESSING;
 }
+
+/* db_stream: Process a query to completion, and pass each result row
+   to a callback function as soon as it has been generated. The handle
+   is freed when the processing stops. A callback can stop the processing
+   by returning an error code, which is then returned to the caller. */
+db_result_t
+db_stream(db_handle_t *handle, db_row_callback_t callback, void *ptr)
+{
+  db_result_t result;
+
+  result = DB_OK;
+  while(db_processing(handle)) {
+    result = db_process(handle);
+    if(result == DB_GOT_ROW) {
+      result = callback(handle, ptr);
+    }
+    if(result != DB_OK) {
+      break;
+    }
+  }
+
+  db_free(handle);
+
+  return result == DB_FINISHED ? DB_OK : result;
+}
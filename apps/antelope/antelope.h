@@ -42,6 +42,7 @@
 #include "aql.h"
 
 typedef int (*db_output_function_t)(const char *, ...);
+typedef db_result_t (*db_row_callback_t)(db_handle_t *, void *);
 
 void db_init(void);
 void db_set_output_function(db_output_function_t f);
@@ -49,5 +50,7 @@ const char *db_get_result_message(db_result_t code);
 db_result_t db_print_header(db_handle_t *handle);
 db_result_t db_print_tuple(db_handle_t *handle);
 int db_processing(db_handle_t *handle);
+db_result_t db_stream(db_handle_t *handle, db_row_callback_t callback,
+                      void *ptr);
 
 #endif /* DB_H */
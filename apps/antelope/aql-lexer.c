@@ -73,6 +73,7 @@ static const struct keyword keywords[] = {
   {"IS", IS},
   {"ON", ON},
   {"IN", IN},
+  {"BY", BY},
 
   {"AND", AND},
   {"NOT", NOT},
@@ -91,6 +92,7 @@ static const struct keyword keywords[] = {
   {"WHERE", WHERE},
   {"COUNT", COUNT},
   {"INDEX", INDEX},
+  {"GROUP", GROUP},
 
   {"INSERT", INSERT},
   {"SELECT", SELECT},
@@ -107,11 +109,12 @@ static const struct keyword keywords[] = {
 
   {"RELATION", RELATION},
 
-  {"ATTRIBUTE", ATTRIBUTE}
+  {"ATTRIBUTE", ATTRIBUTE},
+  {"BPLUSTREE", BPLUSTREE}
 };
 
 /* Provides a pointer to the first keyword of a specific length. */
-static const int8_t skip_hint[] = {0, 13, 21, 27, 33, 36, 44, 47, 48};
+static const int8_t skip_hint[] = {0, 13, 22, 28, 34, 38, 46, 49, 50};
 
 static char separators[] = "#.;,() \t\n";
 
@@ -479,6 +479,33 @@ PARSER(join)
   RETURN(OK);
 }
 
+PARSER(group)
+{
+  int i;
+
+  CONSUME(BY);
+  CONSUME(IDENTIFIER);
+
+  /* The results are grouped by one of the projected attributes. */
+  for(i = 0; i < AQL_ATTRIBUTE_COUNT(adt); i++) {
+    if(adt->aggregators[i] == AQL_NONE &&
+       !(adt->attributes[i].flags & ATTRIBUTE_FLAG_NO_STORE) &&
+       strcmp(adt->attributes[i].name, VALUE) == 0) {
+      break;
+    }
+  }
+
+  if(i == AQL_ATTRIBUTE_COUNT(adt)) {
+    PRINTF("The grouping attribute %s is not projected\n", VALUE);
+    RETURN(SYNTAX_ERROR);
+  }
+
+  adt->attributes[i].flags |= ATTRIBUTE_FLAG_GROUP;
+  AQL_SET_FLAG(adt, AQL_FLAG_AGGREGATE | AQL_FLAG_GROUP);
+
+  RETURN(OK);
+}
+
 PARSER(select)
 {
   AQL_SET_TYPE(adt, AQL_TYPE_SELECT);
@@ -502,11 +529,20 @@ PARSER(select)
     }
 
     AQL_SET_CONDITION(adt, &p);
-  } else {
+    NEXT;
+  } else if(TOKEN != GROUP) {
     REWIND;
     RETURN(OK);
   }
 
+  if(TOKEN == GROUP) {
+    if(!PARSE(group)) {
+      RETURN(SYNTAX_ERROR);
+    }
+  } else {
+    REWIND;
+  }
+
   CONSUME(END);
 
   return OK;
@@ -645,6 +681,9 @@ PARSER_TOKEN(index_type)
   case MEMHASH:
     type = INDEX_MEMHASH;
     break;
+  case BPLUSTREE:
+    type = INDEX_BPLUSTREE;
+    break;
   default:
     return NONE;
   };
@@ -104,6 +104,17 @@
 #endif /* DB_MAX_ELEMENT_SIZE */
 
 
+/* The size of the buffers used for reading rows ahead and for
+   appending rows in batches. Set to 0 to access one row at a time. */
+#ifndef DB_ROW_BUFFER_SIZE
+#define DB_ROW_BUFFER_SIZE		0
+#endif /* DB_ROW_BUFFER_SIZE */
+
+/* The maximum number of relations that have a row buffer at a time. */
+#ifndef DB_ROW_BUFFER_COUNT
+#define DB_ROW_BUFFER_COUNT		3
+#endif /* DB_ROW_BUFFER_COUNT */
+
 /* The maximum size of the LVM bytecode compiled from a
    single database query. */
 #ifndef DB_VM_BYTECODE_SIZE
@@ -133,6 +144,13 @@
 #define AQL_ATTRIBUTE_LIMIT    		5
 #endif /* AQL_ATTRIBUTE_LIMIT */
 
+/* The maximum number of groups aggregated at a time in a query with
+   GROUP BY. More groups are handled in further passes over the
+   relation. Set to 0 to disable GROUP BY. */
+#ifndef DB_GROUP_LIMIT
+#define DB_GROUP_LIMIT			0
+#endif /* DB_GROUP_LIMIT */
+
 /*----------------------------------------------------------------------------*/
 
 /*
@@ -186,6 +204,44 @@
 #define DB_INDEX_COST			64
 #endif /* DB_INDEX_COST */
 
+/* The number of entries in the in-memory table of the hash join.
+   Set to 0 to disable hash joins. */
+#ifndef DB_JOIN_HASH_SIZE
+#define DB_JOIN_HASH_SIZE		0
+#endif /* DB_JOIN_HASH_SIZE */
+
+/* The maximum number of partitions that a hash join spills to storage
+   when the smaller relation does not fit in the in-memory table. */
+#ifndef DB_JOIN_PARTITIONS
+#define DB_JOIN_PARTITIONS		4
+#endif /* DB_JOIN_PARTITIONS */
+
+/* The cost of an index lookup relative to reading a row, used when
+   choosing between an index nested-loop join and a hash join. */
+#ifndef DB_JOIN_INDEX_COST
+#define DB_JOIN_INDEX_COST		4
+#endif /* DB_JOIN_INDEX_COST */
+
+/* The maximum number of B+-tree indexes. */
+#ifndef DB_BPLUSTREE_INDEX_LIMIT
+#define DB_BPLUSTREE_INDEX_LIMIT	1
+#endif /* DB_BPLUSTREE_INDEX_LIMIT */
+
+/* The size of a B+-tree node. A node may hold at most 255 entries. */
+#ifndef DB_BPLUSTREE_PAGE_SIZE
+#define DB_BPLUSTREE_PAGE_SIZE		128
+#endif /* DB_BPLUSTREE_PAGE_SIZE */
+
+/* The number of B+-tree nodes cached in memory. At least two are needed. */
+#ifndef DB_BPLUSTREE_CACHE_LIMIT
+#define DB_BPLUSTREE_CACHE_LIMIT	2
+#endif /* DB_BPLUSTREE_CACHE_LIMIT */
+
+/* The storage space reserved for a B+-tree index. */
+#ifndef DB_BPLUSTREE_FILE_SIZE
+#define DB_BPLUSTREE_FILE_SIZE		(64 * 1024UL)
+#endif /* DB_BPLUSTREE_FILE_SIZE */
+
 /* The maximum number of hash table indexes. */
 #ifndef DB_MEMHASH_INDEX_LIMIT
 #define DB_MEMHASH_INDEX_LIMIT  	1
@@ -227,5 +283,12 @@
 #define LVM_USE_FLOATS			DB_FEATURE_FLOATS
 #endif /* LVM_USE_FLOATS */
 
+/* Translate the condition of a query into a flat instruction array
+   before processing the query, instead of decoding the bytecode for
+   each row. */
+#ifndef LVM_COMPILE
+#define LVM_COMPILE			0
+#endif /* LVM_COMPILE */
+
 
 #endif /* !DB_OPTIONS_H */
@@ -0,0 +1,693 @@
+/*
+ * Copyright (c) 2013, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *     A B+-tree index stored in a single file.
+ *
+ *     The file consists of fixed-size pages. The first page holds the
+ *     tree header, and the other pages are tree nodes. Leaf nodes hold
+ *     (key, tuple ID) pairs sorted by key, and are linked in key order
+ *     so that range queries can scan them sequentially. Inner nodes
+ *     hold (key, page) pairs, where the key is not larger than any key
+ *     in the subtree of the page.
+ *
+ *     Recently used pages are kept in a small write-back cache. When a
+ *     leaf at the right edge of the tree is full and the new key is
+ *     the largest one, the new leaf only receives the new key. Hence,
+ *     the leaves stay full when keys are inserted in increasing
+ *     order, which is the common case for time series.
+ */
+
+#include <limits.h>
+#include <string.h>
+
+#include "cfs/cfs.h"
+#include "lib/assert.h"
+#include "lib/memb.h"
+
+#include "db-options.h"
+#include "index.h"
+#include "result.h"
+#include "storage.h"
+
+#define DEBUG DEBUG_NONE
+#include "net/uip-debug.h"
+
+#if DB_BPLUSTREE_CACHE_LIMIT < 2
+#error "DB_BPLUSTREE_CACHE_LIMIT must be at least 2."
+#endif
+
+#define MAX_HEIGHT	12
+
+typedef uint16_t page_id_t;
+
+struct entry {
+  long key;
+  tuple_id_t value;
+};
+
+struct node {
+  uint8_t leaf;
+  uint8_t count;
+  page_id_t next;
+  struct entry entries[(DB_BPLUSTREE_PAGE_SIZE - 4) / sizeof(struct entry)];
+};
+
+#define NODE_CAPACITY (sizeof(((struct node *)0)->entries) / \
+                       sizeof(struct entry))
+
+/* The padding of the entries may make a node larger than a page. */
+CTASSERT(sizeof(struct node) <= DB_BPLUSTREE_PAGE_SIZE);
+
+struct header {
+  page_id_t root;
+  page_id_t page_count;
+  uint8_t height;
+};
+
+struct tree {
+  db_storage_id_t fd;
+  page_id_t max_pages;
+  struct header header;
+};
+typedef struct tree tree_t;
+
+struct page_cache {
+  tree_t *tree;
+  page_id_t page_id;
+  uint8_t dirty;
+  uint16_t last_used;
+  struct node node;
+};
+
+static struct page_cache page_cache[DB_BPLUSTREE_CACHE_LIMIT];
+static uint16_t cache_clock;
+MEMB(trees, tree_t, DB_BPLUSTREE_INDEX_LIMIT);
+
+static db_result_t create(index_t *);
+static db_result_t destroy(index_t *);
+static db_result_t load(index_t *);
+static db_result_t release(index_t *);
+static db_result_t insert(index_t *, attribute_value_t *, tuple_id_t);
+static db_result_t delete(index_t *, attribute_value_t *);
+static tuple_id_t get_next(index_iterator_t *);
+
+index_api_t index_bplustree = {
+  INDEX_BPLUSTREE,
+  INDEX_API_EXTERNAL | INDEX_API_RANGE_QUERIES,
+  create,
+  destroy,
+  load,
+  release,
+  insert,
+  delete,
+  get_next
+};
+
+static int
+write_page(struct page_cache *cache)
+{
+  if(DB_ERROR(storage_write(cache->tree->fd, &cache->node,
+                            (unsigned long)cache->page_id *
+                            DB_BPLUSTREE_PAGE_SIZE,
+                            sizeof(cache->node)))) {
+    PRINTF("DB: Failed to write B+-tree page %u\n", (unsigned)cache->page_id);
+    return 0;
+  }
+
+  cache->dirty = 0;
+  return 1;
+}
+
+static int
+write_header(tree_t *tree)
+{
+  return !DB_ERROR(storage_write(tree->fd, &tree->header, 0,
+                                 sizeof(tree->header)));
+}
+
+/* Write back the dirty pages of a tree, and optionally drop all of
+   its pages from the cache. */
+static int
+flush_cache(tree_t *tree, int invalidate)
+{
+  int i;
+  int result;
+
+  result = 1;
+  for(i = 0; i < DB_BPLUSTREE_CACHE_LIMIT; i++) {
+    if(page_cache[i].tree == tree) {
+      if(page_cache[i].dirty && write_page(&page_cache[i]) == 0) {
+        result = 0;
+      }
+      if(invalidate) {
+        page_cache[i].tree = NULL;
+      }
+    }
+  }
+
+  return result;
+}
+
+/*
+ * Get a page through the cache. The least recently used page is
+ * replaced on a miss, so the page returned by the previous call stays
+ * in the cache. A new page is not read from storage, but cleared.
+ */
+static struct node *
+get_page(tree_t *tree, page_id_t page_id, int new_page)
+{
+  struct page_cache *cache;
+  struct page_cache *victim;
+  int i;
+
+  victim = NULL;
+  for(i = 0; i < DB_BPLUSTREE_CACHE_LIMIT; i++) {
+    cache = &page_cache[i];
+    if(cache->tree == tree && cache->page_id == page_id) {
+      cache->last_used = ++cache_clock;
+      return &cache->node;
+    }
+    if(victim == NULL ||
+       (victim->tree != NULL &&
+        (cache->tree == NULL ||
+         (uint16_t)(cache_clock - cache->last_used) >
+         (uint16_t)(cache_clock - victim->last_used)))) {
+      victim = cache;
+    }
+  }
+
+  if(victim->tree != NULL && victim->dirty && write_page(victim) == 0) {
+    return NULL;
+  }
+
+  victim->tree = NULL;
+  if(new_page) {
+    memset(&victim->node, 0, sizeof(victim->node));
+  } else if(DB_ERROR(storage_read(tree->fd, &victim->node,
+                                  (unsigned long)page_id *
+                                  DB_BPLUSTREE_PAGE_SIZE,
+                                  sizeof(victim->node)))) {
+    PRINTF("DB: Failed to read B+-tree page %u\n", (unsigned)page_id);
+    return NULL;
+  }
+
+  victim->tree = tree;
+  victim->page_id = page_id;
+  victim->dirty = new_page;
+  victim->last_used = ++cache_clock;
+
+  return &victim->node;
+}
+
+static void
+set_dirty(struct node *node)
+{
+  int i;
+
+  for(i = 0; i < DB_BPLUSTREE_CACHE_LIMIT; i++) {
+    if(&page_cache[i].node == node) {
+      page_cache[i].dirty = 1;
+      return;
+    }
+  }
+}
+
+static page_id_t
+allocate_page(tree_t *tree)
+{
+  return tree->header.page_count++;
+}
+
+/*
+ * Find the child to descend to in an inner node. Insertions go to the
+ * last child whose key is not larger than the key, so that duplicates
+ * are appended. Searches go to the last child whose key is smaller than
+ * the key, and then scan the leaves forward, because duplicates of the
+ * key may end a leaf that precedes the leaf holding the separator.
+ */
+static int
+find_child(struct node *node, long key, int search)
+{
+  int low;
+  int high;
+  int center;
+
+  /* Binary search for the first entry whose key is larger
+     (or not smaller, in a search) than the key. */
+  low = 0;
+  high = node->count;
+  while(low < high) {
+    center = (low + high) / 2;
+    if(node->entries[center].key < key ||
+       (!search && node->entries[center].key == key)) {
+      low = center + 1;
+    } else {
+      high = center;
+    }
+  }
+
+  return low > 0 ? low - 1 : 0;
+}
+
+static page_id_t
+find_leaf(tree_t *tree, long key)
+{
+  struct node *node;
+  page_id_t page_id;
+
+  page_id = tree->header.root;
+  for(;;) {
+    node = get_page(tree, page_id, 0);
+    if(node == NULL) {
+      return 0;
+    }
+    if(node->leaf) {
+      return page_id;
+    }
+    page_id = node->entries[find_child(node, key, 1)].value;
+  }
+}
+
+static void
+insert_entry(struct node *node, int position, struct entry *entry)
+{
+  memmove(&node->entries[position + 1], &node->entries[position],
+          (node->count - position) * sizeof(struct entry));
+  node->entries[position] = *entry;
+  node->count++;
+}
+
+/*
+ * Split a full node and insert an entry at the given position. The
+ * entry is replaced with the entry to insert into the parent node.
+ */
+static int
+split_node(tree_t *tree, page_id_t page_id, int position, struct entry *entry)
+{
+  struct node *node;
+  struct node *right;
+  page_id_t right_id;
+  int half;
+
+  right_id = allocate_page(tree);
+  node = get_page(tree, page_id, 0);
+  right = node == NULL ? NULL : get_page(tree, right_id, 1);
+  if(right == NULL) {
+    return 0;
+  }
+
+  if(node->leaf && node->next == 0 && position == node->count) {
+    half = node->count;
+  } else {
+    half = node->count / 2;
+  }
+
+  right->leaf = node->leaf;
+  right->count = node->count - half;
+  memcpy(right->entries, &node->entries[half],
+         right->count * sizeof(struct entry));
+  node->count = half;
+
+  if(node->leaf) {
+    right->next = node->next;
+    node->next = right_id;
+  }
+
+  if(position <= half && half < NODE_CAPACITY) {
+    insert_entry(node, position, entry);
+  } else {
+    insert_entry(right, position - half, entry);
+  }
+  set_dirty(node);
+
+  entry->key = right->entries[0].key;
+  entry->value = right_id;
+
+  return 1;
+}
+
+static int
+insert_item(tree_t *tree, long key, tuple_id_t value)
+{
+  page_id_t path[MAX_HEIGHT];
+  int positions[MAX_HEIGHT];
+  struct entry entry;
+  struct node *node;
+  page_id_t page_id;
+  page_id_t root_id;
+  int depth;
+  int position;
+
+  /* Refuse an insertion that may fail halfway through splitting nodes. */
+  if(tree->header.page_count + tree->header.height + 1 > tree->max_pages) {
+    PRINTF("DB: The B+-tree file is full\n");
+    return 0;
+  }
+
+  /* Descend to the leaf, and remember the path back to the root. */
+  page_id = tree->header.root;
+  for(depth = 0;; depth++) {
+    node = get_page(tree, page_id, 0);
+    if(node == NULL) {
+      return 0;
+    }
+    if(depth == 0 && tree->header.height >= MAX_HEIGHT &&
+       node->count == NODE_CAPACITY) {
+      PRINTF("DB: The B+-tree has reached its maximum height\n");
+      return 0;
+    }
+    if(node->leaf) {
+      break;
+    }
+    path[depth] = page_id;
+    positions[depth] = find_child(node, key, 0);
+    page_id = node->entries[positions[depth]].value;
+  }
+
+  /* Insert after any duplicates of the key in the leaf. */
+  for(position = node->count;
+      position > 0 && node->entries[position - 1].key > key;
+      position--);
+
+  entry.key = key;
+  entry.value = value;
+
+  for(;;) {
+    if(node->count < NODE_CAPACITY) {
+      insert_entry(node, position, &entry);
+      set_dirty(node);
+      return 1;
+    }
+
+    if(split_node(tree, page_id, position, &entry) == 0) {
+      return 0;
+    }
+
+    if(depth == 0) {
+      break;
+    }
+
+    /* Insert the new node after its sibling in the parent node. */
+    depth--;
+    page_id = path[depth];
+    position = positions[depth] + 1;
+    node = get_page(tree, page_id, 0);
+    if(node == NULL) {
+      return 0;
+    }
+  }
+
+  /* The root was split, so the tree grows by one level. */
+  root_id = allocate_page(tree);
+  node = get_page(tree, root_id, 1);
+  if(node == NULL) {
+    return 0;
+  }
+  node->count = 2;
+  node->entries[0].key = LONG_MIN;
+  node->entries[0].value = tree->header.root;
+  node->entries[1] = entry;
+
+  tree->header.root = root_id;
+  tree->header.height++;
+
+  return 1;
+}
+
+static db_result_t
+open_tree(index_t *index, int flags)
+{
+  tree_t *tree;
+
+  index->opaque_data = tree = memb_alloc(&trees);
+  if(tree == NULL) {
+    PRINTF("DB: Failed to allocate a B+-tree\n");
+    return DB_ALLOCATION_ERROR;
+  }
+
+  /*
+   * Nodes are rewritten in place, so the file is opened without the
+   * flash-aware I/O semantics that storage_open() sets for files that
+   * are only appended to.
+   */
+  tree->fd = cfs_open(index->descriptor_file, flags);
+  if(tree->fd < 0) {
+    memb_free(&trees, tree);
+    return DB_STORAGE_ERROR;
+  }
+
+  if(DB_BPLUSTREE_FILE_SIZE / DB_BPLUSTREE_PAGE_SIZE > 0xffff) {
+    tree->max_pages = 0xffff;
+  } else {
+    tree->max_pages = DB_BPLUSTREE_FILE_SIZE / DB_BPLUSTREE_PAGE_SIZE;
+  }
+
+  return DB_OK;
+}
+
+static db_result_t
+create(index_t *index)
+{
+  char *filename;
+  tree_t *tree;
+  struct node *node;
+
+  filename = storage_generate_file("bptree", DB_BPLUSTREE_FILE_SIZE);
+  if(filename == NULL) {
+    PRINTF("DB: Failed to generate a B+-tree file\n");
+    return DB_INDEX_ERROR;
+  }
+  memcpy(index->descriptor_file, filename, sizeof(index->descriptor_file));
+
+  if(DB_ERROR(open_tree(index, CFS_READ | CFS_WRITE))) {
+    storage_remove(index->descriptor_file);
+    index->descriptor_file[0] = '\0';
+    return DB_INDEX_ERROR;
+  }
+
+  /* The tree starts as an empty leaf in page 1. */
+  tree = index->opaque_data;
+  tree->header.root = 1;
+  tree->header.page_count = 2;
+  tree->header.height = 1;
+
+  node = get_page(tree, 1, 1);
+  if(node != NULL) {
+    node->leaf = 1;
+  }
+  if(node == NULL || write_header(tree) == 0 || flush_cache(tree, 0) == 0) {
+    release(index);
+    storage_remove(index->descriptor_file);
+    index->descriptor_file[0] = '\0';
+    return DB_STORAGE_ERROR;
+  }
+
+  PRINTF("DB: Created a B+-tree index in \"%s\" with %u entries per page\n",
+         index->descriptor_file, (unsigned)NODE_CAPACITY);
+
+  return DB_OK;
+}
+
+static db_result_t
+destroy(index_t *index)
+{
+  release(index);
+  storage_remove(index->descriptor_file);
+  return DB_OK;
+}
+
+static db_result_t
+load(index_t *index)
+{
+  tree_t *tree;
+
+  /* Without CFS_APPEND, some file systems truncate the file. */
+  if(DB_ERROR(open_tree(index, CFS_READ | CFS_WRITE | CFS_APPEND))) {
+    return DB_STORAGE_ERROR;
+  }
+
+  tree = index->opaque_data;
+  if(DB_ERROR(storage_read(tree->fd, &tree->header, 0,
+                           sizeof(tree->header)))) {
+    storage_close(tree->fd);
+    memb_free(&trees, tree);
+    return DB_STORAGE_ERROR;
+  }
+
+  PRINTF("DB: Loaded a B+-tree index from file %s (%u pages, height %u)\n",
+         index->descriptor_file, (unsigned)tree->header.page_count,
+         (unsigned)tree->header.height);
+
+  return DB_OK;
+}
+
+static db_result_t
+release(index_t *index)
+{
+  tree_t *tree;
+  db_result_t result;
+
+  tree = index->opaque_data;
+
+  result = DB_OK;
+  if(flush_cache(tree, 1) == 0 || write_header(tree) == 0) {
+    result = DB_STORAGE_ERROR;
+  }
+  storage_close(tree->fd);
+  memb_free(&trees, tree);
+  return result;
+}
+
+static db_result_t
+insert(index_t *index, attribute_value_t *key, tuple_id_t value)
+{
+  tree_t *tree;
+  page_id_t page_count;
+  long long_key;
+
+  tree = index->opaque_data;
+  long_key = db_value_to_long(key);
+
+  page_count = tree->header.page_count;
+  if(insert_item(tree, long_key, value) == 0) {
+    PRINTF("DB: Failed to insert key %ld into a B+-tree index\n", long_key);
+    return DB_INDEX_ERROR;
+  }
+
+  /* Record the pages allocated by node splits at once, so that they
+     are not handed out again if the tree is not released properly. */
+  if(tree->header.page_count != page_count && write_header(tree) == 0) {
+    return DB_STORAGE_ERROR;
+  }
+  return DB_OK;
+}
+
+/*
+ * Remove all entries with a key from the leaves. Nodes are not merged
+ * when they become empty; searches pass through empty leaves, and the
+ * keys of the inner nodes remain valid lower bounds.
+ */
+static db_result_t
+delete(index_t *index, attribute_value_t *value)
+{
+  tree_t *tree;
+  struct node *node;
+  page_id_t page_id;
+  long key;
+  int i, j;
+
+  tree = index->opaque_data;
+  key = db_value_to_long(value);
+
+  for(page_id = find_leaf(tree, key); page_id != 0; page_id = node->next) {
+    node = get_page(tree, page_id, 0);
+    if(node == NULL) {
+      return DB_STORAGE_ERROR;
+    }
+
+    for(i = j = 0; i < node->count; i++) {
+      if(node->entries[i].key != key) {
+        node->entries[j++] = node->entries[i];
+      }
+    }
+    if(j != node->count) {
+      node->count = j;
+      set_dirty(node);
+    }
+
+    if(node->count > 0 && node->entries[node->count - 1].key > key) {
+      break;
+    }
+  }
+
+  return DB_OK;
+}
+
+static tuple_id_t
+get_next(index_iterator_t *iterator)
+{
+  static struct {
+    index_iterator_t *index_iterator;
+    page_id_t page_id;
+    uint8_t slot;
+    tuple_id_t found_items;
+  } cache;
+  tree_t *tree;
+  struct node *node;
+  long min;
+  long max;
+  long key;
+
+  tree = (tree_t *)iterator->index->opaque_data;
+  min = db_value_to_long(&iterator->min_value);
+  max = db_value_to_long(&iterator->max_value);
+
+  if(cache.index_iterator != iterator || iterator->next_item_no == 0) {
+    /* Start a new search from the first leaf that may hold the
+       minimum key. Items that were already returned by an iterator
+       that is resumed are skipped. */
+    cache.index_iterator = iterator;
+    cache.page_id = find_leaf(tree, min);
+    cache.slot = 0;
+    cache.found_items = 0;
+  }
+
+  while(cache.page_id != 0) {
+    node = get_page(tree, cache.page_id, 0);
+    if(node == NULL) {
+      break;
+    }
+
+    for(; cache.slot < node->count; cache.slot++) {
+      key = node->entries[cache.slot].key;
+      if(key < min) {
+        continue;
+      } else if(key > max) {
+        cache.page_id = 0;
+        return INVALID_TUPLE;
+      }
+
+      if(cache.found_items++ == iterator->next_item_no) {
+        iterator->next_item_no++;
+        cache.slot++;
+        return node->entries[cache.slot - 1].value;
+      }
+    }
+
+    cache.page_id = node->next;
+    cache.slot = 0;
+  }
+
+  return INVALID_TUPLE;
+}
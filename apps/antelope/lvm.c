@@ -87,6 +87,53 @@ static variable_t variables[LVM_MAX_VARIABLE_ID - 1];
 /* Range derivations of variables that are used for index searches. */
 static derivation_t derivations[LVM_MAX_VARIABLE_ID - 1];
 
+#if LVM_COMPILE
+/*
+ * A compiled program is a sequence of instructions in postfix order,
+ * evaluated on a stack of long values. Operands are decoded once, and
+ * comparisons between a variable and a constant are fused into a
+ * single instruction.
+ */
+enum opcode {
+  OP_CONSTANT,
+  OP_VARIABLE,
+  OP_ADD,
+  OP_SUB,
+  OP_MUL,
+  OP_DIV,
+  OP_EQ,
+  OP_NEQ,
+  OP_GE,
+  OP_GEQ,
+  OP_LE,
+  OP_LEQ,
+  OP_VARIABLE_EQ,
+  OP_VARIABLE_NEQ,
+  OP_VARIABLE_GE,
+  OP_VARIABLE_GEQ,
+  OP_VARIABLE_LE,
+  OP_VARIABLE_LEQ,
+  OP_AND,
+  OP_OR,
+  OP_NOT
+};
+
+struct instruction {
+  uint8_t opcode;
+  long *variable;
+  long value;
+};
+
+/* Each instruction is translated from at least a node type and an
+   operator in the bytecode. */
+#define PROGRAM_SIZE	(DB_VM_BYTECODE_SIZE / \
+                         (sizeof(node_type_t) + sizeof(operator_t)))
+
+static struct instruction program[PROGRAM_SIZE];
+static unsigned program_length;
+static lvm_instance_t *program_instance;
+#endif /* LVM_COMPILE */
+
 #if DEBUG
 static void
 print_derivations(derivation_t *d)
@@ -309,6 +356,10 @@ lvm_reset(lvm_instance_t *p, unsigned char *code, lvm_ip_t size)
 
   memset(variables, 0, sizeof(variables));
   memset(derivations, 0, sizeof(derivations));
+
+#if LVM_COMPILE
+  program_instance = NULL;
+#endif /* LVM_COMPILE */
 }
 
 lvm_ip_t
@@ -376,6 +427,228 @@ lvm_set_type(lvm_instance_t *p, node_type_t type)
   p->end += sizeof(type);
 }
 
+#if LVM_COMPILE
+static lvm_status_t
+emit(uint8_t opcode, long *variable, long value)
+{
+  if(program_length == PROGRAM_SIZE) {
+    return STACK_OVERFLOW;
+  }
+
+  program[program_length].opcode = opcode;
+  program[program_length].variable = variable;
+  program[program_length].value = value;
+  program_length++;
+
+  return TRUE;
+}
+
+static lvm_status_t
+compile_expr(lvm_instance_t *p)
+{
+  operator_t operator;
+  operand_t operand;
+  lvm_status_t r;
+  int i;
+
+  switch(get_type(p)) {
+  case LVM_ARITH_OP:
+    operator = *get_operator(p);
+    if(operator < LVM_ADD || operator > LVM_DIV) {
+      return EXECUTION_ERROR;
+    }
+    for(i = 0; i < 2; i++) {
+      r = compile_expr(p);
+      if(LVM_ERROR(r)) {
+        return r;
+      }
+    }
+    return emit(OP_ADD + (operator - LVM_ADD), NULL, 0);
+  case LVM_OPERAND:
+    get_operand(p, &operand);
+    if(operand.type == LVM_VARIABLE) {
+      if(operand.value.id >= LVM_MAX_VARIABLE_ID - 1) {
+        return INVALID_IDENTIFIER;
+      }
+      return emit(OP_VARIABLE, &variables[operand.value.id].value.l, 0);
+    }
+    return emit(OP_CONSTANT, NULL, operand_to_long(&operand));
+  default:
+    return SEMANTIC_ERROR;
+  }
+}
+
+static lvm_status_t
+compile_logic(lvm_instance_t *p, operator_t operator)
+{
+  struct instruction *left;
+  lvm_status_t r;
+  unsigned arguments;
+  int i;
+
+  if(IS_CONNECTIVE(operator)) {
+    arguments = operator == LVM_NOT ? 1 : 2;
+    for(i = 0; i < arguments; i++) {
+      if(get_type(p) != LVM_CMP_OP) {
+        return SEMANTIC_ERROR;
+      }
+      r = compile_logic(p, *get_operator(p));
+      if(LVM_ERROR(r)) {
+        return r;
+      }
+    }
+
+    if(operator == LVM_NOT) {
+      return emit(OP_NOT, NULL, 0);
+    }
+    return emit(operator == LVM_AND ? OP_AND : OP_OR, NULL, 0);
+  }
+
+  if(operator < LVM_EQ || operator > LVM_LEQ) {
+    return EXECUTION_ERROR;
+  }
+
+  for(i = 0; i < 2; i++) {
+    r = compile_expr(p);
+    if(LVM_ERROR(r)) {
+      return r;
+    }
+  }
+
+  left = &program[program_length - 2];
+  if(left[0].opcode == OP_VARIABLE && left[1].opcode == OP_CONSTANT) {
+    left[0].opcode = OP_VARIABLE_EQ + (operator - LVM_EQ);
+    left[0].value = left[1].value;
+    program_length--;
+    return TRUE;
+  }
+
+  return emit(OP_EQ + (operator - LVM_EQ), NULL, 0);
+}
+
+lvm_status_t
+lvm_compile(lvm_instance_t *p)
+{
+  lvm_status_t r;
+
+  program_instance = NULL;
+  program_length = 0;
+
+  p->ip = 0;
+  if(get_type(p) != LVM_CMP_OP) {
+    return SEMANTIC_ERROR;
+  }
+
+  r = compile_logic(p, *get_operator(p));
+  if(LVM_ERROR(r)) {
+    PRINTF("Compilation error: %d\n", (int)r);
+    return r;
+  }
+
+  PRINTF("Compiled the code into %u instructions\n", program_length);
+  program_instance = p;
+  return TRUE;
+}
+
+static lvm_status_t
+execute_program(void)
+{
+  long stack[PROGRAM_SIZE];
+  long *sp;
+  struct instruction *insn;
+  struct instruction *end;
+
+  sp = stack;
+  end = &program[program_length];
+  for(insn = program; insn < end; insn++) {
+    switch(insn->opcode) {
+    case OP_CONSTANT:
+      *sp++ = insn->value;
+      break;
+    case OP_VARIABLE:
+      *sp++ = *insn->variable;
+      break;
+    case OP_ADD:
+      sp--;
+      sp[-1] += sp[0];
+      break;
+    case OP_SUB:
+      sp--;
+      sp[-1] -= sp[0];
+      break;
+    case OP_MUL:
+      sp--;
+      sp[-1] *= sp[0];
+      break;
+    case OP_DIV:
+      sp--;
+      if(sp[0] == 0) {
+        return MATH_ERROR;
+      }
+      sp[-1] /= sp[0];
+      break;
+    case OP_EQ:
+      sp--;
+      sp[-1] = sp[-1] == sp[0];
+      break;
+    case OP_NEQ:
+      sp--;
+      sp[-1] = sp[-1] != sp[0];
+      break;
+    case OP_GE:
+      sp--;
+      sp[-1] = sp[-1] > sp[0];
+      break;
+    case OP_GEQ:
+      sp--;
+      sp[-1] = sp[-1] >= sp[0];
+      break;
+    case OP_LE:
+      sp--;
+      sp[-1] = sp[-1] < sp[0];
+      break;
+    case OP_LEQ:
+      sp--;
+      sp[-1] = sp[-1] <= sp[0];
+      break;
+    case OP_VARIABLE_EQ:
+      *sp++ = *insn->variable == insn->value;
+      break;
+    case OP_VARIABLE_NEQ:
+      *sp++ = *insn->variable != insn->value;
+      break;
+    case OP_VARIABLE_GE:
+      *sp++ = *insn->variable > insn->value;
+      break;
+    case OP_VARIABLE_GEQ:
+      *sp++ = *insn->variable >= insn->value;
+      break;
+    case OP_VARIABLE_LE:
+      *sp++ = *insn->variable < insn->value;
+      break;
+    case OP_VARIABLE_LEQ:
+      *sp++ = *insn->variable <= insn->value;
+      break;
+    case OP_AND:
+      sp--;
+      sp[-1] = sp[-1] && sp[0];
+      break;
+    case OP_OR:
+      sp--;
+      sp[-1] = sp[-1] || sp[0];
+      break;
+    case OP_NOT:
+      sp[-1] = !sp[-1];
+      break;
+    default:
+      return EXECUTION_ERROR;
+    }
+  }
+
+  return stack[0] ? TRUE : FALSE;
+}
+#endif /* LVM_COMPILE */
+
 lvm_status_t
 lvm_execute(lvm_instance_t *p)
 {
@@ -383,6 +656,12 @@ lvm_execute(lvm_instance_t *p)
   operator_t *operator;
   lvm_status_t status;
 
+#if LVM_COMPILE
+  if(p == program_instance) {
+    return execute_program();
+  }
+#endif /* LVM_COMPILE */
+
   p->ip = 0;
   status = EXECUTION_ERROR;
   type = get_type(p);
@@ -472,6 +751,18 @@ lvm_set_variable_value(char *name, operand_value_t value)
   return TRUE;
 }
 
+operand_value_t *
+lvm_get_variable_value(char *name)
+{
+  variable_id_t id;
+
+  id = lookup(name);
+  if(id == LVM_MAX_VARIABLE_ID) {
+    return NULL;
+  }
+  return &variables[id].value;
+}
+
 void
 lvm_set_variable(lvm_instance_t *p, char *name)
 {
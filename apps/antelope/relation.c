@@ -62,12 +62,42 @@
 struct source_dest_map {
   attribute_t *from_attr;
   attribute_t *to_attr;
+  operand_value_t *variable;
   unsigned from_offset;
   unsigned to_offset;
 };
 
 static struct source_dest_map attr_map[AQL_ATTRIBUTE_LIMIT];
 
+/* The number of rows that have been aggregated in a selection. */
+static tuple_id_t aggregation_count;
+
+#if DB_GROUP_LIMIT > 0
+/*
+ * The group structure holds the aggregation values of one group
+ * in a selection with a GROUP BY clause. The values are indexed in
+ * the same order as the attribute map.
+ */
+struct group {
+  long key;
+  tuple_id_t count;
+  long values[AQL_ATTRIBUTE_LIMIT];
+  uint8_t used;
+};
+
+/* An open addressing hash table of the groups being aggregated. */
+static struct group groups[DB_GROUP_LIMIT];
+
+static struct {
+  struct source_dest_map *map;
+  long threshold;
+  uint16_t count;
+  uint8_t has_threshold;
+  uint8_t overflow;
+  uint8_t emitting;
+} group_state;
+#endif /* DB_GROUP_LIMIT > 0 */
+
 #if DB_FEATURE_JOIN
 /*
  * The source_map structure is used for mapping attributes to
@@ -79,6 +109,64 @@ struct source_map {
 };
 
 static struct source_map source_map[AQL_ATTRIBUTE_LIMIT];
+
+typedef enum {
+  JOIN_INDEX = 0,
+  JOIN_MERGE = 1,
+  JOIN_HASH = 2
+} join_method_t;
+
+#if DB_JOIN_HASH_SIZE > 0
+/* A join key and the ID of the tuple that it belongs to. Spilled
+   partitions of the hash join are stored as arrays of this structure. */
+struct join_entry {
+  long key;
+  tuple_id_t tuple_id;
+};
+
+struct join_partition {
+  tuple_id_t start;
+  tuple_id_t count;
+};
+#endif /* DB_JOIN_HASH_SIZE > 0 */
+
+/* The state of the join being processed, apart from the state
+   of the index nested-loop join, which is kept in the handle. */
+static struct {
+  join_method_t method;
+  long key;
+  tuple_id_t left_id;
+  tuple_id_t right_id;
+  tuple_id_t mark;
+#if DB_JOIN_HASH_SIZE > 0
+  relation_t *build_rel;
+  relation_t *probe_rel;
+  attribute_t *build_attr;
+  attribute_t *probe_attr;
+  unsigned char *build_row;
+  unsigned char *probe_row;
+  struct join_partition build_part[DB_JOIN_PARTITIONS];
+  struct join_partition probe_part[DB_JOIN_PARTITIONS];
+  tuple_id_t build_next;
+  tuple_id_t probe_next;
+  tuple_id_t probe_id;
+  db_storage_id_t build_fd;
+  db_storage_id_t probe_fd;
+  char build_file[DB_MAX_FILENAME_LENGTH];
+  char probe_file[DB_MAX_FILENAME_LENGTH];
+  uint16_t match;
+  uint8_t partitions;
+  uint8_t partition;
+  uint8_t probing;
+  uint8_t probe_loaded;
+#endif /* DB_JOIN_HASH_SIZE > 0 */
+} join_state;
+
+#if DB_JOIN_HASH_SIZE > 0
+static struct join_entry join_table[DB_JOIN_HASH_SIZE];
+static uint16_t join_chain[DB_JOIN_HASH_SIZE];
+static uint16_t join_buckets[DB_JOIN_HASH_SIZE];
+#endif /* DB_JOIN_HASH_SIZE > 0 */
 #endif /* DB_FEATURE_JOIN */
 
 static unsigned char row[DB_MAX_ATTRIBUTES_PER_RELATION * DB_MAX_ELEMENT_SIZE];
@@ -266,7 +354,9 @@ relation_release(relation_t *rel)
   }
 
   if(rel->references == 0) {
-    storage_unload(rel);
+    /* If the buffered rows cannot be written, the relation stays loaded
+       with them, and the next release tries again. */
+    return storage_unload(rel);
   }
 
   return DB_OK;
@@ -547,8 +637,36 @@ relation_insert(relation_t *rel, attribute_value_t *values)
   return storage_put_row(rel, record);
 }
 
+static long
+initial_aggregation_value(uint8_t aggregator)
+{
+  switch(aggregator) {
+  case AQL_MAX:
+    return LONG_MIN;
+  case AQL_MIN:
+    return LONG_MAX;
+  default:
+    return 0;
+  }
+}
+
+static long
+final_aggregation_value(uint8_t aggregator, long aggregation_value,
+                        tuple_id_t count)
+{
+  switch(aggregator) {
+  case AQL_COUNT:
+    return (long)count;
+  case AQL_MEAN:
+    return count == 0 ? 0 : aggregation_value / (long)count;
+  default:
+    return aggregation_value;
+  }
+}
+
 static void
-aggregate(attribute_t *attr, attribute_value_t *value)
+aggregate(uint8_t aggregator, long *aggregation_value,
+          attribute_value_t *value)
 {
   long long_value;
 
@@ -563,25 +681,25 @@ aggregate(attribute_t *attr, attribute_value_t *value)
     return;
   }
 
-  switch(attr->aggregator) {
+  switch(aggregator) {
   case AQL_COUNT:
-    attr->aggregation_value++;
+    (*aggregation_value)++;
     break;
   case AQL_SUM:
-    attr->aggregation_value += long_value;
-    break;
   case AQL_MEAN:
+    /* The mean is calculated from the sum when the aggregation ends. */
+    *aggregation_value += long_value;
     break;
   case AQL_MEDIAN:
     break;
   case AQL_MAX:
-    if(long_value > attr->aggregation_value) {
-      attr->aggregation_value = long_value;
+    if(long_value > *aggregation_value) {
+      *aggregation_value = long_value;
     }
     break;
   case AQL_MIN:
-    if(long_value < attr->aggregation_value) {
-      attr->aggregation_value = long_value;
+    if(long_value < *aggregation_value) {
+      *aggregation_value = long_value;
     }
     break;
   default:
@@ -589,6 +707,221 @@ aggregate(attribute_t *attr, attribute_value_t *value)
   }
 }
 
+static db_result_t
+store_long(unsigned char *ptr, attribute_t *attr, long long_value)
+{
+  attribute_value_t value;
+
+  value.domain = attr->domain;
+  if(attr->domain == DOMAIN_LONG) {
+    VALUE_LONG(&value) = long_value;
+  } else {
+    VALUE_INT(&value) = (int)long_value;
+  }
+
+  return db_value_to_phy(ptr, attr, &value);
+}
+
+#if DB_GROUP_LIMIT > 0
+static unsigned
+group_slot(long key)
+{
+  return ((unsigned long)key * 2654435761UL) % DB_GROUP_LIMIT;
+}
+
+static void
+init_groups(void)
+{
+  struct source_dest_map *attr_map_ptr;
+
+  memset(groups, 0, sizeof(groups));
+  memset(&group_state, 0, sizeof(group_state));
+
+  for(attr_map_ptr = attr_map;
+      attr_map_ptr < attr_map + AQL_ATTRIBUTE_LIMIT;
+      attr_map_ptr++) {
+    if(attr_map_ptr->to_attr != NULL &&
+       attr_map_ptr->to_attr->flags & ATTRIBUTE_FLAG_GROUP) {
+      group_state.map = attr_map_ptr;
+      break;
+    }
+  }
+}
+
+static void
+remove_group(struct group *group)
+{
+  unsigned hole, i, home;
+
+  group->used = 0;
+  group_state.count--;
+
+  /* Shift the following groups in the probe sequence backwards,
+     so that no tombstones are needed. */
+  hole = group - groups;
+  for(i = (hole + 1) % DB_GROUP_LIMIT;
+      groups[i].used;
+      i = (i + 1) % DB_GROUP_LIMIT) {
+    home = group_slot(groups[i].key);
+    if((i > hole && (home <= hole || home > i)) ||
+       (i < hole && home <= hole && home > i)) {
+      groups[hole] = groups[i];
+      groups[i].used = 0;
+      hole = i;
+    }
+  }
+}
+
+static struct group *
+get_group(long key, struct source_dest_map *attr_map_end)
+{
+  struct group *group;
+  struct source_dest_map *attr_map_ptr;
+  unsigned i, probes;
+
+  i = group_slot(key);
+  for(probes = 0; probes < DB_GROUP_LIMIT && groups[i].used; probes++) {
+    if(groups[i].key == key) {
+      return &groups[i];
+    }
+    i = (i + 1) % DB_GROUP_LIMIT;
+  }
+
+  if(group_state.has_threshold && key <= group_state.threshold) {
+    /* The group was emitted in an earlier pass. */
+    return NULL;
+  }
+
+  if(group_state.count == DB_GROUP_LIMIT) {
+    /* Keep the groups with the smallest keys. The others are
+       aggregated in another pass over the relation. */
+    group_state.overflow = 1;
+    group = &groups[0];
+    for(i = 1; i < DB_GROUP_LIMIT; i++) {
+      if(groups[i].key > group->key) {
+        group = &groups[i];
+      }
+    }
+    if(key > group->key) {
+      return NULL;
+    }
+    remove_group(group);
+
+    for(i = group_slot(key); groups[i].used; i = (i + 1) % DB_GROUP_LIMIT);
+  }
+
+  group = &groups[i];
+  group->used = 1;
+  group->key = key;
+  group->count = 0;
+  for(attr_map_ptr = attr_map; attr_map_ptr < attr_map_end; attr_map_ptr++) {
+    group->values[attr_map_ptr - attr_map] =
+      initial_aggregation_value(attr_map_ptr->to_attr->aggregator);
+  }
+  group_state.count++;
+
+  return group;
+}
+
+static db_result_t
+aggregate_group(struct source_dest_map *attr_map_end)
+{
+  struct source_dest_map *attr_map_ptr;
+  struct group *group;
+  attribute_value_t value;
+  db_result_t result;
+
+  result = db_phy_to_value(&value, group_state.map->from_attr,
+                           row + group_state.map->from_offset);
+  if(DB_ERROR(result)) {
+    return result;
+  }
+
+  group = get_group(db_value_to_long(&value), attr_map_end);
+  if(group == NULL) {
+    return DB_OK;
+  }
+
+  group->count++;
+  for(attr_map_ptr = attr_map; attr_map_ptr < attr_map_end; attr_map_ptr++) {
+    if(attr_map_ptr->to_attr->aggregator == AQL_NONE) {
+      continue;
+    }
+    result = db_phy_to_value(&value, attr_map_ptr->from_attr,
+                             row + attr_map_ptr->from_offset);
+    if(DB_ERROR(result)) {
+      return result;
+    }
+    aggregate(attr_map_ptr->to_attr->aggregator,
+              &group->values[attr_map_ptr - attr_map], &value);
+  }
+
+  return DB_OK;
+}
+
+static db_result_t
+emit_group(db_handle_t *handle, struct source_dest_map *attr_map_end)
+{
+  struct group *group;
+  struct source_dest_map *attr_map_ptr;
+  attribute_t *result_attr;
+  long value;
+  unsigned i;
+
+  /* Emit the groups in the order of their keys. */
+  group = NULL;
+  for(i = 0; i < DB_GROUP_LIMIT; i++) {
+    if(groups[i].used && (group == NULL || groups[i].key < group->key)) {
+      group = &groups[i];
+    }
+  }
+
+  if(group == NULL) {
+    if(!group_state.overflow) {
+      return DB_FINISHED;
+    }
+
+    PRINTF("DB: Starting another pass for the groups above %ld\n",
+           group_state.threshold);
+    group_state.overflow = 0;
+    group_state.emitting = 0;
+    handle->tuple_id = 0;
+    handle->index_iterator.next_item_no = 0;
+    return DB_OK;
+  }
+
+  for(attr_map_ptr = attr_map; attr_map_ptr < attr_map_end; attr_map_ptr++) {
+    result_attr = attr_map_ptr->to_attr;
+    if(result_attr->flags & ATTRIBUTE_FLAG_NO_STORE) {
+      continue;
+    }
+
+    if(result_attr->flags & ATTRIBUTE_FLAG_GROUP) {
+      value = group->key;
+    } else {
+      value = final_aggregation_value(result_attr->aggregator,
+                                      group->values[attr_map_ptr - attr_map],
+                                      group->count);
+    }
+    store_long(result_row + attr_map_ptr->to_offset, result_attr, value);
+  }
+
+  group_state.threshold = group->key;
+  group_state.has_threshold = 1;
+  remove_group(group);
+
+  if(AQL_GET_FLAGS((aql_adt_t *)handle->adt) & AQL_FLAG_ASSIGN) {
+    if(DB_ERROR(storage_put_row(handle->result_rel, result_row))) {
+      PRINTF("DB: Failed to store a row in the result relation!\n");
+      return DB_STORAGE_ERROR;
+    }
+  }
+
+  handle->current_row++;
+  return DB_GOT_ROW;
+}
+#endif /* DB_GROUP_LIMIT > 0 */
+
 static db_result_t
 generate_attribute_map(struct source_dest_map *attr_map, unsigned attribute_count,
                        relation_t *from_rel, relation_t *to_rel, 
@@ -619,6 +952,7 @@ generate_attribute_map(struct source_dest_map *attr_map, unsigned attribute_coun
     }
     attr_map_ptr->from_offset = offset;
     attr_map_ptr->to_offset = size_sum;
+    attr_map_ptr->variable = lvm_get_variable_value(to_attr->name);
 
     size_sum += to_attr->element_size;
     attr_map_ptr++;
@@ -696,11 +1030,22 @@ generate_selection_result(db_handle_t *handle, relation_t *rel, aql_adt_t *adt)
     return DB_IMPLEMENTATION_ERROR;
   }
 
+  aggregation_count = 0;
+#if DB_GROUP_LIMIT > 0
+  if(AQL_GET_FLAGS(adt) & AQL_FLAG_GROUP) {
+    init_groups();
+  }
+#endif /* DB_GROUP_LIMIT > 0 */
+
   if(adt->lvm_instance != NULL) {
     /* Try to establish acceptable ranges for the attribute values. */
     if(!LVM_ERROR(lvm_derive(adt->lvm_instance))) {
       select_index(handle, adt->lvm_instance);
     }
+#if LVM_COMPILE
+    /* The interpreter is used if the condition cannot be compiled. */
+    lvm_compile(adt->lvm_instance);
+#endif /* LVM_COMPILE */
   }
 
   handle->flags |= DB_HANDLE_FLAG_PROCESSING;
@@ -741,9 +1086,7 @@ relation_process_select(void *handle_ptr)
   struct source_dest_map *attr_map_ptr, *attr_map_end;
   attribute_t *result_attr;
   unsigned char *from_ptr;
-  unsigned char *to_ptr;
   operand_value_t operand_value;
-  uint8_t intbuf[2];
   attribute_value_t value;
   lvm_status_t wanted_result;
 
@@ -753,6 +1096,12 @@ relation_process_select(void *handle_ptr)
   attribute_count = handle->result_rel->attribute_count;
   attr_map_end = attr_map + attribute_count;
 
+#if DB_GROUP_LIMIT > 0
+  if((AQL_GET_FLAGS(adt) & AQL_FLAG_GROUP) && group_state.emitting) {
+    return emit_group(handle, attr_map_end);
+  }
+#endif /* DB_GROUP_LIMIT > 0 */
+
   if(handle->flags & DB_HANDLE_FLAG_SEARCH_INDEX) {
     handle->tuple_id = index_get_next(&handle->index_iterator);
     if(handle->tuple_id == INVALID_TUPLE) {
@@ -789,15 +1138,17 @@ relation_process_select(void *handle_ptr)
     result_attr = attr_map_ptr->to_attr;
 
     /* Update the internal state of the PLE. */
-    if(result_attr->domain == DOMAIN_INT) {
+    if(attr_map_ptr->variable == NULL) {
+      /* The attribute could not be registered as an LVM variable. */
+    } else if(result_attr->domain == DOMAIN_INT) {
       operand_value.l = from_ptr[0] << 8 | from_ptr[1];
-      lvm_set_variable_value(result_attr->name, operand_value);
+      *attr_map_ptr->variable = operand_value;
     } else if(result_attr->domain == DOMAIN_LONG) {
       operand_value.l = (uint32_t)from_ptr[0] << 24 |
                         (uint32_t)from_ptr[1] << 16 |
                         (uint32_t)from_ptr[2] << 8 |
                         from_ptr[3];
-      lvm_set_variable_value(result_attr->name, operand_value);
+      *attr_map_ptr->variable = operand_value;
     }
 
     if(result_attr->flags & ATTRIBUTE_FLAG_NO_STORE) {
@@ -822,13 +1173,20 @@ relation_process_select(void *handle_ptr)
   if(adt->lvm_instance == NULL ||
      lvm_execute(adt->lvm_instance) == wanted_result) {
     if(AQL_GET_FLAGS(adt) & AQL_FLAG_AGGREGATE) {
+#if DB_GROUP_LIMIT > 0
+      if(AQL_GET_FLAGS(adt) & AQL_FLAG_GROUP) {
+        return aggregate_group(attr_map_end);
+      }
+#endif /* DB_GROUP_LIMIT > 0 */
+      aggregation_count++;
       for(attr_map_ptr = attr_map; attr_map_ptr < attr_map_end; attr_map_ptr++) {
         from_ptr = row + attr_map_ptr->from_offset;
-        result = db_phy_to_value(&value, attr_map_ptr->to_attr, from_ptr);
+        result = db_phy_to_value(&value, attr_map_ptr->from_attr, from_ptr);
         if(DB_ERROR(result)) {
 	  return result;
         }
-        aggregate(attr_map_ptr->to_attr, &value);
+        aggregate(attr_map_ptr->to_attr->aggregator,
+                  &attr_map_ptr->to_attr->aggregation_value, &value);
       }
     } else {
       if(AQL_GET_FLAGS(adt) & AQL_FLAG_ASSIGN) {
@@ -845,15 +1203,25 @@ relation_process_select(void *handle_ptr)
   return DB_OK;
 
 end_aggregation:
+#if DB_GROUP_LIMIT > 0
+  if(AQL_GET_FLAGS(adt) & AQL_FLAG_GROUP) {
+    /* The pass is complete, so the groups can be emitted. */
+    group_state.emitting = 1;
+    return emit_group(handle, attr_map_end);
+  }
+#endif /* DB_GROUP_LIMIT > 0 */
+
   /* Generate aggregated result if requested. */
   for(attr_map_ptr = attr_map; attr_map_ptr < attr_map_end; attr_map_ptr++) {
     result_attr = attr_map_ptr->to_attr;
-    to_ptr = result_row + attr_map_ptr->to_offset;
+    if(result_attr->flags & ATTRIBUTE_FLAG_NO_STORE) {
+      continue;
+    }
 
-    intbuf[0] = result_attr->aggregation_value >> 8;
-    intbuf[1] = result_attr->aggregation_value & 0xff;
-    from_ptr = intbuf;
-    memcpy(to_ptr, from_ptr, result_attr->element_size);
+    store_long(result_row + attr_map_ptr->to_offset, result_attr,
+               final_aggregation_value(result_attr->aggregator,
+                                       result_attr->aggregation_value,
+                                       aggregation_count));
   }
 
   if(AQL_GET_FLAGS(adt) & AQL_FLAG_ASSIGN) {
@@ -887,6 +1255,13 @@ relation_select(void *handle_ptr, relation_t *rel, void *adt_ptr)
   handle->rel = rel;
   handle->adt = adt;
 
+#if DB_GROUP_LIMIT == 0
+  if(AQL_GET_FLAGS(adt) & AQL_FLAG_GROUP) {
+    PRINTF("DB: GROUP BY is not supported\n");
+    return DB_RELATIONAL_ERROR;
+  }
+#endif /* DB_GROUP_LIMIT == 0 */
+
   if(AQL_GET_FLAGS(adt) & AQL_FLAG_ASSIGN) {
     name = adt->relations[0];
     dir = DB_STORAGE;
@@ -916,9 +1291,17 @@ relation_select(void *handle_ptr, relation_t *rel, void *adt_ptr)
     PRINTF("DB: Found attribute %s in relation %s\n",
 	attribute_name, rel->name);
 
+    if((adt->attributes[i].flags & ATTRIBUTE_FLAG_GROUP) &&
+       attr->domain == DOMAIN_STRING) {
+      PRINTF("DB: Cannot group by the string attribute %s\n", attribute_name);
+      relation_release(handle->result_rel);
+      return DB_TYPE_ERROR;
+    }
+
     attr = relation_attribute_add(handle->result_rel, dir,
 				  attribute_name, 
-				  adt->aggregators[i] ? DOMAIN_INT : attr->domain,
+				  adt->aggregators[i] && attr->domain != DOMAIN_LONG ?
+				    DOMAIN_INT : attr->domain,
 				  attr->element_size);
     if(attr == NULL) {
       PRINTF("DB: Failed to add a result attribute\n");
@@ -929,19 +1312,15 @@ relation_select(void *handle_ptr, relation_t *rel, void *adt_ptr)
     attr->aggregator = adt->aggregators[i];
     switch(attr->aggregator) {
     case AQL_NONE:
-      if(!(adt->attributes[i].flags & ATTRIBUTE_FLAG_NO_STORE)) {
-        /* Only count attributes projected into the result set. */
+      if(!(adt->attributes[i].flags &
+           (ATTRIBUTE_FLAG_NO_STORE | ATTRIBUTE_FLAG_GROUP))) {
+        /* Only count attributes projected into the result set.
+           The group attribute may be mixed with aggregated ones. */
         normal_attributes++;
       }
       break;
-    case AQL_MAX:
-      attr->aggregation_value = LONG_MIN;
-      break;
-    case AQL_MIN:
-      attr->aggregation_value = LONG_MAX;
-      break;
     default:
-      attr->aggregation_value = 0;
+      attr->aggregation_value = initial_aggregation_value(attr->aggregator);
       break;
     }
 
@@ -959,24 +1338,63 @@ relation_select(void *handle_ptr, relation_t *rel, void *adt_ptr)
 }
 
 #if DB_FEATURE_JOIN
-db_result_t
-relation_process_join(void *handle_ptr)
+static db_result_t
+get_join_key(relation_t *rel, attribute_t *attr, unsigned char *row, long *key)
+{
+  attribute_value_t value;
+
+  if(DB_ERROR(relation_get_value(rel, attr, row, &value))) {
+    PRINTF("DB: Failed to get a value of the attribute \"%s\" to join on\n",
+	attr->name);
+    return DB_IMPLEMENTATION_ERROR;
+  }
+
+  *key = db_value_to_long(&value);
+  return DB_OK;
+}
+
+static db_result_t
+emit_join_row(db_handle_t *handle)
 {
-  db_handle_t *handle;
-  db_result_t result;
-  relation_t *left_rel;
-  relation_t *right_rel;
   relation_t *join_rel;
   unsigned char *join_next_attribute_ptr;
   size_t element_size;
+  int i;
+
+  join_rel = handle->join_rel;
+
+  /* Use the source attribute map to fill in the physical representation
+     of the resulting tuple. */
+  join_next_attribute_ptr = join_row;
+
+  for(i = 0; i < join_rel->attribute_count; i++) {
+    element_size = source_map[i].attr->element_size;
+
+    memcpy(join_next_attribute_ptr, source_map[i].from_ptr, element_size);
+    join_next_attribute_ptr += element_size;
+  }
+
+  if(((aql_adt_t *)handle->adt)->flags & AQL_FLAG_ASSIGN) {
+    if(DB_ERROR(storage_put_row(join_rel, join_row))) {
+      return DB_STORAGE_ERROR;
+    }
+  }
+
+  handle->current_row++;
+  return DB_GOT_ROW;
+}
+
+static db_result_t
+process_index_join(db_handle_t *handle)
+{
+  db_result_t result;
+  relation_t *left_rel;
+  relation_t *right_rel;
   tuple_id_t right_tuple_id;
   attribute_value_t value;
-  int i;
 
-  handle = (db_handle_t *)handle_ptr;
   left_rel = handle->left_rel;
   right_rel = handle->right_rel;
-  join_rel = handle->join_rel;
 
   if(!(handle->flags & DB_HANDLE_FLAG_INDEX_STEP)) {
     goto inner_loop;
@@ -1030,29 +1448,395 @@ inner_loop:
         return DB_IMPLEMENTATION_ERROR;
       }
 
-      /* Use the source attribute map to fill in the physical representation
-	 of the resulting tuple. */
-      join_next_attribute_ptr = join_row;
+      return emit_join_row(handle);
+    }
+  }
+
+  return DB_OK;
+}
+
+/*
+ * The merge join requires both relations to be sorted on the join
+ * attribute, which holds for attributes with an inline index. The left
+ * relation is the outer one. For each left row, the scan of the right
+ * relation restarts at the mark, which is the first right row whose
+ * value is not smaller than the previous left value.
+ */
+static db_result_t
+process_merge_join(db_handle_t *handle)
+{
+  db_result_t result;
+  long right_key;
+
+  for(;;) {
+    if(handle->flags & DB_HANDLE_FLAG_INDEX_STEP) {
+      result = storage_get_row(handle->left_rel, &join_state.left_id, left_row);
+      if(DB_ERROR(result) || result == DB_FINISHED) {
+        return result;
+      }
+      if(DB_ERROR(get_join_key(handle->left_rel, handle->left_join_attr,
+                               left_row, &join_state.key))) {
+        return DB_IMPLEMENTATION_ERROR;
+      }
+      join_state.right_id = join_state.mark;
+      handle->flags &= ~DB_HANDLE_FLAG_INDEX_STEP;
+    }
+
+    result = storage_get_row(handle->right_rel, &join_state.right_id, right_row);
+    if(DB_ERROR(result)) {
+      return result;
+    }
+
+    if(result != DB_FINISHED) {
+      if(DB_ERROR(get_join_key(handle->right_rel, handle->right_join_attr,
+                               right_row, &right_key))) {
+        return DB_IMPLEMENTATION_ERROR;
+      }
+
+      if(right_key < join_state.key) {
+        join_state.mark = ++join_state.right_id;
+        continue;
+      } else if(right_key == join_state.key) {
+        join_state.right_id++;
+        return emit_join_row(handle);
+      }
+    }
+
+    /* No more matches for this left row. */
+    join_state.left_id++;
+    handle->flags |= DB_HANDLE_FLAG_INDEX_STEP;
+  }
+}
+
+#if DB_JOIN_HASH_SIZE > 0
+static unsigned long
+join_hash(long key)
+{
+  return (unsigned long)key * 2654435761UL;
+}
+
+static unsigned
+join_partition(long key)
+{
+  return (join_hash(key) >> 16) % join_state.partitions;
+}
+
+static void
+join_cleanup(void)
+{
+  if(join_state.partitions > 0) {
+    if(join_state.build_fd >= 0) {
+      storage_close(join_state.build_fd);
+      storage_remove(join_state.build_file);
+    }
+    if(join_state.probe_fd >= 0) {
+      storage_close(join_state.probe_fd);
+      storage_remove(join_state.probe_file);
+    }
+    join_state.partitions = 0;
+  }
+}
+
+static db_result_t
+read_join_entry(relation_t *rel, attribute_t *attr, unsigned char *row,
+                db_storage_id_t fd, tuple_id_t index, struct join_entry *entry)
+{
+  db_result_t result;
+
+  if(join_state.partitions > 0) {
+    return storage_read(fd, entry, (unsigned long)index * sizeof(*entry),
+                        sizeof(*entry));
+  }
+
+  result = storage_get_row(rel, &index, row);
+  if(DB_ERROR(result)) {
+    return result;
+  } else if(result == DB_FINISHED) {
+    return DB_IMPLEMENTATION_ERROR;
+  }
+
+  entry->tuple_id = index;
+  return get_join_key(rel, attr, row, &entry->key);
+}
+
+/*
+ * Partition the pairs of join key and tuple ID of a relation. Without a
+ * file, only the size of each partition is counted. With a file, each
+ * pair is written to its partition, whose start offset has been
+ * calculated from the counts.
+ */
+static db_result_t
+partition_relation(relation_t *rel, attribute_t *attr, unsigned char *row,
+                   struct join_partition *parts, db_storage_id_t fd)
+{
+  tuple_id_t fill[DB_JOIN_PARTITIONS];
+  struct join_entry entry;
+  db_result_t result;
+  unsigned p;
+
+  memset(fill, 0, sizeof(fill));
+
+  for(entry.tuple_id = 0;; entry.tuple_id++) {
+    result = storage_get_row(rel, &entry.tuple_id, row);
+    if(DB_ERROR(result)) {
+      return result;
+    } else if(result == DB_FINISHED) {
+      break;
+    }
+
+    if(DB_ERROR(get_join_key(rel, attr, row, &entry.key))) {
+      return DB_IMPLEMENTATION_ERROR;
+    }
+
+    p = join_partition(entry.key);
+    if(fd < 0) {
+      parts[p].count++;
+    } else {
+      if(DB_ERROR(storage_write(fd, &entry,
+                                (unsigned long)(parts[p].start + fill[p]) *
+                                sizeof(entry), sizeof(entry)))) {
+        return DB_STORAGE_ERROR;
+      }
+      fill[p]++;
+    }
+  }
+
+  if(fd < 0) {
+    for(p = 1; p < join_state.partitions; p++) {
+      parts[p].start = parts[p - 1].start + parts[p - 1].count;
+    }
+  }
+
+  return DB_OK;
+}
+
+static db_result_t
+spill_relation(relation_t *rel, attribute_t *attr, unsigned char *row,
+               struct join_partition *parts, tuple_id_t cardinality,
+               char *filename, db_storage_id_t *fd)
+{
+  char *name;
+
+  if(DB_ERROR(partition_relation(rel, attr, row, parts, -1))) {
+    return DB_STORAGE_ERROR;
+  }
+
+  name = storage_generate_file("join",
+                               (unsigned long)cardinality *
+                               sizeof(struct join_entry));
+  if(name == NULL) {
+    return DB_STORAGE_ERROR;
+  }
+  strncpy(filename, name, DB_MAX_FILENAME_LENGTH - 1);
+  filename[DB_MAX_FILENAME_LENGTH - 1] = '\0';
+
+  *fd = storage_open(filename);
+  if(*fd < 0) {
+    storage_remove(filename);
+    return DB_STORAGE_ERROR;
+  }
+
+  return partition_relation(rel, attr, row, parts, *fd);
+}
+
+/*
+ * The hash join builds an in-memory table on the smaller relation and
+ * probes it with the rows of the larger relation. If the smaller
+ * relation does not fit in the table, both relations are first
+ * partitioned on the join key into two files, so that each partition
+ * of the smaller relation is likely to fit. Partitions that still
+ * exceed the table are processed in several chunks.
+ */
+static db_result_t
+prepare_hash_join(db_handle_t *handle, tuple_id_t left_cardinality,
+                  tuple_id_t right_cardinality)
+{
+  tuple_id_t build_cardinality;
+  tuple_id_t probe_cardinality;
+  db_result_t result;
+
+  memset(join_state.build_part, 0, sizeof(join_state.build_part));
+  memset(join_state.probe_part, 0, sizeof(join_state.probe_part));
+
+  if(left_cardinality < right_cardinality) {
+    join_state.build_rel = handle->left_rel;
+    join_state.build_attr = handle->left_join_attr;
+    join_state.build_row = left_row;
+    join_state.probe_rel = handle->right_rel;
+    join_state.probe_attr = handle->right_join_attr;
+    join_state.probe_row = right_row;
+    build_cardinality = left_cardinality;
+    probe_cardinality = right_cardinality;
+  } else {
+    join_state.build_rel = handle->right_rel;
+    join_state.build_attr = handle->right_join_attr;
+    join_state.build_row = right_row;
+    join_state.probe_rel = handle->left_rel;
+    join_state.probe_attr = handle->left_join_attr;
+    join_state.probe_row = left_row;
+    build_cardinality = right_cardinality;
+    probe_cardinality = left_cardinality;
+  }
+
+  join_state.partition = 0;
+  join_state.match = 0;
+  join_state.probing = 0;
+  join_state.build_next = 0;
+
+  if(build_cardinality <= DB_JOIN_HASH_SIZE) {
+    join_state.build_part[0].count = build_cardinality;
+    join_state.probe_part[0].count = probe_cardinality;
+    return DB_OK;
+  }
+
+  join_state.partitions = (build_cardinality + DB_JOIN_HASH_SIZE - 1) /
+                          DB_JOIN_HASH_SIZE;
+  if(join_state.partitions > DB_JOIN_PARTITIONS) {
+    join_state.partitions = DB_JOIN_PARTITIONS;
+  }
+  PRINTF("DB: Spilling the hash join to %u partitions\n",
+         (unsigned)join_state.partitions);
+
+  join_state.build_fd = -1;
+  join_state.probe_fd = -1;
+
+  result = spill_relation(join_state.build_rel, join_state.build_attr,
+                          join_state.build_row, join_state.build_part,
+                          build_cardinality, join_state.build_file,
+                          &join_state.build_fd);
+  if(!DB_ERROR(result)) {
+    result = spill_relation(join_state.probe_rel, join_state.probe_attr,
+                            join_state.probe_row, join_state.probe_part,
+                            probe_cardinality, join_state.probe_file,
+                            &join_state.probe_fd);
+  }
+
+  if(DB_ERROR(result)) {
+    join_cleanup();
+  }
+  return result;
+}
+
+static db_result_t
+load_join_table(void)
+{
+  struct join_partition *part;
+  struct join_entry *entry;
+  unsigned bucket;
+  uint16_t i;
+
+  part = &join_state.build_part[join_state.partition];
+  memset(join_buckets, 0, sizeof(join_buckets));
+
+  for(i = 0;
+      i < DB_JOIN_HASH_SIZE &&
+      join_state.build_next < part->start + part->count;
+      i++, join_state.build_next++) {
+    entry = &join_table[i];
+    if(DB_ERROR(read_join_entry(join_state.build_rel, join_state.build_attr,
+                                join_state.build_row, join_state.build_fd,
+                                join_state.build_next, entry))) {
+      return DB_STORAGE_ERROR;
+    }
+    bucket = join_hash(entry->key) % DB_JOIN_HASH_SIZE;
+    join_chain[i] = join_buckets[bucket];
+    join_buckets[bucket] = i + 1;
+  }
+
+  return DB_OK;
+}
+
+static db_result_t
+process_hash_join(db_handle_t *handle)
+{
+  struct join_partition *part;
+  struct join_entry entry;
+  struct join_entry *match;
+  tuple_id_t tuple_id;
+  db_result_t result;
 
-      for(i = 0; i < join_rel->attribute_count; i++) {
-	element_size = source_map[i].attr->element_size;
+  for(;;) {
+    /* Emit the remaining matches of the current probe row. */
+    while(join_state.match != 0) {
+      match = &join_table[join_state.match - 1];
+      join_state.match = join_chain[join_state.match - 1];
+      if(match->key != join_state.key) {
+        continue;
+      }
 
-	memcpy(join_next_attribute_ptr, source_map[i].from_ptr, element_size);
-	join_next_attribute_ptr += element_size;
+      tuple_id = match->tuple_id;
+      result = storage_get_row(join_state.build_rel, &tuple_id,
+                               join_state.build_row);
+      if(result == DB_OK && !join_state.probe_loaded) {
+        tuple_id = join_state.probe_id;
+        result = storage_get_row(join_state.probe_rel, &tuple_id,
+                                 join_state.probe_row);
+        join_state.probe_loaded = 1;
       }
+      if(result != DB_OK) {
+        return DB_ERROR(result) ? result : DB_IMPLEMENTATION_ERROR;
+      }
+
+      return emit_join_row(handle);
+    }
 
-      if(((aql_adt_t *)handle->adt)->flags & AQL_FLAG_ASSIGN) {
-        if(DB_ERROR(storage_put_row(join_rel, join_row))) {
+    part = &join_state.probe_part[join_state.partition];
+    if(join_state.probing) {
+      if(join_state.probe_next < part->start + part->count) {
+        if(DB_ERROR(read_join_entry(join_state.probe_rel, join_state.probe_attr,
+                                    join_state.probe_row, join_state.probe_fd,
+                                    join_state.probe_next, &entry))) {
           return DB_STORAGE_ERROR;
         }
+        join_state.probe_next++;
+        join_state.key = entry.key;
+        join_state.probe_id = entry.tuple_id;
+        join_state.probe_loaded = join_state.partitions == 0;
+        join_state.match =
+          join_buckets[join_hash(entry.key) % DB_JOIN_HASH_SIZE];
+        continue;
       }
+      join_state.probing = 0;
+    }
 
-      handle->current_row++;
-      return DB_GOT_ROW;
+    /* Load the next chunk of the build partition, or go on
+       to the next partition. */
+    part = &join_state.build_part[join_state.partition];
+    if(join_state.build_next == part->start + part->count) {
+      if(++join_state.partition >= join_state.partitions) {
+        join_cleanup();
+        return DB_FINISHED;
+      }
+      join_state.build_next = join_state.build_part[join_state.partition].start;
+      continue;
+    }
+
+    if(DB_ERROR(load_join_table())) {
+      return DB_STORAGE_ERROR;
     }
+    join_state.probing = 1;
+    join_state.probe_next = join_state.probe_part[join_state.partition].start;
   }
+}
+#endif /* DB_JOIN_HASH_SIZE > 0 */
 
-  return DB_OK;
+db_result_t
+relation_process_join(void *handle_ptr)
+{
+  db_handle_t *handle;
+
+  handle = (db_handle_t *)handle_ptr;
+
+  switch(join_state.method) {
+  case JOIN_MERGE:
+    return process_merge_join(handle);
+#if DB_JOIN_HASH_SIZE > 0
+  case JOIN_HASH:
+    return process_hash_join(handle);
+#endif /* DB_JOIN_HASH_SIZE > 0 */
+  default:
+    return process_index_join(handle);
+  }
 }
 
 static db_result_t
@@ -1107,6 +1891,81 @@ generate_join_result(db_handle_t *handle)
   return DB_OK;
 }
 
+static int
+is_integer_attribute(attribute_t *attr)
+{
+  return attr->domain == DOMAIN_INT || attr->domain == DOMAIN_LONG;
+}
+
+static int
+is_sorted_attribute(attribute_t *attr)
+{
+  return index_exists(attr) &&
+         ((index_t *)attr->index)->type == INDEX_INLINE;
+}
+
+/*
+ * Choose the join method. A merge join is used if both relations are
+ * sorted on the join attribute. Otherwise, an index nested-loop join,
+ * which requires an index on the right attribute, is compared with a
+ * hash join, which reads each relation once, or three times if it has
+ * to spill partitions to storage.
+ */
+static db_result_t
+select_join_method(db_handle_t *handle)
+{
+  attribute_t *left_attr;
+  attribute_t *right_attr;
+#if DB_JOIN_HASH_SIZE > 0
+  tuple_id_t left_cardinality;
+  tuple_id_t right_cardinality;
+  unsigned long hash_cost;
+#endif /* DB_JOIN_HASH_SIZE > 0 */
+
+#if DB_JOIN_HASH_SIZE > 0
+  join_cleanup();
+#endif /* DB_JOIN_HASH_SIZE > 0 */
+
+  left_attr = handle->left_join_attr;
+  right_attr = handle->right_join_attr;
+
+  if(is_integer_attribute(left_attr) && is_integer_attribute(right_attr)) {
+    if(is_sorted_attribute(left_attr) && is_sorted_attribute(right_attr)) {
+      PRINTF("DB: Using a merge join\n");
+      join_state.method = JOIN_MERGE;
+      join_state.left_id = 0;
+      join_state.right_id = 0;
+      join_state.mark = 0;
+      return DB_OK;
+    }
+
+#if DB_JOIN_HASH_SIZE > 0
+    left_cardinality = relation_cardinality(handle->left_rel);
+    right_cardinality = relation_cardinality(handle->right_rel);
+    hash_cost = (unsigned long)left_cardinality + right_cardinality;
+    if(left_cardinality > DB_JOIN_HASH_SIZE &&
+       right_cardinality > DB_JOIN_HASH_SIZE) {
+      hash_cost *= 3;
+    }
+
+    if(!index_exists(right_attr) ||
+       (unsigned long)left_cardinality * DB_JOIN_INDEX_COST > hash_cost) {
+      PRINTF("DB: Using a hash join\n");
+      join_state.method = JOIN_HASH;
+      return prepare_hash_join(handle, left_cardinality, right_cardinality);
+    }
+#endif /* DB_JOIN_HASH_SIZE > 0 */
+  }
+
+  if(!index_exists(right_attr)) {
+    PRINTF("DB: The attribute to join on is not indexed\n");
+    return DB_INDEX_ERROR;
+  }
+
+  join_state.method = JOIN_INDEX;
+  return DB_OK;
+}
+
 db_result_t
 relation_join(void *query_result, void *adt_ptr)
 {
@@ -1120,6 +1979,7 @@ relation_join(void *query_result, void *adt_ptr)
   int i;
   char *attribute_name;
   attribute_t *attr;
+  db_result_t result;
 
   adt = (aql_adt_t *)adt_ptr;
 
@@ -1158,9 +2018,9 @@ relation_join(void *query_result, void *adt_ptr)
     return DB_RELATIONAL_ERROR;
   }
 
-  if(!index_exists(handle->right_join_attr)) {
-    PRINTF("DB: The attribute to join on is not indexed\n");
-    return DB_INDEX_ERROR;
+  result = select_join_method(handle);
+  if(DB_ERROR(result)) {
+    return result;
   }
 
   /*
@@ -166,20 +166,25 @@ db_value_to_long(attribute_value_t *value)
 db_result_t
 db_free(db_handle_t *handle)
 {
-  if(handle->rel != NULL) {
-    relation_release(handle->rel);
+  db_result_t result;
+
+  result = DB_OK;
+  if(handle->rel != NULL && DB_ERROR(relation_release(handle->rel))) {
+    result = DB_STORAGE_ERROR;
   }
-  if(handle->result_rel != NULL) {
-    relation_release(handle->result_rel);
+  if(handle->result_rel != NULL &&
+     DB_ERROR(relation_release(handle->result_rel))) {
+    result = DB_STORAGE_ERROR;
   }
-  if(handle->left_rel != NULL) {
-    relation_release(handle->left_rel);
+  if(handle->left_rel != NULL && DB_ERROR(relation_release(handle->left_rel))) {
+    result = DB_STORAGE_ERROR;
   }
-  if(handle->right_rel != NULL) {
-    relation_release(handle->right_rel);
+  if(handle->right_rel != NULL &&
+     DB_ERROR(relation_release(handle->right_rel))) {
+    result = DB_STORAGE_ERROR;
   }
 
   handle->flags = 0;
 
-  return DB_OK;
+  return result;
 }
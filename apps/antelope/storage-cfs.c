@@ -68,6 +68,26 @@ struct index_record {
 
 #define ROW_XOR 0xf6U
 
+#if DB_ROW_BUFFER_SIZE > 0
+/*
+ * A row buffer holds either a range of rows read ahead from a
+ * relation, or rows that have been appended to the relation but
+ * not yet written. The rows are kept in their stored form.
+ */
+struct row_buffer {
+  relation_t *rel;
+  tuple_id_t first_row;
+  uint16_t rows;
+  uint8_t dirty;
+  unsigned char data[DB_ROW_BUFFER_SIZE];
+};
+
+static struct row_buffer row_buffers[DB_ROW_BUFFER_COUNT];
+static uint8_t next_row_buffer;
+
+static db_result_t write_rows(relation_t *, unsigned char *, unsigned);
+#endif /* DB_ROW_BUFFER_SIZE > 0 */
+
 static void
 merge_strings(char *dest, char *prefix, char *suffix)
 {
@@ -75,6 +95,93 @@ merge_strings(char *dest, char *prefix, char *suffix)
   strcat(dest, suffix);
 }
 
+#if DB_ROW_BUFFER_SIZE > 0
+static struct row_buffer *
+find_row_buffer(relation_t *rel)
+{
+  int i;
+
+  for(i = 0; i < DB_ROW_BUFFER_COUNT; i++) {
+    if(row_buffers[i].rel == rel) {
+      return &row_buffers[i];
+    }
+  }
+  return NULL;
+}
+
+static db_result_t
+flush_row_buffer(struct row_buffer *buf)
+{
+  unsigned length;
+  db_result_t result;
+
+  if(!buf->dirty) {
+    return DB_OK;
+  }
+
+  length = buf->rows * buf->rel->row_length;
+  PRINTF("DB: Flushing %u bytes to relation %s\n", length, buf->rel->name);
+  result = write_rows(buf->rel, buf->data, length);
+  if(DB_ERROR(result)) {
+    /* Keep the rows, so that a later flush can try again. */
+    return result;
+  }
+
+  buf->dirty = 0;
+  buf->rows = 0;
+  return DB_OK;
+}
+
+static struct row_buffer *
+get_row_buffer(relation_t *rel)
+{
+  struct row_buffer *buf;
+
+  buf = find_row_buffer(rel);
+  if(buf != NULL) {
+    return buf;
+  }
+
+  buf = find_row_buffer(NULL);
+  if(buf == NULL) {
+    /* Take over the buffers of other relations in turn. */
+    buf = &row_buffers[next_row_buffer];
+    next_row_buffer = (next_row_buffer + 1) % DB_ROW_BUFFER_COUNT;
+    if(DB_ERROR(flush_row_buffer(buf))) {
+      return NULL;
+    }
+  }
+
+  buf->rel = rel;
+  buf->rows = 0;
+  buf->dirty = 0;
+  return buf;
+}
+
+static db_result_t
+release_row_buffer(relation_t *rel, int flush)
+{
+  struct row_buffer *buf;
+  db_result_t result;
+
+  buf = find_row_buffer(rel);
+  if(buf == NULL) {
+    return DB_OK;
+  }
+
+  result = flush ? flush_row_buffer(buf) : DB_OK;
+  buf->rel = NULL;
+  return result;
+}
+
+static int
+use_row_buffer(relation_t *rel)
+{
+  return RELATION_HAS_TUPLES(rel) && rel->row_length > 0 &&
+         rel->row_length <= DB_ROW_BUFFER_SIZE;
+}
+#endif /* DB_ROW_BUFFER_SIZE > 0 */
+
 char *
 storage_generate_file(char *prefix, unsigned long size)
 {
@@ -103,6 +210,11 @@ storage_generate_file(char *prefix, unsigned long size)
 db_result_t
 storage_load(relation_t *rel)
 {
+  if(RELATION_HAS_TUPLES(rel)) {
+    /* Still open, e.g., because its buffered rows could not be written. */
+    return DB_OK;
+  }
+
   PRINTF("DB: Opening the tuple file %s\n", rel->tuple_filename);
   rel->tuple_storage = cfs_open(rel->tuple_filename,
                                 CFS_READ | CFS_WRITE | CFS_APPEND);
@@ -114,15 +226,31 @@ storage_load(relation_t *rel)
   return DB_OK;
 }
 
-void
+db_result_t
 storage_unload(relation_t *rel)
 {
+#if DB_ROW_BUFFER_SIZE > 0
+  struct row_buffer *buf;
+#endif /* DB_ROW_BUFFER_SIZE > 0 */
+
   if(RELATION_HAS_TUPLES(rel)) {
     PRINTF("DB: Unload tuple file %s\n", rel->tuple_filename);
 
+#if DB_ROW_BUFFER_SIZE > 0
+    /* Keep the file open and the rows buffered until they are written. */
+    buf = find_row_buffer(rel);
+    if(buf != NULL && DB_ERROR(flush_row_buffer(buf))) {
+      PRINTF("DB: Failed to write the buffered rows\n");
+      return DB_STORAGE_ERROR;
+    }
+    release_row_buffer(rel, 0);
+#endif /* DB_ROW_BUFFER_SIZE > 0 */
+
     cfs_close(rel->tuple_storage);
     rel->tuple_storage = -1;
   }
+
+  return DB_OK;
 }
 
 db_result_t
@@ -279,6 +407,10 @@ storage_put_attribute(relation_t *rel, attribute_t *attr)
 db_result_t
 storage_drop_relation(relation_t *rel, int remove_tuples)
 {
+#if DB_ROW_BUFFER_SIZE > 0
+  release_row_buffer(rel, !remove_tuples);
+#endif /* DB_ROW_BUFFER_SIZE > 0 */
+
   if(remove_tuples && RELATION_HAS_TUPLES(rel)) {
     cfs_remove(rel->tuple_filename);
   }
@@ -400,12 +532,74 @@ storage_put_index(index_t *index)
   return result;
 }
 
+#if DB_ROW_BUFFER_SIZE > 0
+static db_result_t
+get_buffered_row(relation_t *rel, tuple_id_t *tuple_id, storage_row_t row)
+{
+  struct row_buffer *buf;
+  unsigned length;
+  int r;
+
+  buf = get_row_buffer(rel);
+  if(buf == NULL || DB_ERROR(flush_row_buffer(buf))) {
+    return DB_STORAGE_ERROR;
+  }
+
+  if(buf->rows == 0 || *tuple_id < buf->first_row ||
+     *tuple_id >= buf->first_row + buf->rows) {
+    /* Read ahead as many whole rows as the buffer can hold. */
+    if(cfs_seek(rel->tuple_storage, *tuple_id * rel->row_length,
+                CFS_SEEK_SET) == (cfs_offset_t)-1) {
+      return DB_STORAGE_ERROR;
+    }
+
+    buf->rows = 0;
+    length = 0;
+    do {
+      r = cfs_read(rel->tuple_storage, buf->data + length,
+                   DB_ROW_BUFFER_SIZE / rel->row_length * rel->row_length -
+                   length);
+      if(r < 0) {
+        PRINTF("DB: Reading failed on fd %d\n", rel->tuple_storage);
+        return DB_STORAGE_ERROR;
+      }
+      length += r;
+    } while(r > 0 && length < DB_ROW_BUFFER_SIZE / rel->row_length *
+                              rel->row_length);
+
+    if(length < rel->row_length) {
+      if(length > 0) {
+        PRINTF("DB: Incomplete record: %u < %d\n", length, rel->row_length);
+        return DB_STORAGE_ERROR;
+      }
+      return DB_FINISHED;
+    }
+
+    buf->first_row = *tuple_id;
+    buf->rows = length / rel->row_length;
+    PRINTF("DB: Read %u rows from relation %s\n", buf->rows, rel->name);
+  }
+
+  memcpy(row, buf->data + (*tuple_id - buf->first_row) * rel->row_length,
+         rel->row_length);
+  row[rel->row_length - 1] ^= ROW_XOR;
+
+  return DB_OK;
+}
+#endif /* DB_ROW_BUFFER_SIZE > 0 */
+
 db_result_t
 storage_get_row(relation_t *rel, tuple_id_t *tuple_id, storage_row_t row)
 {
   int r;
   tuple_id_t nrows;
 
+#if DB_ROW_BUFFER_SIZE > 0
+  if(use_row_buffer(rel)) {
+    return get_buffered_row(rel, tuple_id, row);
+  }
+#endif /* DB_ROW_BUFFER_SIZE > 0 */
+
   if(DB_ERROR(storage_get_row_amount(rel, &nrows))) {
     return DB_STORAGE_ERROR;
   }
@@ -437,13 +631,12 @@ storage_get_row(relation_t *rel, tuple_id_t *tuple_id, storage_row_t row)
   return DB_OK;
 }
 
-db_result_t
-storage_put_row(relation_t *rel, storage_row_t row)
+/* Append rows in their stored form to the tuple file of a relation. */
+static db_result_t
+write_rows(relation_t *rel, unsigned char *data, unsigned length)
 {
   cfs_offset_t end;
-  unsigned remaining;
   int r;
-  unsigned char *last_byte;
 #if DB_FEATURE_INTEGRITY
   int missing_bytes;
   char buf[rel->row_length];
@@ -465,28 +658,65 @@ storage_put_row(relation_t *rel, storage_row_t row)
   }
 #endif
 
+  while(length > 0) {
+    r = cfs_write(rel->tuple_storage, data, length);
+    if(r < 0) {
+      PRINTF("DB: Failed to store %u bytes\n", length);
+      return DB_STORAGE_ERROR;
+    }
+    data += r;
+    length -= r;
+  }
+
+  return DB_OK;
+}
+
+db_result_t
+storage_put_row(relation_t *rel, storage_row_t row)
+{
+  unsigned char *last_byte;
+  db_result_t result;
+#if DB_ROW_BUFFER_SIZE > 0
+  struct row_buffer *buf;
+
+  if(use_row_buffer(rel)) {
+    buf = get_row_buffer(rel);
+    if(buf == NULL) {
+      return DB_STORAGE_ERROR;
+    }
+
+    if(!buf->dirty) {
+      /* Drop the rows read ahead. */
+      buf->rows = 0;
+    } else if((buf->rows + 1) * rel->row_length > DB_ROW_BUFFER_SIZE &&
+              DB_ERROR(flush_row_buffer(buf))) {
+      return DB_STORAGE_ERROR;
+    }
+
+    last_byte = buf->data + buf->rows * rel->row_length;
+    memcpy(last_byte, row, rel->row_length);
+    last_byte += rel->row_length - 1;
+    *last_byte ^= ROW_XOR;
+    buf->rows++;
+    buf->dirty = 1;
+
+    return DB_OK;
+  }
+#endif /* DB_ROW_BUFFER_SIZE > 0 */
+
   /* Ensure that last written byte is separated from 0, to make file
      lengths correct in Coffee. */
   last_byte = row + rel->row_length - 1;
   *last_byte ^= ROW_XOR;
 
-  remaining = rel->row_length;
-  do {
-    r = cfs_write(rel->tuple_storage, row, remaining);
-    if(r < 0) {
-      PRINTF("DB: Failed to store %u bytes\n", remaining);
-      *last_byte ^= ROW_XOR;
-      return DB_STORAGE_ERROR;
-    }
-    row += r;
-    remaining -= r;
-  } while(remaining > 0);
-
-  PRINTF("DB: Stored a of %d bytes\n", rel->row_length);
+  result = write_rows(rel, row, rel->row_length);
+  if(!DB_ERROR(result)) {
+    PRINTF("DB: Stored a of %d bytes\n", rel->row_length);
+  }
 
   *last_byte ^= ROW_XOR;
 
-  return DB_OK;
+  return result;
 }
 
 db_result_t
@@ -494,6 +724,15 @@ storage_get_row_amount(relation_t *rel, tuple_id_t *amount)
 {
   cfs_offset_t offset;
 
+#if DB_ROW_BUFFER_SIZE > 0
+  struct row_buffer *buf;
+
+  buf = find_row_buffer(rel);
+  if(buf != NULL && DB_ERROR(flush_row_buffer(buf))) {
+    return DB_STORAGE_ERROR;
+  }
+#endif /* DB_ROW_BUFFER_SIZE > 0 */
+
   if(rel->row_length == 0) {
     *amount = 0;
   } else {
@@ -528,6 +767,12 @@ storage_close(db_storage_id_t fd)
   cfs_close(fd);
 }
 
+void
+storage_remove(const char *filename)
+{
+  cfs_remove(filename);
+}
+
 db_result_t
 storage_read(db_storage_id_t fd,
 	     void *buffer, unsigned long offset, unsigned length)
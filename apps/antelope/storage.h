@@ -53,7 +53,7 @@ typedef unsigned char * storage_row_t;
 char *storage_generate_file(char *, unsigned long);
 
 db_result_t storage_load(relation_t *);
-void storage_unload(relation_t *);
+db_result_t storage_unload(relation_t *);
 
 db_result_t storage_get_relation(relation_t *, char *);
 db_result_t storage_put_relation(relation_t *);
@@ -70,6 +70,7 @@ db_result_t storage_get_row_amount(relation_t *, tuple_id_t *);
 
 db_storage_id_t storage_open(const char *);
 void storage_close(db_storage_id_t);
+void storage_remove(const char *);
 db_result_t storage_read(db_storage_id_t, void *, unsigned long, unsigned);
 db_result_t storage_write(db_storage_id_t, void *, unsigned long, unsigned);
 
@@ -11,6 +11,7 @@
 #include "dev/light-sensor.h"
 #include "dev/serial-line.h"
 #include "lib/sky-math.h"
+#include "cusum.h"
 #include <stdio.h>
 #include <string.h>
 
@@ -85,29 +86,16 @@ PROCESS_THREAD(shell_sequence_process, ev, data) {
 
 	PROCESS_BEGIN();
 
-	static uint16_t temp3;
-	temp3 = mylog(std_dev_0/std_dev_1);
-
 	// Error probability parameters
 	// alpha = 0.001 - Probability of false alarm.
 	// beta = 0.001 - Probability of miss.
-	static int b = 7;	// b = log((1-beta)/alpha) = 6.9068
+	// b = log((1-beta)/alpha) = 6.9068
+	static struct cusum detector;
+	cusum_init_gaussian(&detector, mean_0, std_dev_0, mean_1, std_dev_1,
+			CUSUM_FIXED(7));
 
 	// Variables
 	uint16_t observation;
-	static int16_t S_n;
-	// Make sure to actually reset S_n every time we run a sequence.
-	S_n = 0;
-	static int16_t suff_stat = 0;
-	static int16_t min_level;
-	min_level = 0;
-	uint16_t temp1 = 0;
-	uint16_t temp2 = 0;
-	static int decision;
-	// Make sure to actually reset decision every time we run a sequence.
-	decision = 0;
-	int a = 0;
-	int c = 0;
 
 	etimer_set(&etimer, (CLOCK_SECOND / 16));
 
@@ -126,41 +114,18 @@ PROCESS_THREAD(shell_sequence_process, ev, data) {
 
 		printf("cusum-seq: observation = %d\n",observation);
 
-		// Calculate new statistic based on:
-		// suff_stat = log(std_dev_0/std_dev_1)
+		// Add the log-likelihood ratio of the observation:
+		// log(std_dev_0 / std_dev_1)
 		// - ((observation - mean_1)^2) / (2*(std_dev_1^2)
-		// + ((observation - mean_0)^2) / (2*(std_dev_0^2)	
-		//suff_stat =  log(std_dev_0 / std_dev_1) - pow2(observation - mean_1) / (2*pow2(std_dev_1)) + pow2(observation - mean_0) / (2*pow2(std_dev_0));
-
-		a = abs_sub(observation, mean_1);
-		c = abs_sub(observation, mean_0);
-
-		// If a or c is too large, calculating temp1 or temp2 can be tough.
-		temp1 = temp3 + log_exp_term(c, std_dev_0);
-		temp2 = log_exp_term(a, std_dev_1);
-		suff_stat = temp1 - temp2;
-
-		// Do appropriate overflow protection.
-		if(S_n/2 + suff_stat/2 > 16384 ) {
-			S_n = 32767;
-		} else if( S_n/2 + suff_stat/2 < -16384) {
-			S_n = -32768;
-		} else {
-			S_n = S_n + suff_stat;
-		}
-
-		// Reset the min_level appropriately.
-		if(S_n < min_level) {
-			min_level = S_n;
-		}
+		// + ((observation - mean_0)^2) / (2*(std_dev_0^2)
+		cusum_update(&detector, observation);
 
 		// DEBUG CODE
-		printf("cusum-seq: min_level = %d\n",min_level);
-		printf("cusum-seq: S_n = %d\n\n",S_n);
+		printf("cusum-seq: S_n - min_level = %ld\n\n",
+			(long)(detector.g >> CUSUM_FRACTION_BITS));
 
-			
 		// Make decision based on statistic.
-		if(S_n >= b + min_level) {
+		if(cusum_alarm(&detector)) {
 			
 			leds_on(LEDS_RED);
 
@@ -0,0 +1,308 @@
+// Fixed-point CUSUM change detectors shared by the CUSUM applications
+
+#include "cusum.h"
+
+#define STATISTIC_MAX 0x7fffffffL
+
+/* ln(1 + i/16) in Q12, interpolated by cusum_ln() */
+static const uint16_t ln_table[17] = {
+  0, 248, 482, 704, 914, 1114, 1304, 1486, 1661,
+  1828, 1989, 2143, 2292, 2436, 2575, 2709, 2839
+};
+#define LN2_Q12 2839
+/*---------------------------------------------------------------------------*/
+int32_t
+cusum_ln(uint16_t x)
+{
+  uint8_t e;
+  uint16_t m, frac;
+  const uint16_t *t;
+
+  if(x == 0) {
+    return 0;
+  }
+
+  /* x = 2^e * (m / 2^15), with m in [2^15, 2^16) */
+  for(e = 15; (x & 0x8000) == 0; e--) {
+    x <<= 1;
+  }
+  m = x;
+  t = &ln_table[(m >> 11) & 0xf];
+  frac = m & 0x7ff;
+
+  return ((int32_t)e * LN2_Q12 + t[0] +
+          (((uint32_t)(t[1] - t[0]) * frac) >> 11) + 8) >> 4;
+}
+/*---------------------------------------------------------------------------*/
+static uint16_t
+isqrt(uint32_t x)
+{
+  uint32_t root = 0;
+  uint32_t bit = 1UL << 30;
+
+  while(bit > x) {
+    bit >>= 2;
+  }
+  while(bit != 0) {
+    if(x >= root + bit) {
+      x -= root + bit;
+      root = (root >> 1) + bit;
+    } else {
+      root >>= 1;
+    }
+    bit >>= 2;
+  }
+  return root;
+}
+/*---------------------------------------------------------------------------*/
+static void
+init_scale(struct cusum_scale *sc, uint16_t std_dev)
+{
+  uint32_t var = std_dev == 0 ? 1 : (uint32_t)std_dev * std_dev;
+  uint32_t factor;
+  uint8_t shift;
+
+  /* Use the largest shift that keeps the factor below 128, which keeps
+     the rounding error of the factor below 1% */
+  for(shift = 0; shift < 23; shift++) {
+    if((((uint32_t)1 << (shift + 8)) + var / 2) / var >= 128) {
+      break;
+    }
+  }
+  factor = (((uint32_t)1 << (shift + 7)) + var / 2) / var;
+  if(factor == 0) {
+    factor = 1;
+  } else if(factor > 127) {
+    factor = 127;
+  }
+
+  sc->factor = factor;
+  sc->shift = shift;
+  /* Terms up to 2^30 leave room to add them without overflow */
+  sc->limit = isqrt((1UL << 30) / factor);
+  sc->max_term = ((uint32_t)sc->limit * sc->limit * factor) >> shift;
+}
+/*---------------------------------------------------------------------------*/
+/* d^2 / (2 * std_dev^2) in Q8 */
+static int32_t
+square_term(const struct cusum_scale *sc, uint32_t d)
+{
+  if(d >= sc->limit) {
+    return sc->max_term;
+  }
+  return ((uint32_t)d * d * sc->factor) >> sc->shift;
+}
+/*---------------------------------------------------------------------------*/
+/* x * f for a Q8 factor f, without overflowing the intermediate product */
+static int32_t
+mul_q8(int32_t x, int32_t f)
+{
+  return (x >> 8) * f + (((x & 0xff) * f) >> 8);
+}
+/*---------------------------------------------------------------------------*/
+static uint32_t
+distance(int32_t a, int32_t b)
+{
+  return a > b ? a - b : b - a;
+}
+/*---------------------------------------------------------------------------*/
+static void
+accumulate(struct cusum *c, int32_t z)
+{
+  c->z = z;
+  if(z > 0 && c->g > STATISTIC_MAX - z) {
+    c->s = STATISTIC_MAX;
+  } else {
+    c->s = c->g + z;
+  }
+  c->g = c->s < 0 ? 0 : c->s;
+  c->count++;
+}
+/*---------------------------------------------------------------------------*/
+static int32_t
+plain_z(struct cusum *c, uint16_t x)
+{
+  int32_t z = ((int32_t)x << 8) - c->u.plain.mean0 - c->u.plain.drift;
+
+  return (c->flags & CUSUM_DECREASE) ? -z : z;
+}
+/*---------------------------------------------------------------------------*/
+static int32_t
+gaussian_z(struct cusum *c, uint16_t x)
+{
+  return c->u.gaussian.log_ratio +
+    square_term(&c->u.gaussian.scale0, distance(x, c->u.gaussian.mean0)) -
+    square_term(&c->u.gaussian.scale1, distance(x, c->u.gaussian.mean1));
+}
+/*---------------------------------------------------------------------------*/
+static int32_t
+adaptive_z(struct cusum *c, uint16_t x)
+{
+  int32_t x8 = (int32_t)x << 8;
+  int32_t half_delta = c->u.adaptive.delta / 2;
+  int32_t z;
+
+  /* D_k = ((x - phi_a)^2 - (x - phi_a - delta)^2) / 2 */
+  c->u.adaptive.d = mul_q8(x8 - c->u.adaptive.phi_a - half_delta,
+                           c->u.adaptive.delta);
+  c->u.adaptive.phi_a += mul_q8(c->u.adaptive.d, c->u.adaptive.epsilon);
+
+  c->u.adaptive.phi = c->u.adaptive.phi_a + half_delta;
+  if(c->u.adaptive.phi > c->u.adaptive.phi_max) {
+    c->u.adaptive.phi = c->u.adaptive.phi_max;
+    c->u.adaptive.phi_a = c->u.adaptive.phi - half_delta;
+  } else if(c->u.adaptive.phi < c->u.adaptive.phi_min) {
+    c->u.adaptive.phi = c->u.adaptive.phi_min;
+    c->u.adaptive.phi_a = c->u.adaptive.phi - half_delta;
+  }
+
+  z = square_term(&c->u.adaptive.scale, distance(x, c->u.adaptive.mean0)) -
+    square_term(&c->u.adaptive.scale,
+                (distance(x8, c->u.adaptive.phi) + 0x80) >> 8);
+  if(z > -c->u.adaptive.dead_zone && z < c->u.adaptive.dead_zone) {
+    z = 0;
+  }
+  return z;
+}
+/*---------------------------------------------------------------------------*/
+static int32_t
+page_hinkley_z(struct cusum *c, uint16_t x)
+{
+  int32_t x8 = (int32_t)x << 8;
+
+  if(c->count == 0) {
+    c->u.page_hinkley.mean = x8;
+  } else {
+    c->u.page_hinkley.mean +=
+      (x8 - c->u.page_hinkley.mean) >> c->u.page_hinkley.mean_shift;
+  }
+
+  if(c->flags & CUSUM_DECREASE) {
+    return c->u.page_hinkley.mean - x8 - c->u.page_hinkley.delta;
+  }
+  return x8 - c->u.page_hinkley.mean - c->u.page_hinkley.delta;
+}
+/*---------------------------------------------------------------------------*/
+static void
+init(struct cusum *c, uint8_t type, uint8_t flags, int32_t threshold)
+{
+  c->type = type;
+  c->flags = flags;
+  c->threshold = threshold;
+  cusum_reset(c);
+}
+/*---------------------------------------------------------------------------*/
+void
+cusum_init_plain(struct cusum *c, uint16_t mean0, uint16_t mean1,
+                 int32_t threshold)
+{
+  init(c, CUSUM_PLAIN, mean1 < mean0 ? CUSUM_DECREASE : 0, threshold);
+  c->u.plain.mean0 = (int32_t)mean0 << 8;
+  c->u.plain.drift = ((int32_t)mean1 - mean0) << 7;
+}
+/*---------------------------------------------------------------------------*/
+void
+cusum_init_gaussian(struct cusum *c, uint16_t mean0, uint16_t std_dev_0,
+                    uint16_t mean1, uint16_t std_dev_1, int32_t threshold)
+{
+  init(c, CUSUM_GAUSSIAN, 0, threshold);
+  init_scale(&c->u.gaussian.scale0, std_dev_0);
+  init_scale(&c->u.gaussian.scale1, std_dev_1);
+  c->u.gaussian.mean0 = mean0;
+  c->u.gaussian.mean1 = mean1;
+  c->u.gaussian.log_ratio = cusum_ln(std_dev_0) - cusum_ln(std_dev_1);
+}
+/*---------------------------------------------------------------------------*/
+void
+cusum_init_adaptive(struct cusum *c, uint16_t mean0, uint16_t std_dev,
+                    int32_t delta, int32_t epsilon,
+                    uint16_t phi_min, uint16_t phi_max,
+                    int32_t dead_zone, int32_t threshold)
+{
+  init(c, CUSUM_ADAPTIVE, 0, threshold);
+  init_scale(&c->u.adaptive.scale, std_dev);
+  c->u.adaptive.mean0 = mean0;
+  c->u.adaptive.delta = delta;
+  c->u.adaptive.epsilon = epsilon;
+  c->u.adaptive.phi_min = (int32_t)phi_min << 8;
+  c->u.adaptive.phi_max = (int32_t)phi_max << 8;
+  c->u.adaptive.dead_zone = dead_zone;
+  c->u.adaptive.phi = (int32_t)mean0 << 8;
+  c->u.adaptive.phi_a = c->u.adaptive.phi - delta / 2;
+  c->u.adaptive.d = 0;
+}
+/*---------------------------------------------------------------------------*/
+void
+cusum_init_page_hinkley(struct cusum *c, int32_t delta, uint8_t mean_shift,
+                        uint8_t flags, int32_t threshold)
+{
+  init(c, CUSUM_PAGE_HINKLEY, flags, threshold);
+  c->u.page_hinkley.delta = delta;
+  c->u.page_hinkley.mean_shift = mean_shift;
+}
+/*---------------------------------------------------------------------------*/
+void
+cusum_reset(struct cusum *c)
+{
+  c->g = 0;
+  c->s = 0;
+  c->z = 0;
+  c->count = 0;
+}
+/*---------------------------------------------------------------------------*/
+int
+cusum_update(struct cusum *c, uint16_t sample)
+{
+  int32_t z;
+
+  switch(c->type) {
+  case CUSUM_PLAIN:
+    z = plain_z(c, sample);
+    break;
+  case CUSUM_GAUSSIAN:
+    z = gaussian_z(c, sample);
+    break;
+  case CUSUM_ADAPTIVE:
+    z = adaptive_z(c, sample);
+    break;
+  default:
+    z = page_hinkley_z(c, sample);
+    break;
+  }
+  accumulate(c, z);
+
+  return cusum_alarm(c);
+}
+/*---------------------------------------------------------------------------*/
+/* One loop per detector type, so the type is not dispatched per sample */
+#define BATCH(z_function)                         \
+  for(i = 0; i < n;) {                            \
+    accumulate(c, z_function(c, samples[i++]));   \
+    if(cusum_alarm(c)) {                          \
+      break;                                      \
+    }                                             \
+  }
+
+uint16_t
+cusum_update_batch(struct cusum *c, const uint16_t *samples, uint16_t n)
+{
+  uint16_t i;
+
+  switch(c->type) {
+  case CUSUM_PLAIN:
+    BATCH(plain_z);
+    break;
+  case CUSUM_GAUSSIAN:
+    BATCH(gaussian_z);
+    break;
+  case CUSUM_ADAPTIVE:
+    BATCH(adaptive_z);
+    break;
+  default:
+    BATCH(page_hinkley_z);
+    break;
+  }
+
+  return i;
+}
+/*---------------------------------------------------------------------------*/
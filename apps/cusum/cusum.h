@@ -0,0 +1,134 @@
+#ifndef __CUSUM_H__
+#define __CUSUM_H__
+
+#include "contiki.h"
+
+/*
+ * Streaming CUSUM change detectors in fixed point.
+ *
+ * A detector is a struct cusum that one of the cusum_init_*() functions
+ * configures.  Each sample is then fed through cusum_update(), or a whole
+ * window of samples through cusum_update_batch().  Neither allocates
+ * memory, divides, or takes a logarithm: the constant parts of the
+ * log-likelihood ratio are computed once, at initialization.
+ *
+ * All detectors keep the decision statistic in the recursive form
+ * g = max(0, g + z), which equals S_n - min(S_n) of the cumulative sum,
+ * and raise an alarm while g >= threshold.  Statistics and thresholds are
+ * Q8 fixed point (CUSUM_FIXED(1) == 256).  For the Gaussian and adaptive
+ * detectors they are log-likelihoods in nats, for the plain and
+ * Page-Hinkley detectors they are in sample units.
+ */
+
+#define CUSUM_FRACTION_BITS 8
+#define CUSUM_FIXED(x) ((int32_t)((x) * (1L << CUSUM_FRACTION_BITS)))
+
+enum cusum_type {
+  CUSUM_PLAIN,
+  CUSUM_GAUSSIAN,
+  CUSUM_ADAPTIVE,
+  CUSUM_PAGE_HINKLEY
+};
+
+/* Set for plain and Page-Hinkley detectors that look for a decrease */
+#define CUSUM_DECREASE 1
+
+/* (d^2 / (2 * std_dev^2)) in Q8 is (d^2 * factor) >> shift */
+struct cusum_scale {
+  uint16_t limit;     /* deviations at or above this saturate to max_term */
+  uint8_t factor;
+  uint8_t shift;
+  int32_t max_term;
+};
+
+struct cusum {
+  int32_t g;          /* decision statistic, never negative */
+  int32_t s;          /* g before it was clamped at zero by the last sample */
+  int32_t z;          /* log-likelihood ratio of the last sample */
+  int32_t threshold;
+  uint32_t count;     /* samples since the last reset */
+  uint8_t type;
+  uint8_t flags;
+  union {
+    struct {
+      int32_t mean0;
+      int32_t drift;      /* half the shift of the mean, signed */
+    } plain;
+    struct {
+      struct cusum_scale scale0;
+      struct cusum_scale scale1;
+      uint16_t mean0;
+      uint16_t mean1;
+      int32_t log_ratio;  /* ln(std_dev_0 / std_dev_1) */
+    } gaussian;
+    struct {
+      struct cusum_scale scale;
+      uint16_t mean0;
+      int32_t phi_a;      /* lower edge of the estimate of the post-change mean */
+      int32_t phi;        /* current estimate of the post-change mean */
+      int32_t delta;
+      int32_t epsilon;
+      int32_t phi_min;
+      int32_t phi_max;
+      int32_t dead_zone;  /* |z| below this counts as no evidence */
+      int32_t d;          /* last gradient D_k, a measure of instantaneous change */
+    } adaptive;
+    struct {
+      int32_t mean;       /* exponentially weighted mean of the samples */
+      int32_t delta;      /* magnitude of change tolerated */
+      uint8_t mean_shift; /* the mean weighs new samples by 2^-mean_shift */
+    } page_hinkley;
+  } u;
+};
+
+/*
+ * Page's CUSUM for a shift of the mean from mean0 to mean1, in either
+ * direction.  Each sample adds (sample - (mean0 + mean1) / 2) towards mean1.
+ */
+void cusum_init_plain(struct cusum *c, uint16_t mean0, uint16_t mean1,
+                      int32_t threshold);
+
+/*
+ * CUSUM of the log-likelihood ratio between two normal distributions,
+ * N(mean1, std_dev_1) after the change and N(mean0, std_dev_0) before.
+ */
+void cusum_init_gaussian(struct cusum *c, uint16_t mean0, uint16_t std_dev_0,
+                         uint16_t mean1, uint16_t std_dev_1, int32_t threshold);
+
+/*
+ * CUSUM against an unknown post-change mean, which the detector estimates
+ * from the samples by gradient descent with step epsilon and spacing delta
+ * (both Q8), bounded to [phi_min, phi_max].  Log-likelihood ratios smaller
+ * than dead_zone are ignored.
+ */
+void cusum_init_adaptive(struct cusum *c, uint16_t mean0, uint16_t std_dev,
+                         int32_t delta, int32_t epsilon,
+                         uint16_t phi_min, uint16_t phi_max,
+                         int32_t dead_zone, int32_t threshold);
+
+/*
+ * Page-Hinkley test against a running mean, tolerating changes up to
+ * delta (Q8).  flags is 0 or CUSUM_DECREASE.
+ */
+void cusum_init_page_hinkley(struct cusum *c, int32_t delta, uint8_t mean_shift,
+                             uint8_t flags, int32_t threshold);
+
+/* Clears the statistic, and the running mean of Page-Hinkley */
+void cusum_reset(struct cusum *c);
+
+/* Adds one sample and returns 1 if the detector is in alarm */
+int cusum_update(struct cusum *c, uint16_t sample);
+
+/*
+ * Adds up to n samples, stopping after the first one that puts the
+ * detector in alarm.  Returns the number of samples consumed; use
+ * cusum_alarm() to tell whether it stopped early.
+ */
+uint16_t cusum_update_batch(struct cusum *c, const uint16_t *samples, uint16_t n);
+
+#define cusum_alarm(c) ((c)->g >= (c)->threshold)
+
+/* ln(x) in Q8, from a lookup table; ln(0) is returned as 0 */
+int32_t cusum_ln(uint16_t x);
+
+#endif /* __CUSUM_H__ */
@@ -1,7 +1,7 @@
 #include <stdio.h>
 #include "contiki.h"
 #include "sky-transmission.h"
-#include "sky-math.h"
+#include "cusum.h"
 #include "shell.h"
 #include "dev/leds.h"
 #include "dev/light-sensor.h"
@@ -29,23 +29,11 @@ PROCESS_THREAD(shell_adaptive_cusum_process, ev, data)
 	
 	// delta and epsilon are arbitrarily chosen, will affect how quickly
 	// the cusum algorithm converges as well as how noisy it is
-	uint16_t delta = 1;
-	uint16_t epsilon = 1;
-
 	// phi_min and phi_max are dependent on the ADC of the motes, which is 12-bit
-	uint16_t phi_min = 0;
-	uint16_t phi_max = 4096;
-	static uint16_t phi_hat_a;
-	phi_hat_a = sample_mean - delta/2;
-	static uint16_t phi_hat_b;
-	phi_hat_b = sample_mean + delta/2;
-	static uint16_t phi_hat = 0;
-
-	// Standard CUSUM variables
 	// Note: threshold "b" is arbitrarily chosen
-	static int16_t S_n = 0;
-	static int16_t minS_n = 0;
-	static uint8_t b = 80;
+	static struct cusum detector;
+	cusum_init_adaptive(&detector, sample_mean, 1, CUSUM_FIXED(1), CUSUM_FIXED(1),
+	                    0, 4096, CUSUM_FIXED(ZK_BOUND), CUSUM_FIXED(80));
 	static uint8_t detected = 0;
 
 
@@ -67,42 +55,22 @@ PROCESS_THREAD(shell_adaptive_cusum_process, ev, data)
 		}
 */
 
-	   	// Calculate D_k, essentially a metric of instantaneous change
-		int16_t D_k = (mypow2(obs - phi_hat_a))/2 - (mypow2(obs - phi_hat_b))/2;
-		
-		// Recursion rule
-		phi_hat_a = phi_hat_a + epsilon * D_k;
-		phi_hat_b = phi_hat_a + delta;
-
-		// Calculate parameter estimate (phi_hat) and check bounds
-		phi_hat = phi_hat_a + 0.5 * delta;
-		if (phi_hat > phi_max) 
-			phi_hat = phi_max;
-		else if (phi_hat < phi_min)
-			phi_hat = phi_min;
-		
-		// Run CUSUM test normally, using phi_hat
-		// And find new log-likelihood statistic
-		int16_t z_k = (mypow2(obs - sample_mean))/2 - (mypow2(obs - phi_hat))/2;
-		if (ZK_BOUND * -1 < z_k && z_k < ZK_BOUND)
-			z_k = 0;
-
-		// Add the log-likelihood statistic to the current CUSUM
-		S_n = S_n + z_k;
-	
-		// Check to see if a change was detected or not
-		if (S_n >= (minS_n + b))
+		// Estimate the post-change mean (phi_hat) and add the log-likelihood
+		// statistic, with small ones ignored, to the current CUSUM
+		if (cusum_update(&detector, obs))
 		{
 			leds_on(LEDS_RED);
 //			etimer_set(&led_timer, 5*CLOCK_SECOND);
 			detected = 1;
 //			led_time = clock_time();
-		} else if (S_n < minS_n)
-			minS_n = S_n;
+		}
+
+		// D_k is essentially a metric of instantaneous change
+		int16_t D_k = detector.u.adaptive.d >> CUSUM_FRACTION_BITS;
 		if (D_k < DK_BOUND * -1 || DK_BOUND < D_k)
 			leds_on(LEDS_BLUE);
 		else leds_off(LEDS_BLUE);
-		printf("S_n: %d\nD_k: %d\n", S_n, D_k);
+		printf("S_n: %ld\nD_k: %d\n", (long)(detector.g >> CUSUM_FRACTION_BITS), D_k);
 	}
 
 	PROCESS_END();
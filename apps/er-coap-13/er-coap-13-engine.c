@@ -71,6 +71,145 @@ PROCESS(coap_receiver, "CoAP Receiver");
 /*- Variables ----------------------------------------------------------------*/
 /*----------------------------------------------------------------------------*/
 static service_callback_t service_cbk = NULL;
+
+#if COAP_BLOCK_CACHE_SIZE
+typedef struct {
+  uip_ipaddr_t addr;
+  uint16_t port;
+  uint32_t key; /* hash of Uri-Path and Uri-Query */
+  uint32_t offset; /* offset of the first cached byte in the representation */
+  uint16_t length;
+  uint8_t more; /* the representation continues after the cached bytes */
+  uint8_t code;
+  int content_type; /* -1 if not set */
+  uint8_t etag_len;
+  uint8_t etag[COAP_ETAG_LEN];
+  struct timer expires;
+  uint8_t data[REST_MAX_CHUNK_SIZE];
+} coap_block_cache_t;
+
+static coap_block_cache_t block_cache[COAP_BLOCK_CACHE_SIZE];
+#endif
+/*----------------------------------------------------------------------------*/
+/*- Block cache --------------------------------------------------------------*/
+/*----------------------------------------------------------------------------*/
+#if COAP_BLOCK_CACHE_SIZE
+static
+uint32_t
+coap_block_cache_hash(uint32_t hash, const char *str, int len)
+{
+  /* FNV-1a */
+  while (len-- > 0)
+  {
+    hash ^= (uint8_t) *str++;
+    hash *= 16777619UL;
+  }
+  return hash;
+}
+/*----------------------------------------------------------------------------*/
+static
+uint32_t
+coap_block_cache_key(coap_packet_t *request)
+{
+  const char *str = NULL;
+  int len = 0;
+  uint32_t key = 2166136261UL;
+
+  len = coap_get_header_uri_path(request, &str);
+  key = coap_block_cache_hash(key, str, len);
+  len = coap_get_header_uri_query(request, &str);
+  key = coap_block_cache_hash(key, "?", 1);
+  key = coap_block_cache_hash(key, str, len);
+
+  return key;
+}
+/*----------------------------------------------------------------------------*/
+static
+coap_block_cache_t *
+coap_block_cache_lookup(uip_ipaddr_t *addr, uint16_t port, uint32_t key, uint32_t offset)
+{
+  coap_block_cache_t *entry = NULL;
+
+  for (entry = block_cache; entry < block_cache+COAP_BLOCK_CACHE_SIZE; ++entry)
+  {
+    if (entry->length && !timer_expired(&entry->expires)
+        && entry->key==key && entry->port==port && uip_ipaddr_cmp(&entry->addr, addr)
+        && offset>=entry->offset && offset-entry->offset < entry->length)
+    {
+      return entry;
+    }
+  }
+  return NULL;
+}
+/*----------------------------------------------------------------------------*/
+static
+void
+coap_block_cache_store(uip_ipaddr_t *addr, uint16_t port, uint32_t key, uint32_t offset, coap_packet_t *response, uint8_t more)
+{
+  coap_block_cache_t *entry = NULL;
+  coap_block_cache_t *victim = block_cache;
+  const uint8_t *etag = NULL;
+
+  if (response->payload_len==0 || response->payload_len > REST_MAX_CHUNK_SIZE)
+  {
+    return;
+  }
+
+  /* Replace an older part of the same transfer, or a free or the oldest entry. */
+  for (entry = block_cache; entry < block_cache+COAP_BLOCK_CACHE_SIZE; ++entry)
+  {
+    if (entry->length==0 || timer_expired(&entry->expires)
+        || (entry->key==key && entry->port==port && uip_ipaddr_cmp(&entry->addr, addr)))
+    {
+      victim = entry;
+      break;
+    }
+    if (timer_remaining(&entry->expires) < timer_remaining(&victim->expires))
+    {
+      victim = entry;
+    }
+  }
+
+  PRINTF("Block cache: storing %u bytes @ %lu%s\n", response->payload_len, offset, more ? "+" : "");
+
+  uip_ipaddr_copy(&victim->addr, addr);
+  victim->port = port;
+  victim->key = key;
+  victim->offset = offset;
+  victim->length = response->payload_len;
+  victim->more = more;
+  victim->code = response->code;
+  victim->content_type = IS_OPTION(response, COAP_OPTION_CONTENT_TYPE) ? (int) response->content_type : -1;
+  victim->etag_len = coap_get_header_etag(response, &etag);
+  memcpy(victim->etag, etag, victim->etag_len);
+  memcpy(victim->data, response->payload, response->payload_len);
+  timer_set(&victim->expires, COAP_BLOCK_CACHE_LIFETIME * CLOCK_SECOND);
+}
+/*----------------------------------------------------------------------------*/
+static
+void
+coap_block_cache_respond(coap_block_cache_t *entry, coap_packet_t *response, uint8_t *buffer, uint32_t block_num, uint16_t block_size, uint32_t block_offset)
+{
+  uint16_t pos = block_offset - entry->offset;
+  uint16_t len = MIN(entry->length - pos, block_size);
+
+  PRINTF("Block cache: serving block %lu from %lu bytes @ %lu\n", block_num, entry->length, entry->offset);
+
+  response->code = entry->code;
+  if (entry->content_type>=0)
+  {
+    coap_set_header_content_type(response, entry->content_type);
+  }
+  if (entry->etag_len)
+  {
+    coap_set_header_etag(response, entry->etag, entry->etag_len);
+  }
+
+  memcpy(buffer, entry->data+pos, len);
+  coap_set_header_block2(response, block_num, entry->more || pos+len < entry->length, block_size);
+  coap_set_payload(response, buffer, len);
+}
+#endif /* COAP_BLOCK_CACHE_SIZE */
 /*----------------------------------------------------------------------------*/
 /*----------------------------------------------------------------------------*/
 /*----------------------------------------------------------------------------*/
@@ -116,6 +255,11 @@ coap_receive(void)
           uint16_t block_size = REST_MAX_CHUNK_SIZE;
           uint32_t block_offset = 0;
           int32_t new_offset = 0;
+#if COAP_BLOCK_CACHE_SIZE
+          coap_block_cache_t *cached = NULL;
+          uint32_t cache_key = 0;
+          uint8_t cacheable = 0;
+#endif
 
           /* prepare response */
           if (message->type==COAP_TYPE_CON)
@@ -143,11 +287,38 @@ coap_receive(void)
               new_offset = block_offset;
           }
 
+#if COAP_BLOCK_CACHE_SIZE
+          /* Later blocks of a cached GET representation do not need the resource handler. */
+          if (IS_OPTION(message, COAP_OPTION_BLOCK2) && message->code==COAP_GET && !IS_OPTION(message, COAP_OPTION_OBSERVE))
+          {
+            cacheable = 1;
+            cache_key = coap_block_cache_key(message);
+            if (block_num>0)
+            {
+              cached = coap_block_cache_lookup(&UIP_IP_BUF->srcipaddr, UIP_UDP_BUF->srcport, cache_key, block_offset);
+            }
+          }
+#endif
+
           /* Invoke resource handler. */
           if (service_cbk)
           {
+#if COAP_BLOCK_CACHE_SIZE
+            if (cached)
+            {
+              coap_block_cache_respond(cached, response, transaction->packet+COAP_MAX_HEADER_SIZE, block_num, block_size, block_offset);
+            }
+            else
+#endif
             /* Call REST framework and check if found and allowed. */
-            if (service_cbk(message, response, transaction->packet+COAP_MAX_HEADER_SIZE, block_size, &new_offset))
+            if (service_cbk(message, response, transaction->packet+COAP_MAX_HEADER_SIZE,
+#if COAP_BLOCK_CACHE_SIZE
+                            /* A whole chunk also covers the following blocks from the cache. */
+                            cacheable ? REST_MAX_CHUNK_SIZE : block_size,
+#else
+                            block_size,
+#endif
+                            &new_offset))
             {
               if (coap_error_code==NO_ERROR)
               {
@@ -174,6 +345,12 @@ coap_receive(void)
                     }
                     else
                     {
+#if COAP_BLOCK_CACHE_SIZE
+                      if (cacheable && response->code<BAD_REQUEST_4_00)
+                      {
+                        coap_block_cache_store(&UIP_IP_BUF->srcipaddr, UIP_UDP_BUF->srcport, cache_key, 0, response, 0);
+                      }
+#endif
                       coap_set_header_block2(response, block_num, response->payload_len - block_offset > block_size, block_size);
                       coap_set_payload(response, response->payload+block_offset, MIN(response->payload_len - block_offset, block_size));
                     } /* if (valid offset) */
@@ -182,6 +359,12 @@ coap_receive(void)
                   {
                     /* resource provides chunk-wise data */
                     PRINTF("Blockwise: blockwise resource, new offset %ld\n", new_offset);
+#if COAP_BLOCK_CACHE_SIZE
+                    if (cacheable && response->code<BAD_REQUEST_4_00)
+                    {
+                      coap_block_cache_store(&UIP_IP_BUF->srcipaddr, UIP_UDP_BUF->srcport, cache_key, block_offset, response, new_offset!=-1);
+                    }
+#endif
                     coap_set_header_block2(response, block_num, new_offset!=-1 || response->payload_len > block_size, block_size);
                     if (response->payload_len > block_size) coap_set_payload(response, response->payload, block_size);
                   } /* if (resource aware of blockwise) */
@@ -518,16 +701,110 @@ PROCESS_THREAD(coap_receiver, ev, data)
 /*----------------------------------------------------------------------------*/
 /*- Client part --------------------------------------------------------------*/
 /*----------------------------------------------------------------------------*/
+enum {
+  BLOCK_FREE,
+  BLOCK_PENDING,
+  BLOCK_RECEIVED,
+  BLOCK_TIMEOUT
+};
+
+#if COAP_BLOCKING_WINDOW > 1
+/* Responses are handed to the response handler one at a time. */
+static coap_packet_t blocking_response[1];
+#endif
+/*----------------------------------------------------------------------------*/
 void coap_blocking_request_callback(void *callback_data, void *response) {
-  struct request_state_t *state = (struct request_state_t *) callback_data;
-  state->response = (coap_packet_t*) response;
-  process_poll(state->process);
+  struct request_block_t *block = (struct request_block_t *) callback_data;
+  coap_packet_t *const coap_pkt = (coap_packet_t *) response;
+
+  /* The transaction layer already freed the transaction. */
+  block->transaction = NULL;
+
+  if (coap_pkt)
+  {
+#if COAP_BLOCKING_WINDOW > 1
+    /* Keep the datagram, as the response may arrive before the preceding blocks. */
+    if (coap_pkt->payload)
+    {
+      block->length = coap_pkt->payload + coap_pkt->payload_len - coap_pkt->buffer;
+    }
+    else
+    {
+      block->length = COAP_HEADER_LEN + coap_pkt->token_len + coap_pkt->options_len;
+    }
+    block->length = MIN(block->length, COAP_MAX_PACKET_SIZE);
+    memcpy(block->buffer, coap_pkt->buffer, block->length);
+#else
+    block->response = coap_pkt;
+#endif
+    block->status = BLOCK_RECEIVED;
+  }
+  else
+  {
+    block->status = BLOCK_TIMEOUT;
+  }
+
+  process_poll(block->state->process);
+}
+/*----------------------------------------------------------------------------*/
+static
+int
+coap_blocking_request_block(struct request_block_t *block, uint32_t block_num,
+                            uip_ipaddr_t *remote_ipaddr, uint16_t remote_port,
+                            coap_packet_t *request)
+{
+  request->mid = coap_get_mid();
+  if (!(block->transaction = coap_new_transaction(request->mid, remote_ipaddr, remote_port)))
+  {
+    return 0;
+  }
+
+  block->transaction->callback = coap_blocking_request_callback;
+  block->transaction->callback_data = block;
+  block->block_num = block_num;
+  block->status = BLOCK_PENDING;
+
+  /* Ask for the first block explicitly when requesting the following ones in parallel. */
+  if (block_num>0 || COAP_BLOCKING_WINDOW>1)
+  {
+    coap_set_header_block2(request, block_num, 0, REST_MAX_CHUNK_SIZE);
+  }
+
+  block->transaction->packet_len = coap_serialize_message(request, block->transaction->packet);
+
+  coap_send_transaction(block->transaction);
+  PRINTF("Requested #%lu (MID %u)\n", block_num, request->mid);
+
+  return 1;
+}
+/*----------------------------------------------------------------------------*/
+static
+void
+coap_blocking_request_cancel(struct request_state_t *state, uint32_t from)
+{
+  int i;
+
+  for (i=0; i<COAP_BLOCKING_WINDOW; ++i)
+  {
+    if (state->blocks[i].status!=BLOCK_FREE && state->blocks[i].block_num>=from)
+    {
+      if (state->blocks[i].transaction)
+      {
+        coap_clear_transaction(state->blocks[i].transaction);
+        state->blocks[i].transaction = NULL;
+      }
+      state->blocks[i].status = BLOCK_FREE;
+    }
+  }
 }
 /*----------------------------------------------------------------------------*/
 PT_THREAD(coap_blocking_request(struct request_state_t *state, process_event_t ev,
                                 uip_ipaddr_t *remote_ipaddr, uint16_t remote_port,
                                 coap_packet_t *request,
                                 blocking_response_handler request_callback)) {
+  struct request_block_t *block = NULL;
+  int i;
+
   PT_BEGIN(&state->pt);
 
   static uint8_t more;
@@ -535,59 +812,115 @@ PT_THREAD(coap_blocking_request(struct request_state_t *state, process_event_t e
   static uint8_t block_error;
 
   state->block_num = 0;
+  state->next_block = 0;
+  state->last_block = 0xFFFFFFFF;
   state->response = NULL;
   state->process = PROCESS_CURRENT();
 
+  for (i=0; i<COAP_BLOCKING_WINDOW; ++i)
+  {
+    state->blocks[i].state = state;
+    state->blocks[i].transaction = NULL;
+    state->blocks[i].status = BLOCK_FREE;
+  }
+
   more = 0;
   res_block = 0;
   block_error = 0;
 
   do {
-    request->mid = coap_get_mid();
-    if ((state->transaction = coap_new_transaction(request->mid, remote_ipaddr, remote_port)))
+    /* Keep the window filled with requests for the following blocks. */
+    for (i=0; i<COAP_BLOCKING_WINDOW && state->next_block<=state->last_block; ++i)
     {
-      state->transaction->callback = coap_blocking_request_callback;
-      state->transaction->callback_data = state;
-
-      if (state->block_num>0)
+      if (state->blocks[i].status==BLOCK_FREE)
       {
-        coap_set_header_block2(request, state->block_num, 0, REST_MAX_CHUNK_SIZE);
+        if (!coap_blocking_request_block(&state->blocks[i], state->next_block, remote_ipaddr, remote_port, request))
+        {
+          break;
+        }
+        ++(state->next_block);
       }
+    }
 
-      state->transaction->packet_len = coap_serialize_message(request, state->transaction->packet);
+    if (state->next_block==state->block_num)
+    {
+      PRINTF("Could not allocate transaction buffer");
+      PT_EXIT(&state->pt);
+    }
 
-      coap_send_transaction(state->transaction);
-      PRINTF("Requested #%lu (MID %u)\n", state->block_num, request->mid);
+    PT_YIELD_UNTIL(&state->pt, ev == PROCESS_EVENT_POLL);
 
-      PT_YIELD_UNTIL(&state->pt, ev == PROCESS_EVENT_POLL);
+    /* Hand over the received blocks in order. */
+    do {
+      block = NULL;
+      for (i=0; i<COAP_BLOCKING_WINDOW; ++i)
+      {
+        if (state->blocks[i].status!=BLOCK_FREE && state->blocks[i].block_num==state->block_num)
+        {
+          block = &state->blocks[i];
+          break;
+        }
+      }
+
+      if (block==NULL || block->status==BLOCK_PENDING)
+      {
+        break;
+      }
 
-      if (!state->response)
+      if (block->status==BLOCK_TIMEOUT)
       {
         PRINTF("Server not responding\n");
+        state->response = NULL;
+        coap_blocking_request_cancel(state, 0);
         PT_EXIT(&state->pt);
       }
 
+#if COAP_BLOCKING_WINDOW > 1
+      coap_parse_message(blocking_response, block->buffer, block->length);
+      state->response = blocking_response;
+#else
+      state->response = block->response;
+#endif
+
+      res_block = block->block_num;
+      more = 0;
       coap_get_header_block2(state->response, &res_block, &more, NULL, NULL);
 
       PRINTF("Received #%lu%s (%u bytes)\n", res_block, more ? "+" : "", state->response->payload_len);
 
       if (res_block==state->block_num)
       {
+        block->status = BLOCK_FREE;
         request_callback(state->response);
+
+        if (!more)
+        {
+          /* Requests beyond the last block are answered with errors. */
+          state->last_block = state->block_num;
+          coap_blocking_request_cancel(state, state->last_block+1);
+        }
         ++(state->block_num);
       }
       else
       {
         PRINTF("WRONG BLOCK %lu/%lu\n", res_block, state->block_num);
         ++block_error;
+
+        /* Request the block again in the same slot. */
+        block->status = BLOCK_FREE;
+        if (block_error<COAP_MAX_ATTEMPTS && !coap_blocking_request_block(block, state->block_num, remote_ipaddr, remote_port, request))
+        {
+          PRINTF("Could not allocate transaction buffer");
+          coap_blocking_request_cancel(state, 0);
+          PT_EXIT(&state->pt);
+        }
+        break;
       }
-    }
-    else
-    {
-      PRINTF("Could not allocate transaction buffer");
-      PT_EXIT(&state->pt);
-    }
-  } while (more && block_error<COAP_MAX_ATTEMPTS);
+    } while (state->block_num<=state->last_block);
+
+  } while (state->block_num<=state->last_block && block_error<COAP_MAX_ATTEMPTS);
+
+  coap_blocking_request_cancel(state, 0);
 
   PT_END(&state->pt);
 }
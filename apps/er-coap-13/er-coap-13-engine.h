@@ -55,6 +55,29 @@ PROCESS_NAME(coap_receiver);
 
 #define SERVER_LISTEN_PORT      UIP_HTONS(COAP_SERVER_PORT)
 
+/*
+ * The number of Block2 responses the server keeps per client and resource, so that the
+ * remaining blocks of a transfer are served without invoking the resource handler again.
+ * Set to 0 to disable the cache.
+ */
+#ifndef COAP_BLOCK_CACHE_SIZE
+#define COAP_BLOCK_CACHE_SIZE 0
+#endif /* COAP_BLOCK_CACHE_SIZE */
+
+/* Seconds after which a cached Block2 response is no longer used. */
+#ifndef COAP_BLOCK_CACHE_LIFETIME
+#define COAP_BLOCK_CACHE_LIFETIME 10
+#endif /* COAP_BLOCK_CACHE_LIFETIME */
+
+/*
+ * The number of Block2 requests a blocking client keeps in flight. Each block is an own
+ * transaction and retransmitted independently, so the window should not exceed
+ * COAP_MAX_OPEN_TRANSACTIONS.
+ */
+#ifndef COAP_BLOCKING_WINDOW
+#define COAP_BLOCKING_WINDOW 1
+#endif /* COAP_BLOCKING_WINDOW */
+
 typedef coap_packet_t rest_request_t;
 typedef coap_packet_t rest_response_t;
 
@@ -65,12 +88,33 @@ void coap_receiver_init(void);
 /*-----------------------------------------------------------------------------------*/
 /*- Client part ---------------------------------------------------------------------*/
 /*-----------------------------------------------------------------------------------*/
+struct request_state_t;
+
+/*
+ * A block request in flight and its response. With a window, responses may arrive out of
+ * order and are buffered; otherwise the parsed response is used before the next one arrives.
+ */
+struct request_block_t {
+    struct request_state_t *state;
+    coap_transaction_t *transaction;
+    uint32_t block_num;
+    uint8_t status;
+#if COAP_BLOCKING_WINDOW > 1
+    uint16_t length;
+    uint8_t buffer[COAP_MAX_PACKET_SIZE+1];
+#else
+    coap_packet_t *response;
+#endif
+};
+
 struct request_state_t {
     struct pt pt;
     struct process *process;
-    coap_transaction_t *transaction;
     coap_packet_t *response;
-    uint32_t block_num;
+    uint32_t block_num; /* next block to hand to the response handler */
+    uint32_t next_block; /* next block to request */
+    uint32_t last_block;
+    struct request_block_t blocks[COAP_BLOCKING_WINDOW];
 };
 
 typedef void (*blocking_response_handler) (void* response);
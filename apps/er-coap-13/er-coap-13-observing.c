@@ -56,6 +56,73 @@
 MEMB(observers_memb, coap_observer_t, COAP_MAX_OBSERVERS);
 LIST(observers_list);
 
+static coap_observer_t *observer_hash[COAP_OBSERVER_INDICES][COAP_OBSERVER_HASH_SIZE];
+
+/*-----------------------------------------------------------------------------------*/
+static
+unsigned int
+coap_observer_hash_bytes(const uint8_t *bytes, size_t length)
+{
+  /* FNV-1a */
+  uint16_t hash = 0x9dc5;
+
+  while (length--)
+  {
+    hash ^= *bytes++;
+    hash *= 0x0193;
+  }
+  return hash % COAP_OBSERVER_HASH_SIZE;
+}
+/*-----------------------------------------------------------------------------------*/
+static
+unsigned int
+coap_observer_bucket(coap_observer_t *o, int index)
+{
+  switch (index)
+  {
+    case COAP_OBSERVER_BY_URL:
+      return coap_observer_hash_bytes((const uint8_t *) o->url, strlen(o->url));
+    case COAP_OBSERVER_BY_TOKEN:
+      return coap_observer_hash_bytes(o->token, o->token_len);
+    default:
+      return o->last_mid % COAP_OBSERVER_HASH_SIZE;
+  }
+}
+/*-----------------------------------------------------------------------------------*/
+static
+void
+coap_observer_link(coap_observer_t *o, int index)
+{
+  coap_observer_t **bucket = &observer_hash[index][coap_observer_bucket(o, index)];
+
+  o->hash_next[index] = *bucket;
+  *bucket = o;
+}
+/*-----------------------------------------------------------------------------------*/
+static
+void
+coap_observer_unlink(coap_observer_t *o, int index)
+{
+  coap_observer_t **prev = &observer_hash[index][coap_observer_bucket(o, index)];
+
+  while (*prev && *prev!=o)
+  {
+    prev = &(*prev)->hash_next[index];
+  }
+  if (*prev)
+  {
+    *prev = o->hash_next[index];
+  }
+}
+/*-----------------------------------------------------------------------------------*/
+static
+void
+coap_observer_set_mid(coap_observer_t *o, uint16_t mid)
+{
+  coap_observer_unlink(o, COAP_OBSERVER_BY_MID);
+  o->last_mid = mid;
+  coap_observer_link(o, COAP_OBSERVER_BY_MID);
+}
 /*-----------------------------------------------------------------------------------*/
 coap_observer_t *
 coap_add_observer(uip_ipaddr_t *addr, uint16_t port, const uint8_t *token, size_t token_len, const char *url)
@@ -67,6 +134,8 @@ coap_add_observer(uip_ipaddr_t *addr, uint16_t port, const uint8_t *token, size_
 
   if (o)
   {
+    int index;
+
     o->url = url;
     uip_ipaddr_copy(&o->addr, addr);
     o->port = port;
@@ -78,6 +147,11 @@ coap_add_observer(uip_ipaddr_t *addr, uint16_t port, const uint8_t *token, size_
 
     PRINTF("Adding observer for /%s [0x%02X%02X]\n", o->url, o->token[0], o->token[1]);
     list_add(observers_list, o);
+
+    for (index=0; index<COAP_OBSERVER_INDICES; ++index)
+    {
+      coap_observer_link(o, index);
+    }
   }
 
   return o;
@@ -86,10 +160,17 @@ coap_add_observer(uip_ipaddr_t *addr, uint16_t port, const uint8_t *token, size_
 void
 coap_remove_observer(coap_observer_t *o)
 {
+  int index;
+
   PRINTF("Removing observer for /%s [0x%02X%02X]\n", o->url, o->token[0], o->token[1]);
 
-  memb_free(&observers_memb, o);
+  for (index=0; index<COAP_OBSERVER_INDICES; ++index)
+  {
+    coap_observer_unlink(o, index);
+  }
+
   list_remove(observers_list, o);
+  memb_free(&observers_memb, o);
 }
 
 int
@@ -97,9 +178,11 @@ coap_remove_observer_by_client(uip_ipaddr_t *addr, uint16_t port)
 {
   int removed = 0;
   coap_observer_t* obs = NULL;
+  coap_observer_t* next = NULL;
 
-  for (obs = (coap_observer_t*)list_head(observers_list); obs; obs = obs->next)
+  for (obs = (coap_observer_t*)list_head(observers_list); obs; obs = next)
   {
+    next = obs->next;
     PRINTF("Remove check client ");
     PRINT6ADDR(addr);
     PRINTF(":%u\n", port);
@@ -117,9 +200,11 @@ coap_remove_observer_by_token(uip_ipaddr_t *addr, uint16_t port, uint8_t *token,
 {
   int removed = 0;
   coap_observer_t* obs = NULL;
+  coap_observer_t* next = NULL;
 
-  for (obs = (coap_observer_t*)list_head(observers_list); obs; obs = obs->next)
+  for (obs = observer_hash[COAP_OBSERVER_BY_TOKEN][coap_observer_hash_bytes(token, token_len)]; obs; obs = next)
   {
+    next = obs->hash_next[COAP_OBSERVER_BY_TOKEN];
     PRINTF("Remove check Token 0x%02X%02X\n", token[0], token[1]);
     if (uip_ipaddr_cmp(&obs->addr, addr) && obs->port==port && obs->token_len==token_len && memcmp(obs->token, token, token_len)==0)
     {
@@ -135,11 +220,13 @@ coap_remove_observer_by_url(uip_ipaddr_t *addr, uint16_t port, const char *url)
 {
   int removed = 0;
   coap_observer_t* obs = NULL;
+  coap_observer_t* next = NULL;
 
-  for (obs = (coap_observer_t*)list_head(observers_list); obs; obs = obs->next)
+  for (obs = observer_hash[COAP_OBSERVER_BY_URL][coap_observer_hash_bytes((const uint8_t *) url, strlen(url))]; obs; obs = next)
   {
+    next = obs->hash_next[COAP_OBSERVER_BY_URL];
     PRINTF("Remove check URL %p\n", url);
-    if ((addr==NULL || (uip_ipaddr_cmp(&obs->addr, addr) && obs->port==port)) && (obs->url==url || memcmp(obs->url, url, strlen(obs->url))==0))
+    if ((addr==NULL || (uip_ipaddr_cmp(&obs->addr, addr) && obs->port==port)) && (obs->url==url || strcmp(obs->url, url)==0))
     {
       coap_remove_observer(obs);
       removed++;
@@ -153,9 +240,11 @@ coap_remove_observer_by_mid(uip_ipaddr_t *addr, uint16_t port, uint16_t mid)
 {
   int removed = 0;
   coap_observer_t* obs = NULL;
+  coap_observer_t* next = NULL;
 
-  for (obs = (coap_observer_t*)list_head(observers_list); obs; obs = obs->next)
+  for (obs = observer_hash[COAP_OBSERVER_BY_MID][mid % COAP_OBSERVER_HASH_SIZE]; obs; obs = next)
   {
+    next = obs->hash_next[COAP_OBSERVER_BY_MID];
     PRINTF("Remove check MID %u\n", mid);
     if (uip_ipaddr_cmp(&obs->addr, addr) && obs->port==port && obs->last_mid==mid)
     {
@@ -166,17 +255,39 @@ coap_remove_observer_by_mid(uip_ipaddr_t *addr, uint16_t port, uint16_t mid)
   return removed;
 }
 /*-----------------------------------------------------------------------------------*/
+/*
+ * Copies a notification that was serialized for another observer and patches
+ * the fields that differ between observers: the type, the MID, and the Token.
+ */
+static
+void
+coap_copy_notification(coap_transaction_t *transaction, coap_transaction_t *template, coap_observer_t *obs, uint8_t type)
+{
+  memcpy(transaction->packet, template->packet, template->packet_len);
+  transaction->packet_len = template->packet_len;
+
+  transaction->packet[0] &= ~COAP_HEADER_TYPE_MASK;
+  transaction->packet[0] |= COAP_HEADER_TYPE_MASK & type<<COAP_HEADER_TYPE_POSITION;
+  transaction->packet[2] = (uint8_t) (transaction->mid>>8);
+  transaction->packet[3] = (uint8_t) (transaction->mid);
+  memcpy(transaction->packet+COAP_HEADER_LEN, obs->token, obs->token_len);
+}
+/*-----------------------------------------------------------------------------------*/
 void
 coap_notify_observers(resource_t *resource, int32_t obs_counter, void *notification)
 {
   coap_packet_t *const coap_res = (coap_packet_t *) notification;
   coap_observer_t* obs = NULL;
+  coap_transaction_t *previous = NULL;
   uint8_t preferred_type = coap_res->type;
+  uint8_t type;
 
   PRINTF("Observing: Notification from %s\n", resource->url);
 
-  /* Iterate over observers. */
-  for (obs = (coap_observer_t*)list_head(observers_list); obs; obs = obs->next)
+  if (obs_counter>=0) coap_set_header_observe(coap_res, obs_counter);
+
+  /* Iterate over the observers of the resource. */
+  for (obs = observer_hash[COAP_OBSERVER_BY_URL][coap_observer_hash_bytes((const uint8_t *) resource->url, strlen(resource->url))]; obs; obs = obs->hash_next[COAP_OBSERVER_BY_URL])
   {
     if (obs->url==resource->url) /* using RESOURCE url pointer as handle */
     {
@@ -184,38 +295,63 @@ coap_notify_observers(resource_t *resource, int32_t obs_counter, void *notificat
 
       /*TODO implement special transaction for CON, sharing the same buffer to allow for more observers. */
 
-      if ( (transaction = coap_new_transaction(coap_get_mid(), &obs->addr, obs->port)) )
+      if ( !(transaction = coap_new_transaction(coap_get_mid(), &obs->addr, obs->port)) && previous )
+      {
+        /* Sending the previous notification may free its transaction. */
+        coap_send_transaction(previous);
+        previous = NULL;
+        transaction = coap_new_transaction(coap_get_mid(), &obs->addr, obs->port);
+      }
+
+      if (transaction)
       {
         PRINTF("           Observer ");
         PRINT6ADDR(&obs->addr);
         PRINTF(":%u\n", obs->port);
 
         /* Update last MID for RST matching. */
-        obs->last_mid = transaction->mid;
-
-        /* Prepare response */
-        coap_res->mid = transaction->mid;
-        if (obs_counter>=0) coap_set_header_observe(coap_res, obs_counter);
-        coap_set_header_token(coap_res, obs->token, obs->token_len);
+        coap_observer_set_mid(obs, transaction->mid);
 
         /* Use CON to check whether client is still there/interested after COAP_OBSERVING_REFRESH_INTERVAL. */
         if (stimer_expired(&obs->refresh_timer))
         {
           PRINTF("           Refreshing with CON\n");
-          coap_res->type = COAP_TYPE_CON;
+          type = COAP_TYPE_CON;
           stimer_restart(&obs->refresh_timer);
         }
         else
         {
-          coap_res->type = preferred_type;
+          type = preferred_type;
         }
 
-        transaction->packet_len = coap_serialize_message(coap_res, transaction->packet);
+        /* The notification is only serialized again if the Token length changes. */
+        if (previous && previous->packet_len && coap_res->token_len==obs->token_len)
+        {
+          coap_copy_notification(transaction, previous, obs, type);
+        }
+        else
+        {
+          coap_res->mid = transaction->mid;
+          coap_res->type = type;
+          coap_set_header_token(coap_res, obs->token, obs->token_len);
 
-        coap_send_transaction(transaction);
+          transaction->packet_len = coap_serialize_message(coap_res, transaction->packet);
+        }
+
+        /* The previous notification is sent once it has been copied. */
+        if (previous)
+        {
+          coap_send_transaction(previous);
+        }
+        previous = transaction;
       }
     }
   }
+
+  if (previous)
+  {
+    coap_send_transaction(previous);
+  }
 }
 /*-----------------------------------------------------------------------------------*/
 void
@@ -47,6 +47,11 @@
 #define COAP_MAX_OBSERVERS    COAP_MAX_OPEN_TRANSACTIONS-1
 #endif /* COAP_MAX_OBSERVERS */
 
+/* The number of hash buckets used for each of the observer lookups by URL, Token, and MID. */
+#ifndef COAP_OBSERVER_HASH_SIZE
+#define COAP_OBSERVER_HASH_SIZE 4
+#endif /* COAP_OBSERVER_HASH_SIZE */
+
 /* Interval in seconds in which NON notifies are changed to CON notifies to check client. */
 #define COAP_OBSERVING_REFRESH_INTERVAL  60
 
@@ -54,8 +59,17 @@
 #warning "COAP_MAX_OPEN_TRANSACTIONS smaller than COAP_MAX_OBSERVERS: cannot handle CON notifications"
 #endif
 
+/* The hash indices in which each observer is linked. */
+enum {
+  COAP_OBSERVER_BY_URL,
+  COAP_OBSERVER_BY_TOKEN,
+  COAP_OBSERVER_BY_MID,
+  COAP_OBSERVER_INDICES
+};
+
 typedef struct coap_observer {
   struct coap_observer *next; /* for LIST */
+  struct coap_observer *hash_next[COAP_OBSERVER_INDICES]; /* next observer in the same hash bucket of each index */
 
   const char *url;
   uip_ipaddr_t addr;
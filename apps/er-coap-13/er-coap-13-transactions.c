@@ -65,6 +65,8 @@
 MEMB(transactions_memb, coap_transaction_t, COAP_MAX_OPEN_TRANSACTIONS);
 LIST(transactions_list);
 
+static coap_transaction_t *transactions_by_mid[COAP_TRANSACTION_HASH_SIZE];
+
 
 static struct process *transaction_handler_process = NULL;
 
@@ -89,6 +91,9 @@ coap_new_transaction(uint16_t mid, uip_ipaddr_t *addr, uint16_t port)
     t->port = port;
 
     list_add(transactions_list, t); /* List itself makes sure same element is not added twice. */
+
+    t->hash_next = transactions_by_mid[mid % COAP_TRANSACTION_HASH_SIZE];
+    transactions_by_mid[mid % COAP_TRANSACTION_HASH_SIZE] = t;
   }
 
   return t;
@@ -162,6 +167,17 @@ coap_clear_transaction(coap_transaction_t *t)
 
     etimer_stop(&t->retrans_timer);
     list_remove(transactions_list, t);
+
+    coap_transaction_t **prev = &transactions_by_mid[t->mid % COAP_TRANSACTION_HASH_SIZE];
+    while (*prev && *prev!=t)
+    {
+      prev = &(*prev)->hash_next;
+    }
+    if (*prev)
+    {
+      *prev = t->hash_next;
+    }
+
     memb_free(&transactions_memb, t);
   }
 }
@@ -171,7 +187,7 @@ coap_get_transaction_by_mid(uint16_t mid)
 {
   coap_transaction_t *t = NULL;
 
-  for (t = (coap_transaction_t*)list_head(transactions_list); t; t = t->next)
+  for (t = transactions_by_mid[mid % COAP_TRANSACTION_HASH_SIZE]; t; t = t->hash_next)
   {
     if (t->mid==mid)
     {
@@ -186,9 +202,12 @@ void
 coap_check_transactions()
 {
   coap_transaction_t *t = NULL;
+  coap_transaction_t *next = NULL;
 
-  for (t = (coap_transaction_t*)list_head(transactions_list); t; t = t->next)
+  /* Timed-out transactions are freed while iterating. */
+  for (t = (coap_transaction_t*)list_head(transactions_list); t; t = next)
   {
+    next = t->next;
     if (etimer_expired(&t->retrans_timer))
     {
       ++(t->retrans_counter);
@@ -48,9 +48,17 @@
 #define COAP_MAX_OPEN_TRANSACTIONS 4 
 #endif /* COAP_MAX_OPEN_TRANSACTIONS */
 
+/*
+ * The number of hash buckets used for looking up open transactions by their MID.
+ */
+#ifndef COAP_TRANSACTION_HASH_SIZE
+#define COAP_TRANSACTION_HASH_SIZE 4
+#endif /* COAP_TRANSACTION_HASH_SIZE */
+
 /* container for transactions with message buffer and retransmission info */
 typedef struct coap_transaction {
   struct coap_transaction *next; /* for LIST */
+  struct coap_transaction *hash_next; /* next transaction in the same MID hash bucket */
 
   uint16_t mid;
   struct etimer retrans_timer;
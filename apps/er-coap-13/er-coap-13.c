@@ -270,6 +270,240 @@ coap_get_variable(const char *buffer, size_t length, const char *name, const cha
   return 0;
 }
 /*-----------------------------------------------------------------------------------*/
+static
+uint8_t *
+coap_parse_option_header(uint8_t *current_option, unsigned int *delta, size_t *length)
+{
+  unsigned int option_delta = current_option[0]>>4;
+  unsigned int option_length = current_option[0] & 0x0F;
+  ++current_option;
+
+  /* avoids code duplication without function overhead */
+  unsigned int *x = &option_delta;
+  do
+  {
+    if (*x==13)
+    {
+      *x += current_option[0];
+      ++current_option;
+    }
+    else if (*x==14)
+    {
+      *x += 255;
+      *x += current_option[0]<<8;
+      ++current_option;
+      *x += current_option[0];
+      ++current_option;
+    }
+  }
+  while (x!=&option_length && (x=&option_length));
+
+  *delta = option_delta;
+  *length = option_length;
+  return current_option;
+}
+/*-----------------------------------------------------------------------------------*/
+static
+coap_status_t
+coap_parse_option_value(coap_packet_t *coap_pkt, unsigned int option_number, uint8_t *option_value, size_t option_length)
+{
+  switch (option_number)
+  {
+    case COAP_OPTION_CONTENT_TYPE:
+      coap_pkt->content_type = coap_parse_int_option(option_value, option_length);
+      PRINTF("Content-Format [%u]\n", coap_pkt->content_type);
+      break;
+    case COAP_OPTION_MAX_AGE:
+      coap_pkt->max_age = coap_parse_int_option(option_value, option_length);
+      PRINTF("Max-Age [%lu]\n", coap_pkt->max_age);
+      break;
+    case COAP_OPTION_ETAG:
+      coap_pkt->etag_len = MIN(COAP_ETAG_LEN, option_length);
+      memcpy(coap_pkt->etag, option_value, coap_pkt->etag_len);
+      PRINTF("ETag %u [0x%02X%02X%02X%02X%02X%02X%02X%02X]\n", coap_pkt->etag_len,
+        coap_pkt->etag[0],
+        coap_pkt->etag[1],
+        coap_pkt->etag[2],
+        coap_pkt->etag[3],
+        coap_pkt->etag[4],
+        coap_pkt->etag[5],
+        coap_pkt->etag[6],
+        coap_pkt->etag[7]
+      ); /*FIXME always prints 8 bytes */
+      break;
+    case COAP_OPTION_ACCEPT:
+      if (coap_pkt->accept_num < COAP_MAX_ACCEPT_NUM)
+      {
+        coap_pkt->accept[coap_pkt->accept_num] = coap_parse_int_option(option_value, option_length);
+        coap_pkt->accept_num += 1;
+        PRINTF("Accept [%u]\n", coap_pkt->content_type);
+      }
+      break;
+    case COAP_OPTION_IF_MATCH:
+      /*FIXME support multiple ETags */
+      coap_pkt->if_match_len = MIN(COAP_ETAG_LEN, option_length);
+      memcpy(coap_pkt->if_match, option_value, coap_pkt->if_match_len);
+      PRINTF("If-Match %u [0x%02X%02X%02X%02X%02X%02X%02X%02X]\n", coap_pkt->if_match_len,
+        coap_pkt->if_match[0],
+        coap_pkt->if_match[1],
+        coap_pkt->if_match[2],
+        coap_pkt->if_match[3],
+        coap_pkt->if_match[4],
+        coap_pkt->if_match[5],
+        coap_pkt->if_match[6],
+        coap_pkt->if_match[7]
+      ); /*FIXME always prints 8 bytes */
+      break;
+    case COAP_OPTION_IF_NONE_MATCH:
+      coap_pkt->if_none_match = 1;
+      PRINTF("If-None-Match\n");
+      break;
+
+    case COAP_OPTION_URI_HOST:
+      coap_pkt->uri_host = (char *) option_value;
+      coap_pkt->uri_host_len = option_length;
+      PRINTF("Uri-Host [%.*s]\n", coap_pkt->uri_host_len, coap_pkt->uri_host);
+      break;
+    case COAP_OPTION_URI_PORT:
+      coap_pkt->uri_port = coap_parse_int_option(option_value, option_length);
+      PRINTF("Uri-Port [%u]\n", coap_pkt->uri_port);
+      break;
+    case COAP_OPTION_URI_PATH:
+      /* coap_merge_multi_option() operates in-place on the IPBUF, but final packet field should be const string -> cast to string */
+      coap_merge_multi_option( (char **) &(coap_pkt->uri_path), &(coap_pkt->uri_path_len), option_value, option_length, '/');
+      PRINTF("Uri-Path [%.*s]\n", coap_pkt->uri_path_len, coap_pkt->uri_path);
+      break;
+    case COAP_OPTION_URI_QUERY:
+      /* coap_merge_multi_option() operates in-place on the IPBUF, but final packet field should be const string -> cast to string */
+      coap_merge_multi_option( (char **) &(coap_pkt->uri_query), &(coap_pkt->uri_query_len), option_value, option_length, '&');
+      PRINTF("Uri-Query [%.*s]\n", coap_pkt->uri_query_len, coap_pkt->uri_query);
+      break;
+
+    case COAP_OPTION_LOCATION_PATH:
+      /* coap_merge_multi_option() operates in-place on the IPBUF, but final packet field should be const string -> cast to string */
+      coap_merge_multi_option( (char **) &(coap_pkt->location_path), &(coap_pkt->location_path_len), option_value, option_length, '/');
+      PRINTF("Location-Path [%.*s]\n", coap_pkt->location_path_len, coap_pkt->location_path);
+      break;
+    case COAP_OPTION_LOCATION_QUERY:
+      /* coap_merge_multi_option() operates in-place on the IPBUF, but final packet field should be const string -> cast to string */
+      coap_merge_multi_option( (char **) &(coap_pkt->location_query), &(coap_pkt->location_query_len), option_value, option_length, '&');
+      PRINTF("Location-Query [%.*s]\n", coap_pkt->location_query_len, coap_pkt->location_query);
+      break;
+
+    case COAP_OPTION_PROXY_URI:
+      /*FIXME check for own end-point */
+      coap_pkt->proxy_uri = (char *) option_value;
+      coap_pkt->proxy_uri_len = option_length;
+      /*TODO length > 270 not implemented (actually not required) */
+      PRINTF("Proxy-Uri NOT IMPLEMENTED [%.*s]\n", coap_pkt->proxy_uri_len, coap_pkt->proxy_uri);
+      coap_error_message = "This is a constrained server (Contiki)";
+      return PROXYING_NOT_SUPPORTED_5_05;
+      break;
+
+    case COAP_OPTION_OBSERVE:
+      coap_pkt->observe = coap_parse_int_option(option_value, option_length);
+      PRINTF("Observe [%lu]\n", coap_pkt->observe);
+      break;
+    case COAP_OPTION_BLOCK2:
+      coap_pkt->block2_num = coap_parse_int_option(option_value, option_length);
+      coap_pkt->block2_more = (coap_pkt->block2_num & 0x08)>>3;
+      coap_pkt->block2_size = 16 << (coap_pkt->block2_num & 0x07);
+      coap_pkt->block2_offset = (coap_pkt->block2_num & ~0x0000000F)<<(coap_pkt->block2_num & 0x07);
+      coap_pkt->block2_num >>= 4;
+      PRINTF("Block2 [%lu%s (%u B/blk)]\n", coap_pkt->block2_num, coap_pkt->block2_more ? "+" : "", coap_pkt->block2_size);
+      break;
+    case COAP_OPTION_BLOCK1:
+      coap_pkt->block1_num = coap_parse_int_option(option_value, option_length);
+      coap_pkt->block1_more = (coap_pkt->block1_num & 0x08)>>3;
+      coap_pkt->block1_size = 16 << (coap_pkt->block1_num & 0x07);
+      coap_pkt->block1_offset = (coap_pkt->block1_num & ~0x0000000F)<<(coap_pkt->block1_num & 0x07);
+      coap_pkt->block1_num >>= 4;
+      PRINTF("Block1 [%lu%s (%u B/blk)]\n", coap_pkt->block1_num, coap_pkt->block1_more ? "+" : "", coap_pkt->block1_size);
+      break;
+    case COAP_OPTION_SIZE:
+      coap_pkt->size = coap_parse_int_option(option_value, option_length);
+      PRINTF("Size [%lu]\n", coap_pkt->size);
+      break;
+    default:
+      PRINTF("unknown (%u)\n", option_number);
+      /* Check if critical (odd) */
+      if (option_number & 1)
+      {
+        coap_error_message = "Unsupported critical option";
+        return BAD_OPTION_4_02;
+      }
+  }
+
+  return NO_ERROR;
+}
+/*-----------------------------------------------------------------------------------*/
+static
+int
+coap_is_lazy_option(unsigned int option_number)
+{
+  /* Uri-Path and Block options are needed for every request and decoded right away. */
+  switch (option_number)
+  {
+    case COAP_OPTION_IF_MATCH:
+    case COAP_OPTION_URI_HOST:
+    case COAP_OPTION_ETAG:
+    case COAP_OPTION_OBSERVE:
+    case COAP_OPTION_URI_PORT:
+    case COAP_OPTION_LOCATION_PATH:
+    case COAP_OPTION_CONTENT_TYPE:
+    case COAP_OPTION_MAX_AGE:
+    case COAP_OPTION_URI_QUERY:
+    case COAP_OPTION_ACCEPT:
+    case COAP_OPTION_LOCATION_QUERY:
+    case COAP_OPTION_SIZE:
+      return 1;
+    default:
+      return 0;
+  }
+}
+/*-----------------------------------------------------------------------------------*/
+static
+void
+coap_decode_option(coap_packet_t *coap_pkt, unsigned int option_number)
+{
+  uint8_t *options;
+  uint8_t *current_option;
+  unsigned int option_delta = 0;
+  size_t option_length = 0;
+
+  if (!IS_LAZY_OPTION(coap_pkt, option_number)) return;
+
+  CLEAR_LAZY_OPTION(coap_pkt, option_number);
+
+  options = coap_pkt->buffer + COAP_HEADER_LEN + coap_pkt->token_len;
+  current_option = options + coap_pkt->option_offset[option_number];
+
+  /* Instances of a repeatable option follow each other with a zero delta. */
+  do
+  {
+    current_option = coap_parse_option_header(current_option, &option_delta, &option_length);
+    coap_parse_option_value(coap_pkt, option_number, current_option, option_length);
+    current_option += option_length;
+
+    if (current_option >= options + coap_pkt->options_len || (current_option[0] & 0xF0)==0xF0) break;
+
+    coap_parse_option_header(current_option, &option_delta, &option_length);
+  }
+  while (option_delta==0);
+}
+/*-----------------------------------------------------------------------------------*/
+static
+void
+coap_decode_options(coap_packet_t *coap_pkt)
+{
+  unsigned int option_number;
+
+  for (option_number=0; option_number<=COAP_OPTION_SIZE; ++option_number)
+  {
+    coap_decode_option(coap_pkt, option_number);
+  }
+}
+/*-----------------------------------------------------------------------------------*/
 /*- MEASSAGE SENDING ----------------------------------------------------------------*/
 /*-----------------------------------------------------------------------------------*/
 void
@@ -312,6 +546,9 @@ coap_serialize_message(void *packet, uint8_t *buffer)
   uint8_t *option;
   unsigned int current_number = 0;
 
+  /* Deferred options of a parsed packet still refer to its old buffer */
+  coap_decode_options(coap_pkt);
+
   /* Initialize */
   coap_pkt->buffer = buffer;
   coap_pkt->version = 1;
@@ -458,9 +695,12 @@ coap_parse_message(void *packet, uint8_t *data, uint16_t data_len)
   memset(coap_pkt->options, 0, sizeof(coap_pkt->options));
   current_option += coap_pkt->token_len;
 
+  uint8_t *options = current_option;
+  uint8_t *option_header = NULL;
   unsigned int option_number = 0;
   unsigned int option_delta = 0;
   size_t option_length = 0;
+  coap_status_t error = NO_ERROR;
 
   while (current_option < data+data_len)
   {
@@ -479,168 +719,41 @@ coap_parse_message(void *packet, uint8_t *data, uint16_t data_len)
       /* Null-terminate payload */
       coap_pkt->payload[coap_pkt->payload_len] = '\0';
 
+      --current_option;
       break;
     }
 
-    option_delta = current_option[0]>>4;
-    option_length = current_option[0] & 0x0F;
-    ++current_option;
-
-    /* avoids code duplication without function overhead */
-    unsigned int *x = &option_delta;
-    do
-    {
-      if (*x==13)
-      {
-        *x += current_option[0];
-        ++current_option;
-      }
-      else if (*x==14)
-      {
-        *x += 255;
-        *x += current_option[0]<<8;
-        ++current_option;
-        *x += current_option[0];
-        ++current_option;
-      }
-    }
-    while (x!=&option_length && (x=&option_length));
+    option_header = current_option;
+    current_option = coap_parse_option_header(current_option, &option_delta, &option_length);
 
     option_number += option_delta;
 
     PRINTF("OPTION %u (delta %u, len %u): ", option_number, option_delta, option_length);
 
-    SET_OPTION(coap_pkt, option_number);
-
-    switch (option_number)
+    if (IS_LAZY_OPTION(coap_pkt, option_number))
+    {
+      /* Further instances are decoded together with the first one. */
+      PRINTF("deferred\n");
+    }
+    else
     {
-      case COAP_OPTION_CONTENT_TYPE:
-        coap_pkt->content_type = coap_parse_int_option(current_option, option_length);
-        PRINTF("Content-Format [%u]\n", coap_pkt->content_type);
-        break;
-      case COAP_OPTION_MAX_AGE:
-        coap_pkt->max_age = coap_parse_int_option(current_option, option_length);
-        PRINTF("Max-Age [%lu]\n", coap_pkt->max_age);
-        break;
-      case COAP_OPTION_ETAG:
-        coap_pkt->etag_len = MIN(COAP_ETAG_LEN, option_length);
-        memcpy(coap_pkt->etag, current_option, coap_pkt->etag_len);
-        PRINTF("ETag %u [0x%02X%02X%02X%02X%02X%02X%02X%02X]\n", coap_pkt->etag_len,
-          coap_pkt->etag[0],
-          coap_pkt->etag[1],
-          coap_pkt->etag[2],
-          coap_pkt->etag[3],
-          coap_pkt->etag[4],
-          coap_pkt->etag[5],
-          coap_pkt->etag[6],
-          coap_pkt->etag[7]
-        ); /*FIXME always prints 8 bytes */
-        break;
-      case COAP_OPTION_ACCEPT:
-        if (coap_pkt->accept_num < COAP_MAX_ACCEPT_NUM)
-        {
-          coap_pkt->accept[coap_pkt->accept_num] = coap_parse_int_option(current_option, option_length);
-          coap_pkt->accept_num += 1;
-          PRINTF("Accept [%u]\n", coap_pkt->content_type);
-        }
-        break;
-      case COAP_OPTION_IF_MATCH:
-        /*FIXME support multiple ETags */
-        coap_pkt->if_match_len = MIN(COAP_ETAG_LEN, option_length);
-        memcpy(coap_pkt->if_match, current_option, coap_pkt->if_match_len);
-        PRINTF("If-Match %u [0x%02X%02X%02X%02X%02X%02X%02X%02X]\n", coap_pkt->if_match_len,
-          coap_pkt->if_match[0],
-          coap_pkt->if_match[1],
-          coap_pkt->if_match[2],
-          coap_pkt->if_match[3],
-          coap_pkt->if_match[4],
-          coap_pkt->if_match[5],
-          coap_pkt->if_match[6],
-          coap_pkt->if_match[7]
-        ); /*FIXME always prints 8 bytes */
-        break;
-      case COAP_OPTION_IF_NONE_MATCH:
-        coap_pkt->if_none_match = 1;
-        PRINTF("If-None-Match\n");
-        break;
-
-      case COAP_OPTION_URI_HOST:
-        coap_pkt->uri_host = (char *) current_option;
-        coap_pkt->uri_host_len = option_length;
-        PRINTF("Uri-Host [%.*s]\n", coap_pkt->uri_host_len, coap_pkt->uri_host);
-        break;
-      case COAP_OPTION_URI_PORT:
-        coap_pkt->uri_port = coap_parse_int_option(current_option, option_length);
-        PRINTF("Uri-Port [%u]\n", coap_pkt->uri_port);
-        break;
-      case COAP_OPTION_URI_PATH:
-        /* coap_merge_multi_option() operates in-place on the IPBUF, but final packet field should be const string -> cast to string */
-        coap_merge_multi_option( (char **) &(coap_pkt->uri_path), &(coap_pkt->uri_path_len), current_option, option_length, '/');
-        PRINTF("Uri-Path [%.*s]\n", coap_pkt->uri_path_len, coap_pkt->uri_path);
-        break;
-      case COAP_OPTION_URI_QUERY:
-        /* coap_merge_multi_option() operates in-place on the IPBUF, but final packet field should be const string -> cast to string */
-        coap_merge_multi_option( (char **) &(coap_pkt->uri_query), &(coap_pkt->uri_query_len), current_option, option_length, '&');
-        PRINTF("Uri-Query [%.*s]\n", coap_pkt->uri_query_len, coap_pkt->uri_query);
-        break;
-
-      case COAP_OPTION_LOCATION_PATH:
-        /* coap_merge_multi_option() operates in-place on the IPBUF, but final packet field should be const string -> cast to string */
-        coap_merge_multi_option( (char **) &(coap_pkt->location_path), &(coap_pkt->location_path_len), current_option, option_length, '/');
-        PRINTF("Location-Path [%.*s]\n", coap_pkt->location_path_len, coap_pkt->location_path);
-        break;
-      case COAP_OPTION_LOCATION_QUERY:
-        /* coap_merge_multi_option() operates in-place on the IPBUF, but final packet field should be const string -> cast to string */
-        coap_merge_multi_option( (char **) &(coap_pkt->location_query), &(coap_pkt->location_query_len), current_option, option_length, '&');
-        PRINTF("Location-Query [%.*s]\n", coap_pkt->location_query_len, coap_pkt->location_query);
-        break;
-
-      case COAP_OPTION_PROXY_URI:
-        /*FIXME check for own end-point */
-        coap_pkt->proxy_uri = (char *) current_option;
-        coap_pkt->proxy_uri_len = option_length;
-        /*TODO length > 270 not implemented (actually not required) */
-        PRINTF("Proxy-Uri NOT IMPLEMENTED [%.*s]\n", coap_pkt->proxy_uri_len, coap_pkt->proxy_uri);
-        coap_error_message = "This is a constrained server (Contiki)";
-        return PROXYING_NOT_SUPPORTED_5_05;
-        break;
-
-      case COAP_OPTION_OBSERVE:
-        coap_pkt->observe = coap_parse_int_option(current_option, option_length);
-        PRINTF("Observe [%lu]\n", coap_pkt->observe);
-        break;
-      case COAP_OPTION_BLOCK2:
-        coap_pkt->block2_num = coap_parse_int_option(current_option, option_length);
-        coap_pkt->block2_more = (coap_pkt->block2_num & 0x08)>>3;
-        coap_pkt->block2_size = 16 << (coap_pkt->block2_num & 0x07);
-        coap_pkt->block2_offset = (coap_pkt->block2_num & ~0x0000000F)<<(coap_pkt->block2_num & 0x07);
-        coap_pkt->block2_num >>= 4;
-        PRINTF("Block2 [%lu%s (%u B/blk)]\n", coap_pkt->block2_num, coap_pkt->block2_more ? "+" : "", coap_pkt->block2_size);
-        break;
-      case COAP_OPTION_BLOCK1:
-        coap_pkt->block1_num = coap_parse_int_option(current_option, option_length);
-        coap_pkt->block1_more = (coap_pkt->block1_num & 0x08)>>3;
-        coap_pkt->block1_size = 16 << (coap_pkt->block1_num & 0x07);
-        coap_pkt->block1_offset = (coap_pkt->block1_num & ~0x0000000F)<<(coap_pkt->block1_num & 0x07);
-        coap_pkt->block1_num >>= 4;
-        PRINTF("Block1 [%lu%s (%u B/blk)]\n", coap_pkt->block1_num, coap_pkt->block1_more ? "+" : "", coap_pkt->block1_size);
-        break;
-      case COAP_OPTION_SIZE:
-        coap_pkt->size = coap_parse_int_option(current_option, option_length);
-        PRINTF("Size [%lu]\n", coap_pkt->size);
-        break;
-      default:
-        PRINTF("unknown (%u)\n", option_number);
-        /* Check if critical (odd) */
-        if (option_number & 1)
-        {
-          coap_error_message = "Unsupported critical option";
-          return BAD_OPTION_4_02;
-        }
+      SET_OPTION(coap_pkt, option_number);
+
+      if (coap_is_lazy_option(option_number) && option_header - options < 0xFF)
+      {
+        coap_pkt->option_offset[option_number] = option_header - options;
+        SET_LAZY_OPTION(coap_pkt, option_number);
+        PRINTF("deferred\n");
+      }
+      else if ((error = coap_parse_option_value(coap_pkt, option_number, current_option, option_length))!=NO_ERROR)
+      {
+        return error;
+      }
     }
 
     current_option += option_length;
   } /* for */
+  coap_pkt->options_len = current_option - options;
   PRINTF("-Done parsing-------\n");
 
 
@@ -656,6 +769,7 @@ coap_get_query_variable(void *packet, const char *name, const char **output)
   coap_packet_t *const coap_pkt = (coap_packet_t *) packet;
 
   if (IS_OPTION(coap_pkt, COAP_OPTION_URI_QUERY)) {
+    coap_decode_option(coap_pkt, COAP_OPTION_URI_QUERY);
     return coap_get_variable(coap_pkt->uri_query, coap_pkt->uri_query_len, name, output);
   }
   return 0;
@@ -695,6 +809,8 @@ coap_get_header_content_type(void *packet)
 
   if (!IS_OPTION(coap_pkt, COAP_OPTION_CONTENT_TYPE)) return -1;
 
+  coap_decode_option(coap_pkt, COAP_OPTION_CONTENT_TYPE);
+
   return coap_pkt->content_type;
 }
 
@@ -715,6 +831,8 @@ coap_get_header_accept(void *packet, const uint16_t **accept)
 
   if (!IS_OPTION(coap_pkt, COAP_OPTION_ACCEPT)) return 0;
 
+  coap_decode_option(coap_pkt, COAP_OPTION_ACCEPT);
+
   *accept = coap_pkt->accept;
   return coap_pkt->accept_num;
 }
@@ -724,6 +842,8 @@ coap_set_header_accept(void *packet, uint16_t accept)
 {
   coap_packet_t *const coap_pkt = (coap_packet_t *) packet;
 
+  coap_decode_option(coap_pkt, COAP_OPTION_ACCEPT);
+
   if (coap_pkt->accept_num < COAP_MAX_ACCEPT_NUM)
   {
     coap_pkt->accept[coap_pkt->accept_num] = accept;
@@ -742,6 +862,7 @@ coap_get_header_max_age(void *packet, uint32_t *age)
   if (!IS_OPTION(coap_pkt, COAP_OPTION_MAX_AGE)) {
     *age = COAP_DEFAULT_MAX_AGE;
   } else {
+    coap_decode_option(coap_pkt, COAP_OPTION_MAX_AGE);
     *age = coap_pkt->max_age;
   }
   return 1;
@@ -764,6 +885,8 @@ coap_get_header_etag(void *packet, const uint8_t **etag)
 
   if (!IS_OPTION(coap_pkt, COAP_OPTION_ETAG)) return 0;
 
+  coap_decode_option(coap_pkt, COAP_OPTION_ETAG);
+
   *etag = coap_pkt->etag;
   return coap_pkt->etag_len;
 }
@@ -788,6 +911,8 @@ coap_get_header_if_match(void *packet, const uint8_t **etag)
 
   if (!IS_OPTION(coap_pkt, COAP_OPTION_IF_MATCH)) return 0;
 
+  coap_decode_option(coap_pkt, COAP_OPTION_IF_MATCH);
+
   *etag = coap_pkt->if_match;
   return coap_pkt->if_match_len;
 }
@@ -867,6 +992,8 @@ coap_get_header_uri_host(void *packet, const char **host)
 
   if (!IS_OPTION(coap_pkt, COAP_OPTION_URI_HOST)) return 0;
 
+  coap_decode_option(coap_pkt, COAP_OPTION_URI_HOST);
+
   *host = coap_pkt->uri_host;
   return coap_pkt->uri_host_len;
 }
@@ -915,6 +1042,8 @@ coap_get_header_uri_query(void *packet, const char **query)
 
   if (!IS_OPTION(coap_pkt, COAP_OPTION_URI_QUERY)) return 0;
 
+  coap_decode_option(coap_pkt, COAP_OPTION_URI_QUERY);
+
   *query = coap_pkt->uri_query;
   return coap_pkt->uri_query_len;
 }
@@ -940,6 +1069,8 @@ coap_get_header_location_path(void *packet, const char **path)
 
   if (!IS_OPTION(coap_pkt, COAP_OPTION_LOCATION_PATH)) return 0;
 
+  coap_decode_option(coap_pkt, COAP_OPTION_LOCATION_PATH);
+
   *path = coap_pkt->location_path;
   return coap_pkt->location_path_len;
 }
@@ -976,6 +1107,8 @@ coap_get_header_location_query(void *packet, const char **query)
 
   if (!IS_OPTION(coap_pkt, COAP_OPTION_LOCATION_QUERY)) return 0;
 
+  coap_decode_option(coap_pkt, COAP_OPTION_LOCATION_QUERY);
+
   *query = coap_pkt->location_query;
   return coap_pkt->location_query_len;
 }
@@ -1001,6 +1134,8 @@ coap_get_header_observe(void *packet, uint32_t *observe)
 
   if (!IS_OPTION(coap_pkt, COAP_OPTION_OBSERVE)) return 0;
 
+  coap_decode_option(coap_pkt, COAP_OPTION_OBSERVE);
+
   *observe = coap_pkt->observe;
   return 1;
 }
@@ -1087,6 +1222,8 @@ coap_get_header_size(void *packet, uint32_t *size)
   coap_packet_t *const coap_pkt = (coap_packet_t *) packet;
 
   if (!IS_OPTION(coap_pkt, COAP_OPTION_SIZE)) return 0;
+
+  coap_decode_option(coap_pkt, COAP_OPTION_SIZE);
   
   *size = coap_pkt->size;
   return 1;
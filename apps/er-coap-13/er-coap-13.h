@@ -97,9 +97,14 @@
 
 /* Bitmap for set options */
 enum { OPTION_MAP_SIZE = sizeof(uint8_t) * 8 };
-#define SET_OPTION(packet, opt) ((packet)->options[opt / OPTION_MAP_SIZE] |= 1 << (opt % OPTION_MAP_SIZE))
+#define SET_OPTION(packet, opt) ((packet)->options[opt / OPTION_MAP_SIZE] |= 1 << (opt % OPTION_MAP_SIZE), CLEAR_LAZY_OPTION(packet, opt))
 #define IS_OPTION(packet, opt) ((packet)->options[opt / OPTION_MAP_SIZE] & (1 << (opt % OPTION_MAP_SIZE)))
 
+/* Bitmap for parsed options whose values are decoded on first access */
+#define SET_LAZY_OPTION(packet, opt) ((packet)->lazy_options[opt / OPTION_MAP_SIZE] |= 1 << (opt % OPTION_MAP_SIZE))
+#define CLEAR_LAZY_OPTION(packet, opt) ((packet)->lazy_options[opt / OPTION_MAP_SIZE] &= ~(1 << (opt % OPTION_MAP_SIZE)))
+#define IS_LAZY_OPTION(packet, opt) ((packet)->lazy_options[opt / OPTION_MAP_SIZE] & (1 << (opt % OPTION_MAP_SIZE)))
+
 #ifndef MIN
 #define MIN(a, b) ((a) < (b)? (a) : (b))
 #endif /* MIN */
@@ -215,6 +220,9 @@ typedef struct {
   uint16_t mid;
 
   uint8_t options[COAP_OPTION_PROXY_URI / OPTION_MAP_SIZE + 1]; /* Bitmap to check if option is set */
+  uint8_t lazy_options[COAP_OPTION_PROXY_URI / OPTION_MAP_SIZE + 1]; /* Bitmap to check if option still needs decoding */
+  uint8_t option_offset[COAP_OPTION_SIZE + 1]; /* Offset of the first instance of a lazy option from the start of the options */
+  uint16_t options_len; /* Length of the options in the incoming packet buffer */
 
   coap_content_type_t content_type; /* Parse options once and store; allows setting options in random order  */
   uint32_t max_age;
@@ -58,6 +58,50 @@ PROCESS_NAME(rest_manager_process);
 LIST(restful_services);
 LIST(restful_periodic_services);
 
+/* Hash table for finding resources by their exact URL. */
+static resource_t *resource_hash[REST_RESOURCE_HASH_SIZE];
+
+static unsigned int
+rest_hash_url(const char *url, size_t len)
+{
+  /* FNV-1a */
+  uint16_t hash = 0x9dc5;
+
+  while (len--)
+  {
+    hash ^= (uint8_t) *url++;
+    hash *= 0x0193;
+  }
+  return hash % REST_RESOURCE_HASH_SIZE;
+}
+
+static resource_t*
+rest_find_resource(const char *url, size_t len)
+{
+  resource_t* resource = NULL;
+
+  /* Exact matches are found through the hash table. */
+  for (resource = resource_hash[rest_hash_url(url, len)]; resource; resource = resource->hash_next)
+  {
+    if (strlen(resource->url)==len && strncmp(resource->url, url, len)==0)
+    {
+      return resource;
+    }
+  }
+
+  /* Otherwise, look for a resource that handles sub-resources of the URL. */
+  for (resource = (resource_t*)list_head(restful_services); resource; resource = resource->next)
+  {
+    if ((resource->flags & HAS_SUB_RESOURCES) && len>strlen(resource->url)
+        && strncmp(resource->url, url, strlen(resource->url)) == 0)
+    {
+      return resource;
+    }
+  }
+
+  return NULL;
+}
+
 
 void
 rest_init_engine(void)
@@ -88,6 +132,15 @@ rest_activate_resource(resource_t* resource)
   }
 
   list_add(restful_services, resource);
+
+  unsigned int bucket = rest_hash_url(resource->url, strlen(resource->url));
+  resource_t* r = NULL;
+  for (r = resource_hash[bucket]; r && r!=resource; r = r->hash_next);
+  if (r==NULL)
+  {
+    resource->hash_next = resource_hash[bucket];
+    resource_hash[bucket] = resource;
+  }
 }
 
 void
@@ -149,42 +202,38 @@ rest_invoke_restful_service(void* request, void* response, uint8_t *buffer, uint
   uint8_t found = 0;
   uint8_t allowed = 0;
 
-  PRINTF("rest_invoke_restful_service url /%.*s -->\n", url_len, url);
-
   resource_t* resource = NULL;
   const char *url = NULL;
+  int url_len = REST.get_url(request, &url);
 
-  for (resource = (resource_t*)list_head(restful_services); resource; resource = resource->next)
+  PRINTF("rest_invoke_restful_service url /%.*s -->\n", url_len, url);
+
+  /*if the web service handles that kind of requests and urls matches*/
+  if ((resource = rest_find_resource(url, url_len)))
   {
-    /*if the web service handles that kind of requests and urls matches*/
-    if ((REST.get_url(request, &url)==strlen(resource->url) || (REST.get_url(request, &url)>strlen(resource->url) && (resource->flags & HAS_SUB_RESOURCES)))
-        && strncmp(resource->url, url, strlen(resource->url)) == 0)
-    {
-      found = 1;
-      rest_resource_flags_t method = REST.get_method_type(request);
+    found = 1;
+    rest_resource_flags_t method = REST.get_method_type(request);
 
-      PRINTF("method %u, resource->flags %u\n", (uint16_t)method, resource->flags);
+    PRINTF("method %u, resource->flags %u\n", (uint16_t)method, resource->flags);
 
-      if (resource->flags & method)
+    if (resource->flags & method)
+    {
+      allowed = 1;
+
+      /*call pre handler if it exists*/
+      if (!resource->pre_handler || resource->pre_handler(resource, request, response))
       {
-        allowed = 1;
+        /* call handler function*/
+        resource->handler(request, response, buffer, buffer_size, offset);
 
-        /*call pre handler if it exists*/
-        if (!resource->pre_handler || resource->pre_handler(resource, request, response))
+        /*call post handler if it exists*/
+        if (resource->post_handler)
         {
-          /* call handler function*/
-          resource->handler(request, response, buffer, buffer_size, offset);
-
-          /*call post handler if it exists*/
-          if (resource->post_handler)
-          {
-            resource->post_handler(resource, request, response);
-          }
+          resource->post_handler(resource, request, response);
         }
-      } else {
-        REST.set_response_status(response, REST.status.METHOD_NOT_ALLOWED);
       }
-      break;
+    } else {
+      REST.set_response_status(response, REST.status.METHOD_NOT_ALLOWED);
     }
   }
 
@@ -52,6 +52,13 @@
 #define REST_MAX_CHUNK_SIZE     128
 #endif
 
+/*
+ * The number of hash buckets used for looking up activated resources by their URL.
+ */
+#ifndef REST_RESOURCE_HASH_SIZE
+#define REST_RESOURCE_HASH_SIZE 16
+#endif
+
 #ifndef MIN
 #define MIN(a, b) ((a) < (b)? (a) : (b))
 #endif /* MIN */
@@ -148,6 +155,7 @@ struct resource_s {
   restful_post_handler post_handler; /* to be called after handler, may perform finalizations (cleanup, etc) */
   void* user_data; /* pointer to user specific data */
   unsigned int benchmark; /* to benchmark resource handler, used for separate response */
+  struct resource_s *hash_next; /* next resource in the same URL hash bucket */
 };
 typedef struct resource_s resource_t;
 
@@ -1,6 +1,9 @@
 // Sets up the global package for 'Active Sensor'
 
 #include "global-sensor.h"
+#include "sensor-sampler.h"
+#include "sensor-record.h"
+#include "sensor-aggregate.h"
 #include "contiki.h"
 #include "shell.h"
 
@@ -10,6 +13,8 @@
 #include "dev/battery-sensor.h"
 #include "dev/serial-line.h"
 #include "net/rime.h"
+#include "net/netstack.h"
+#include "lib/random.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -21,6 +26,40 @@
 
 #define DEBUG
 
+/*
+ * sensor-readall answers are scheduled: node addr0.x answers in slot
+ * addr0 - 1 of a schedule the querier sends along, so that the nodes do not
+ * all broadcast at once.  A ContikiMAC broadcast is repeated for a whole
+ * channel check interval and may have to wait out the one of the slot
+ * before, so a slot lasts two intervals.  Nodes without a slot (addr0 0 or
+ * above the slot count) answer at a random time in the STRAGGLER_SLOTS
+ * after the schedule, leaving collisions to CSMA.
+ */
+#ifdef SENSOR_READALL_CONF_SLOT_MS
+#define READALL_SLOT_MS SENSOR_READALL_CONF_SLOT_MS
+#else
+#define READALL_SLOT_MS (2 * 1000 / NETSTACK_RDC_CHANNEL_CHECK_RATE + 10)
+#endif
+
+#ifdef SENSOR_READALL_CONF_SLOTS
+#define READALL_SLOTS SENSOR_READALL_CONF_SLOTS
+#else
+#define READALL_SLOTS 25
+#endif
+
+#define READALL_STRAGGLER_SLOTS 4
+
+/*
+ * sensor-aggregate keeps a collect tree running on every node, so it is
+ * only compiled in when a project asks for it.  Projects that aggregate
+ * on their own call sensor_aggregate_open() themselves.
+ */
+#ifdef GLOBAL_SENSOR_CONF_AGGREGATE
+#define GLOBAL_SENSOR_AGGREGATE GLOBAL_SENSOR_CONF_AGGREGATE
+#else
+#define GLOBAL_SENSOR_AGGREGATE 0
+#endif
+
 /*
  * Global sensor_sel definition - default to temperature
  * This holds the current active sensor
@@ -32,6 +71,10 @@ PROCESS( shell_sensor_select_process, "sensor-sel");
 PROCESS( shell_sensor_read_process, "sensor-read");
 PROCESS( broadcast_sensor_set_process, "sensor-setall");
 PROCESS( broadcast_sensor_read_proc, "sensor-readall");
+PROCESS( shell_sampler_stats_process, "sampler-stats");
+#if GLOBAL_SENSOR_AGGREGATE
+PROCESS( shell_sensor_aggregate_process, "sensor-aggregate");
+#endif
 
 PROCESS( sensor_set_dispatcher, "dispatcher" );
 PROCESS( sensor_set, "sensor-set" );
@@ -59,6 +102,16 @@ SHELL_COMMAND(sensor_readall_command,
               "sensor-readall",
               "sensor-readall : read current active sensor of all nodes",
               &broadcast_sensor_read_proc);
+SHELL_COMMAND(sampler_stats_command,
+              "sampler-stats",
+              "sampler-stats : print sample count, dropped samples and jitter of the sensor sampler",
+              &shell_sampler_stats_process);
+#if GLOBAL_SENSOR_AGGREGATE
+SHELL_COMMAND(sensor_aggregate_command,
+              "sensor-aggregate",
+              "sensor-aggregate : read all nodes through the aggregation tree",
+              &shell_sensor_aggregate_process);
+#endif
 
 /*---------------------------------------------------------------------------*/
 static void
@@ -73,6 +126,11 @@ broadcast_recv(struct broadcast_conn *c, const rimeaddr_t *from)
 
 static const struct broadcast_callbacks broadcast_call = {broadcast_recv};
 static struct broadcast_conn broadcast;
+
+// Epoch of the last scheduled read sent from here, and its answers
+static unsigned char readall_epoch;
+static unsigned short readall_answers;
+static clock_time_t readall_last;
 /*---------------------------------------------------------------------------*/
 /*---------------------------------------------------------------------------*/
 PROCESS_THREAD( sensor_set_dispatcher, ev, data )
@@ -83,7 +141,7 @@ PROCESS_THREAD( sensor_set_dispatcher, ev, data )
    * Start a process to handle the incoming broadcast command
    */
   int i;
-  char cmd[7];
+  char cmd[8];
 
   if( data != NULL )
   {
@@ -110,13 +168,25 @@ PROCESS_THREAD( sensor_set_dispatcher, ev, data )
         process_start( &sensor_unset, cmd );
         break;
       case 'r':
-        // Read sensor
+        // Read sensor.  Only reads with a schedule are delayed, cmd[4] of
+        // the old 5 byte command is not a slot length.
+        if( packetbuf_datalen() >= 7 )
+        {
+          cmd[5] = ((char*)data)[5];
+          cmd[6] = ((char*)data)[6];
+          cmd[7] = packetbuf_datalen() >= 8 ? ((char*)data)[7] : 0;
+        }
+        else
+          cmd[4] = cmd[5] = cmd[6] = cmd[7] = 0;
+        if( process_is_running( &sensor_read_proc ) )
+          process_exit( &sensor_read_proc );
         process_start( &sensor_read_proc, cmd );
         break;
       case 'd':
         // Copy extra data and display received data
         cmd[5] = ((char*)data)[5];
         cmd[6] = ((char*)data)[6];
+        cmd[7] = packetbuf_datalen() >= 8 ? ((char*)data)[7] : 0;
         process_start( &sensor_print_data, cmd );
         break;
     }
@@ -174,20 +244,61 @@ PROCESS_THREAD( sensor_unset, ev, data )
   PROCESS_END();
 }
 
+// Length of a slot of a scheduled read, in clock ticks
+static clock_time_t
+readall_slot(unsigned short slot_ms)
+{
+  clock_time_t slot = (unsigned long)slot_ms * CLOCK_SECOND / 1000;
+
+  return slot == 0 ? 1 : slot;
+}
+
+// Delay of this node's answer to a scheduled read
+static clock_time_t
+readall_delay(unsigned short slot_ms, unsigned char slots)
+{
+  clock_time_t slot = readall_slot(slot_ms);
+  unsigned char a0 = rimeaddr_node_addr.u8[0];
+
+  if( a0 != 0 && a0 <= slots )
+    return (a0 - 1) * slot;
+
+  // Stragglers contend after the last slot
+  return slots * slot + random_rand() % (READALL_STRAGGLER_SLOTS * slot);
+}
+
 PROCESS_THREAD( sensor_read_proc, ev, data )
 {
-  PROCESS_BEGIN();
+  static struct etimer et;
+  static unsigned char epoch;
   unsigned char *cmd = (unsigned char *)data;
-  char my_data[7];
-  uint16_t reading = sensor_read();
+  char my_data[8];
+  uint16_t reading;
+  unsigned short slot_ms;
   unsigned char a0, a1;
 
+  PROCESS_BEGIN();
+
   a0 = (unsigned char)(rimeaddr_node_addr.u8[0]);
   a1 = (unsigned char)(rimeaddr_node_addr.u8[1]);
 
   if( (cmd[2] == a0 && cmd[3] == a1) ||
       (cmd[2] == 0  || cmd[3] == 0 ) )
   {
+    // cmd[4] and cmd[7] are the slot length in ms, 0 to answer right away
+    epoch = cmd[5];
+    slot_ms = cmd[4] | (unsigned short)cmd[7] << 8;
+    if( slot_ms != 0 )
+    {
+      etimer_set( &et, readall_delay(slot_ms, cmd[6]) );
+      PROCESS_WAIT_EVENT_UNTIL( etimer_expired(&et) );
+
+      // Locals do not survive the wait
+      a0 = (unsigned char)(rimeaddr_node_addr.u8[0]);
+      a1 = (unsigned char)(rimeaddr_node_addr.u8[1]);
+    }
+
+    reading = sensor_read();
     my_data[0] = 'd';
     my_data[1] = 'x';
     my_data[2] = a0;
@@ -198,19 +309,20 @@ PROCESS_THREAD( sensor_read_proc, ev, data )
     my_data[5] = reading&0x00FF;
 
     my_data[6] = '\0';
+    my_data[7] = epoch;
 
 #ifdef DEBUG
     printf("Reading %d.%d:%i\n", a0, a1, reading);
 #endif
 
     // Broadcast data
-    packetbuf_copyfrom(my_data, 7);
+    packetbuf_copyfrom(my_data, 8);
     broadcast_send(&broadcast);
 
 #ifdef DEBUG
     int i;
     printf("Sending ");
-    for( i=0; i<7; i++ )
+    for( i=0; i<8; i++ )
       printf("%d ",my_data[i]);
     printf("\n");
 #endif
@@ -235,21 +347,36 @@ PROCESS_THREAD( sensor_print_data, ev, data )
 
   printf("%d.%d:%i\n", d[2], d[3], reading);
 
+  // Count the answers to our last scheduled read
+  if( readall_epoch != 0 && (unsigned char)d[7] == readall_epoch )
+  {
+    readall_answers++;
+    readall_last = clock_time();
+  }
+
   PROCESS_END();
 }
 
 PROCESS_THREAD( broadcast_sensor_read_proc, ev, data )
 {
+  static struct etimer et;
+  static clock_time_t start;
+  static unsigned short slot_ms;
+  unsigned char cmd[8];
+  int retval;
+
   PROCESS_BEGIN();
 
   /*
    * Broadcasts a message to all/given sensors telling them to
-   * transmit a reading.
+   * transmit a reading.  Reads of all nodes carry a schedule:
+   *    cmd[4]: Slot length in ms, low byte, 0 to answer right away
+   *    cmd[5]: Epoch, to tell the answers to this read apart
+   *    cmd[6]: Number of slots
+   *    cmd[7]: Slot length in ms, high byte
+   * The data argument sets the slot length.
    */
 
-  unsigned char cmd[6];
-  int retval;
-
   retval = parse_shell_command( data, cmd );
 
   if( retval == -1 )
@@ -259,18 +386,41 @@ PROCESS_THREAD( broadcast_sensor_read_proc, ev, data )
   else
   {
     cmd[0] = 'r';
+    if( cmd[2] == 0 || cmd[3] == 0 )
+      slot_ms = cmd[4] != 0 ? cmd[4] : READALL_SLOT_MS;
+    else
+      slot_ms = 0;
+    cmd[4] = slot_ms & 0xff;
+    cmd[7] = slot_ms >> 8;
+
+    if( ++readall_epoch == 0 )
+      readall_epoch = 1;
+    cmd[5] = readall_epoch;
+    cmd[6] = READALL_SLOTS;
+    readall_answers = 0;
+    start = readall_last = clock_time();
 #ifdef DEBUG
     printf( "Sending %c %c %d.%d\n", cmd[0], cmd[1], cmd[2], cmd[3]);
 #endif
 
-    packetbuf_copyfrom(cmd, 6);
+    packetbuf_copyfrom(cmd, 8);
     broadcast_send(&broadcast);
+
+    if( slot_ms != 0 )
+    {
+      // Wait out the slots and the stragglers, then report
+      etimer_set( &et, readall_slot(slot_ms) *
+                  (READALL_SLOTS + READALL_STRAGGLER_SLOTS + 1) );
+      PROCESS_WAIT_EVENT_UNTIL( etimer_expired(&et) );
+      printf( "readall epoch %u: %u answers, last after %lu ms\n",
+              readall_epoch, readall_answers,
+              (unsigned long)(readall_last - start) * 1000 / CLOCK_SECOND );
+    }
   }
 
   PROCESS_END();
 }
 
-
 PROCESS_THREAD( broadcast_sensor_set_process, ev, data )
 {
   PROCESS_BEGIN();
@@ -320,6 +470,48 @@ PROCESS_THREAD(shell_sensor_read_process, ev, data)
   PROCESS_END();
 }
 
+PROCESS_THREAD(shell_sampler_stats_process, ev, data)
+{
+  const struct sensor_sampler_stats *stats;
+
+  PROCESS_BEGIN();
+
+  /* Jitter is in rtimer ticks */
+  stats = sensor_sampler_get_stats();
+  printf( "samples %lu dropped %u jitter max %u mean %lu\n",
+          (unsigned long)stats->samples, stats->dropped,
+          (unsigned)stats->jitter_max,
+          stats->samples ? (unsigned long)(stats->jitter_sum / stats->samples) : 0UL );
+
+  PROCESS_END();
+}
+
+#if GLOBAL_SENSOR_AGGREGATE
+PROCESS_THREAD(shell_sensor_aggregate_process, ev, data)
+{
+  const struct sensor_aggregate *a;
+  uint8_t i;
+
+  PROCESS_BEGIN();
+
+  if( !sensor_aggregate_query() )
+  {
+    printf("sensor-aggregate: the last epoch is still running\n");
+    PROCESS_EXIT();
+  }
+  PROCESS_WAIT_EVENT_UNTIL(ev == sensor_aggregate_event);
+
+  a = data;
+  printf( "epoch %u: %u nodes min %u max %u mean %u\n", a->epoch, a->count,
+          a->min, a->max, sensor_aggregate_mean(a) );
+  for( i=0; i<SENSOR_AGGREGATE_VECTOR_SIZE; i++ )
+    if( a->present & (1U << i) )
+      printf("%d.%d:%u\n", SENSOR_AGGREGATE_VECTOR_BASE + i, 0, a->readings[i]);
+
+  PROCESS_END();
+}
+#endif
+
 // PROCESS_THREAD( global_sensor_init, ev, data )
 // {
 //   PROCESS_BEGIN();
@@ -401,8 +593,13 @@ void shell_global_sensor_init(void)
   shell_register_command(&sensor_set_all_command);
   shell_register_command(&sensor_read_command);
   shell_register_command(&sensor_readall_command);
+  shell_register_command(&sampler_stats_command);
 
   broadcast_open(&broadcast, SENSOR_CHANNEL, &broadcast_call);
+#if GLOBAL_SENSOR_AGGREGATE
+  shell_register_command(&sensor_aggregate_command);
+  sensor_aggregate_open();
+#endif
 }
 
 unsigned char shell_datatochar(const unsigned char *str)
@@ -609,3 +806,16 @@ unsigned char valid_sensor( unsigned char s )
       return 0;
   }
 }
+
+// Fills in the header of a record made by this node.
+void sensor_record_stamp(struct sensor_record *r, uint8_t kind)
+{
+  static uint8_t seqno;
+
+  r->kind = kind;
+  r->sensor = sensor_sel;
+  r->node[0] = rimeaddr_node_addr.u8[0];
+  r->node[1] = rimeaddr_node_addr.u8[1];
+  r->seqno = seqno++;
+  r->time = clock_seconds();
+}
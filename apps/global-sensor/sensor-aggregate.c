@@ -0,0 +1,406 @@
+// Aggregates the active sensor of all nodes up a collect tree
+
+#include "sensor-aggregate.h"
+#include "global-sensor.h"
+#include "contiki.h"
+#include "net/rime.h"
+#include "net/rime/collect.h"
+#include "lib/random.h"
+#include <stdio.h>
+#include <string.h>
+
+#define COLLECT_CHANNEL 150  /* and 151 */
+#define QUERY_CHANNEL 152
+#define AGGREGATE_CHANNEL 153
+
+/* Longest wait before a node passes the query on */
+#define QUERY_DELAY (CLOCK_SECOND / 32)
+/* Nodes of a level send at a random time within this part of their slot */
+#define SEND_SPREAD (CLOCK_SECOND / 2)
+/* Retransmitted aggregates remembered to not merge them twice */
+#define RECENT_MAX 8
+
+/* The header of an aggregate message, followed by its present readings */
+#define HEADER_SIZE 13
+
+enum {
+  IDLE,
+  COLLECTING, /* merging the aggregates of the children */
+  SENT,       /* the aggregate went to the parent, or the sink finished */
+};
+
+struct query_msg {
+  uint8_t epoch;
+};
+
+struct recent {
+  rimeaddr_t from;
+  uint8_t seqno;
+  uint8_t epoch;
+};
+
+process_event_t sensor_aggregate_event;
+
+static struct collect_conn collect;
+static struct broadcast_conn query_broadcast;
+static struct runicast_conn aggregate_runicast;
+static struct ctimer query_timer;
+static struct ctimer send_timer;
+
+static struct sensor_aggregate partial;
+static uint8_t state;
+static uint8_t is_open;
+static uint8_t is_sink;
+
+static struct recent recent[RECENT_MAX];
+static uint8_t recent_next;
+
+/* Aggregates waiting for the runicast to the parent to finish */
+static struct sensor_aggregate queue[SENSOR_AGGREGATE_QUEUE_SIZE];
+static uint8_t queue_first;
+static uint8_t queue_len;
+/*---------------------------------------------------------------------------*/
+static void
+add_reading(struct sensor_aggregate *a, const rimeaddr_t *node, uint16_t reading)
+{
+  uint8_t i = node->u8[0] - SENSOR_AGGREGATE_VECTOR_BASE;
+
+  if(a->count == 0 || reading < a->min) {
+    a->min = reading;
+  }
+  if(a->count == 0 || reading > a->max) {
+    a->max = reading;
+  }
+  a->sum += reading;
+  a->count++;
+
+  if(node->u8[1] == 0 && i < SENSOR_AGGREGATE_VECTOR_SIZE) {
+    a->present |= 1U << i;
+    a->readings[i] = reading;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+merge(struct sensor_aggregate *a, const struct sensor_aggregate *b)
+{
+  uint8_t i;
+
+  if(b->count == 0) {
+    return;
+  }
+  if(a->count == 0 || b->min < a->min) {
+    a->min = b->min;
+  }
+  if(a->count == 0 || b->max > a->max) {
+    a->max = b->max;
+  }
+  a->sum += b->sum;
+  a->count += b->count;
+  for(i = 0; i < SENSOR_AGGREGATE_VECTOR_SIZE; i++) {
+    if(b->present & (1U << i)) {
+      a->readings[i] = b->readings[i];
+    }
+  }
+  a->present |= b->present;
+}
+/*---------------------------------------------------------------------------*/
+static uint8_t *
+put16(uint8_t *p, uint16_t v)
+{
+  *p++ = v >> 8;
+  *p++ = v & 0xff;
+  return p;
+}
+/*---------------------------------------------------------------------------*/
+static const uint8_t *
+get16(const uint8_t *p, uint16_t *v)
+{
+  *v = (uint16_t)p[0] << 8 | p[1];
+  return p + 2;
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * Copies the aggregate to the packet buffer, without the absent readings.
+ * The fields go in network byte order:
+ *
+ *   0-3    sum
+ *   4-5    count
+ *   6-7    min
+ *   8-9    max
+ *   10-11  present
+ *   12     epoch
+ *   13-    the present readings, two bytes each
+ */
+static void
+pack(const struct sensor_aggregate *a)
+{
+  uint8_t *p;
+  uint8_t i;
+
+  packetbuf_clear();
+  p = packetbuf_dataptr();
+  p = put16(p, a->sum >> 16);
+  p = put16(p, a->sum & 0xffff);
+  p = put16(p, a->count);
+  p = put16(p, a->min);
+  p = put16(p, a->max);
+  p = put16(p, a->present);
+  *p++ = a->epoch;
+  for(i = 0; i < SENSOR_AGGREGATE_VECTOR_SIZE; i++) {
+    if(a->present & (1U << i)) {
+      p = put16(p, a->readings[i]);
+    }
+  }
+  packetbuf_set_datalen(p - (uint8_t *)packetbuf_dataptr());
+}
+/*---------------------------------------------------------------------------*/
+/* Reads an aggregate from the packet buffer, returns 0 if it is too short */
+static int
+unpack(struct sensor_aggregate *b)
+{
+  const uint8_t *p = packetbuf_dataptr();
+  const uint8_t *end = p + packetbuf_datalen();
+  uint16_t high, low;
+  uint8_t i;
+
+  if(end - p < HEADER_SIZE) {
+    return 0;
+  }
+  p = get16(p, &high);
+  p = get16(p, &low);
+  b->sum = (uint32_t)high << 16 | low;
+  p = get16(p, &b->count);
+  p = get16(p, &b->min);
+  p = get16(p, &b->max);
+  p = get16(p, &b->present);
+  b->epoch = *p++;
+  for(i = 0; i < SENSOR_AGGREGATE_VECTOR_SIZE; i++) {
+    if(b->present & (1U << i)) {
+      if(end - p < 2) {
+        return 0;
+      }
+      p = get16(p, &b->readings[i]);
+    }
+  }
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static int
+is_duplicate(const rimeaddr_t *from, uint8_t seqno, uint8_t epoch)
+{
+  uint8_t i;
+
+  for(i = 0; i < RECENT_MAX; i++) {
+    if(rimeaddr_cmp(&recent[i].from, from) &&
+       recent[i].seqno == seqno && recent[i].epoch == epoch) {
+      return 1;
+    }
+  }
+  rimeaddr_copy(&recent[recent_next].from, from);
+  recent[recent_next].seqno = seqno;
+  recent[recent_next].epoch = epoch;
+  recent_next = (recent_next + 1) % RECENT_MAX;
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static void
+send_to_parent(const struct sensor_aggregate *a)
+{
+  const rimeaddr_t *parent = collect_parent(&collect);
+
+  if(rimeaddr_cmp(parent, &rimeaddr_null)) {
+    printf("sensor-aggregate: no route to the sink, epoch %u dropped\n",
+           a->epoch);
+    return;
+  }
+  pack(a);
+  runicast_send(&aggregate_runicast, parent,
+                SENSOR_AGGREGATE_MAX_RETRANSMISSIONS);
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * Sends the aggregate, or queues it while the previous one is still being
+ * retransmitted.  A queued aggregate of the same epoch absorbs it instead.
+ */
+static void
+send_aggregate(const struct sensor_aggregate *a)
+{
+  struct sensor_aggregate *q;
+  uint8_t i;
+
+  if(!runicast_is_transmitting(&aggregate_runicast)) {
+    send_to_parent(a);
+    return;
+  }
+  for(i = 0; i < queue_len; i++) {
+    q = &queue[(queue_first + i) % SENSOR_AGGREGATE_QUEUE_SIZE];
+    if(q->epoch == a->epoch) {
+      merge(q, a);
+      return;
+    }
+  }
+  if(queue_len == SENSOR_AGGREGATE_QUEUE_SIZE) {
+    printf("sensor-aggregate: queue full, epoch %u dropped\n", a->epoch);
+    return;
+  }
+  memcpy(&queue[(queue_first + queue_len) % SENSOR_AGGREGATE_QUEUE_SIZE],
+         a, sizeof(*a));
+  queue_len++;
+}
+/*---------------------------------------------------------------------------*/
+/* Called when the runicast to the parent is acked or given up */
+static void
+send_next(void)
+{
+  if(queue_len == 0) {
+    return;
+  }
+  send_to_parent(&queue[queue_first]);
+  queue_first = (queue_first + 1) % SENSOR_AGGREGATE_QUEUE_SIZE;
+  queue_len--;
+}
+/*---------------------------------------------------------------------------*/
+static void
+send_partial(void *ptr)
+{
+  if(state != COLLECTING) {
+    return;
+  }
+  state = SENT;
+  send_aggregate(&partial);
+}
+/*---------------------------------------------------------------------------*/
+static void
+finish_epoch(void *ptr)
+{
+  state = SENT;
+  process_post(PROCESS_BROADCAST, sensor_aggregate_event, &partial);
+}
+/*---------------------------------------------------------------------------*/
+static void
+start_epoch(uint8_t epoch)
+{
+  memset(&partial, 0, sizeof(partial));
+  partial.epoch = epoch;
+  add_reading(&partial, &rimeaddr_node_addr, sensor_read());
+  state = COLLECTING;
+}
+/*---------------------------------------------------------------------------*/
+static void
+send_query(void *ptr)
+{
+  struct query_msg msg;
+
+  msg.epoch = partial.epoch;
+  packetbuf_copyfrom(&msg, sizeof(msg));
+  broadcast_send(&query_broadcast);
+}
+/*---------------------------------------------------------------------------*/
+static void
+query_recv(struct broadcast_conn *c, const rimeaddr_t *from)
+{
+  struct query_msg msg;
+  uint16_t level;
+  clock_time_t delay;
+
+  if(is_sink || packetbuf_datalen() < sizeof(msg)) {
+    return;
+  }
+  memcpy(&msg, packetbuf_dataptr(), sizeof(msg));
+  if(state != IDLE && msg.epoch == partial.epoch) {
+    return;
+  }
+
+  start_epoch(msg.epoch);
+  ctimer_set(&query_timer, random_rand() % QUERY_DELAY, send_query, NULL);
+
+  /* Children are at least a level deeper, so they send before us.  The
+     random part spreads the nodes of a level over the start of their
+     slot, which leaves the rest for retransmissions. */
+  level = collect_depth(&collect) / COLLECT_LINK_ESTIMATE_UNIT;
+  if(level >= SENSOR_AGGREGATE_LEVELS) {
+    level = SENSOR_AGGREGATE_LEVELS - 1;
+  }
+  delay = (SENSOR_AGGREGATE_LEVELS - 1 - level) * SENSOR_AGGREGATE_SLOT +
+    random_rand() % SEND_SPREAD;
+  ctimer_set(&send_timer, delay, send_partial, NULL);
+}
+/*---------------------------------------------------------------------------*/
+static void
+aggregate_recv(struct runicast_conn *c, const rimeaddr_t *from, uint8_t seqno)
+{
+  static struct sensor_aggregate child;
+
+  if(!unpack(&child) || is_duplicate(from, seqno, child.epoch)) {
+    return;
+  }
+  if(child.epoch != partial.epoch) {
+    return;
+  }
+
+  if(state == COLLECTING) {
+    merge(&partial, &child);
+  } else if(!is_sink) {
+    /* The child missed our slot, pass its aggregate on as it is */
+    send_aggregate(&child);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+collect_recv(const rimeaddr_t *originator, uint8_t seqno, uint8_t hops)
+{
+  /* The tree is only used for its routes, nothing is sent over it */
+}
+/*---------------------------------------------------------------------------*/
+static void
+aggregate_sent(struct runicast_conn *c, const rimeaddr_t *to,
+               uint8_t retransmissions)
+{
+  send_next();
+}
+/*---------------------------------------------------------------------------*/
+static void
+aggregate_timedout(struct runicast_conn *c, const rimeaddr_t *to,
+                   uint8_t retransmissions)
+{
+  printf("sensor-aggregate: %d.%d did not ack\n", to->u8[0], to->u8[1]);
+  send_next();
+}
+/*---------------------------------------------------------------------------*/
+static const struct broadcast_callbacks query_callbacks = { query_recv };
+static const struct runicast_callbacks aggregate_callbacks = {
+  aggregate_recv, aggregate_sent, aggregate_timedout
+};
+static const struct collect_callbacks collect_callbacks = { collect_recv };
+/*---------------------------------------------------------------------------*/
+void
+sensor_aggregate_open(void)
+{
+  if(is_open) {
+    return;
+  }
+  is_open = 1;
+  sensor_aggregate_event = process_alloc_event();
+  collect_open(&collect, COLLECT_CHANNEL, COLLECT_ROUTER, &collect_callbacks);
+  broadcast_open(&query_broadcast, QUERY_CHANNEL, &query_callbacks);
+  runicast_open(&aggregate_runicast, AGGREGATE_CHANNEL, &aggregate_callbacks);
+}
+/*---------------------------------------------------------------------------*/
+int
+sensor_aggregate_query(void)
+{
+  if(is_sink && state == COLLECTING) {
+    return 0;
+  }
+  if(!is_sink) {
+    is_sink = 1;
+    collect_set_sink(&collect, 1);
+  }
+
+  start_epoch(partial.epoch + 1);
+  send_query(NULL);
+  ctimer_set(&send_timer, SENSOR_AGGREGATE_LEVELS * SENSOR_AGGREGATE_SLOT,
+             finish_epoch, NULL);
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
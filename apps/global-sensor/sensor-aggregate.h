@@ -0,0 +1,106 @@
+#ifndef __SENSOR_AGGREGATE_H__
+#define __SENSOR_AGGREGATE_H__
+
+#include "contiki.h"
+
+/*
+ * In-network aggregation of the active sensor over a collect tree.
+ *
+ * A sink starts an epoch with sensor_aggregate_query(), which floods a
+ * query through the network.  Every node then merges its own reading into
+ * the partial aggregates its children in the collect tree send it, and
+ * sends the result to its parent as one packet.  Nodes send one level at
+ * a time, deepest first, one slot per level, so a snapshot of the whole
+ * network reaches the sink after a slot per level of the tree instead of
+ * one reply per node, and no two levels answer at the same time.
+ *
+ * A node's level is its collect routing metric in hops,
+ * collect_depth() / COLLECT_LINK_ESTIMATE_UNIT, which always exceeds the
+ * level of its parent.  The tree takes a few announcement rounds to form
+ * after the sink is set, so the first epochs may miss distant nodes.
+ */
+
+/* Levels of the tree that get a slot; deeper nodes share the first slot */
+#ifdef SENSOR_AGGREGATE_CONF_LEVELS
+#define SENSOR_AGGREGATE_LEVELS SENSOR_AGGREGATE_CONF_LEVELS
+#else
+#define SENSOR_AGGREGATE_LEVELS 8
+#endif
+
+/* Retransmissions of an aggregate before it is given up */
+#ifdef SENSOR_AGGREGATE_CONF_MAX_RETRANSMISSIONS
+#define SENSOR_AGGREGATE_MAX_RETRANSMISSIONS SENSOR_AGGREGATE_CONF_MAX_RETRANSMISSIONS
+#else
+#define SENSOR_AGGREGATE_MAX_RETRANSMISSIONS 3
+#endif
+
+/*
+ * Time a level has to reach its parent.  runicast retransmits once a
+ * second, so the default leaves room for the last retransmission of a
+ * node that sends at the end of the random spread of its slot.
+ */
+#ifdef SENSOR_AGGREGATE_CONF_SLOT
+#define SENSOR_AGGREGATE_SLOT SENSOR_AGGREGATE_CONF_SLOT
+#else
+#define SENSOR_AGGREGATE_SLOT \
+  ((SENSOR_AGGREGATE_MAX_RETRANSMISSIONS + 1) * CLOCK_SECOND)
+#endif
+
+/* Aggregates of late children waiting for the runicast to the parent */
+#ifdef SENSOR_AGGREGATE_CONF_QUEUE_SIZE
+#define SENSOR_AGGREGATE_QUEUE_SIZE SENSOR_AGGREGATE_CONF_QUEUE_SIZE
+#else
+#define SENSOR_AGGREGATE_QUEUE_SIZE 2
+#endif
+
+/*
+ * The readings of nodes SENSOR_AGGREGATE_VECTOR_BASE.0 up to
+ * SENSOR_AGGREGATE_VECTOR_BASE + SENSOR_AGGREGATE_VECTOR_SIZE - 1 are also
+ * kept individually.  Only the readings present are sent.
+ */
+#ifdef SENSOR_AGGREGATE_CONF_VECTOR_BASE
+#define SENSOR_AGGREGATE_VECTOR_BASE SENSOR_AGGREGATE_CONF_VECTOR_BASE
+#else
+#define SENSOR_AGGREGATE_VECTOR_BASE 1
+#endif
+
+#ifdef SENSOR_AGGREGATE_CONF_VECTOR_SIZE
+#define SENSOR_AGGREGATE_VECTOR_SIZE SENSOR_AGGREGATE_CONF_VECTOR_SIZE
+#else
+#define SENSOR_AGGREGATE_VECTOR_SIZE 16
+#endif
+
+#if SENSOR_AGGREGATE_VECTOR_SIZE > 16
+#error SENSOR_AGGREGATE_CONF_VECTOR_SIZE must be at most 16
+#endif
+
+struct sensor_aggregate {
+  uint32_t sum;
+  uint16_t count;     /* number of readings merged */
+  uint16_t min;
+  uint16_t max;
+  uint16_t present;   /* bit i is set if readings[i] holds a reading */
+  uint8_t epoch;
+  uint16_t readings[SENSOR_AGGREGATE_VECTOR_SIZE];
+};
+
+#define sensor_aggregate_mean(a) ((a)->count ? (uint16_t)((a)->sum / (a)->count) : 0)
+
+/*
+ * Posted to all processes when an epoch of the sink ends, with its
+ * aggregate as data, so that a process can also wait for an epoch that
+ * another process started.
+ */
+extern process_event_t sensor_aggregate_event;
+
+/* Joins the aggregation tree.  Calling it again has no effect. */
+void sensor_aggregate_open(void);
+
+/*
+ * Makes this node the sink and starts a new epoch.  sensor_aggregate_event
+ * follows once the slots of all levels have passed.  Returns 0 if the
+ * previous epoch has not finished yet.
+ */
+int sensor_aggregate_query(void);
+
+#endif /* __SENSOR_AGGREGATE_H__ */
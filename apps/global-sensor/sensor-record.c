@@ -0,0 +1,165 @@
+// Encodes and decodes the binary records described in sensor-record.h
+
+#include "sensor-record.h"
+#include <stdio.h>
+
+#define VERSION_SHIFT 5
+#define DELTA_FLAG 0x10
+#define KIND_MASK 0x0f
+
+#define TIME_OFFSET 5
+/*---------------------------------------------------------------------------*/
+static int
+varint_length(uint32_t v)
+{
+  int n = 1;
+
+  while(v >= 0x80) {
+    v >>= 7;
+    n++;
+  }
+  return n;
+}
+/*---------------------------------------------------------------------------*/
+static uint8_t *
+put_varint(uint8_t *p, uint32_t v)
+{
+  while(v >= 0x80) {
+    *p++ = (v & 0x7f) | 0x80;
+    v >>= 7;
+  }
+  *p++ = v;
+  return p;
+}
+/*---------------------------------------------------------------------------*/
+/* Returns the position after the varint, or NULL if it runs past end */
+static const uint8_t *
+get_varint(const uint8_t *p, const uint8_t *end, uint32_t *v)
+{
+  uint8_t shift = 0;
+
+  *v = 0;
+  while(p < end && shift < 35) {
+    *v |= (uint32_t)(*p & 0x7f) << shift;
+    if((*p++ & 0x80) == 0) {
+      return p;
+    }
+    shift += 7;
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+static uint32_t
+zigzag(int32_t d)
+{
+  return ((uint32_t)d << 1) ^ (uint32_t)(d >> 31);
+}
+/*---------------------------------------------------------------------------*/
+static int32_t
+unzigzag(uint32_t z)
+{
+  return (int32_t)(z >> 1) ^ -(int32_t)(z & 1);
+}
+/*---------------------------------------------------------------------------*/
+int
+sensor_record_encode(const struct sensor_record *r, uint8_t *buf, int size)
+{
+  uint8_t *p;
+  int i, plain, delta, use_delta, length;
+
+  /* Size both encodings of the values and keep the shorter, delta on a
+     tie */
+  plain = delta = 0;
+  for(i = 0; i < r->count; i++) {
+    plain += varint_length(r->values[i]);
+    delta += i == 0 ? varint_length(r->values[0]) :
+      varint_length(zigzag((int32_t)r->values[i] - r->values[i - 1]));
+  }
+
+  use_delta = delta <= plain;
+  length = TIME_OFFSET + varint_length(r->time) + 1 +
+    (use_delta ? delta : plain);
+  if(length > size) {
+    return -1;
+  }
+
+  p = buf;
+  *p++ = (SENSOR_RECORD_VERSION << VERSION_SHIFT) |
+    (use_delta ? DELTA_FLAG : 0) | (r->kind & KIND_MASK);
+  *p++ = r->sensor;
+  *p++ = r->node[0];
+  *p++ = r->node[1];
+  *p++ = r->seqno;
+  p = put_varint(p, r->time);
+  *p++ = r->count;
+  for(i = 0; i < r->count; i++) {
+    if(use_delta && i > 0) {
+      p = put_varint(p, zigzag((int32_t)r->values[i] - r->values[i - 1]));
+    } else {
+      p = put_varint(p, r->values[i]);
+    }
+  }
+
+  return p - buf;
+}
+/*---------------------------------------------------------------------------*/
+int
+sensor_record_decode(struct sensor_record *r, const uint8_t *buf, int len,
+                     int max)
+{
+  const uint8_t *p, *end;
+  uint32_t v;
+  uint16_t previous;
+  int i;
+
+  end = buf + len;
+  if(len < TIME_OFFSET + 2 ||
+     (buf[0] >> VERSION_SHIFT) != SENSOR_RECORD_VERSION) {
+    return -1;
+  }
+
+  r->kind = buf[0] & KIND_MASK;
+  r->sensor = buf[1];
+  r->node[0] = buf[2];
+  r->node[1] = buf[3];
+  r->seqno = buf[4];
+  p = get_varint(buf + TIME_OFFSET, end, &r->time);
+  if(p == NULL || p == end) {
+    return -1;
+  }
+  r->count = *p++;
+
+  previous = 0;
+  for(i = 0; i < r->count; i++) {
+    p = get_varint(p, end, &v);
+    if(p == NULL) {
+      return -1;
+    }
+    if((buf[0] & DELTA_FLAG) && i > 0) {
+      v = previous + unzigzag(v);
+    }
+    previous = v;
+    if(i < max) {
+      r->values[i] = v;
+    }
+  }
+
+  /* Text that happens to parse as a record rarely ends right after it */
+  if(p != end) {
+    return -1;
+  }
+  return r->count;
+}
+/*---------------------------------------------------------------------------*/
+void
+sensor_record_print(const uint8_t *buf, int len)
+{
+  int i;
+
+  printf("SR ");
+  for(i = 0; i < len; i++) {
+    printf("%02x", buf[i]);
+  }
+  printf("\n");
+}
+/*---------------------------------------------------------------------------*/
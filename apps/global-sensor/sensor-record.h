@@ -0,0 +1,79 @@
+#ifndef __SENSOR_RECORD_H__
+#define __SENSOR_RECORD_H__
+
+#include <stdint.h>
+
+/*
+ * Binary records for the sensor apps' messages.
+ *
+ * A record replaces a text message such as "mean_0 = 312\nst. dev. = 3\n"
+ * with a few bytes:
+ *
+ *   0    version (3 bits), delta flag (1 bit), kind (4 bits)
+ *   1    sensor, as selected with sensor-sel
+ *   2-3  rime address of the node that made the record
+ *   4    sequence number
+ *   5-   time in seconds, varint
+ *   n    number of values
+ *   n+1- values as varints, or with the delta flag the first value
+ *        followed by zigzag varint differences to the previous value
+ *
+ * The encoder picks whichever of the two value encodings is shorter.
+ * sensor_record_print() writes a record to the serial port as a line
+ * "SR <hex>" that tools/sensor-record decodes on the host.
+ *
+ * This file and sensor-record.c do not depend on Contiki, so the host
+ * decoder builds them as they are.
+ */
+
+#define SENSOR_RECORD_VERSION 1
+
+/* The longest header, with a five byte time */
+#define SENSOR_RECORD_HEADER_MAX 11
+/* The longest encoding of one value */
+#define SENSOR_RECORD_VALUE_MAX 3
+
+/* A value of a record that keeps its position but has no reading, such as
+   a node that did not answer */
+#define SENSOR_RECORD_MISSING 0xffff
+
+enum sensor_record_kind {
+  SENSOR_RECORD_SAMPLES,    /* readings of the sensor */
+  SENSOR_RECORD_STATS,      /* mean, standard deviation */
+  SENSOR_RECORD_MEAN_SHIFT, /* baseline mean, difference, standard deviation */
+  SENSOR_RECORD_CHANGE,     /* a change was detected, with its size */
+  SENSOR_RECORD_AVERAGE,    /* running average over the nodes so far */
+};
+
+struct sensor_record {
+  uint8_t kind;
+  uint8_t sensor;
+  uint8_t node[2];
+  uint8_t seqno;
+  uint32_t time;
+  uint8_t count;
+  uint16_t *values;
+};
+
+/* Returns the length of the encoded record, or -1 if it does not fit */
+int sensor_record_encode(const struct sensor_record *r, uint8_t *buf, int size);
+
+/*
+ * Decodes up to max values into r->values and returns the number of
+ * values in the record, or -1 if the record is malformed or len is not
+ * exactly its length.
+ */
+int sensor_record_decode(struct sensor_record *r, const uint8_t *buf, int len,
+                         int max);
+
+/* Prints the record as a line for the host decoder */
+void sensor_record_print(const uint8_t *buf, int len);
+
+/*
+ * Fills in the header of a record from this node: its address, the
+ * active sensor, the time and the next sequence number.  Defined in
+ * global-sensor.c, as it needs Contiki.
+ */
+void sensor_record_stamp(struct sensor_record *r, uint8_t kind);
+
+#endif /* __SENSOR_RECORD_H__ */
@@ -0,0 +1,276 @@
+// Samples the active sensor into a ring buffer for batch consumers
+
+#include "sensor-sampler.h"
+#include "global-sensor.h"
+#include "contiki.h"
+#include "lib/list.h"
+#include <string.h>
+
+#if (SENSOR_SAMPLER_BUFFER_SIZE & (SENSOR_SAMPLER_BUFFER_SIZE - 1)) != 0
+#error SENSOR_SAMPLER_CONF_BUFFER_SIZE must be a power of two
+#endif
+
+#define RING_MASK (SENSOR_SAMPLER_BUFFER_SIZE - 1)
+
+process_event_t sensor_sampler_event;
+
+static struct sensor_sample ring[SENSOR_SAMPLER_BUFFER_SIZE];
+/* Sequence number of the next sample, only ever incremented by the timer */
+static volatile uint16_t head;
+static volatile uint16_t rate;
+static struct sensor_sampler_stats stats;
+
+/* A sampling period is period + frac / rate timer ticks.  The fraction is
+   accumulated, so the rate stays exact over time. */
+#if SENSOR_SAMPLER_RTIMER
+#define TICKS_PER_SECOND RTIMER_SECOND
+#else
+#define TICKS_PER_SECOND CLOCK_SECOND
+#endif
+static uint16_t period;
+static uint16_t period_rem;
+static uint16_t frac;
+
+LIST(subscribers);
+
+PROCESS(sensor_sampler_process, "sensor-sampler");
+
+#if SENSOR_SAMPLER_RTIMER
+static struct rtimer rt;
+static rtimer_clock_t next_time;
+#else
+static struct etimer et;
+#endif
+/*---------------------------------------------------------------------------*/
+// Returns the timer ticks of the next n sampling periods
+static uint32_t
+advance(uint16_t n)
+{
+  uint32_t acc = frac + (uint32_t)n * period_rem;
+
+  frac = acc % rate;
+  return (uint32_t)n * period + acc / rate;
+}
+/*---------------------------------------------------------------------------*/
+static void
+store_sample(rtimer_clock_t late)
+{
+  struct sensor_sample *sample = &ring[head & RING_MASK];
+
+  sample->time = RTIMER_NOW();
+  sample->value = sensor_read();
+  ++head;
+
+  ++stats.samples;
+  stats.jitter_sum += late;
+  if(late > stats.jitter_max) {
+    stats.jitter_max = late;
+  }
+}
+/*---------------------------------------------------------------------------*/
+#if SENSOR_SAMPLER_RTIMER
+static void
+sample_rtimer(struct rtimer *t, void *ptr)
+{
+  rtimer_clock_t now = RTIMER_NOW();
+  rtimer_clock_t late = now - next_time;
+  rtimer_clock_t skip;
+
+  if(rate == 0) {
+    return;
+  }
+
+  /* Skip the sampling instants that already passed */
+  if(RTIMER_CLOCK_LT(now, next_time)) {
+    late = 0;
+  } else if(late >= period) {
+    stats.dropped += late / period;
+    skip = advance(late / period);
+    next_time += skip;
+    late = skip > late ? 0 : late - skip;
+  }
+
+  store_sample(late);
+
+  next_time += advance(1);
+  rtimer_set(&rt, next_time, 1, sample_rtimer, NULL);
+  process_poll(&sensor_sampler_process);
+}
+#endif /* SENSOR_SAMPLER_RTIMER */
+/*---------------------------------------------------------------------------*/
+static void
+dispatch(void)
+{
+  struct sensor_sampler_subscriber *s;
+
+  for(s = list_head(subscribers); s != NULL; s = s->next) {
+    if(!s->pending && (uint16_t)(head - s->tail) >= s->window) {
+      s->pending = 1;
+      process_post(s->process, sensor_sampler_event, s);
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(sensor_sampler_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+  while(1) {
+    PROCESS_WAIT_EVENT();
+
+#if !SENSOR_SAMPLER_RTIMER
+    if(ev == PROCESS_EVENT_TIMER && data == &et && rate != 0) {
+      clock_time_t late = clock_time() - etimer_expiration_time(&et);
+      clock_time_t skip;
+
+      /* Skip the sampling instants that already passed */
+      if(late >= period) {
+        stats.dropped += late / period;
+        skip = advance(late / period);
+        et.timer.start += skip;
+        late = skip > late ? 0 : late - skip;
+      }
+
+      store_sample((rtimer_clock_t)((uint32_t)late * RTIMER_SECOND / CLOCK_SECOND));
+      // The timer keeps the whole period, the fraction adds a tick now and then
+      etimer_reset(&et);
+      etimer_adjust(&et, advance(1) - period);
+    }
+#endif /* !SENSOR_SAMPLER_RTIMER */
+
+    dispatch();
+  }
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
+int
+sensor_sampler_start(uint16_t r)
+{
+#if SENSOR_SAMPLER_RTIMER
+  uint8_t was_running = rate != 0;
+#endif
+
+  if(sensor_sel == 0 || r == 0 || r > TICKS_PER_SECOND) {
+    return 0;
+  }
+
+  // Subscribers keep the rate they started with
+  if(rate != 0 && list_head(subscribers) != NULL) {
+    return rate;
+  }
+
+  if(sensor_sampler_event == 0) {
+    sensor_sampler_event = process_alloc_event();
+  }
+  if(!process_is_running(&sensor_sampler_process)) {
+    process_start(&sensor_sampler_process, NULL);
+  }
+
+  rate = r;
+  period = TICKS_PER_SECOND / r;
+  period_rem = TICKS_PER_SECOND % r;
+  frac = 0;
+#if SENSOR_SAMPLER_RTIMER
+  // A running rtimer picks the new period up at its next sample
+  if(!was_running) {
+    next_time = RTIMER_NOW() + advance(1);
+    rtimer_set(&rt, next_time, 1, sample_rtimer, NULL);
+  }
+#else
+  PROCESS_CONTEXT_BEGIN(&sensor_sampler_process);
+  etimer_set(&et, period);
+  etimer_adjust(&et, advance(1) - period);
+  PROCESS_CONTEXT_END(&sensor_sampler_process);
+#endif /* SENSOR_SAMPLER_RTIMER */
+
+  return r;
+}
+/*---------------------------------------------------------------------------*/
+void
+sensor_sampler_stop(void)
+{
+  // Keeps sampling for the remaining subscribers
+  if(list_head(subscribers) != NULL) {
+    return;
+  }
+
+  /* An rtimer cannot be cancelled, it stops rescheduling itself instead */
+  rate = 0;
+#if !SENSOR_SAMPLER_RTIMER
+  etimer_stop(&et);
+#endif
+}
+/*---------------------------------------------------------------------------*/
+void
+sensor_sampler_subscribe(struct sensor_sampler_subscriber *s, uint16_t window)
+{
+  s->process = PROCESS_CURRENT();
+  s->window = window == 0 ? 1 :
+    (window > SENSOR_SAMPLER_BUFFER_SIZE ? SENSOR_SAMPLER_BUFFER_SIZE : window);
+  s->tail = head;
+  s->overrun = 0;
+  s->pending = 0;
+  list_add(subscribers, s);
+}
+/*---------------------------------------------------------------------------*/
+void
+sensor_sampler_unsubscribe(struct sensor_sampler_subscriber *s)
+{
+  list_remove(subscribers, s);
+}
+/*---------------------------------------------------------------------------*/
+int
+sensor_sampler_read(struct sensor_sampler_subscriber *s,
+                    struct sensor_sample *samples, int max)
+{
+  uint16_t available = head - s->tail;
+  int i, n;
+
+  if(available > SENSOR_SAMPLER_BUFFER_SIZE) {
+    s->overrun += available - SENSOR_SAMPLER_BUFFER_SIZE;
+    s->tail = head - SENSOR_SAMPLER_BUFFER_SIZE;
+    available = SENSOR_SAMPLER_BUFFER_SIZE;
+  }
+
+  n = available < max ? available : max;
+  for(i = 0; i < n; i++) {
+    samples[i] = ring[(s->tail + i) & RING_MASK];
+  }
+
+#if SENSOR_SAMPLER_RTIMER
+  /* Drop the copies the rtimer may have overwritten meanwhile */
+  available = head - s->tail;
+  if(available > SENSOR_SAMPLER_BUFFER_SIZE) {
+    uint16_t lost = available - SENSOR_SAMPLER_BUFFER_SIZE;
+    if(lost > n) {
+      lost = n;
+    }
+    memmove(samples, samples + lost, (n - lost) * sizeof(struct sensor_sample));
+    n -= lost;
+    s->overrun += lost;
+    s->tail += lost;
+  }
+#endif /* SENSOR_SAMPLER_RTIMER */
+
+  s->tail += n;
+  s->pending = 0;
+
+  /* Posts the next event right away if another window is buffered */
+  process_poll(&sensor_sampler_process);
+
+  return n;
+}
+/*---------------------------------------------------------------------------*/
+const struct sensor_sampler_stats *
+sensor_sampler_get_stats(void)
+{
+  return &stats;
+}
+/*---------------------------------------------------------------------------*/
+void
+sensor_sampler_reset_stats(void)
+{
+  memset(&stats, 0, sizeof(stats));
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,86 @@
+#ifndef __SENSOR_SAMPLER_H__
+#define __SENSOR_SAMPLER_H__
+
+#include "contiki.h"
+#include "sys/rtimer.h"
+
+/*
+ * Continuous sampling of the active sensor (sensor_sel).
+ *
+ * One timer samples the sensor at a fixed rate into a ring buffer of
+ * timestamped readings.  The sensor stays powered while the sampler runs,
+ * so readings do not pay for a sensor_init()/sensor_uinit() warm-up each.
+ * Consumers subscribe with a window size and receive sensor_sampler_event
+ * once that many unread samples are buffered, then fetch them in one batch
+ * with sensor_sampler_read().
+ */
+
+/* Number of buffered samples, must be a power of two */
+#ifdef SENSOR_SAMPLER_CONF_BUFFER_SIZE
+#define SENSOR_SAMPLER_BUFFER_SIZE SENSOR_SAMPLER_CONF_BUFFER_SIZE
+#else
+#define SENSOR_SAMPLER_BUFFER_SIZE 64
+#endif
+
+/*
+ * Sample from an rtimer instead of the sampler process.  This gives the
+ * lowest jitter, but the rtimer is shared with radio duty cycling drivers
+ * such as ContikiMAC, so only enable it with nullrdc.  The sensor is read
+ * from interrupt context, which suits the ADC sensors (battery, light)
+ * rather than the slow SHT11.
+ */
+#ifdef SENSOR_SAMPLER_CONF_RTIMER
+#define SENSOR_SAMPLER_RTIMER SENSOR_SAMPLER_CONF_RTIMER
+#else
+#define SENSOR_SAMPLER_RTIMER 0
+#endif
+
+struct sensor_sample {
+  rtimer_clock_t time;
+  uint16_t value;
+};
+
+struct sensor_sampler_subscriber {
+  struct sensor_sampler_subscriber *next;
+  struct process *process;
+  uint16_t window;
+  uint16_t tail;      /* sequence number of the next unread sample */
+  uint16_t overrun;   /* samples overwritten before they were read */
+  uint8_t pending;    /* an event was posted and not yet followed by a read */
+};
+
+struct sensor_sampler_stats {
+  uint32_t samples;
+  uint16_t dropped;       /* sampling instants missed because the timer ran late */
+  rtimer_clock_t jitter_max;
+  uint32_t jitter_sum;    /* total lateness, jitter_sum / samples is the mean */
+};
+
+/* Posted to a subscriber with the subscriber as data */
+extern process_event_t sensor_sampler_event;
+
+/*
+ * Starts sampling the active sensor at rate samples per second, and
+ * returns the rate in use.  While processes are subscribed, the sampler
+ * keeps its rate and a different one is not applied.  Returns 0 if no
+ * sensor is active or the timer cannot sample that fast.
+ */
+int sensor_sampler_start(uint16_t rate);
+/* Stops sampling, unless processes are still subscribed */
+void sensor_sampler_stop(void);
+
+/* Subscribes the calling process to batches of window samples */
+void sensor_sampler_subscribe(struct sensor_sampler_subscriber *s, uint16_t window);
+void sensor_sampler_unsubscribe(struct sensor_sampler_subscriber *s);
+
+/*
+ * Copies up to max unread samples, oldest first, and returns their number.
+ * Samples the ring buffer overwrote in the meantime are added to s->overrun.
+ */
+int sensor_sampler_read(struct sensor_sampler_subscriber *s,
+                        struct sensor_sample *samples, int max);
+
+const struct sensor_sampler_stats *sensor_sampler_get_stats(void);
+void sensor_sampler_reset_stats(void);
+
+#endif /* __SENSOR_SAMPLER_H__ */
@@ -18,11 +18,4 @@
 
 void shell_grad_desc_localization_init();
 
-struct history_entry
-{
-	struct history_entry *next;
-	rimeaddr_t addr;
-	uint8_t seq;
-};
-
 #endif /* __GRAD_DESC_LOCALIZATION_H__ */
@@ -13,6 +13,9 @@
 #include "shell.h"
 #include "shell-collect-view.h"
 #include "collect-view.h"
+#include "global-sensor.h"
+#include "sensor-sampler.h"
+#include "sensor-record.h"
 
 #include "dev/leds.h"
 #include "dev/light-sensor.h"
@@ -41,9 +44,16 @@ timedout(struct mesh_conn *c)
 static void
 recv(struct mesh_conn *c, const rimeaddr_t *from, uint8_t hops)
 {
-  printf("Data received from %d.%d: %s (%d)\n",
-         from->u8[0], from->u8[1],
-         (char *)packetbuf_dataptr(), packetbuf_datalen());
+  struct sensor_record r;
+
+  // Records go to the host decoder, anything else is printed as text
+  if(sensor_record_decode(&r, packetbuf_dataptr(), packetbuf_datalen(), 0) >= 0) {
+    sensor_record_print(packetbuf_dataptr(), packetbuf_datalen());
+  } else {
+    printf("Data received from %d.%d: %s (%d)\n",
+           from->u8[0], from->u8[1],
+           (char *)packetbuf_dataptr(), packetbuf_datalen());
+  }
 }
 
 const static struct mesh_callbacks callbacks = {recv, sent, timedout};
@@ -75,28 +85,35 @@ SHELL_COMMAND(mesh_reset_command,
 PROCESS_THREAD(shell_simpledetect_process, ev, data)
 {
 	static struct etimer etimer;
-	static uint16_t data_sam[NUM_SAM];
-	char message[52];
-	char numhold[5];
+	static struct sensor_sample data_sam[NUM_SAM];
+	static struct sensor_sampler_subscriber sampler;
+	static struct sensor_record r;
+	static uint16_t values[3];
+	static uint8_t record[SENSOR_RECORD_HEADER_MAX + 3 * SENSOR_RECORD_VALUE_MAX];
+	int len;
 
-	PROCESS_EXITHANDLER(mesh_close(&mesh);)
+	PROCESS_EXITHANDLER(sensor_sampler_unsubscribe(&sampler); sensor_sampler_stop(); mesh_close(&mesh);)
 
 	PROCESS_BEGIN();
 
-	SENSORS_ACTIVATE(light_sensor);
+	sensor_init('l');
 	etimer_set(&etimer, CLOCK_SECOND);
 	PROCESS_WAIT_UNTIL(etimer_expired(&etimer));
+
+	// One batch of NUM_SAM samples per second
+	sensor_sampler_start(NUM_SAM);
+	sensor_sampler_subscribe(&sampler, NUM_SAM);
 	while (1)
 	{
+		PROCESS_WAIT_EVENT_UNTIL(ev == sensor_sampler_event && data == &sampler);
+		sensor_sampler_read(&sampler, data_sam, NUM_SAM);
+
 		blink_LEDs(LEDS_ALL);
 		mean_1 = 0;
 
 		for (counter = 0; counter < NUM_SAM; counter++)
 		{
-			etimer_set(&etimer, CLOCK_SECOND / NUM_SAM);
-			PROCESS_WAIT_UNTIL(etimer_expired(&etimer));
-			data_sam[counter] = light_sensor.value(LIGHT_SENSOR_PHOTOSYNTHETIC);
-			mean_1 = mean_1 + data_sam[counter];
+			mean_1 = mean_1 + data_sam[counter].value;
 		}
 
 		mean_1 = mean_1/NUM_SAM - mean_0;
@@ -106,25 +123,28 @@ PROCESS_THREAD(shell_simpledetect_process, ev, data)
 		rimeaddr_t addr;
                 addr.u8[0] = 62;
                 addr.u8[1] = 41;
-                strcpy(message, "\nmean_0 = "); // 10char
-                itoa(mean_0, numhold, 10);
-                strcat(message, numhold);  // 5 char
-                strcat(message, "\ndifference = "); // 14 char
-                itoa(mean_1, numhold, 10);
-		strcat(message, numhold); // 5 char
-		strcat(message, "\nst. dev. = "); // 12 char
-		itoa(stdev_0, numhold, 10);
-		strcat(message, numhold); // 5 char
-		strcat(message, "\n"); // 1 char                Total: 51 chars
-		
-		packetbuf_copyfrom(message, sizeof(message));
+		sensor_record_stamp(&r, SENSOR_RECORD_MEAN_SHIFT);
+		values[0] = mean_0;
+		values[1] = mean_1;
+		values[2] = stdev_0;
+		r.values = values;
+		r.count = 3;
+		len = sensor_record_encode(&r, record, sizeof(record));
+
+		packetbuf_copyfrom(record, len);
 		mesh_send(&mesh, &addr);
 		
 		if (mean_1 > stdev_0*3)
 		{
 			leds_on(LEDS_RED);
-			packetbuf_copyfrom("Change detected", strlen("Change detected"));
-			sensor_uinit();
+			sensor_record_stamp(&r, SENSOR_RECORD_CHANGE);
+			values[0] = mean_1;
+			r.count = 1;
+			len = sensor_record_encode(&r, record, sizeof(record));
+			packetbuf_copyfrom(record, len);
+			sensor_sampler_unsubscribe(&sampler);
+			sensor_sampler_stop();
+			sensor_uinit('l');
 			mesh_send(&mesh, &addr);
 			break;
 		}
@@ -136,23 +156,31 @@ PROCESS_THREAD(shell_simpledetect_process, ev, data)
 PROCESS_THREAD(shell_sample_init_process, ev, data)
 {
 	static uint16_t data_sam[NUM_SAM];
-	static struct etimer etimer;
+	static struct sensor_sample samples[NUM_SAM];
+	static struct sensor_sampler_subscriber sampler;
+
+	PROCESS_EXITHANDLER(sensor_sampler_unsubscribe(&sampler); sensor_sampler_stop();)
 
 	PROCESS_BEGIN();
 	
 	
 	// Gather NUM_SUM samples over one second of time
-	SENSORS_ACTIVATE(light_sensor);
+	sensor_init('l');
+	sensor_sampler_start(NUM_SAM);
+	sensor_sampler_subscribe(&sampler, NUM_SAM);
+	PROCESS_WAIT_EVENT_UNTIL(ev == sensor_sampler_event && data == &sampler);
+	sensor_sampler_read(&sampler, samples, NUM_SAM);
+	sensor_sampler_unsubscribe(&sampler);
+	sensor_sampler_stop();
+	sensor_uinit('l');
+
 	mean_0 = 0;
 	for (counter = 0; counter < NUM_SAM; counter++)
 	{
-		etimer_set(&etimer, CLOCK_SECOND / NUM_SAM); 
-		PROCESS_WAIT_UNTIL(etimer_expired(&etimer));
-		data_sam[counter] = light_sensor.value(LIGHT_SENSOR_PHOTOSYNTHETIC);
+		data_sam[counter] = samples[counter].value;
 		mean_0 = mean_0 + data_sam[counter];
 		printf("Reading = %d  Sum = %d\n", data_sam[counter], mean_0);
 	}
-	SENSORS_DEACTIVATE(light_sensor);
 
 	mean_0 = mean_0/NUM_SAM;
 	stdev_0 = mystdev(data_sam, mean_0);
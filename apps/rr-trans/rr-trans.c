@@ -8,6 +8,7 @@
  */
 
 #include "rr-trans.h"
+#include "sensor-record.h"
 
 #define FIRST_NODE 9
 #define LAST_NODE 20
@@ -15,6 +16,7 @@
 #define FREQUENCY 15
 #define MAX_RETRANSMISSIONS 4
 #define NUM_HISTORY_ENTRIES 4
+#define SINK_CHANNEL 146
 
 /*---------------------------------------------------------------------------*/
 PROCESS(round_robin_blink_process, "rr-blink");
@@ -31,7 +33,9 @@ SHELL_COMMAND(round_robin_end_command,
 			  "rr-end: ends the round-robin collection",
 			  &shell_round_robin_end_process);
 /*---------------------------------------------------------------------------*/
-static char *received_string;
+/* The last record received, holding the cumulative average */
+static uint8_t received[SENSOR_RECORD_HEADER_MAX + SENSOR_RECORD_VALUE_MAX];
+static int received_len;
 static uint8_t healing_offset = 0;
 LIST(history_table);
 MEMB(history_mem, struct history_entry, NUM_HISTORY_ENTRIES);
@@ -66,11 +70,13 @@ recv_runicast(struct runicast_conn *c, const rimeaddr_t *from, uint8_t seqno)
 		e->seq = seqno;
 	}
 
-	printf("Runicast message received from %d.%d: %s\n",
-	       from->u8[0], from->u8[1], (char *)packetbuf_dataptr());
+	printf("Runicast message received from %d.%d, %d bytes\n",
+	       from->u8[0], from->u8[1], packetbuf_datalen());
 
 	/* Receiving a message triggers the next process in the sequence to begin */
-	received_string = (char *)packetbuf_dataptr();
+	received_len = packetbuf_datalen() < sizeof(received) ?
+		packetbuf_datalen() : sizeof(received);
+	memcpy(received, packetbuf_dataptr(), received_len);
 	if (rimeaddr_node_addr.u8[0] != SINK_NODE)
 		process_start(&round_robin_blink_process, NULL);
 }
@@ -96,16 +102,47 @@ static const struct runicast_callbacks runicast_callbacks = {
 
 static struct runicast_conn runicast;
 
-int transmit_runicast(char *message, uint8_t addr_one)
+int transmit_runicast(const void *message, int len, uint8_t addr_one)
 {
 	rimeaddr_t recv;
-	packetbuf_copyfrom(message, strlen(message));
 	recv.u8[0] = addr_one;
 	recv.u8[1] = 0;
-	packetbuf_copyfrom(message, strlen(message));
+	packetbuf_copyfrom(message, len);
 	return runicast_send(&runicast, &recv, MAX_RETRANSMISSIONS);
 }
 
+/* The sink passes the averages on to the host decoder */
+static void
+recv_sink(struct unicast_conn *c, const rimeaddr_t *from)
+{
+	sensor_record_print(packetbuf_dataptr(), packetbuf_datalen());
+}
+
+static const struct unicast_callbacks sink_callbacks = {recv_sink};
+
+static struct unicast_conn sink_conn;
+
+static int
+transmit_sink(const void *message, int len)
+{
+	rimeaddr_t recv;
+	recv.u8[0] = SINK_NODE;
+	recv.u8[1] = 0;
+	packetbuf_copyfrom(message, len);
+	return unicast_send(&sink_conn, &recv);
+}
+
+/* Encodes an average into the record buffer and returns its length */
+static int
+encode_average(uint8_t *record, int size, uint16_t *average, uint8_t count)
+{
+	struct sensor_record r;
+	sensor_record_stamp(&r, SENSOR_RECORD_AVERAGE);
+	r.values = average;
+	r.count = count;
+	return sensor_record_encode(&r, record, size);
+}
+
 void open_runicast(void)
 {
 	list_init(history_table);
@@ -127,7 +164,7 @@ PROCESS_THREAD(shell_round_robin_start_process, ev, data)
 	PROCESS_BEGIN();
 	
 	open_runicast();
-	open_unicast();
+	unicast_open(&sink_conn, SINK_CHANNEL, &sink_callbacks);
 
 	/* Data collection always begins with the first node */
 	if (rimeaddr_node_addr.u8[0] == FIRST_NODE)
@@ -135,22 +172,23 @@ PROCESS_THREAD(shell_round_robin_start_process, ev, data)
 		/* Initialization of the first node's ID and neighboring node */
 		static struct etimer etimer0;
 		uint8_t next_node = FIRST_NODE + 1;
-		uint16_t sensor_value;
-		static char message[5];
+		static uint16_t sensor_value;
+		static uint8_t message[SENSOR_RECORD_HEADER_MAX + SENSOR_RECORD_VALUE_MAX];
+		static int len;
 
-		/* Collects data from the light sensor and converts it to a string */
+		/* Collects data from the light sensor and converts it to a record */
 		etimer_set(&etimer0, CLOCK_SECOND/16);
 		sensor_init();
 		PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&etimer0));
 		sensor_value = sensor_read();
 		sensor_uinit();
-		itoa(sensor_value, message, 10);
+		len = encode_average(message, sizeof(message), &sensor_value, 1);
 
 		/* Sends data to the second node in the sequence */
   //  	etimer_set(&etimer0, CLOCK_SECOND/FREQUENCY);
 		leds_on(LEDS_ALL);
 	//	PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&etimer0));
-		transmit_runicast(message, next_node);
+		transmit_runicast(message, len, next_node);
 		leds_off(LEDS_ALL);
 	}
 	
@@ -170,7 +208,9 @@ PROCESS_THREAD(round_robin_blink_process, ev, data)
 	/* Initialization of node ID's and neighbor's node ID */
 	static struct etimer etimer;
 	static uint8_t my_node;
-	static char message[5];
+	static uint8_t message[SENSOR_RECORD_HEADER_MAX + SENSOR_RECORD_VALUE_MAX];
+	static int len;
+	static struct sensor_record r;
 	my_node = rimeaddr_node_addr.u8[0];
 	static uint8_t next_node;
 	next_node = my_node + 1;
@@ -178,21 +218,23 @@ PROCESS_THREAD(round_robin_blink_process, ev, data)
 		next_node = FIRST_NODE;
 	static uint8_t sent = 0;
 
-	/* Sensor data is collected and the received message is converted to an integer */
+	/* Sensor data is collected and the received average is decoded */
 	static uint16_t new_data;
 	static uint16_t received_data;
-	received_data = atoi(received_string);
+	received_data = 0;
+	r.values = &received_data;
+	sensor_record_decode(&r, received, received_len, 1);
 	etimer_set(&etimer, CLOCK_SECOND/16);
 	sensor_init();
 	PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&etimer));
 	new_data = sensor_read();
 	sensor_uinit();
 		
-	/* Cumulative average is calculated and converted back to a string */
+	/* Cumulative average is calculated and encoded back into a record */
 	received_data = received_data * (my_node - FIRST_NODE - healing_offset);
 	new_data = new_data + received_data;
 	new_data = new_data / (my_node - FIRST_NODE + 1 - healing_offset);
-	itoa(new_data, message, 10);
+	len = encode_average(message, sizeof(message), &new_data, 1);
 
 	/* Message is sent to the next node, and the sink node if it is the last node */
 //	etimer_set(&etimer, CLOCK_SECOND/FREQUENCY);
@@ -200,12 +242,14 @@ PROCESS_THREAD(round_robin_blink_process, ev, data)
 //	PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&etimer));
 	if (my_node == LAST_NODE)
 	{
-		transmit_unicast(message, SINK_NODE);
-		transmit_runicast("0", next_node);
+		transmit_sink(message, len);
+		/* An empty average starts the next round */
+		len = encode_average(message, sizeof(message), NULL, 0);
+		transmit_runicast(message, len, next_node);
 	} 
 	else
 	{
-		transmit_runicast(message, next_node);
+		transmit_runicast(message, len, next_node);
 	/*	while (sent != 1)
 		{
 
@@ -244,7 +288,7 @@ PROCESS_THREAD(shell_round_robin_end_process, ev, data)
 {
 	PROCESS_BEGIN();
 
-	close_unicast();
+	unicast_close(&sink_conn);
 	close_runicast();
 	process_exit(&round_robin_blink_process);
 	
@@ -254,7 +298,7 @@ PROCESS_THREAD(shell_round_robin_end_process, ev, data)
 void shell_rr_trans_init(void)
 {
 	open_runicast();
-	open_unicast();
+	unicast_open(&sink_conn, SINK_CHANNEL, &sink_callbacks);
 	shell_register_command(&round_robin_start_command);
 	shell_register_command(&round_robin_end_command);
 }
@@ -5,7 +5,17 @@
 
 
 #include "sleepy-cusum-node.h"
+#include "sensor-sampler.h"
+#include "cusum.h"
 #define MU_VALUE 2000
+// Longest sleep in seconds, as with the former 16-bit statistic; longer
+// sleeps would also overflow the 16-bit clock of sky
+#define MAX_SLEEP_TIME 16
+// Samples per second for the distributions and sleepy-CUSUM
+#define SAMPLE_RATE 25
+// Samples per second and per batch for adaptive-CUSUM
+#define ADCUSUM_RATE 100
+#define ADCUSUM_BATCH 10
 // Below are two bounds for ad-cusum
 #define ZK_BOUND 35
 #define DK_BOUND 7
@@ -42,34 +52,41 @@ static int16_t mean_0 = 0;
 static uint16_t std_dev_1 = 1;
 static int16_t mean_1 = 1;
 
+// Readings for the distributions, batches for adaptive-CUSUM
+static struct sensor_sample samples[50];
+
 /*---------------------------------------------------------------------------*/
 PROCESS_THREAD(shell_prechange_distribution_process, ev, data)
 {
+	static struct sensor_sampler_subscriber sampler;
+
+	PROCESS_EXITHANDLER(sensor_sampler_unsubscribe(&sampler); sensor_sampler_stop();)
+
 	PROCESS_BEGIN();
 
 	static struct etimer etimer;
 	static uint8_t counter = 0;	
-	int16_t std_dev_array[50];
 	mean_0 = 0;
 	std_dev_0 = 0;
 
-	sensor_init();
-	etimer_set(&etimer, CLOCK_SECOND/16);
-	PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&etimer));
-
-	for (counter = 0; counter < 50; counter++)
+	// The 50 readings arrive as one batch from the sampler
+	if (!sensor_sampler_start(SAMPLE_RATE))
 	{
-		etimer_set(&etimer, CLOCK_SECOND/25);
-		PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&etimer));
-		std_dev_array[counter] = sensor_read();
-		mean_0 += std_dev_array[counter];
+		printf("No active sensor, use sensor-sel first\n");
+		PROCESS_EXIT();
 	}
+	sensor_sampler_subscribe(&sampler, 50);
+	PROCESS_WAIT_EVENT_UNTIL(ev == sensor_sampler_event && data == &sampler);
+	sensor_sampler_read(&sampler, samples, 50);
+	sensor_sampler_unsubscribe(&sampler);
+	sensor_sampler_stop();
 
-	sensor_uinit();	
+	for (counter = 0; counter < 50; counter++)
+		mean_0 += samples[counter].value;
 	mean_0 = mean_0/50;
 
 	for (counter = 0; counter < 50; counter++)
-		std_dev_0 = mypow2(std_dev_array[counter] - mean_0);
+		std_dev_0 = mypow2((int16_t)samples[counter].value - mean_0);
 	std_dev_0 = mysqrt(std_dev_0 / 49);
 	if (std_dev_0 == 0) 
 		std_dev_0 = 1;
@@ -86,31 +103,35 @@ PROCESS_THREAD(shell_prechange_distribution_process, ev, data)
 
 PROCESS_THREAD(shell_postchange_distribution_process, ev, data)
 {
+	static struct sensor_sampler_subscriber sampler;
+
+	PROCESS_EXITHANDLER(sensor_sampler_unsubscribe(&sampler); sensor_sampler_stop();)
+
 	PROCESS_BEGIN();
 
 	static struct etimer etimer;
 	static uint8_t counter = 0;	
-	int16_t std_dev_array[50];
 	mean_1 = 0;
 	std_dev_1 = 0;
 
-	sensor_init();
-	etimer_set(&etimer, CLOCK_SECOND/16);
-	PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&etimer));
-
-	for (counter = 0; counter < 50; counter++)
+	// The 50 readings arrive as one batch from the sampler
+	if (!sensor_sampler_start(SAMPLE_RATE))
 	{
-		etimer_set(&etimer, CLOCK_SECOND/25);
-		PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&etimer));
-		std_dev_array[counter] = sensor_read();
-		mean_1 += std_dev_array[counter];
+		printf("No active sensor, use sensor-sel first\n");
+		PROCESS_EXIT();
 	}
+	sensor_sampler_subscribe(&sampler, 50);
+	PROCESS_WAIT_EVENT_UNTIL(ev == sensor_sampler_event && data == &sampler);
+	sensor_sampler_read(&sampler, samples, 50);
+	sensor_sampler_unsubscribe(&sampler);
+	sensor_sampler_stop();
 
-	sensor_uinit();	
+	for (counter = 0; counter < 50; counter++)
+		mean_1 += samples[counter].value;
 	mean_1 = mean_1/50;
 
 	for (counter = 0; counter < 50; counter++)
-		std_dev_1 = mypow2(std_dev_array[counter] - mean_1);
+		std_dev_1 = mypow2((int16_t)samples[counter].value - mean_1);
 	std_dev_1 = mysqrt(std_dev_1 / 49);
 	if (std_dev_1 == 0)
 		std_dev_1 = 1;
@@ -127,6 +148,10 @@ PROCESS_THREAD(shell_postchange_distribution_process, ev, data)
 
 PROCESS_THREAD(shell_sleepy_cusum_process, ev, data)
 {
+	static struct sensor_sampler_subscriber sampler;
+
+	PROCESS_EXITHANDLER(sensor_sampler_unsubscribe(&sampler); sensor_sampler_stop();)
+
 	PROCESS_BEGIN();
 	
 	static struct etimer etimer;
@@ -139,52 +164,48 @@ PROCESS_THREAD(shell_sleepy_cusum_process, ev, data)
 	// Variables
 	static uint16_t change_occurred = 0;
 	static uint16_t sleep = 0;
-	static int16_t S_n = 0;
-	static int16_t z_k = 0;
-	static uint16_t sensor_value = 0;
+	static long sleep_time;
+	static struct cusum detector;
+	static struct sensor_sample sample;
+	static unsigned char sensor;
 	
 
 	static int16_t b = 20;
 	//b = (qlog((1000 - beta)) - qlog(alpha))/2048;
 	printf("b = %d\n", b);
+	cusum_init_gaussian(&detector, mean_0, std_dev_0, mean_1, std_dev_1,
+			CUSUM_FIXED(b));
 	
 	//Program flow:
 	// If it sleeps, then it uninitializes the sensor and goes to top of loop
 	// Otherwise, it keeps sensor on and keeps taking readings
-	// signed short qlog(unsigned short var) returns Q11, or ret/2048=ans
 
-	sensor_init();
-	etimer_set(&etimer, CLOCK_SECOND/16);
-	PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&etimer));
+	sensor = sensor_sel;
+	if (!sensor_sampler_start(SAMPLE_RATE))
+	{
+		printf("No active sensor, use sensor-sel first\n");
+		PROCESS_EXIT();
+	}
+	sensor_sampler_subscribe(&sampler, 1);
 	while (1)
 	{
+		PROCESS_WAIT_EVENT_UNTIL(ev == sensor_sampler_event && data == &sampler);
+		sensor_sampler_read(&sampler, &sample, 1);
 		leds_on(LEDS_RED);
-		sensor_value = sensor_read();
 
-		int post_term = mypow2(sensor_value-mean_1)/(2*mypow2(std_dev_1));	
-		int pre_term = mypow2(sensor_value-mean_0)/(2*mypow2(std_dev_0));
-		printf("post_term = %d\npre_term = %d\n", post_term, pre_term);	
+		// z_k = log(std_dev_0/std_dev_1) - post_term + pre_term
+		cusum_update(&detector, sample.value);
+		printf("z_k = %ld\nS_n = %ld\n",
+			(long)(detector.z >> CUSUM_FRACTION_BITS),
+			(long)(detector.s >> CUSUM_FRACTION_BITS));
 
-	
-		z_k = (qlog(std_dev_0) - qlog(std_dev_1))/2048;
-		z_k = z_k - post_term; 
-		z_k = z_k + pre_term;
-		S_n = S_n + z_k;
-
-		if (post_term == 32767)
-			S_n = -32767;
-		if (pre_term == 32767)
-			S_n = 32767;
-		printf("z_k = %d\nS_n = %d\n", z_k, S_n);
-
-		if (S_n >= b)
+		if (cusum_alarm(&detector))
 		{
 			change_occurred = 1;
 		} 
-		else if (S_n < 0)
+		else if (detector.s < 0)
 		{
 			sleep = 1;
-			sensor_uinit();
 		}		
 
 		if (!change_occurred) leds_off(LEDS_BLUE);
@@ -192,21 +213,30 @@ PROCESS_THREAD(shell_sleepy_cusum_process, ev, data)
 		if (change_occurred)
 		{
 			leds_on(LEDS_BLUE);
-			S_n = 0;
+			cusum_reset(&detector);
 			change_occurred = 0;
 			printf("Change occurred!\n\n");
 		}
 		else if (sleep)
 		{
-			printf("Sleep time = %d\n\n", -S_n / MU_VALUE);
-			etimer_set(&etimer, CLOCK_SECOND * -S_n / MU_VALUE);
+			// Power the sensor down for the sleep time
+			sensor_sampler_unsubscribe(&sampler);
+			sensor_sampler_stop();
+			sensor_uinit(sensor);
+			sleep_time = (-detector.s >> CUSUM_FRACTION_BITS) / MU_VALUE;
+			if (sleep_time > MAX_SLEEP_TIME)
+				sleep_time = MAX_SLEEP_TIME;
+			printf("Sleep time = %ld\n\n", sleep_time);
+			etimer_set(&etimer, CLOCK_SECOND * sleep_time);
 			leds_off(LEDS_RED);
 			PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&etimer));
 			leds_on(LEDS_RED);
-			S_n = 0;
-			sensor_init();
+			cusum_reset(&detector);
+			sensor_init(sensor);
 			etimer_set(&etimer, CLOCK_SECOND/16);
 			PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&etimer));
+			sensor_sampler_start(SAMPLE_RATE);
+			sensor_sampler_subscribe(&sampler, 1);
 			sleep = 0;		
 		}
 	}
@@ -216,82 +246,69 @@ PROCESS_THREAD(shell_sleepy_cusum_process, ev, data)
 
 PROCESS_THREAD(shell_sleepy_adcusum_process, ev, data)
 {
+	static struct sensor_sampler_subscriber sampler;
+	static int n, i;
+
+	PROCESS_EXITHANDLER(sensor_sampler_unsubscribe(&sampler); sensor_sampler_stop();)
+
 	PROCESS_BEGIN();
 	
-	static struct etimer etimer;
 	leds_off(LEDS_ALL);
 
 	// delta and epsilon are arbitrarily chosen. They affect how quickly
 	// the cusum algorithm converges, as well as how noisy it is
-	uint16_t delta = 1;
-	uint16_t epsilon = 1;
-	
 	// phi_min and phi_max define the range of possible readings
-	uint16_t phi_min = 0;
-	uint16_t phi_max = 4096;
-	static uint16_t phi_hat_a;
-	phi_hat_a = mean_0 - delta/2;
-	static uint16_t phi_hat_b;
-	phi_hat_b = mean_0 + delta/2;
-	static uint16_t phi_hat = 0;
-	
-	// Standard CUSUM variables, with b arbitrarily chosen
-	static int16_t S_n = 0;
-	static int16_t minS_n = 0;
-	static uint8_t b = 80;
+	// Standard CUSUM threshold b is arbitrarily chosen
+	static struct cusum detector;
+	cusum_init_adaptive(&detector, mean_0, 1, CUSUM_FIXED(1), CUSUM_FIXED(1),
+			0, 4096, CUSUM_FIXED(ZK_BOUND), CUSUM_FIXED(80));
 
 	static uint16_t change_occurred = 0;
-	static uint8_t movement_detected = 0;
-	static uint16_t sleep = 0;
-	static uint16_t sensor_value = 0;
 	static uint16_t change_counter = 0;
+	static uint16_t values[ADCUSUM_BATCH];
 
-	sensor_init();
-	etimer_set(&etimer, CLOCK_SECOND/16);
-	PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&etimer));
+	if (!sensor_sampler_start(ADCUSUM_RATE))
+	{
+		printf("No active sensor, use sensor-sel first\n");
+		PROCESS_EXIT();
+	}
+	sensor_sampler_subscribe(&sampler, ADCUSUM_BATCH);
 	while (1)
 	{
-		sensor_value = sensor_read();
-	
-		int16_t D_k = mypow2(sensor_value - phi_hat_a)/2 - mypow2(sensor_value - phi_hat_b)/2;
-
-		phi_hat_a = phi_hat_a + epsilon * D_k;
-		phi_hat_b = phi_hat_a + delta;
+		PROCESS_WAIT_EVENT_UNTIL(ev == sensor_sampler_event && data == &sampler);
+		n = sensor_sampler_read(&sampler, samples, ADCUSUM_BATCH);
+		for (i = 0; i < n; i++)
+			values[i] = samples[i].value;
 
-		phi_hat = phi_hat_a + 0.5 * delta;
-		if (phi_hat > phi_max)
-			phi_hat = phi_max;
-		else if (phi_hat < phi_min)
-			phi_hat = phi_min;
-
-		int16_t z_k = mypow2(sensor_value - mean_0)/2 - mypow2(sensor_value - phi_hat)/2;
-		if (ZK_BOUND * -1 < z_k && z_k < ZK_BOUND) z_k = 0;	
-
-		S_n = S_n + z_k;
-
-		if (S_n >= (minS_n + b))
-			change_occurred = 1;
-		else if (S_n < minS_n)
-			minS_n = S_n;
-	
-		if (change_occurred && change_counter <= 250)
+		for (i = 0; i < n; )
 		{
-			change_counter++;
-			leds_on(LEDS_RED);
-		} else if (change_occurred && change_counter > 250)
-		{
-			change_counter = 0;
-			change_occurred = 0;
-			S_n = 0;
-			minS_n = 0;
-			leds_off(LEDS_RED);
+			if (change_occurred)
+			{
+				// Hold the alarm for 250 samples, then start over
+				cusum_update(&detector, values[i++]);
+				if (++change_counter > 250)
+				{
+					change_counter = 0;
+					change_occurred = 0;
+					cusum_reset(&detector);
+					leds_off(LEDS_RED);
+				}
+			}
+			else
+			{
+				// Runs through the batch until the first sample that raises the alarm
+				i += cusum_update_batch(&detector, values + i, n - i);
+				if (cusum_alarm(&detector))
+				{
+					change_occurred = 1;
+					leds_on(LEDS_RED);
+				}
+			}
 		}
 
+		int16_t D_k = detector.u.adaptive.d >> CUSUM_FRACTION_BITS;
 		if (D_k < DK_BOUND * -1 || DK_BOUND < D_k) leds_on(LEDS_BLUE);
 		else leds_off(LEDS_BLUE);
-	
-		etimer_set(&etimer, CLOCK_SECOND/100);
-		PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&etimer));
 	}
 	PROCESS_END();
 }
@@ -4,6 +4,7 @@
 #include "contiki.h"
 #include "shell.h"
 #include "global-sensor.h"
+#include "sensor-sampler.h"
 #include "tool-sample-stats.h"
 
 #include "dev/leds.h"
@@ -14,7 +15,11 @@
 
 #define NUM_DEVS 5
 
-static uint16_t sample;
+// Samples per second
+#define SAMPLE_RATE 4
+
+static struct sensor_sample sample;
+static struct sensor_sampler_subscriber sampler;
 
 /*---------------------------------------------------------------------------*/
 PROCESS(shell_change_detect_process, "change-detect");
@@ -25,20 +30,23 @@ SHELL_COMMAND(change_detect_command,
 /*---------------------------------------------------------------------------*/
 PROCESS_THREAD(shell_change_detect_process, ev, data)
 {
-	static struct etimer etimer;
+	PROCESS_EXITHANDLER(sensor_sampler_unsubscribe(&sampler); sensor_sampler_stop();)
 
 	PROCESS_BEGIN();
 	
 	leds_init();
+	if(!sensor_sampler_start(SAMPLE_RATE)) {
+		printf("No active sensor, use sensor-sel first\n");
+		PROCESS_EXIT();
+	}
+	sensor_sampler_subscribe(&sampler, 1);
 	while(1) {
-		sensor_init();
-		etimer_set(&etimer, CLOCK_SECOND / 4);
-		PROCESS_WAIT_UNTIL(etimer_expired(&etimer));
-		sample = sensor_read();
-		sensor_uinit();
-		printf("sample = %d\n",sample);
+		// The sensor stays on between samples.
+		PROCESS_WAIT_EVENT_UNTIL(ev == sensor_sampler_event && data == &sampler);
+		sensor_sampler_read(&sampler, &sample, 1);
+		printf("sample = %d\n",sample.value);
 		
-		if(abs_sub(sample, sample_mean) > (sample_std_dev * NUM_DEVS)) {
+		if(abs_sub(sample.value, sample_mean) > (sample_std_dev * NUM_DEVS)) {
 			// Change detected, turn on LED(s)?
 			leds_on(LEDS_RED);
 		} else {
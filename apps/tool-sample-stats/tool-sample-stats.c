@@ -5,6 +5,8 @@
 #include "net/rime.h"
 #include "shell.h"
 #include "global-sensor.h"
+#include "sensor-sampler.h"
+#include "sensor-record.h"
 
 #include "dev/serial-line.h"
 #include "lib/sky-math.h"
@@ -38,10 +40,16 @@ timedout(struct mesh_conn *c)
 static void
 recv(struct mesh_conn *c, const rimeaddr_t *from, uint8_t hops)
 {
-  printf("Data received from %d.%d: %s (%d)\n",
-         from->u8[0], from->u8[1],
-         (char *)packetbuf_dataptr(), packetbuf_datalen());
-
+  struct sensor_record r;
+
+  // Records go to the host decoder, anything else is printed as text
+  if(sensor_record_decode(&r, packetbuf_dataptr(), packetbuf_datalen(), 0) >= 0) {
+    sensor_record_print(packetbuf_dataptr(), packetbuf_datalen());
+  } else {
+    printf("Data received from %d.%d: %s (%d)\n",
+           from->u8[0], from->u8[1],
+           (char *)packetbuf_dataptr(), packetbuf_datalen());
+  }
 }
 
 const static struct mesh_callbacks callbacks = {recv, sent, timedout};
@@ -64,29 +72,33 @@ SHELL_COMMAND(get_stats_command,
 /*---------------------------------------------------------------------------*/
 PROCESS_THREAD(shell_sample_stats_process, ev, data) {
 
-	static uint16_t data_sam[NUM_SAM]; 
+	static struct sensor_sample data_sam[NUM_SAM];
+	static struct sensor_sampler_subscriber sampler;
 	uint16_t sum = 0;
 	uint16_t sqsum = 0;
-	static struct etimer etimer;
+
+	PROCESS_EXITHANDLER(sensor_sampler_unsubscribe(&sampler); sensor_sampler_stop();)
 
 	PROCESS_BEGIN();
 
-	// Gather NUM_SAM samples over 1 second of time
-	sensor_init();
-	printf("Gathering data... ");
-	for(counter = 0;counter < NUM_SAM;counter++) {
-		// Get data for no change analysis.
-		etimer_set(&etimer, CLOCK_SECOND / NUM_SAM);
-		PROCESS_WAIT_UNTIL(etimer_expired(&etimer));
-		data_sam[counter] = sensor_read();
+	// Gather NUM_SAM samples over 1 second of time, in one batch from the
+	// sampler instead of waking up for every reading.
+	if(!sensor_sampler_start(NUM_SAM)) {
+		printf("No active sensor, use sensor-sel first\n");
+		PROCESS_EXIT();
 	}
+	sensor_sampler_subscribe(&sampler, NUM_SAM);
+	printf("Gathering data... ");
+	PROCESS_WAIT_EVENT_UNTIL(ev == sensor_sampler_event && data == &sampler);
+	sensor_sampler_read(&sampler, data_sam, NUM_SAM);
+	sensor_sampler_unsubscribe(&sampler);
+	sensor_sampler_stop();
 	printf("done!\n");
-	sensor_uinit();
 
 	// Sum the no change data
 	sum = 0;
 	for(counter = 0;counter < NUM_SAM;counter++) {
-		sum = sum + data_sam[counter];
+		sum = sum + data_sam[counter].value;
 	}
 	sample_mean = 0;
 	printf("sum = %d\n",sum);
@@ -96,7 +108,7 @@ PROCESS_THREAD(shell_sample_stats_process, ev, data) {
 	// Caclulate sample_std_dev
 	sqsum = 0;
 	for(counter = 0;counter < NUM_SAM;counter++) {
-		sqsum = sqsum + mypow2(abs_sub(data_sam[counter], sample_mean));
+		sqsum = sqsum + mypow2(abs_sub(data_sam[counter].value, sample_mean));
 	}
 	sample_std_dev = 0;
 	sample_std_dev = sqsum/NUM_SAM;
@@ -111,22 +123,20 @@ PROCESS_THREAD(shell_get_stats_process, ev, data) {
 	PROCESS_BEGIN();
 
 	// Print out the data distribution stats, to both the local serial and
-	// broadcast over the network as a response to a call.
-
-	char message[29];
-	strcpy(message,"sample_mean = ");				// 7 chars
-	char num[5];
-	itoa(sample_mean, num, 10);
-	strcat(message,num);					// 5 chars
-
-	strcat(message,"\nstd_dev = ");			// 11 chars
-	itoa(sample_std_dev, num, 10);
-	strcat(message,num);					// 5 chars
-	strcat(message,"\n");					// 1 char
+	// send them over the network as a record in response to a call.
+	struct sensor_record r;
+	uint16_t values[2];
+	uint8_t record[SENSOR_RECORD_HEADER_MAX + 2 * SENSOR_RECORD_VALUE_MAX];
+	int len;
 
-											// Total = 29 chars
+	sensor_record_stamp(&r, SENSOR_RECORD_STATS);
+	values[0] = sample_mean;
+	values[1] = sample_std_dev;
+	r.values = values;
+	r.count = 2;
+	len = sensor_record_encode(&r, record, sizeof(record));
 
-	packetbuf_copyfrom(message, sizeof(message));
+	packetbuf_copyfrom(record, len);
 
 	rimeaddr_t addr;
 	/*
@@ -139,8 +149,8 @@ PROCESS_THREAD(shell_get_stats_process, ev, data) {
 	addr.u8[1] = 41;
     mesh_send(&mesh, &addr);
 
-	// Print out the message on the local serial port.
-	printf("%s\n",message);
+	// Print out the stats on the local serial port.
+	printf("sample_mean = %d\nstd_dev = %d\n\n", sample_mean, sample_std_dev);
 
 	PROCESS_END();
 
@@ -54,7 +54,7 @@
 #define PRINTF(...)
 #endif
 
-#include "contiki-conf.h"
+#include "contiki.h"
 #include "cfs/cfs.h"
 #include "cfs-coffee-arch.h"
 #include "cfs/cfs-coffee.h"
@@ -90,6 +90,36 @@
 #define COFFEE_EXTENDED_WEAR_LEVELLING	1
 #endif
 
+/*
+ * Keep a hash index in RAM from file names to the pages where the
+ * files start, so that opening a file that is not cached does not
+ * require a scan of every file header in the storage. The index is
+ * built on the first lookup and then kept up to date as files are
+ * reserved and removed. COFFEE_NAME_INDEX_SIZE should be larger than
+ * the number of files expected; if the index fills up, Coffee falls
+ * back to scanning the storage until it is formatted or restarted.
+ */
+#ifndef COFFEE_NAME_INDEX
+#define COFFEE_NAME_INDEX	0
+#endif
+
+#ifndef COFFEE_NAME_INDEX_SIZE
+#define COFFEE_NAME_INDEX_SIZE	64
+#endif
+
+/*
+ * Reclaim sectors in a background process, one sector at a time, so
+ * that at least COFFEE_GC_RESERVE pages stay free. File writes then
+ * seldom have to wait for the garbage collector to erase sectors.
+ */
+#ifndef COFFEE_BACKGROUND_GC
+#define COFFEE_BACKGROUND_GC	0
+#endif
+
+#ifndef COFFEE_GC_RESERVE
+#define COFFEE_GC_RESERVE	(2 * COFFEE_PAGES_PER_SECTOR)
+#endif
+
 #if COFFEE_START & (COFFEE_SECTOR_SIZE - 1)
 #error COFFEE_START must point to the first byte in a sector.
 #endif
@@ -200,6 +230,24 @@ struct log_param {
   uint16_t size;
 };
 
+#if COFFEE_NAME_INDEX
+/* A slot in the file name index, which uses linear probing. Free slots
+   have the page value INVALID_PAGE, and at least one slot is always
+   free so that every probe sequence ends. */
+struct name_slot {
+  coffee_page_t page;
+  uint16_t hash;
+};
+
+#define NAME_INDEX_UNKNOWN	0	/* Must be built from the storage. */
+#define NAME_INDEX_VALID	1	/* Holds every file in the storage. */
+#define NAME_INDEX_FULL		2	/* Too small for the files. */
+
+static struct name_slot name_index[COFFEE_NAME_INDEX_SIZE];
+static uint8_t name_index_state;
+static unsigned name_index_count;
+#endif /* COFFEE_NAME_INDEX */
+
 /*
  * The protected memory consists of structures that should not be 
  * overwritten during system checkpointing because they may be used by 
@@ -217,6 +265,12 @@ static struct file_desc * const coffee_fd_set = protected_mem.coffee_fd_set;
 static coffee_page_t * const next_free = &protected_mem.next_free;
 static char * const gc_wait = &protected_mem.gc_wait;
 
+#if COFFEE_BACKGROUND_GC
+PROCESS(coffee_gc_process, "Coffee GC");
+
+static struct cfs_coffee_gc_stats gc_stats;
+#endif /* COFFEE_BACKGROUND_GC */
+
 /*---------------------------------------------------------------------------*/
 static void
 write_header(struct file_header *hdr, coffee_page_t page)
@@ -362,18 +416,70 @@ isolate_pages(coffee_page_t start, coffee_page_t skip_pages)
 
 }
 /*---------------------------------------------------------------------------*/
+static int
+sector_is_erasable(struct sector_status *stats, int mode)
+{
+  /*
+   * A sector is erasable if there are only free or obsolete pages in
+   * it. Obsolete files have already been removed from the file name
+   * index.
+   */
+  if(stats->active > 0) {
+    return 0;
+  }
+  return (mode == GC_RELUCTANT && stats->free == 0) ||
+         (mode == GC_GREEDY && stats->obsolete > 0);
+}
+/*---------------------------------------------------------------------------*/
+static void
+erase_sector(uint16_t sector, coffee_page_t isolation_count)
+{
+  coffee_page_t first_page;
+
+  first_page = sector * COFFEE_PAGES_PER_SECTOR;
+  if(first_page < *next_free) {
+    *next_free = first_page;
+  }
+
+  if(isolation_count > 0) {
+    isolate_pages(first_page + COFFEE_PAGES_PER_SECTOR, isolation_count);
+  }
+
+  COFFEE_ERASE(sector);
+  PRINTF("Coffee: Erased sector %d!\n", sector);
+}
+/*---------------------------------------------------------------------------*/
+#if COFFEE_BACKGROUND_GC
+static void
+record_gc_pause(uint16_t *histogram, clock_time_t start)
+{
+  unsigned long ms;
+  int i;
+
+  ms = (unsigned long)(clock_time() - start) * 1000 / CLOCK_SECOND;
+  for(i = 0; i < CFS_COFFEE_GC_HISTOGRAM_SIZE - 1 && ms >= (1UL << i); i++);
+  if(histogram[i] < 0xffff) {
+    histogram[i]++;
+  }
+}
+#endif /* COFFEE_BACKGROUND_GC */
+/*---------------------------------------------------------------------------*/
 static void
 collect_garbage(int mode)
 {
   uint16_t sector;
   struct sector_status stats;
-  coffee_page_t first_page, isolation_count;
+  coffee_page_t isolation_count;
+#if COFFEE_BACKGROUND_GC
+  clock_time_t start;
+
+  start = clock_time();
+#endif /* COFFEE_BACKGROUND_GC */
 
   PRINTF("Coffee: Running the file system garbage collector in %s mode\n",
 	 mode == GC_RELUCTANT ? "reluctant" : "greedy");
   /*
-   * The garbage collector erases as many sectors as possible. A sector is
-   * erasable if there are only free or obsolete pages in it.
+   * The garbage collector erases as many sectors as possible.
    */
   for(sector = 0; sector < COFFEE_SECTOR_COUNT; sector++) {
     isolation_count = get_sector_status(sector, &stats);
@@ -381,30 +487,86 @@ collect_garbage(int mode)
         sector, (unsigned)stats.active,
 	(unsigned)stats.obsolete, (unsigned)stats.free);
 
-    if(stats.active > 0) {
-      continue;
-    }
+    if(sector_is_erasable(&stats, mode)) {
+      erase_sector(sector, isolation_count);
 
-    if((mode == GC_RELUCTANT && stats.free == 0) ||
-       (mode == GC_GREEDY && stats.obsolete > 0)) {
-      first_page = sector * COFFEE_PAGES_PER_SECTOR;
-      if(first_page < *next_free) {
-        *next_free = first_page;
+      if(mode == GC_RELUCTANT && isolation_count > 0) {
+        break;
       }
+    }
+  }
 
-      if(isolation_count > 0) {
-        isolate_pages(first_page + COFFEE_PAGES_PER_SECTOR, isolation_count);
-      }
+#if COFFEE_BACKGROUND_GC
+  record_gc_pause(gc_stats.foreground, start);
+#endif /* COFFEE_BACKGROUND_GC */
+}
+/*---------------------------------------------------------------------------*/
+#if COFFEE_BACKGROUND_GC
+/*
+ * Erase at most one sector, and only if fewer than COFFEE_GC_RESERVE
+ * pages are free. Returns non-zero if a sector was erased.
+ */
+static int
+collect_garbage_slice(void)
+{
+  uint16_t sector, candidate;
+  struct sector_status stats;
+  coffee_page_t isolation_count, candidate_isolation;
+  unsigned long free_pages;
+  clock_time_t start;
 
-      COFFEE_ERASE(sector);
-      PRINTF("Coffee: Erased sector %d!\n", sector);
+  start = clock_time();
 
-      if(mode == GC_RELUCTANT && isolation_count > 0) {
-        break;
-      }
+  /* The sector status must be computed from the first sector each
+     time, since files may have been changed since the last slice. */
+  free_pages = 0;
+  candidate = COFFEE_SECTOR_COUNT;
+  candidate_isolation = 0;
+  for(sector = 0; sector < COFFEE_SECTOR_COUNT; sector++) {
+    isolation_count = get_sector_status(sector, &stats);
+    free_pages += stats.free;
+    if(candidate == COFFEE_SECTOR_COUNT &&
+       sector_is_erasable(&stats, GC_GREEDY)) {
+      candidate = sector;
+      candidate_isolation = isolation_count;
+    }
+  }
+
+  if(free_pages >= COFFEE_GC_RESERVE || candidate == COFFEE_SECTOR_COUNT) {
+    return 0;
+  }
+
+  erase_sector(candidate, candidate_isolation);
+  *gc_wait = 0;
+  record_gc_pause(gc_stats.background, start);
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static void
+request_gc(void)
+{
+  if(!process_is_running(&coffee_gc_process)) {
+    process_start(&coffee_gc_process, NULL);
+  }
+  process_poll(&coffee_gc_process);
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(coffee_gc_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+  while(1) {
+    PROCESS_WAIT_EVENT_UNTIL(ev == PROCESS_EVENT_POLL);
+
+    /* Let other processes run between the sector erasures. */
+    while(collect_garbage_slice()) {
+      PROCESS_PAUSE();
     }
   }
+
+  PROCESS_END();
 }
+#endif /* COFFEE_BACKGROUND_GC */
 /*---------------------------------------------------------------------------*/
 static coffee_page_t
 next_file(coffee_page_t page, struct file_header *hdr)
@@ -469,6 +631,127 @@ load_file(coffee_page_t start, struct file_header *hdr)
   return file;
 }
 /*---------------------------------------------------------------------------*/
+#if COFFEE_NAME_INDEX
+static uint16_t
+name_hash(const char *name)
+{
+  uint16_t hash;
+  int i;
+
+  /* Only the part of the name that fits in a file header counts. */
+  hash = 0;
+  for(i = 0; i < COFFEE_NAME_LENGTH - 1 && name[i] != '\0'; i++) {
+    hash = (hash << 5) + hash + (unsigned char)name[i];
+  }
+  return hash;
+}
+/*---------------------------------------------------------------------------*/
+static void
+name_index_add(const char *name, coffee_page_t page)
+{
+  uint16_t hash;
+  unsigned slot;
+
+  if(name_index_count < COFFEE_NAME_INDEX_SIZE - 1) {
+    hash = name_hash(name);
+    slot = hash % COFFEE_NAME_INDEX_SIZE;
+    while(name_index[slot].page != INVALID_PAGE) {
+      slot = (slot + 1) % COFFEE_NAME_INDEX_SIZE;
+    }
+    name_index[slot].page = page;
+    name_index[slot].hash = hash;
+    name_index_count++;
+    return;
+  }
+
+  PRINTF("Coffee: The file name index is full\n");
+  name_index_state = NAME_INDEX_FULL;
+}
+/*---------------------------------------------------------------------------*/
+static void
+name_index_remove(const char *name, coffee_page_t page)
+{
+  unsigned hole, slot, home, i;
+
+  hole = name_hash(name) % COFFEE_NAME_INDEX_SIZE;
+  for(i = 0; name_index[hole].page != page; i++) {
+    if(name_index[hole].page == INVALID_PAGE ||
+       i == COFFEE_NAME_INDEX_SIZE) {
+      return;
+    }
+    hole = (hole + 1) % COFFEE_NAME_INDEX_SIZE;
+  }
+
+  /*
+   * Fill the hole by moving back the following entries of the probe
+   * sequence, unless their home slot lies (cyclically) after the hole.
+   */
+  slot = hole;
+  for(;;) {
+    slot = (slot + 1) % COFFEE_NAME_INDEX_SIZE;
+    if(name_index[slot].page == INVALID_PAGE) {
+      break;
+    }
+    home = name_index[slot].hash % COFFEE_NAME_INDEX_SIZE;
+    if((slot > hole && (home <= hole || home > slot)) ||
+       (slot < hole && (home <= hole && home > slot))) {
+      name_index[hole] = name_index[slot];
+      hole = slot;
+    }
+  }
+  name_index[hole].page = INVALID_PAGE;
+  name_index_count--;
+}
+/*---------------------------------------------------------------------------*/
+static void
+name_index_build(void)
+{
+  struct file_header hdr;
+  coffee_page_t page;
+  unsigned i;
+
+  for(i = 0; i < COFFEE_NAME_INDEX_SIZE; i++) {
+    name_index[i].page = INVALID_PAGE;
+  }
+  name_index_count = 0;
+  name_index_state = NAME_INDEX_VALID;
+
+  for(page = 0; page < COFFEE_PAGE_COUNT; page = next_file(page, &hdr)) {
+    read_header(&hdr, page);
+    if(HDR_ACTIVE(hdr) && !HDR_LOG(hdr)) {
+      name_index_add(hdr.name, page);
+      if(name_index_state != NAME_INDEX_VALID) {
+        return;
+      }
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static struct file *
+name_index_find(const char *name)
+{
+  struct file_header hdr;
+  uint16_t hash;
+  unsigned slot, i;
+
+  hash = name_hash(name);
+  slot = hash % COFFEE_NAME_INDEX_SIZE;
+  for(i = 0; i < COFFEE_NAME_INDEX_SIZE; i++) {
+    if(name_index[slot].page == INVALID_PAGE) {
+      break;
+    }
+    if(name_index[slot].hash == hash) {
+      read_header(&hdr, name_index[slot].page);
+      if(HDR_ACTIVE(hdr) && !HDR_LOG(hdr) && strcmp(name, hdr.name) == 0) {
+        return load_file(name_index[slot].page, &hdr);
+      }
+    }
+    slot = (slot + 1) % COFFEE_NAME_INDEX_SIZE;
+  }
+  return NULL;
+}
+#endif /* COFFEE_NAME_INDEX */
+/*---------------------------------------------------------------------------*/
 static struct file *
 find_file(const char *name)
 {
@@ -488,6 +771,15 @@ find_file(const char *name)
     }
   }
   
+#if COFFEE_NAME_INDEX
+  if(name_index_state == NAME_INDEX_UNKNOWN) {
+    name_index_build();
+  }
+  if(name_index_state == NAME_INDEX_VALID) {
+    return name_index_find(name);
+  }
+#endif /* COFFEE_NAME_INDEX */
+
   /* Scan the flash memory sequentially otherwise. */
   for(page = 0; page < COFFEE_PAGE_COUNT; page = next_file(page, &hdr)) {
     read_header(&hdr, page);
@@ -590,6 +882,12 @@ remove_by_page(coffee_page_t page, int remove_log, int close_fds,
   hdr.flags |= HDR_FLAG_OBSOLETE;
   write_header(&hdr, page);
 
+#if COFFEE_NAME_INDEX
+  if(name_index_state == NAME_INDEX_VALID && !HDR_LOG(hdr)) {
+    name_index_remove(hdr.name, page);
+  }
+#endif /* COFFEE_NAME_INDEX */
+
   *gc_wait = 0;
 
   /* Close all file descriptors that reference the removed file. */
@@ -615,6 +913,10 @@ remove_by_page(coffee_page_t page, int remove_log, int close_fds,
   }
 #endif
 
+#if COFFEE_BACKGROUND_GC
+  request_gc();
+#endif /* COFFEE_BACKGROUND_GC */
+
   return 0;
 }
 /*---------------------------------------------------------------------------*/
@@ -656,9 +958,19 @@ reserve(const char *name, coffee_page_t pages,
   hdr.flags = HDR_FLAG_ALLOCATED | flags;
   write_header(&hdr, page);
 
+#if COFFEE_NAME_INDEX
+  if(name_index_state == NAME_INDEX_VALID && !(flags & HDR_FLAG_LOG)) {
+    name_index_add(hdr.name, page);
+  }
+#endif /* COFFEE_NAME_INDEX */
+
   PRINTF("Coffee: Reserved %u pages starting from %u for file %s\n",
       pages, page, name);
 
+#if COFFEE_BACKGROUND_GC
+  request_gc();
+#endif /* COFFEE_BACKGROUND_GC */
+
   file = load_file(page, &hdr);
   if(file != NULL) {
     file->end = 0;
@@ -1350,12 +1662,23 @@ cfs_coffee_format(void)
 
   /* Formatting invalidates the file information. */
   memset(&protected_mem, 0, sizeof(protected_mem));
+#if COFFEE_NAME_INDEX
+  name_index_state = NAME_INDEX_UNKNOWN;
+#endif /* COFFEE_NAME_INDEX */
 
   PRINTF(" done!\n");
 
   return 0;
 }
 /*---------------------------------------------------------------------------*/
+#if COFFEE_BACKGROUND_GC
+void
+cfs_coffee_get_gc_stats(struct cfs_coffee_gc_stats *stats)
+{
+  memcpy(stats, &gc_stats, sizeof(*stats));
+}
+#endif /* COFFEE_BACKGROUND_GC */
+/*---------------------------------------------------------------------------*/
 void *
 cfs_coffee_get_protected_mem(unsigned *size)
 {
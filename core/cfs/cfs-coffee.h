@@ -126,6 +126,28 @@ int cfs_coffee_set_io_semantics(int fd, unsigned flags);
  */
 int cfs_coffee_format(void);
 
+/**
+ * The number of buckets in the garbage collection pause histograms.
+ * Bucket i counts the pauses shorter than 2^i milliseconds that did
+ * not fit in a lower bucket, and the last bucket counts the rest.
+ */
+#define CFS_COFFEE_GC_HISTOGRAM_SIZE	10
+
+struct cfs_coffee_gc_stats {
+  /* Garbage collections that a file operation had to wait for. */
+  uint16_t foreground[CFS_COFFEE_GC_HISTOGRAM_SIZE];
+  /* Sectors erased by the background garbage collector. */
+  uint16_t background[CFS_COFFEE_GC_HISTOGRAM_SIZE];
+};
+
+/**
+ * \brief Get the garbage collection pause histograms.
+ * \param stats The structure to copy the histograms to.
+ *
+ * Available when Coffee is compiled with COFFEE_BACKGROUND_GC.
+ */
+void cfs_coffee_get_gc_stats(struct cfs_coffee_gc_stats *stats);
+
 /**
  * \brief Points out a memory region that may not be altered during
  * checkpointing operations that use the file system.
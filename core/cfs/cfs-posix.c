@@ -47,6 +47,7 @@ int
 cfs_open(const char *n, int f)
 {
   int s = 0;
+  int fd;
   if(f == CFS_READ) {
     return open(n, O_RDONLY);
   } else if(f & CFS_WRITE) {
@@ -56,12 +57,18 @@ cfs_open(const char *n, int f)
     } else {
       s |= O_WRONLY;
     }
-    if(f & CFS_APPEND) {
-      s |= O_APPEND;
-    } else {
+    if(!(f & CFS_APPEND)) {
       s |= O_TRUNC;
+    } else if(!(f & CFS_READ)) {
+      s |= O_APPEND;
+    }
+    fd = open(n, s, 0600);
+    if(fd >= 0 && (f & CFS_APPEND) && (f & CFS_READ)) {
+      /* As in Coffee, a file that is also opened for reading starts
+         at its end, but can be written anywhere after a seek. */
+      lseek(fd, 0, SEEK_END);
     }
-    return open(n, s, 0600);
+    return fd;
   }
   return -1;
 }
@@ -256,6 +256,11 @@ PROCESS_THREAD(slip_process, ev, data)
 
   rxbuf_init();
 
+#if PROCESS_PRIORITIES
+  /* Serve SLIP input before broadcasts and application events. */
+  process_set_priority(PROCESS_CURRENT(), PROCESS_PRIORITY_HIGH);
+#endif /* PROCESS_PRIORITIES */
+
   while(1) {
     PROCESS_YIELD_UNTIL(ev == PROCESS_EVENT_POLL);
     
@@ -62,6 +62,20 @@ static unsigned num_tables;
 MEMB(neighbor_addr_mem, nbr_table_key_t, NBR_TABLE_MAX_NEIGHBORS);
 LIST(nbr_table_keys);
 
+/* For each neighbor, when it was last added or looked up, counted in
+ * lookups. Used to replace the least recently used neighbor. */
+static uint16_t last_used[NBR_TABLE_MAX_NEIGHBORS];
+static uint16_t use_count;
+
+#if NBR_TABLE_HASH
+#if NBR_TABLE_HASH_SIZE <= NBR_TABLE_MAX_NEIGHBORS
+#error NBR_TABLE_CONF_HASH_SIZE must be larger than NBR_TABLE_CONF_MAX_NEIGHBORS
+#endif
+/* Open addressing hash table with linear probing. Each slot holds the
+ * neighbor index plus one, or zero if the slot is free. */
+static uint16_t hash_slots[NBR_TABLE_HASH_SIZE];
+#endif /* NBR_TABLE_HASH */
+
 /*---------------------------------------------------------------------------*/
 /* Get a key from a neighbor index */
 static nbr_table_key_t *
@@ -105,16 +119,91 @@ key_from_item(nbr_table_t *table, nbr_table_item_t *item)
   return key_from_index(index_from_item(table, item));
 }
 /*---------------------------------------------------------------------------*/
+#if NBR_TABLE_HASH
+/* Get the home slot of a link-layer address in the hash table */
+static int
+hash_slot(const rimeaddr_t *lladdr)
+{
+  uint16_t h;
+  int i;
+
+  h = 0;
+  for(i = 0; i < sizeof(rimeaddr_t); i++) {
+    h = (h << 5) + h + lladdr->u8[i];
+  }
+  return h % NBR_TABLE_HASH_SIZE;
+}
+/*---------------------------------------------------------------------------*/
+/* Add a neighbor to the hash table */
+static void
+hash_add(nbr_table_key_t *key)
+{
+  int slot;
+
+  slot = hash_slot(&key->lladdr);
+  while(hash_slots[slot] != 0) {
+    slot = (slot + 1) % NBR_TABLE_HASH_SIZE;
+  }
+  hash_slots[slot] = index_from_key(key) + 1;
+}
+/*---------------------------------------------------------------------------*/
+/* Remove a neighbor from the hash table, moving back the entries that
+ * follow it so that no probe sequence is broken */
+static void
+hash_remove(nbr_table_key_t *key)
+{
+  int hole, slot, home;
+
+  hole = hash_slot(&key->lladdr);
+  while(hash_slots[hole] != index_from_key(key) + 1) {
+    if(hash_slots[hole] == 0) {
+      return;
+    }
+    hole = (hole + 1) % NBR_TABLE_HASH_SIZE;
+  }
+
+  slot = hole;
+  while(1) {
+    slot = (slot + 1) % NBR_TABLE_HASH_SIZE;
+    if(hash_slots[slot] == 0) {
+      break;
+    }
+    home = hash_slot(&key_from_index(hash_slots[slot] - 1)->lladdr);
+    /* The entry can move to the hole unless its home slot lies
+       (cyclically) after the hole and at or before its slot */
+    if((slot > hole && (home <= hole || home > slot)) ||
+       (slot < hole && (home <= hole && home > slot))) {
+      hash_slots[hole] = hash_slots[slot];
+      hole = slot;
+    }
+  }
+  hash_slots[hole] = 0;
+}
+#endif /* NBR_TABLE_HASH */
+/*---------------------------------------------------------------------------*/
 /* Get the index of a neighbor from its link-layer address */
 static int
 index_from_lladdr(const rimeaddr_t *lladdr)
 {
   nbr_table_key_t *key;
+#if NBR_TABLE_HASH
+  int slot;
+#endif /* NBR_TABLE_HASH */
   /* Allow lladdr-free insertion, useful e.g. for IPv6 ND.
    * Only one such entry is possible at a time, indexed by rimeaddr_null. */
   if(lladdr == NULL) {
     lladdr = &rimeaddr_null;
   }
+#if NBR_TABLE_HASH
+  for(slot = hash_slot(lladdr); hash_slots[slot] != 0;
+      slot = (slot + 1) % NBR_TABLE_HASH_SIZE) {
+    key = key_from_index(hash_slots[slot] - 1);
+    if(rimeaddr_cmp(lladdr, &key->lladdr)) {
+      return hash_slots[slot] - 1;
+    }
+  }
+  return -1;
+#endif /* NBR_TABLE_HASH */
   key = list_head(nbr_table_keys);
   while(key != NULL) {
     if(lladdr && rimeaddr_cmp(lladdr, &key->lladdr)) {
@@ -161,6 +250,7 @@ nbr_table_allocate(void)
 {
   nbr_table_key_t *key;
   int least_used_count = 0;
+  uint16_t least_used_age = 0;
   nbr_table_key_t *least_used_key = NULL;
 
   key = memb_alloc(&neighbor_addr_mem);
@@ -170,7 +260,7 @@ nbr_table_allocate(void)
             * The replacement policy is the following: remove neighbor that is:
             * (1) not locked
             * (2) used by fewest tables
-            * (3) oldest (the list is ordered by insertion time)
+            * (3) least recently added or looked up
             * */
     /* Get item from first key */
     key = list_head(nbr_table_keys);
@@ -188,13 +278,14 @@ nbr_table_allocate(void)
           }
           used >>= 1;
         }
-        /* Find least used item */
-        if(least_used_key == NULL || used_count < least_used_count) {
+        /* Find least used item, and among those the least recently
+           used one */
+        uint16_t age = use_count - last_used[item_index];
+        if(least_used_key == NULL || used_count < least_used_count ||
+           (used_count == least_used_count && age > least_used_age)) {
           least_used_key = key;
           least_used_count = used_count;
-          if(used_count == 0) { /* We won't find any least used item */
-            break;
-          }
+          least_used_age = age;
         }
       }
       key = list_item_next(key);
@@ -218,6 +309,9 @@ nbr_table_allocate(void)
       used_map[index_from_key(least_used_key)] = 0;
       /* Remove neighbor from list */
       list_remove(nbr_table_keys, least_used_key);
+#if NBR_TABLE_HASH
+      hash_remove(least_used_key);
+#endif /* NBR_TABLE_HASH */
       /* Return associated key */
       return least_used_key;
     }
@@ -298,7 +392,11 @@ nbr_table_add_lladdr(nbr_table_t *table, const rimeaddr_t *lladdr)
 
     /* Set link-layer address */
     rimeaddr_copy(&key->lladdr, lladdr);
+#if NBR_TABLE_HASH
+    hash_add(key);
+#endif /* NBR_TABLE_HASH */
   }
+  last_used[index] = ++use_count;
 
   /* Get item in the current table */
   item = item_from_index(table, index);
@@ -314,8 +412,13 @@ nbr_table_add_lladdr(nbr_table_t *table, const rimeaddr_t *lladdr)
 void *
 nbr_table_get_from_lladdr(nbr_table_t *table, const rimeaddr_t *lladdr)
 {
-  void *item = item_from_index(table, index_from_lladdr(lladdr));
-  return nbr_get_bit(used_map, table, item) ? item : NULL;
+  int index = index_from_lladdr(lladdr);
+  void *item = item_from_index(table, index);
+  if(nbr_get_bit(used_map, table, item)) {
+    last_used[index] = ++use_count;
+    return item;
+  }
+  return NULL;
 }
 /*---------------------------------------------------------------------------*/
 /* Removes a neighbor from the current table (unset "used" bit) */
@@ -348,3 +451,21 @@ nbr_table_get_lladdr(nbr_table_t *table, void *item)
   nbr_table_key_t *key = key_from_item(table, item);
   return key != NULL ? &key->lladdr : NULL;
 }
+/*---------------------------------------------------------------------------*/
+/* Change the link-layer address of an item, keeping the index in sync */
+int
+nbr_table_update_lladdr(nbr_table_t *table, void *item, const rimeaddr_t *lladdr)
+{
+  nbr_table_key_t *key = key_from_item(table, item);
+  if(key == NULL) {
+    return 0;
+  }
+#if NBR_TABLE_HASH
+  hash_remove(key);
+#endif /* NBR_TABLE_HASH */
+  rimeaddr_copy(&key->lladdr, lladdr);
+#if NBR_TABLE_HASH
+  hash_add(key);
+#endif /* NBR_TABLE_HASH */
+  return 1;
+}
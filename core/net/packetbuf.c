@@ -55,12 +55,44 @@ struct packetbuf_addr packetbuf_addrs[PACKETBUF_NUM_ADDRS];
 static uint16_t buflen, bufptr;
 static uint8_t hdrptr;
 
+#if PACKETBUF_POOL
+#ifdef PACKETBUF_CONF_POOL_NUM
+#define POOL_NUM PACKETBUF_CONF_POOL_NUM
+#else /* PACKETBUF_CONF_POOL_NUM */
+#define POOL_NUM (QUEUEBUF_NUM + 2)
+#endif /* PACKETBUF_CONF_POOL_NUM */
+
+#if POOL_NUM < 2
+#error PACKETBUF_CONF_POOL_NUM must be at least 2
+#endif
+
+/* A slot has extra headroom in front of the usual header and data
+   portions. The packetbuf normally starts PACKETBUF_HDR_SIZE bytes
+   into its slot. */
+#define SLOT_SIZE (2 * PACKETBUF_HDR_SIZE + PACKETBUF_SIZE)
+
+struct packetbuf_slot {
+  uint16_t aligned[SLOT_SIZE / 2 + 1];
+  uint8_t refcount;
+  /* The lowest offset in the slot of a packet that is shared with a
+     view. Headers must not be written below it. */
+  uint16_t lowmark;
+};
+
+/* The first slot is the packetbuf until the pool is used. */
+static struct packetbuf_slot pool[POOL_NUM] = {{{0}, 1, SLOT_SIZE}};
+static struct packetbuf_slot *current = &pool[0];
+static uint8_t *packetbuf = (uint8_t *)pool[0].aligned + PACKETBUF_HDR_SIZE;
+
+#define SLOT_DATA(slot) ((uint8_t *)(slot)->aligned)
+#else /* PACKETBUF_POOL */
 /* The declarations below ensure that the packet buffer is aligned on
    an even 16-bit boundary. On some platforms (most notably the
    msp430), having apotentially misaligned packet buffer may lead to
    problems when accessing 16-bit values. */
 static uint16_t packetbuf_aligned[(PACKETBUF_SIZE + PACKETBUF_HDR_SIZE) / 2 + 1];
 static uint8_t *packetbuf = (uint8_t *)packetbuf_aligned;
+#endif /* PACKETBUF_POOL */
 
 static uint8_t *packetbufptr;
 
@@ -72,6 +104,87 @@ static uint8_t *packetbufptr;
 #define PRINTF(...)
 #endif
 
+/*---------------------------------------------------------------------------*/
+#if PACKETBUF_POOL
+static struct packetbuf_slot *
+slot_alloc(void)
+{
+  int i;
+
+  for(i = 0; i < POOL_NUM; i++) {
+    if(pool[i].refcount == 0) {
+      pool[i].refcount = 1;
+      pool[i].lowmark = SLOT_SIZE;
+      return &pool[i];
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+static void
+slot_release(struct packetbuf_slot *slot)
+{
+  if(--slot->refcount == 1 && slot == current) {
+    /* Only the packetbuf is left using the slot. */
+    slot->lowmark = SLOT_SIZE;
+  }
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * Give the packetbuf a slot of its own before it is modified. The
+ * header and data are copied along if copy is non-zero. Returns zero
+ * if the packetbuf is still shared, in which case it must not be
+ * written to. packetbuf_share() only shares a slot while another one
+ * is free, so this does not happen.
+ */
+static int
+make_private(int copy)
+{
+  struct packetbuf_slot *slot;
+  uint16_t base, start, end;
+  int is_reference;
+
+  if(current->refcount == 1) {
+    return 1;
+  }
+
+  slot = slot_alloc();
+  if(slot == NULL) {
+    PRINTF("packetbuf: no free slot, pool is too small\n");
+    return 0;
+  }
+
+  is_reference = packetbuf_is_reference();
+  base = packetbuf - SLOT_DATA(current);
+  if(copy) {
+    start = base + hdrptr;
+    end = base + PACKETBUF_HDR_SIZE + bufptr + buflen;
+    memcpy(SLOT_DATA(slot) + start, SLOT_DATA(current) + start, end - start);
+    RIMESTATS_ADD_N(copied, end - start);
+  }
+  slot_release(current);
+  current = slot;
+  packetbuf = SLOT_DATA(slot) + base;
+  if(!is_reference) {
+    packetbufptr = &packetbuf[PACKETBUF_HDR_SIZE];
+  }
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static int
+free_slots(void)
+{
+  int i, n;
+
+  n = 0;
+  for(i = 0; i < POOL_NUM; i++) {
+    if(pool[i].refcount == 0) {
+      n++;
+    }
+  }
+  return n;
+}
+#endif /* PACKETBUF_POOL */
 /*---------------------------------------------------------------------------*/
 void
 packetbuf_clear(void)
@@ -79,6 +192,14 @@ packetbuf_clear(void)
   buflen = bufptr = 0;
   hdrptr = PACKETBUF_HDR_SIZE;
 
+#if PACKETBUF_POOL
+  /* The old content is not needed, so a shared slot is simply left
+     to its other users. */
+  if(make_private(0)) {
+    packetbuf = SLOT_DATA(current) + PACKETBUF_HDR_SIZE;
+  }
+#endif /* PACKETBUF_POOL */
+
   packetbufptr = &packetbuf[PACKETBUF_HDR_SIZE];
   packetbuf_attr_clear();
 }
@@ -95,8 +216,14 @@ packetbuf_copyfrom(const void *from, uint16_t len)
   uint16_t l;
 
   packetbuf_clear();
+#if PACKETBUF_POOL
+  if(current->refcount > 1) {
+    return 0;
+  }
+#endif /* PACKETBUF_POOL */
   l = len > PACKETBUF_SIZE? PACKETBUF_SIZE: len;
   memcpy(packetbufptr, from, l);
+  RIMESTATS_ADD_N(copied, l);
   buflen = l;
   return l;
 }
@@ -107,9 +234,21 @@ packetbuf_compact(void)
   int i, len;
 
   if(packetbuf_is_reference()) {
+#if PACKETBUF_POOL
+    if(!make_private(0)) {
+      return;
+    }
+#endif /* PACKETBUF_POOL */
     memcpy(&packetbuf[PACKETBUF_HDR_SIZE], packetbuf_reference_ptr(),
 	   packetbuf_datalen());
+    RIMESTATS_ADD_N(copied, packetbuf_datalen());
   } else if(bufptr > 0) {
+#if PACKETBUF_POOL
+    if(!make_private(1)) {
+      return;
+    }
+#endif /* PACKETBUF_POOL */
+    RIMESTATS_ADD_N(copied, packetbuf_datalen());
     len = packetbuf_datalen() + PACKETBUF_HDR_SIZE;
     for(i = PACKETBUF_HDR_SIZE; i < len; i++) {
       packetbuf[i] = packetbuf[bufptr + i];
@@ -133,6 +272,7 @@ packetbuf_copyto_hdr(uint8_t *to)
   }
 #endif /* DEBUG_LEVEL */
   memcpy(to, packetbuf + hdrptr, PACKETBUF_HDR_SIZE - hdrptr);
+  RIMESTATS_ADD_N(copied, PACKETBUF_HDR_SIZE - hdrptr);
   return PACKETBUF_HDR_SIZE - hdrptr;
 }
 /*---------------------------------------------------------------------------*/
@@ -165,6 +305,7 @@ packetbuf_copyto(void *to)
   memcpy(to, packetbuf + hdrptr, PACKETBUF_HDR_SIZE - hdrptr);
   memcpy((uint8_t *)to + PACKETBUF_HDR_SIZE - hdrptr, packetbufptr + bufptr,
 	 buflen);
+  RIMESTATS_ADD_N(copied, PACKETBUF_HDR_SIZE - hdrptr + buflen);
   return PACKETBUF_HDR_SIZE - hdrptr + buflen;
 }
 /*---------------------------------------------------------------------------*/
@@ -172,6 +313,13 @@ int
 packetbuf_hdralloc(int size)
 {
   if(hdrptr >= size && packetbuf_totlen() + size <= PACKETBUF_SIZE) {
+#if PACKETBUF_POOL
+    /* The new header bytes must not overwrite a shared packet. */
+    if(packetbuf - SLOT_DATA(current) + hdrptr > current->lowmark &&
+       !make_private(1)) {
+      return 0;
+    }
+#endif /* PACKETBUF_POOL */
     hdrptr -= size;
     return 1;
   }
@@ -206,12 +354,24 @@ packetbuf_set_datalen(uint16_t len)
 void *
 packetbuf_dataptr(void)
 {
+#if PACKETBUF_POOL
+  /* The caller may write through the pointer. */
+  make_private(1);
+#endif /* PACKETBUF_POOL */
   return (void *)(&packetbuf[bufptr + PACKETBUF_HDR_SIZE]);
 }
 /*---------------------------------------------------------------------------*/
 void *
 packetbuf_hdrptr(void)
 {
+#if PACKETBUF_POOL
+  /* Header bytes allocated in front of a shared packet may be
+     written without a copy. Without such bytes, the header pointer
+     points into the shared packet itself. */
+  if(packetbuf - SLOT_DATA(current) + hdrptr >= current->lowmark) {
+    make_private(1);
+  }
+#endif /* PACKETBUF_POOL */
   return (void *)(&packetbuf[hdrptr]);
 }
 /*---------------------------------------------------------------------------*/
@@ -253,6 +413,68 @@ packetbuf_totlen(void)
   return packetbuf_hdrlen() + packetbuf_datalen();
 }
 /*---------------------------------------------------------------------------*/
+#if PACKETBUF_POOL
+int
+packetbuf_share(struct packetbuf_view *v)
+{
+  uint16_t off;
+
+  off = packetbuf - SLOT_DATA(current) + hdrptr;
+  if(packetbuf_is_reference() || bufptr > 0 || off < PACKETBUF_HDR_SIZE) {
+    /* The header and data are not contiguous, or there would not be
+       a full header area in front of the packet once restored. */
+    return 0;
+  }
+  if(off & 1) {
+    /* Restored, the packetbuf would start at an odd address, which
+       breaks 16-bit accesses on the msp430. */
+    return 0;
+  }
+  if(free_slots() == 0) {
+    /* Keep a slot free for the packetbuf to move to when it is
+       modified, so that a shared slot is never written. */
+    return 0;
+  }
+
+  v->slot = current;
+  v->off = off;
+  v->len = packetbuf_totlen();
+  current->refcount++;
+  if(off < current->lowmark) {
+    current->lowmark = off;
+  }
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+void
+packetbuf_view_restore(const struct packetbuf_view *v)
+{
+  v->slot->refcount++;
+  slot_release(current);
+  current = v->slot;
+
+  buflen = v->len;
+  bufptr = 0;
+  hdrptr = PACKETBUF_HDR_SIZE;
+  packetbuf = SLOT_DATA(current) + v->off - PACKETBUF_HDR_SIZE;
+  packetbufptr = &packetbuf[PACKETBUF_HDR_SIZE];
+  packetbuf_attr_clear();
+}
+/*---------------------------------------------------------------------------*/
+void
+packetbuf_view_release(struct packetbuf_view *v)
+{
+  slot_release(v->slot);
+  v->slot = NULL;
+}
+/*---------------------------------------------------------------------------*/
+void *
+packetbuf_view_ptr(const struct packetbuf_view *v)
+{
+  return SLOT_DATA(v->slot) + v->off;
+}
+#endif /* PACKETBUF_POOL */
+/*---------------------------------------------------------------------------*/
 void
 packetbuf_attr_clear(void)
 {
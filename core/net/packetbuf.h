@@ -313,6 +313,90 @@ int packetbuf_hdralloc(int size);
  */
 int packetbuf_hdrreduce(int size);
 
+/**
+ * \name Packet buffer pool
+ *
+ * When PACKETBUF_CONF_POOL is set to 1, the packetbuf is one slot in
+ * a pool of reference counted packet buffers, rather than a single
+ * static buffer. A queue buffer can then hold on to the packet in the
+ * packetbuf by taking a reference to its slot, instead of copying
+ * it, and put it back into the packetbuf later by making that slot
+ * the packetbuf again. The packetbuf switches to a fresh slot when it
+ * is cleared, and copies the shared slot before it is modified
+ * through packetbuf_dataptr(), packetbuf_compact() or a
+ * packetbuf_hdralloc() that would overwrite bytes of a shared packet.
+ * Header bytes returned by packetbuf_hdrptr() may be written without
+ * a copy only if they were allocated after the packet was shared, as
+ * is the case when a lower layer prepends its header.
+ *
+ * Each slot has PACKETBUF_HDR_SIZE bytes of extra headroom, so that a
+ * packet that was shared with its headers can get a full header
+ * area back. Code that keeps pointers into the packetbuf must fetch
+ * them again after queuebuf_to_packetbuf().
+ *
+ * The pool holds PACKETBUF_CONF_POOL_NUM slots, by default two more
+ * than the number of queue buffers, which is the least number that
+ * always leaves a slot free for the packetbuf.
+ * @{
+ */
+#ifdef PACKETBUF_CONF_POOL
+#define PACKETBUF_POOL PACKETBUF_CONF_POOL
+#else /* PACKETBUF_CONF_POOL */
+#define PACKETBUF_POOL 0
+#endif /* PACKETBUF_CONF_POOL */
+
+#if PACKETBUF_POOL
+struct packetbuf_slot;
+
+/**
+ * A reference to a packet, header included, in a slot of the pool.
+ */
+struct packetbuf_view {
+  struct packetbuf_slot *slot;
+  uint16_t off, len;
+};
+
+/**
+ * \brief      Take a reference to the packet in the packetbuf
+ * \param v    The view to fill in
+ * \retval     Non-zero if the packet is now shared with the view,
+ *             zero if it must be copied instead
+ *
+ *             The packet can only be shared when its header and data
+ *             are contiguous in the packetbuf, that is, when it does
+ *             not reference external data and no header has been
+ *             reduced with packetbuf_hdrreduce(), and when it starts
+ *             at an even offset, so that the packetbuf stays 16-bit
+ *             aligned once it is restored. It is not shared either
+ *             when no slot of the pool is free, since the packetbuf
+ *             must always be able to move to a slot of its own before
+ *             it is written to.
+ */
+int packetbuf_share(struct packetbuf_view *v);
+
+/**
+ * \brief      Make a shared packet the content of the packetbuf
+ * \param v    The view of the packet
+ *
+ *             As after packetbuf_copyfrom() of the packet, the whole
+ *             packet is in the data portion of the packetbuf, the
+ *             header is empty and the attributes are cleared. The
+ *             view keeps its reference.
+ */
+void packetbuf_view_restore(const struct packetbuf_view *v);
+
+/**
+ * \brief      Drop the reference of a view
+ */
+void packetbuf_view_release(struct packetbuf_view *v);
+
+/**
+ * \brief      Get a pointer to the first byte of a shared packet
+ */
+void *packetbuf_view_ptr(const struct packetbuf_view *v);
+#endif /* PACKETBUF_POOL */
+/** @} */
+
 /* Packet attributes stuff below: */
 
 typedef uint16_t packetbuf_attr_t;
@@ -55,6 +55,10 @@
 #define QUEUEBUF_REF_NUM 2
 #endif
 
+/* With a packetbuf pool, queuebufs share the packetbuf slot rather
+   than copying it. Swapped queuebufs always hold a copy. */
+#define QUEUEBUF_VIEWS (PACKETBUF_POOL && !WITH_SWAP)
+
 /* Structure pointing to a buffer either stored
    in RAM or swapped in CFS */
 struct queuebuf {
@@ -73,6 +77,9 @@ struct queuebuf {
     int swap_id;
   };
 #endif
+#if QUEUEBUF_VIEWS
+  struct queuebuf_view *view_ptr;
+#endif /* QUEUEBUF_VIEWS */
 };
 
 /* The actual queuebuf data */
@@ -90,6 +97,17 @@ struct queuebuf_ref {
   uint8_t hdrlen;
 };
 
+#if QUEUEBUF_VIEWS
+/* A queuebuf that refers to a packet in the packetbuf pool */
+struct queuebuf_view {
+  struct packetbuf_view view;
+  struct packetbuf_attr attrs[PACKETBUF_NUM_ATTRS];
+  struct packetbuf_addr addrs[PACKETBUF_NUM_ADDRS];
+};
+
+MEMB(bufviewmem, struct queuebuf_view, QUEUEBUF_NUM);
+#endif /* QUEUEBUF_VIEWS */
+
 MEMB(bufmem, struct queuebuf, QUEUEBUF_NUM);
 MEMB(refbufmem, struct queuebuf_ref, QUEUEBUF_REF_NUM);
 MEMB(buframmem, struct queuebuf_data, QUEUEBUFRAM_NUM);
@@ -302,6 +320,9 @@ queuebuf_init(void)
   memb_init(&buframmem);
   memb_init(&bufmem);
   memb_init(&refbufmem);
+#if QUEUEBUF_VIEWS
+  memb_init(&bufviewmem);
+#endif /* QUEUEBUF_VIEWS */
 #if QUEUEBUF_STATS
   queuebuf_max_len = QUEUEBUF_NUM;
 #endif /* QUEUEBUF_STATS */
@@ -341,6 +362,18 @@ queuebuf_new_from_packetbuf(void)
       buf->line = line;
       buf->time = clock_time();
 #endif /* QUEUEBUF_DEBUG */
+#if QUEUEBUF_VIEWS
+      buf->ram_ptr = NULL;
+      buf->view_ptr = memb_alloc(&bufviewmem);
+      if(buf->view_ptr != NULL) {
+        if(packetbuf_share(&buf->view_ptr->view)) {
+          packetbuf_attr_copyto(buf->view_ptr->attrs, buf->view_ptr->addrs);
+          goto allocated;
+        }
+        memb_free(&bufviewmem, buf->view_ptr);
+        buf->view_ptr = NULL;
+      }
+#endif /* QUEUEBUF_VIEWS */
       buf->ram_ptr = memb_alloc(&buframmem);
 #if WITH_SWAP
       /* If the allocation failed, store the qbuf in swap files */
@@ -374,13 +407,15 @@ queuebuf_new_from_packetbuf(void)
       }
 #endif
 
+#if QUEUEBUF_VIEWS
+    allocated:
+#endif /* QUEUEBUF_VIEWS */
 #if QUEUEBUF_STATS
       ++queuebuf_len;
       PRINTF("queuebuf len %d\n", queuebuf_len);
       printf("#A q=%d\n", queuebuf_len);
       if(queuebuf_len == queuebuf_max_len + 1) {
-  memb_free(&bufmem, buf);
-  queuebuf_len--;
+  queuebuf_free(buf);
   return NULL;
       }
 #endif /* QUEUEBUF_STATS */
@@ -395,7 +430,14 @@ queuebuf_new_from_packetbuf(void)
 void
 queuebuf_update_attr_from_packetbuf(struct queuebuf *buf)
 {
-  struct queuebuf_data *buframptr = queuebuf_load_to_ram(buf);
+  struct queuebuf_data *buframptr;
+#if QUEUEBUF_VIEWS
+  if(buf->view_ptr != NULL) {
+    packetbuf_attr_copyto(buf->view_ptr->attrs, buf->view_ptr->addrs);
+    return;
+  }
+#endif /* QUEUEBUF_VIEWS */
+  buframptr = queuebuf_load_to_ram(buf);
   packetbuf_attr_copyto(buframptr->attrs, buframptr->addrs);
 #if WITH_SWAP
   if(buf->location == IN_CFS) {
@@ -415,6 +457,12 @@ queuebuf_free(struct queuebuf *buf)
       queuebuf_remove_from_file(buf->swap_id);
     }
 #else
+#if QUEUEBUF_VIEWS
+    if(buf->view_ptr != NULL) {
+      packetbuf_view_release(&buf->view_ptr->view);
+      memb_free(&bufviewmem, buf->view_ptr);
+    } else
+#endif /* QUEUEBUF_VIEWS */
     memb_free(&buframmem, buf->ram_ptr);
 #endif
     memb_free(&bufmem, buf);
@@ -438,7 +486,15 @@ queuebuf_to_packetbuf(struct queuebuf *b)
 {
   struct queuebuf_ref *r;
   if(memb_inmemb(&bufmem, b)) {
-    struct queuebuf_data *buframptr = queuebuf_load_to_ram(b);
+    struct queuebuf_data *buframptr;
+#if QUEUEBUF_VIEWS
+    if(b->view_ptr != NULL) {
+      packetbuf_view_restore(&b->view_ptr->view);
+      packetbuf_attr_copyfrom(b->view_ptr->attrs, b->view_ptr->addrs);
+      return;
+    }
+#endif /* QUEUEBUF_VIEWS */
+    buframptr = queuebuf_load_to_ram(b);
     packetbuf_copyfrom(buframptr->data, buframptr->len);
     packetbuf_attr_copyfrom(buframptr->attrs, buframptr->addrs);
   } else if(memb_inmemb(&refbufmem, b)) {
@@ -456,7 +512,13 @@ queuebuf_dataptr(struct queuebuf *b)
   struct queuebuf_ref *r;
 
   if(memb_inmemb(&bufmem, b)) {
-    struct queuebuf_data *buframptr = queuebuf_load_to_ram(b);
+    struct queuebuf_data *buframptr;
+#if QUEUEBUF_VIEWS
+    if(b->view_ptr != NULL) {
+      return packetbuf_view_ptr(&b->view_ptr->view);
+    }
+#endif /* QUEUEBUF_VIEWS */
+    buframptr = queuebuf_load_to_ram(b);
     return buframptr->data;
   } else if(memb_inmemb(&refbufmem, b)) {
     r = (struct queuebuf_ref *)b;
@@ -468,21 +530,39 @@ queuebuf_dataptr(struct queuebuf *b)
 int
 queuebuf_datalen(struct queuebuf *b)
 {
-  struct queuebuf_data *buframptr = queuebuf_load_to_ram(b);
+  struct queuebuf_data *buframptr;
+#if QUEUEBUF_VIEWS
+  if(b->view_ptr != NULL) {
+    return b->view_ptr->view.len;
+  }
+#endif /* QUEUEBUF_VIEWS */
+  buframptr = queuebuf_load_to_ram(b);
   return buframptr->len;
 }
 /*---------------------------------------------------------------------------*/
 rimeaddr_t *
 queuebuf_addr(struct queuebuf *b, uint8_t type)
 {
-  struct queuebuf_data *buframptr = queuebuf_load_to_ram(b);
+  struct queuebuf_data *buframptr;
+#if QUEUEBUF_VIEWS
+  if(b->view_ptr != NULL) {
+    return &b->view_ptr->addrs[type - PACKETBUF_ADDR_FIRST].addr;
+  }
+#endif /* QUEUEBUF_VIEWS */
+  buframptr = queuebuf_load_to_ram(b);
   return &buframptr->addrs[type - PACKETBUF_ADDR_FIRST].addr;
 }
 /*---------------------------------------------------------------------------*/
 packetbuf_attr_t
 queuebuf_attr(struct queuebuf *b, uint8_t type)
 {
-  struct queuebuf_data *buframptr = queuebuf_load_to_ram(b);
+  struct queuebuf_data *buframptr;
+#if QUEUEBUF_VIEWS
+  if(b->view_ptr != NULL) {
+    return b->view_ptr->attrs[type].val;
+  }
+#endif /* QUEUEBUF_VIEWS */
+  buframptr = queuebuf_load_to_ram(b);
   return buframptr->attrs[type].val;
 }
 /*---------------------------------------------------------------------------*/
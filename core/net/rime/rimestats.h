@@ -53,6 +53,20 @@ struct rimestats {
     sendingdrop; /* Packet dropped when we were sending a packet */
 
   unsigned long lltx, llrx;
+
+  /* Bytes copied into, out of and within the packetbuf and the queue
+     buffers, including 6lowpan's copies between the packetbuf, uip_buf
+     and its reassembly buffers. Divided by the number of transmitted
+     packets, this gives the copying cost per packet. */
+  unsigned long copied;
+
+  /* Outcome of 6lowpan reassembly contexts: datagrams completed,
+     discarded after SICSLOWPAN_REASS_MAXAGE, and discarded to make
+     room for another datagram. */
+  unsigned long reasscompleted, reasstimedout, reassevicted;
+
+  /* 6lowpan fragments forwarded without reassembly */
+  unsigned long fragforwarded;
 };
 
 #if RIMESTATS_CONF_ENABLED
@@ -60,9 +74,11 @@ struct rimestats {
 extern struct rimestats rimestats;
 
 #define RIMESTATS_ADD(x) rimestats.x++
+#define RIMESTATS_ADD_N(x, n) rimestats.x += (n)
 #define RIMESTATS_GET(x) rimestats.x
 #else /* RIMESTATS_CONF_ENABLED */
 #define RIMESTATS_ADD(x)
+#define RIMESTATS_ADD_N(x, n)
 #define RIMESTATS_GET(x) 0
 #endif /* RIMESTATS_CONF_ENABLED */
 
@@ -104,6 +104,22 @@ void uip_log(char *msg);
 #define SICSLOWPAN_MAX_MAC_TRANSMISSIONS 4
 #endif
 
+/* With fragment forwarding, a router sends on the fragments of a
+   datagram that is not for itself as they arrive, instead of
+   reassembling the datagram and fragmenting it again. */
+#ifdef SICSLOWPAN_CONF_FRAG_FORWARDING
+#define SICSLOWPAN_FRAG_FORWARDING SICSLOWPAN_CONF_FRAG_FORWARDING
+#else
+#define SICSLOWPAN_FRAG_FORWARDING 0
+#endif
+
+/* The number of datagrams that can be forwarded at the same time */
+#ifdef SICSLOWPAN_CONF_FRAG_FORWARD_NUM
+#define SICSLOWPAN_FRAG_FORWARD_NUM SICSLOWPAN_CONF_FRAG_FORWARD_NUM
+#else
+#define SICSLOWPAN_FRAG_FORWARD_NUM 4
+#endif
+
 #ifndef SICSLOWPAN_COMPRESSION
 #ifdef SICSLOWPAN_CONF_COMPRESSION
 #define SICSLOWPAN_COMPRESSION SICSLOWPAN_CONF_COMPRESSION
@@ -219,35 +235,65 @@ static int last_tx_status;
  *  @{
  */
 
-static uint16_t sicslowpan_len;
-
 /**
- * The buffer used for the 6lowpan reassembly.
- * This buffer contains only the IPv6 packet (no MAC header, 6lowpan, etc).
- * It has a fix size as we do not use dynamic memory allocation.
+ * The buffer that the incoming packet is uncompressed into: the
+ * buffer of its reassembly context if it is a fragment, uip_buf
+ * otherwise.
  */
-static uip_buf_t sicslowpan_aligned_buf;
-#define sicslowpan_buf (sicslowpan_aligned_buf.u8)
+static uint8_t *sicslowpan_buf;
 
-/** The total length of the IPv6 packet in the sicslowpan_buf. */
+/** Number of 8-octet units in the largest datagram we reassemble */
+#define REASS_UNITS ((UIP_BUFSIZE + 7) / 8)
 
 /**
- * length of the ip packet already sent / received.
- * It includes IP and transport headers.
+ * A datagram being reassembled. Fragments are told apart by the link
+ * layer sender, the datagram tag and the datagram size (RFC 4944,
+ * section 5.3). The bitmap has one bit for each 8-octet unit of the
+ * datagram that has been received.
  */
-static uint16_t processed_ip_in_len;
+struct sicslowpan_reass {
+  /** The total length of the IPv6 packet, 0 if the context is free */
+  uint16_t size;
+  uint16_t tag;
+  rimeaddr_t sender;
+  /** Number of bits set in received */
+  uint16_t nreceived;
+  uint8_t received[(REASS_UNITS + 7) / 8];
+  /** Reassembly %process %timer. */
+  struct timer timer;
+  /**
+   * The buffer used for the 6lowpan reassembly.
+   * This buffer contains only the IPv6 packet (no MAC header, 6lowpan, etc).
+   * It has a fix size as we do not use dynamic memory allocation.
+   */
+  uip_buf_t buf;
+};
 
-/** Datagram tag to be put in the fragments I send. */
-static uint16_t my_tag;
+static struct sicslowpan_reass reass[SICSLOWPAN_REASS_CONTEXTS];
 
-/** When reassembling, the tag in the fragments being merged. */
-static uint16_t reass_tag;
+#if SICSLOWPAN_FRAG_FORWARDING
+/**
+ * A datagram whose fragments are forwarded as they arrive. The first
+ * fragment decides the next hop, and the following fragments are
+ * sent there with the tag that we gave the datagram.
+ */
+struct sicslowpan_fwd {
+  /** The total length of the IPv6 packet, 0 if the entry is free */
+  uint16_t size;
+  uint16_t tag;
+  rimeaddr_t sender;
+  uint16_t out_tag;
+  rimeaddr_t nexthop;
+  /** Bytes of the datagram that have not been forwarded yet */
+  uint16_t remaining;
+  struct timer timer;
+};
 
-/** When reassembling, the source address of the fragments being merged */
-rimeaddr_t frag_sender;
+static struct sicslowpan_fwd fwd[SICSLOWPAN_FRAG_FORWARD_NUM];
+#endif /* SICSLOWPAN_FRAG_FORWARDING */
 
-/** Reassembly %process %timer. */
-static struct timer reass_timer;
+/** Datagram tag to be put in the fragments I send. */
+static uint16_t my_tag;
 
 /** @} */
 #else /* SICSLOWPAN_CONF_FRAG */
@@ -1099,6 +1145,7 @@ compress_hdr_hc1(rimeaddr_t *rime_destaddr)
     *rime_ptr = SICSLOWPAN_DISPATCH_IPV6;
     rime_hdr_len += SICSLOWPAN_IPV6_HDR_LEN;
     memcpy(rime_ptr + rime_hdr_len, UIP_IP_BUF, UIP_IPH_LEN);
+    RIMESTATS_ADD_N(copied, UIP_IPH_LEN);
     rime_hdr_len += UIP_IPH_LEN;
     uncomp_hdr_len += UIP_IPH_LEN;
   } else {
@@ -1287,6 +1334,7 @@ compress_hdr_ipv6(rimeaddr_t *rime_destaddr)
   *rime_ptr = SICSLOWPAN_DISPATCH_IPV6;
   rime_hdr_len += SICSLOWPAN_IPV6_HDR_LEN;
   memcpy(rime_ptr + rime_hdr_len, UIP_IP_BUF, UIP_IPH_LEN);
+  RIMESTATS_ADD_N(copied, UIP_IPH_LEN);
   rime_hdr_len += UIP_IPH_LEN;
   uncomp_hdr_len += UIP_IPH_LEN;
   return;
@@ -1484,6 +1532,7 @@ output(uip_lladdr_t *localdest)
     PRINTFO("(len %d, tag %d)\n", rime_payload_len, my_tag);
     memcpy(rime_ptr + rime_hdr_len,
            (uint8_t *)UIP_IP_BUF + uncomp_hdr_len, rime_payload_len);
+    RIMESTATS_ADD_N(copied, rime_payload_len);
     packetbuf_set_datalen(rime_payload_len + rime_hdr_len);
     q = queuebuf_new_from_packetbuf();
     if(q == NULL) {
@@ -1494,6 +1543,8 @@ output(uip_lladdr_t *localdest)
     queuebuf_to_packetbuf(q);
     queuebuf_free(q);
     q = NULL;
+    /* The restored packet need not be where the fragment was built */
+    rime_ptr = packetbuf_dataptr();
 
     /* Check tx result. */
     if((last_tx_status == MAC_TX_COLLISION) ||
@@ -1530,6 +1581,7 @@ output(uip_lladdr_t *localdest)
              processed_ip_out_len >> 3, rime_payload_len, my_tag);
       memcpy(rime_ptr + rime_hdr_len,
              (uint8_t *)UIP_IP_BUF + processed_ip_out_len, rime_payload_len);
+      RIMESTATS_ADD_N(copied, rime_payload_len);
       packetbuf_set_datalen(rime_payload_len + rime_hdr_len);
       q = queuebuf_new_from_packetbuf();
       if(q == NULL) {
@@ -1540,6 +1592,7 @@ output(uip_lladdr_t *localdest)
       queuebuf_to_packetbuf(q);
       queuebuf_free(q);
       q = NULL;
+      rime_ptr = packetbuf_dataptr();
       processed_ip_out_len += rime_payload_len;
 
       /* Check tx result. */
@@ -1562,12 +1615,336 @@ output(uip_lladdr_t *localdest)
      */
     memcpy(rime_ptr + rime_hdr_len, (uint8_t *)UIP_IP_BUF + uncomp_hdr_len,
            uip_len - uncomp_hdr_len);
+    RIMESTATS_ADD_N(copied, uip_len - uncomp_hdr_len);
     packetbuf_set_datalen(uip_len - uncomp_hdr_len + rime_hdr_len);
     send_packet(&dest);
   }
   return 1;
 }
 
+#if SICSLOWPAN_CONF_FRAG
+/*--------------------------------------------------------------------*/
+/** \name Reassembly contexts
+ *  @{
+ */
+/*--------------------------------------------------------------------*/
+/**
+ * \brief Free the reassembly contexts, and the forwarding entries,
+ * that have timed out
+ */
+static void
+reass_expire(void)
+{
+  int i;
+
+  for(i = 0; i < SICSLOWPAN_REASS_CONTEXTS; i++) {
+    if(reass[i].size != 0 && timer_expired(&reass[i].timer)) {
+      PRINTFI("sicslowpan input: reassembly of tag %d timed out\n",
+              reass[i].tag);
+      reass[i].size = 0;
+      RIMESTATS_ADD(reasstimedout);
+    }
+  }
+#if SICSLOWPAN_FRAG_FORWARDING
+  for(i = 0; i < SICSLOWPAN_FRAG_FORWARD_NUM; i++) {
+    if(fwd[i].size != 0 && timer_expired(&fwd[i].timer)) {
+      fwd[i].size = 0;
+    }
+  }
+#endif /* SICSLOWPAN_FRAG_FORWARDING */
+}
+/*--------------------------------------------------------------------*/
+/** \brief Find the reassembly context of a fragment */
+static struct sicslowpan_reass *
+reass_lookup(const rimeaddr_t *sender, uint16_t tag, uint16_t size)
+{
+  int i;
+
+  for(i = 0; i < SICSLOWPAN_REASS_CONTEXTS; i++) {
+    if(reass[i].size != 0 && reass[i].size == size && reass[i].tag == tag &&
+       rimeaddr_cmp(&reass[i].sender, sender)) {
+      return &reass[i];
+    }
+  }
+  return NULL;
+}
+/*--------------------------------------------------------------------*/
+/**
+ * \brief Find the reassembly context of a fragment, or set up a new one
+ * \return The context, or NULL if the fragment is not accepted
+ *
+ * When all contexts are busy, the one that has been reassembling for
+ * the longest time is given up.
+ */
+static struct sicslowpan_reass *
+reass_get(const rimeaddr_t *sender, uint16_t tag, uint16_t size)
+{
+  struct sicslowpan_reass *r, *free, *oldest;
+  int i;
+
+  r = reass_lookup(sender, tag, size);
+  if(r != NULL) {
+    return r;
+  }
+
+  free = oldest = NULL;
+  for(i = 0; i < SICSLOWPAN_REASS_CONTEXTS; i++) {
+    r = &reass[i];
+    if(r->size == 0) {
+      free = r;
+    } else if(oldest == NULL ||
+              timer_remaining(&r->timer) < timer_remaining(&oldest->timer)) {
+      oldest = r;
+    }
+  }
+
+  if(size == 0 || size > UIP_BUFSIZE - UIP_LLH_LEN) {
+    return NULL;
+  }
+
+  if(free == NULL) {
+    PRINTFI("sicslowpan input: evicting reassembly of tag %d\n", oldest->tag);
+    free = oldest;
+    RIMESTATS_ADD(reassevicted);
+  }
+
+  r = free;
+  r->size = size;
+  r->tag = tag;
+  rimeaddr_copy(&r->sender, sender);
+  r->nreceived = 0;
+  memset(r->received, 0, sizeof(r->received));
+  timer_set(&r->timer, SICSLOWPAN_REASS_MAXAGE * CLOCK_SECOND / 16);
+  PRINTFI("sicslowpan input: INIT FRAGMENTATION (len %d, tag %d)\n",
+          size, tag);
+  return r;
+}
+/*--------------------------------------------------------------------*/
+/** \brief Check whether the 8-octet unit at offset has been received */
+static int
+reass_has(struct sicslowpan_reass *r, uint16_t offset)
+{
+  return (r->received[offset >> 6] & (1 << ((offset >> 3) & 7))) != 0;
+}
+/*--------------------------------------------------------------------*/
+/**
+ * \brief Record that the bytes from start to end of the datagram
+ * have been received
+ * \return Non-zero when the whole datagram has been received
+ */
+static int
+reass_mark(struct sicslowpan_reass *r, uint16_t start, uint16_t end)
+{
+  uint16_t unit;
+
+  if(end > r->size) {
+    /* Extraneous bytes at the end of the last fragment */
+    end = r->size;
+  }
+  for(unit = start >> 3; unit < (end + 7) >> 3; unit++) {
+    if(!(r->received[unit >> 3] & (1 << (unit & 7)))) {
+      r->received[unit >> 3] |= 1 << (unit & 7);
+      r->nreceived++;
+    }
+  }
+  return r->nreceived == (r->size + 7) >> 3;
+}
+#if SICSLOWPAN_FRAG_FORWARDING
+/*--------------------------------------------------------------------*/
+/** \brief Find the forwarding entry of a fragment */
+static struct sicslowpan_fwd *
+fwd_lookup(const rimeaddr_t *sender, uint16_t tag, uint16_t size)
+{
+  int i;
+
+  for(i = 0; i < SICSLOWPAN_FRAG_FORWARD_NUM; i++) {
+    if(fwd[i].size != 0 && fwd[i].size == size && fwd[i].tag == tag &&
+       rimeaddr_cmp(&fwd[i].sender, sender)) {
+      return &fwd[i];
+    }
+  }
+  return NULL;
+}
+/*--------------------------------------------------------------------*/
+/**
+ * \brief Find the link layer address of the next hop towards the
+ * destination of the IP packet in uip_buf
+ * \return The address, or NULL if the next hop is not a known neighbor
+ */
+static const uip_lladdr_t *
+fwd_nexthop(void)
+{
+  uip_ipaddr_t *nexthop;
+  uip_ds6_route_t *route;
+  uip_ds6_nbr_t *nbr;
+
+  if(uip_ds6_is_addr_onlink(&UIP_IP_BUF->destipaddr)) {
+    nexthop = &UIP_IP_BUF->destipaddr;
+  } else {
+    route = uip_ds6_route_lookup(&UIP_IP_BUF->destipaddr);
+    if(route != NULL) {
+      nexthop = uip_ds6_route_nexthop(route);
+    } else {
+      nexthop = uip_ds6_defrt_choose();
+    }
+  }
+  if(nexthop == NULL) {
+    return NULL;
+  }
+
+  nbr = uip_ds6_nbr_lookup(nexthop);
+  if(nbr == NULL || nbr->state == NBR_INCOMPLETE) {
+    return NULL;
+  }
+  return uip_ds6_nbr_get_ll(nbr);
+}
+/*--------------------------------------------------------------------*/
+/**
+ * \brief Forward the first fragment of a datagram
+ * \param sender The link layer sender of the fragment
+ * \param tag The datagram tag of the fragment
+ * \param size The size of the datagram
+ * \param frag_end The number of bytes of the datagram in the fragment
+ * \return Non-zero if the fragment was forwarded
+ *
+ * The fragment has been uncompressed into uip_buf. It is forwarded
+ * if the datagram is for another node that we know the next hop to,
+ * and if it has no extension headers that the IP layer would need to
+ * process. Its header is compressed again for the next hop. If the
+ * fragment is not forwarded, uip_buf still holds the uncompressed
+ * fragment.
+ */
+static int
+fwd_first(const rimeaddr_t *sender, uint16_t tag, uint16_t size,
+          uint16_t frag_end)
+{
+  struct sicslowpan_fwd *f;
+  const uip_lladdr_t *lladdr;
+  int framer_hdrlen;
+  int i;
+
+  if(uip_is_addr_mcast(&UIP_IP_BUF->destipaddr) ||
+     uip_is_addr_link_local(&UIP_IP_BUF->destipaddr) ||
+     uip_ds6_is_my_addr(&UIP_IP_BUF->destipaddr) ||
+     UIP_IP_BUF->ttl <= 1) {
+    return 0;
+  }
+  if(UIP_IP_BUF->proto != UIP_PROTO_UDP &&
+     UIP_IP_BUF->proto != UIP_PROTO_TCP &&
+     UIP_IP_BUF->proto != UIP_PROTO_ICMP6) {
+    return 0;
+  }
+
+  f = NULL;
+  for(i = 0; i < SICSLOWPAN_FRAG_FORWARD_NUM; i++) {
+    if(fwd[i].size == 0) {
+      f = &fwd[i];
+      break;
+    }
+  }
+  lladdr = fwd_nexthop();
+  if(f == NULL || lladdr == NULL) {
+    return 0;
+  }
+
+  f->tag = tag;
+  rimeaddr_copy(&f->sender, sender);
+  rimeaddr_copy(&f->nexthop, (const rimeaddr_t *)lladdr);
+
+  UIP_IP_BUF->ttl--;
+
+  /* From here on, the incoming fragment only exists in uip_buf. */
+  packetbuf_clear();
+  packetbuf_set_addr(PACKETBUF_ADDR_RECEIVER, &f->nexthop);
+  framer_hdrlen = NETSTACK_FRAMER.create();
+  if(framer_hdrlen < 0) {
+    framer_hdrlen = 21;
+  }
+  packetbuf_clear();
+  packetbuf_set_attr(PACKETBUF_ATTR_MAX_MAC_TRANSMISSIONS,
+                     SICSLOWPAN_MAX_MAC_TRANSMISSIONS);
+
+  rime_ptr = packetbuf_dataptr();
+  rime_hdr_len = 0;
+  uncomp_hdr_len = 0;
+#if SICSLOWPAN_COMPRESSION == SICSLOWPAN_COMPRESSION_HC1
+  compress_hdr_hc1(&f->nexthop);
+#endif /* SICSLOWPAN_COMPRESSION == SICSLOWPAN_COMPRESSION_HC1 */
+#if SICSLOWPAN_COMPRESSION == SICSLOWPAN_COMPRESSION_IPV6
+  compress_hdr_ipv6(&f->nexthop);
+#endif /* SICSLOWPAN_COMPRESSION == SICSLOWPAN_COMPRESSION_IPV6 */
+#if SICSLOWPAN_COMPRESSION == SICSLOWPAN_COMPRESSION_HC06
+  compress_hdr_hc06(&f->nexthop);
+#endif /* SICSLOWPAN_COMPRESSION == SICSLOWPAN_COMPRESSION_HC06 */
+
+  if(frag_end < uncomp_hdr_len ||
+     SICSLOWPAN_FRAG1_HDR_LEN + rime_hdr_len + frag_end - uncomp_hdr_len >
+     MAC_MAX_PAYLOAD - framer_hdrlen) {
+    /* The header compresses worse towards the next hop, and the
+       fragment no longer fits in a frame. */
+    PRINTFI("sicslowpan input: first fragment too large to forward\n");
+    UIP_IP_BUF->ttl++;
+    return 0;
+  }
+
+  memmove(rime_ptr + SICSLOWPAN_FRAG1_HDR_LEN, rime_ptr, rime_hdr_len);
+  SET16(RIME_FRAG_PTR, RIME_FRAG_DISPATCH_SIZE,
+        ((SICSLOWPAN_DISPATCH_FRAG1 << 8) | size));
+  SET16(RIME_FRAG_PTR, RIME_FRAG_TAG, my_tag);
+  rime_hdr_len += SICSLOWPAN_FRAG1_HDR_LEN;
+  memcpy(rime_ptr + rime_hdr_len, (uint8_t *)UIP_IP_BUF + uncomp_hdr_len,
+         frag_end - uncomp_hdr_len);
+  RIMESTATS_ADD_N(copied, frag_end - uncomp_hdr_len);
+  packetbuf_set_datalen(rime_hdr_len + frag_end - uncomp_hdr_len);
+
+  f->size = frag_end < size ? size : 0;
+  f->out_tag = my_tag++;
+  f->remaining = size - frag_end;
+  timer_set(&f->timer, SICSLOWPAN_REASS_MAXAGE * CLOCK_SECOND / 16);
+
+  PRINTFI("sicslowpan input: forwarding tag %d as tag %d\n", tag, f->out_tag);
+  RIMESTATS_ADD(fragforwarded);
+  send_packet(&f->nexthop);
+  return 1;
+}
+/*--------------------------------------------------------------------*/
+/**
+ * \brief Forward a subsequent fragment of a datagram whose first
+ * fragment has been forwarded
+ *
+ * The fragment is sent from the packetbuf as it is, with only its
+ * datagram tag changed.
+ */
+static void
+fwd_next(struct sicslowpan_fwd *f)
+{
+  uint16_t len;
+
+  /* Reuse the packetbuf for the outgoing fragment. */
+  packetbuf_compact();
+  packetbuf_clear_hdr();
+  len = packetbuf_datalen();
+  packetbuf_attr_clear();
+  packetbuf_set_attr(PACKETBUF_ATTR_MAX_MAC_TRANSMISSIONS,
+                     SICSLOWPAN_MAX_MAC_TRANSMISSIONS);
+
+  rime_ptr = packetbuf_dataptr();
+  SET16(RIME_FRAG_PTR, RIME_FRAG_TAG, f->out_tag);
+
+  if(len - SICSLOWPAN_FRAGN_HDR_LEN >= f->remaining) {
+    /* This was the rest of the datagram */
+    f->size = 0;
+  } else {
+    f->remaining -= len - SICSLOWPAN_FRAGN_HDR_LEN;
+  }
+
+  RIMESTATS_ADD(fragforwarded);
+  send_packet(&f->nexthop);
+}
+#endif /* SICSLOWPAN_FRAG_FORWARDING */
+/** @} */
+#endif /* SICSLOWPAN_CONF_FRAG */
+
 /*--------------------------------------------------------------------*/
 /** \brief Process a received 6lowpan packet.
  *  \param r The MAC layer
@@ -1578,6 +1955,11 @@ output(uip_lladdr_t *localdest)
  *  copied in siclowpan_buf. If the IP packet is complete it is copied
  *  to uip_buf and the IP layer is called.
  *
+ *  Fragments are reassembled in the buffer of the reassembly context
+ *  of their datagram, so several datagrams can be reassembled at the
+ *  same time. Packets that are not fragmented are uncompressed directly
+ *  into uip_buf.
+ *
  * \note We do not check for overlapping sicslowpan fragments
  * (it is a SHALL in the RFC 4944 and should never happen)
  */
@@ -1592,7 +1974,12 @@ input(void)
 #if SICSLOWPAN_CONF_FRAG
   /* tag of the fragment */
   uint16_t frag_tag = 0;
-  uint8_t first_fragment = 0, last_fragment = 0;
+  /* the reassembly context of the fragment */
+  struct sicslowpan_reass *r = NULL;
+#if SICSLOWPAN_FRAG_FORWARDING
+  struct sicslowpan_fwd *f;
+  rimeaddr_t sender;
+#endif /* SICSLOWPAN_FRAG_FORWARDING */
 #endif /*SICSLOWPAN_CONF_FRAG*/
 
   /* init */
@@ -1603,11 +1990,8 @@ input(void)
   rime_ptr = packetbuf_dataptr();
 
 #if SICSLOWPAN_CONF_FRAG
-  /* if reassembly timed out, cancel it */
-  if(timer_expired(&reass_timer)) {
-    sicslowpan_len = 0;
-    processed_ip_in_len = 0;
-  }
+  /* cancel the reassemblies that timed out */
+  reass_expire();
   /*
    * Since we don't support the mesh and broadcast header, the first header
    * we look for is the fragmentation header
@@ -1623,8 +2007,6 @@ input(void)
       PRINTFI("size %d, tag %d, offset %d)\n",
              frag_size, frag_tag, frag_offset);
       rime_hdr_len += SICSLOWPAN_FRAG1_HDR_LEN;
-      /*      printf("frag1 %d %d\n", reass_tag, frag_tag);*/
-      first_fragment = 1;
       is_fragment = 1;
       break;
     case SICSLOWPAN_DISPATCH_FRAGN:
@@ -1639,71 +2021,49 @@ input(void)
       PRINTFI("size %d, tag %d, offset %d)\n",
              frag_size, frag_tag, frag_offset);
       rime_hdr_len += SICSLOWPAN_FRAGN_HDR_LEN;
-
-      /* If this is the last fragment, we may shave off any extrenous
-         bytes at the end. We must be liberal in what we accept. */
-      PRINTFI("last_fragment?: processed_ip_in_len %d rime_payload_len %d frag_size %d\n",
-              processed_ip_in_len, packetbuf_datalen() - rime_hdr_len, frag_size);
-
-      if(processed_ip_in_len + packetbuf_datalen() - rime_hdr_len >= frag_size) {
-        last_fragment = 1;
-      }
       is_fragment = 1;
       break;
     default:
       break;
   }
 
-  /* We are currently reassembling a packet, but have just received the first
-   * fragment of another packet. We can either ignore it and hope to receive
-   * the rest of the under-reassembly packet fragments, or we can discard the
-   * previous packet altogether, and start reassembling the new packet.
-   *
-   * We discard the previous packet, and start reassembling the new packet.
-   * This lessens the negative impacts of too high SICSLOWPAN_REASS_MAXAGE.
-   */
-#define PRIORITIZE_NEW_PACKETS 1
-#if PRIORITIZE_NEW_PACKETS
-  if(processed_ip_in_len > 0 && first_fragment
-      && !rimeaddr_cmp(&frag_sender, packetbuf_addr(PACKETBUF_ADDR_SENDER))) {
-    sicslowpan_len = 0;
-    processed_ip_in_len = 0;
-  }
-#endif /* PRIORITIZE_NEW_PACKETS */
-
-  if(processed_ip_in_len > 0) {
-    /* reassembly is ongoing */
-    /*    printf("frag %d %d\n", reass_tag, frag_tag);*/
-    if((frag_size > 0 &&
-        (frag_size != sicslowpan_len ||
-         reass_tag  != frag_tag ||
-         !rimeaddr_cmp(&frag_sender, packetbuf_addr(PACKETBUF_ADDR_SENDER))))  ||
-       frag_size == 0) {
-      /*
-       * the packet is a fragment that does not belong to the packet
-       * being reassembled or the packet is not a fragment.
-       */
-      PRINTFI("sicslowpan input: Dropping 6lowpan packet that is not a fragment of the packet currently being reassembled\n");
+  sicslowpan_buf = uip_buf;
+  if(is_fragment) {
+    if(((uint16_t)frag_offset << 3) >= frag_size) {
+      /* The received units are only tracked within the datagram */
+      PRINTFI("sicslowpan input: Dropping fragment beyond the datagram\n");
       return;
     }
-  } else {
-    /*
-     * reassembly is off
-     * start it if we received a fragment
-     */
-    if((frag_size > 0) && (frag_size <= UIP_BUFSIZE)) {
-      /* We are currently not reassembling a packet, but have received a packet fragment
-       * that is not the first one. */
-      if(is_fragment && !first_fragment) {
-        return;
+#if SICSLOWPAN_FRAG_FORWARDING
+    rimeaddr_copy(&sender, packetbuf_addr(PACKETBUF_ADDR_SENDER));
+    f = fwd_lookup(&sender, frag_tag, frag_size);
+    if(f != NULL) {
+      if(rime_hdr_len == SICSLOWPAN_FRAGN_HDR_LEN) {
+        fwd_next(f);
       }
+      /* else a first fragment that we have forwarded already */
+      return;
+    }
 
-      sicslowpan_len = frag_size;
-      reass_tag = frag_tag;
-      timer_set(&reass_timer, SICSLOWPAN_REASS_MAXAGE * CLOCK_SECOND / 16);
-      PRINTFI("sicslowpan input: INIT FRAGMENTATION (len %d, tag %d)\n",
-             sicslowpan_len, reass_tag);
-      rimeaddr_copy(&frag_sender, packetbuf_addr(PACKETBUF_ADDR_SENDER));
+    /* The first fragment of a datagram that we may forward is
+       uncompressed into uip_buf. A reassembly context is set up only
+       if it is not forwarded. */
+    if(rime_hdr_len != SICSLOWPAN_FRAG1_HDR_LEN ||
+       reass_lookup(&sender, frag_tag, frag_size) != NULL)
+#endif /* SICSLOWPAN_FRAG_FORWARDING */
+    {
+      r = reass_get(packetbuf_addr(PACKETBUF_ADDR_SENDER), frag_tag, frag_size);
+      if(r == NULL) {
+        PRINTFI("sicslowpan input: Dropping fragment of a bad size packet\n");
+        return;
+      }
+      if(reass_has(r, (uint16_t)frag_offset << 3)) {
+        /* The first unit of a fragment is never covered by another
+           fragment, so this one has been received before. */
+        PRINTFI("sicslowpan input: Dropping duplicate fragment\n");
+        return;
+      }
+      sicslowpan_buf = r->buf.u8;
     }
   }
 
@@ -1733,6 +2093,7 @@ input(void)
 
       /* Put uncompressed IP header in sicslowpan_buf. */
       memcpy(SICSLOWPAN_IP_BUF, rime_ptr + rime_hdr_len, UIP_IPH_LEN);
+      RIMESTATS_ADD_N(copied, UIP_IPH_LEN);
 
       /* Update uncomp_hdr_len and rime_hdr_len. */
       rime_hdr_len += UIP_IPH_LEN;
@@ -1766,77 +2127,80 @@ input(void)
   {
     int req_size = UIP_LLH_LEN + uncomp_hdr_len + (uint16_t)(frag_offset << 3)
         + rime_payload_len;
-    if(req_size > sizeof(sicslowpan_buf)) {
+    if(req_size > UIP_BUFSIZE) {
       PRINTF(
           "SICSLOWPAN: packet dropped, minimum required SICSLOWPAN_IP_BUF size: %d+%d+%d+%d=%d (current size: %d)\n",
           UIP_LLH_LEN, uncomp_hdr_len, (uint16_t)(frag_offset << 3),
-          rime_payload_len, req_size, sizeof(sicslowpan_buf));
+          rime_payload_len, req_size, UIP_BUFSIZE);
       return;
     }
   }
 
   memcpy((uint8_t *)SICSLOWPAN_IP_BUF + uncomp_hdr_len + (uint16_t)(frag_offset << 3), rime_ptr + rime_hdr_len, rime_payload_len);
+  RIMESTATS_ADD_N(copied, rime_payload_len);
   
-  /* update processed_ip_in_len if fragment, sicslowpan_len otherwise */
+  /* record what part of the datagram we have if fragment, set uip_len
+     otherwise */
 
 #if SICSLOWPAN_CONF_FRAG
-  if(frag_size > 0) {
-    /* Add the size of the header only for the first fragment. */
-    if(first_fragment != 0) {
-      processed_ip_in_len += uncomp_hdr_len;
+  if(is_fragment) {
+    uint16_t start = (uint16_t)(frag_offset << 3);
+    uint16_t end = start + uncomp_hdr_len + rime_payload_len;
+
+#if SICSLOWPAN_FRAG_FORWARDING
+    if(r == NULL) {
+      if(fwd_first(&sender, frag_tag, frag_size, end)) {
+        return;
+      }
+      r = reass_get(&sender, frag_tag, frag_size);
+      if(r == NULL) {
+        return;
+      }
+      memcpy(r->buf.u8 + UIP_LLH_LEN, uip_buf + UIP_LLH_LEN, end);
+      RIMESTATS_ADD_N(copied, end);
+      sicslowpan_buf = r->buf.u8;
     }
-    /* For the last fragment, we are OK if there is extrenous bytes at
-       the end of the packet. */
-    if(last_fragment != 0) {
-      processed_ip_in_len = frag_size;
-    } else {
-      processed_ip_in_len += rime_payload_len;
+#endif /* SICSLOWPAN_FRAG_FORWARDING */
+
+    if(!reass_mark(r, start, end)) {
+      return;
     }
-    PRINTF("processed_ip_in_len %d, rime_payload_len %d\n", processed_ip_in_len, rime_payload_len);
 
-  } else {
+    /*
+     * We have a full IP packet in the reassembly buffer, deliver it
+     * to the IP stack
+     */
+    PRINTFI("sicslowpan input: IP packet ready (length %d)\n", r->size);
+    memcpy((uint8_t *)UIP_IP_BUF, (uint8_t *)SICSLOWPAN_IP_BUF, r->size);
+    RIMESTATS_ADD_N(copied, r->size);
+    uip_len = r->size;
+    r->size = 0;
+    RIMESTATS_ADD(reasscompleted);
+  } else
 #endif /* SICSLOWPAN_CONF_FRAG */
-    sicslowpan_len = rime_payload_len + uncomp_hdr_len;
-#if SICSLOWPAN_CONF_FRAG
+  {
+    uip_len = rime_payload_len + uncomp_hdr_len;
   }
 
-  /*
-   * If we have a full IP packet in sicslowpan_buf, deliver it to
-   * the IP stack
-   */
-  PRINTF("sicslowpan_init processed_ip_in_len %d, sicslowpan_len %d\n",
-         processed_ip_in_len, sicslowpan_len);
-  if(processed_ip_in_len == 0 || (processed_ip_in_len == sicslowpan_len)) {
-    PRINTFI("sicslowpan input: IP packet ready (length %d)\n",
-           sicslowpan_len);
-    memcpy((uint8_t *)UIP_IP_BUF, (uint8_t *)SICSLOWPAN_IP_BUF, sicslowpan_len);
-    uip_len = sicslowpan_len;
-    sicslowpan_len = 0;
-    processed_ip_in_len = 0;
-#endif /* SICSLOWPAN_CONF_FRAG */
-
 #if DEBUG
-    {
-      uint16_t ndx;
-      PRINTF("after decompression %u:", SICSLOWPAN_IP_BUF->len[1]);
-      for (ndx = 0; ndx < SICSLOWPAN_IP_BUF->len[1] + 40; ndx++) {
-        uint8_t data = ((uint8_t *) (SICSLOWPAN_IP_BUF))[ndx];
-        PRINTF("%02x", data);
-      }
-      PRINTF("\n");
+  {
+    uint16_t ndx;
+    PRINTF("after decompression %u:", SICSLOWPAN_IP_BUF->len[1]);
+    for (ndx = 0; ndx < SICSLOWPAN_IP_BUF->len[1] + 40; ndx++) {
+      uint8_t data = ((uint8_t *) (SICSLOWPAN_IP_BUF))[ndx];
+      PRINTF("%02x", data);
     }
+    PRINTF("\n");
+  }
 #endif
 
-    /* if callback is set then set attributes and call */
-    if(callback) {
-      set_packet_attrs();
-      callback->input_callback();
-    }
-
-    tcpip_input();
-#if SICSLOWPAN_CONF_FRAG
+  /* if callback is set then set attributes and call */
+  if(callback) {
+    set_packet_attrs();
+    callback->input_callback();
   }
-#endif /* SICSLOWPAN_CONF_FRAG */
+
+  tcpip_input();
 }
 /** @} */
 
@@ -795,6 +795,11 @@ tcpip_uipcall(void)
 PROCESS_THREAD(tcpip_process, ev, data)
 {
   PROCESS_BEGIN();
+
+#if PROCESS_PRIORITIES
+  /* Packets posted to the stack go ahead of the ordinary events. */
+  process_set_priority(PROCESS_CURRENT(), PROCESS_PRIORITY_HIGH);
+#endif /* PROCESS_PRIORITIES */
   
 #if UIP_TCP
  {
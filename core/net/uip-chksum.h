@@ -0,0 +1,80 @@
+/*
+ * Copyright (c) 2013, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Header file for the Internet checksum module
+ *
+ *         The module computes the one's complement sum used by the IP,
+ *         ICMP, UDP and TCP checksums, and updates a checksum when a
+ *         16-bit word of the data it covers changes (RFC 1624).
+ */
+
+#ifndef __UIP_CHKSUM_H__
+#define __UIP_CHKSUM_H__
+
+#include "net/uip.h"
+
+/**
+ * \brief      Add data to a partial one's complement sum
+ * \param sum  The sum so far, in host byte order
+ * \param data Pointer to the data
+ * \param len  Length of the data
+ * \return     The new sum, in host byte order
+ *
+ *             The data are summed as 16-bit words in network byte
+ *             order. An odd last byte is padded with a zero byte.
+ *             Sums of data that start at even offsets can be
+ *             combined with uip_chksum_combine().
+ */
+uint16_t uip_chksum_add(uint16_t sum, const uint8_t *data, uint16_t len);
+
+/**
+ * \brief      Combine two partial one's complement sums
+ */
+uint16_t uip_chksum_combine(uint16_t sum1, uint16_t sum2);
+
+/**
+ * \brief        Update a checksum for a changed 16-bit word
+ * \param chksum The checksum, as stored in the header
+ * \param oldval The old value of the word, as stored in the packet
+ * \param newval The new value of the word, as stored in the packet
+ * \return       The updated checksum, to be stored in the header
+ *
+ *               This is equation 3 of RFC 1624. It works on the
+ *               values as they are stored in the packet, whatever the
+ *               byte order of the CPU.
+ */
+uint16_t uip_chksum_update16(uint16_t chksum, uint16_t oldval,
+                             uint16_t newval);
+
+#endif /* __UIP_CHKSUM_H__ */
@@ -65,12 +65,69 @@ LIST(notificationlist);
 
 static int num_routes = 0;
 
+#if UIP_DS6_ROUTE_HASH
+/* The route index. Host routes are chained in hash buckets by their
+   address. The other routes are on the prefixroutes list, longest
+   prefix first, so that the first matching entry is the longest
+   match. */
+static uip_ds6_route_t *hashtab[UIP_DS6_ROUTE_HASH_SIZE];
+static uip_ds6_route_t *prefixroutes;
+#endif /* UIP_DS6_ROUTE_HASH */
+
 #undef DEBUG
 #define DEBUG DEBUG_NONE
 #include "net/uip-debug.h"
 
 static void rm_routelist_callback(nbr_table_item_t *ptr);
 /*---------------------------------------------------------------------------*/
+#if UIP_DS6_ROUTE_HASH
+static uip_ds6_route_t **
+index_head(uip_ipaddr_t *ipaddr, uint8_t length)
+{
+  uint32_t h;
+  int i;
+
+  if(length != 128) {
+    return &prefixroutes;
+  }
+
+  h = 0;
+  for(i = 0; i < 8; i++) {
+    h = (h * 33) ^ ipaddr->u16[i];
+  }
+  h ^= h >> 16;
+  h ^= h >> 8;
+  return &hashtab[h & (UIP_DS6_ROUTE_HASH_SIZE - 1)];
+}
+/*---------------------------------------------------------------------------*/
+static void
+index_add(uip_ds6_route_t *r)
+{
+  uip_ds6_route_t **p;
+
+  for(p = index_head(&r->ipaddr, r->length);
+      *p != NULL && (*p)->length > r->length;
+      p = &(*p)->index_next);
+  r->index_next = *p;
+  *p = r;
+}
+/*---------------------------------------------------------------------------*/
+static void
+index_remove(uip_ds6_route_t *r)
+{
+  uip_ds6_route_t **p;
+
+  for(p = index_head(&r->ipaddr, r->length);
+      *p != NULL;
+      p = &(*p)->index_next) {
+    if(*p == r) {
+      *p = r->index_next;
+      return;
+    }
+  }
+}
+#endif /* UIP_DS6_ROUTE_HASH */
+/*---------------------------------------------------------------------------*/
 #if DEBUG != DEBUG_NONE
 static void
 assert_nbr_routes_list_sane(void)
@@ -146,6 +203,11 @@ uip_ds6_route_init(void)
   memb_init(&defaultroutermemb);
   list_init(defaultrouterlist);
 
+#if UIP_DS6_ROUTE_HASH
+  memset(hashtab, 0, sizeof(hashtab));
+  prefixroutes = NULL;
+#endif /* UIP_DS6_ROUTE_HASH */
+
 #if UIP_DS6_NOTIFICATIONS
   list_init(notificationlist);
 #endif
@@ -218,7 +280,9 @@ uip_ds6_route_lookup(uip_ipaddr_t *addr)
 {
   uip_ds6_route_t *r;
   uip_ds6_route_t *found_route;
+#if !UIP_DS6_ROUTE_HASH
   uint8_t longestmatch;
+#endif /* !UIP_DS6_ROUTE_HASH */
 
   PRINTF("uip-ds6-route: Looking up route for ");
   PRINT6ADDR(addr);
@@ -226,6 +290,24 @@ uip_ds6_route_lookup(uip_ipaddr_t *addr)
 
 
   found_route = NULL;
+#if UIP_DS6_ROUTE_HASH
+  /* A host route is the longest possible match, so look for one
+     first, and then for the first (longest) matching prefix. */
+  for(r = *index_head(addr, 128); r != NULL; r = r->index_next) {
+    if(uip_ipaddr_cmp(addr, &r->ipaddr)) {
+      found_route = r;
+      break;
+    }
+  }
+  if(found_route == NULL) {
+    for(r = prefixroutes; r != NULL; r = r->index_next) {
+      if(uip_ipaddr_prefixcmp(addr, &r->ipaddr, r->length)) {
+        found_route = r;
+        break;
+      }
+    }
+  }
+#else /* UIP_DS6_ROUTE_HASH */
   longestmatch = 0;
   for(r = uip_ds6_route_head();
       r != NULL;
@@ -236,6 +318,7 @@ uip_ds6_route_lookup(uip_ipaddr_t *addr)
       found_route = r;
     }
   }
+#endif /* UIP_DS6_ROUTE_HASH */
 
   if(found_route != NULL) {
     PRINTF("uip-ds6-route: Found route: ");
@@ -277,6 +360,11 @@ uip_ds6_route_add(uip_ipaddr_t *ipaddr, uint8_t length,
     PRINTF("uip_ds6_route_add: old route already found, updating this one instead: ");
     PRINT6ADDR(ipaddr);
     PRINTF("\n");
+#if UIP_DS6_ROUTE_HASH
+    /* The address and length may change, so the route is indexed
+       again below. */
+    index_remove(r);
+#endif /* UIP_DS6_ROUTE_HASH */
   } else {
     struct uip_ds6_route_neighbor_routes *routes;
     /* If there is no routing entry, create one */
@@ -330,6 +418,9 @@ uip_ds6_route_add(uip_ipaddr_t *ipaddr, uint8_t length,
 
   uip_ipaddr_copy(&(r->ipaddr), ipaddr);
   r->length = length;
+#if UIP_DS6_ROUTE_HASH
+  index_add(r);
+#endif /* UIP_DS6_ROUTE_HASH */
 
 #ifdef UIP_DS6_ROUTE_STATE_TYPE
   memset(&r->state, 0, sizeof(UIP_DS6_ROUTE_STATE_TYPE));
@@ -366,6 +457,9 @@ uip_ds6_route_rm(uip_ds6_route_t *route)
     PRINTF("\n");
 
     list_remove(route->routes->route_list, route);
+#if UIP_DS6_ROUTE_HASH
+    index_remove(route);
+#endif /* UIP_DS6_ROUTE_HASH */
     if(list_head(route->routes->route_list) == NULL) {
       /* If this was the only route using this neighbor, remove the
          neibhor from the table */
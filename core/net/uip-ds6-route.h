@@ -80,6 +80,25 @@ void uip_ds6_notification_rm(struct uip_ds6_notification *n);
 #define UIP_DS6_ROUTE_NB UIP_CONF_MAX_ROUTES
 #endif /* UIP_CONF_MAX_ROUTES */
 
+/* With UIP_CONF_DS6_ROUTE_HASH, the routing table keeps an index
+   beside the per-neighbor route lists: host (/128) routes are found
+   through a hash table and the other routes are kept on a list
+   ordered by decreasing prefix length. This makes lookups fast on
+   nodes with many host routes, such as RPL roots in storing mode. */
+#ifdef UIP_CONF_DS6_ROUTE_HASH
+#define UIP_DS6_ROUTE_HASH UIP_CONF_DS6_ROUTE_HASH
+#else /* UIP_CONF_DS6_ROUTE_HASH */
+#define UIP_DS6_ROUTE_HASH 0
+#endif /* UIP_CONF_DS6_ROUTE_HASH */
+
+/* The number of hash buckets for host routes. Must be a power of
+   two. */
+#ifdef UIP_CONF_DS6_ROUTE_HASH_SIZE
+#define UIP_DS6_ROUTE_HASH_SIZE UIP_CONF_DS6_ROUTE_HASH_SIZE
+#else /* UIP_CONF_DS6_ROUTE_HASH_SIZE */
+#define UIP_DS6_ROUTE_HASH_SIZE 64
+#endif /* UIP_CONF_DS6_ROUTE_HASH_SIZE */
+
 /** \brief define some additional RPL related route state and
  *  neighbor callback for RPL - if not a DS6_ROUTE_STATE is already set */
 #ifndef UIP_DS6_ROUTE_STATE_TYPE
@@ -108,6 +127,11 @@ typedef struct uip_ds6_route {
      belong to the neighbor table entry that this routing table entry
      uses. */
   struct uip_ds6_route_neighbor_routes *routes;
+#if UIP_DS6_ROUTE_HASH
+  /* The next route in the same hash bucket, or on the list of
+     prefix routes. */
+  struct uip_ds6_route *index_next;
+#endif /* UIP_DS6_ROUTE_HASH */
   uip_ipaddr_t ipaddr;
 #ifdef UIP_DS6_ROUTE_STATE_TYPE
   UIP_DS6_ROUTE_STATE_TYPE state;
@@ -59,6 +59,7 @@
 #include "net/uip.h"
 #include "net/uip_arch.h"
 #include "net/uip-fw.h"
+#include "net/uip-chksum.h"
 #ifdef AODV_COMPLIANCE
 #include "net/uaodv-def.h"
 #endif
@@ -461,15 +462,12 @@ uip_fw_forward(void)
     time_exceeded();
   }
   
-  /* Decrement the TTL (time-to-live) value in the IP header */
+  /* Decrement the TTL (time-to-live) value in the IP header and
+     update the IP checksum for the changed TTL/protocol word. */
+  BUF->ipchksum = uip_chksum_update16(BUF->ipchksum,
+                                      UIP_HTONS((BUF->ttl << 8) | BUF->proto),
+                                      UIP_HTONS(((BUF->ttl - 1) << 8) | BUF->proto));
   BUF->ttl = BUF->ttl - 1;
-  
-  /* Update the IP checksum. */
-  if(BUF->ipchksum >= UIP_HTONS(0xffff - 0x0100)) {
-    BUF->ipchksum = BUF->ipchksum + UIP_HTONS(0x0100) + 1;
-  } else {
-    BUF->ipchksum = BUF->ipchksum + UIP_HTONS(0x0100);
-  }
 
   if(uip_len > 0) {
     uip_appdata = &uip_buf[UIP_LLH_LEN + UIP_TCPIP_HLEN];
@@ -194,8 +194,8 @@ uip_nd6_ns_input(void)
           uip_lladdr_t *lladdr = uip_ds6_nbr_get_ll(nbr);
           if(memcmp(&nd6_opt_llao[UIP_ND6_OPT_DATA_OFFSET],
 		    lladdr, UIP_LLADDR_LEN) != 0) {
-            memcpy(lladdr, &nd6_opt_llao[UIP_ND6_OPT_DATA_OFFSET],
-		   UIP_LLADDR_LEN);
+            nbr_table_update_lladdr(ds6_neighbors, nbr,
+                                    (rimeaddr_t *)&nd6_opt_llao[UIP_ND6_OPT_DATA_OFFSET]);
             nbr->state = NBR_STALE;
           } else {
             if(nbr->state == NBR_INCOMPLETE) {
@@ -476,8 +476,8 @@ uip_nd6_na_input(void)
       if(nd6_opt_llao == NULL) {
         goto discard;
       }
-      memcpy(lladdr, &nd6_opt_llao[UIP_ND6_OPT_DATA_OFFSET],
-	     UIP_LLADDR_LEN);
+      nbr_table_update_lladdr(ds6_neighbors, nbr,
+                              (rimeaddr_t *)&nd6_opt_llao[UIP_ND6_OPT_DATA_OFFSET]);
       if(is_solicited) {
         nbr->state = NBR_REACHABLE;
         nbr->nscount = 0;
@@ -499,8 +499,8 @@ uip_nd6_na_input(void)
         if(is_override || (!is_override && nd6_opt_llao != 0 && !is_llchange)
            || nd6_opt_llao == 0) {
           if(nd6_opt_llao != 0) {
-            memcpy(lladdr, &nd6_opt_llao[UIP_ND6_OPT_DATA_OFFSET],
-		   UIP_LLADDR_LEN);
+            nbr_table_update_lladdr(ds6_neighbors, nbr,
+                                    (rimeaddr_t *)&nd6_opt_llao[UIP_ND6_OPT_DATA_OFFSET]);
           }
           if(is_solicited) {
             nbr->state = NBR_REACHABLE;
@@ -822,8 +822,8 @@ uip_nd6_ra_input(void)
         uip_lladdr_t *lladdr = uip_ds6_nbr_get_ll(nbr);
         if(memcmp(&nd6_opt_llao[UIP_ND6_OPT_DATA_OFFSET],
 		  lladdr, UIP_LLADDR_LEN) != 0) {
-          memcpy(lladdr, &nd6_opt_llao[UIP_ND6_OPT_DATA_OFFSET],
-		 UIP_LLADDR_LEN);
+          nbr_table_update_lladdr(ds6_neighbors, nbr,
+                                  (rimeaddr_t *)&nd6_opt_llao[UIP_ND6_OPT_DATA_OFFSET]);
           nbr->state = NBR_STALE;
         }
         nbr->isrouter = 1;
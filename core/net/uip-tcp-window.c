@@ -0,0 +1,153 @@
+/*
+ * Copyright (c) 2013, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         The TCP send window: segments in flight and their
+ *         retransmit buffers
+ */
+
+#include "net/uip-tcp-window.h"
+#include "net/uip_arch.h"
+#include "lib/memb.h"
+
+#include <string.h>
+
+#if UIP_TCP_WINDOW
+
+struct rexmit_buf {
+  uint8_t data[UIP_TCP_MSS];
+};
+
+MEMB(rexmit_bufs, struct rexmit_buf, UIP_TCP_WINDOW_BUFS);
+static uint8_t nfree;
+/*---------------------------------------------------------------------------*/
+void
+uip_tcp_window_init(void)
+{
+  memb_init(&rexmit_bufs);
+  nfree = UIP_TCP_WINDOW_BUFS;
+}
+/*---------------------------------------------------------------------------*/
+uint16_t
+uip_tcp_window_room(struct uip_conn *conn)
+{
+  uint16_t room;
+
+  if(conn->len == 0) {
+    return conn->mss;
+  }
+
+  /* A new segment can only be sent after other data segments (not a
+     SYN or a FIN) that uIP can retransmit by itself. */
+  if(conn->nseg == 0 || conn->nseg == UIP_TCP_WINDOW_SEGMENTS ||
+     conn->segbuf[0] == NULL || nfree == 0 ||
+     conn->snd_wnd <= conn->len) {
+    return 0;
+  }
+
+  room = conn->snd_wnd - conn->len;
+  return room < conn->mss ? room : conn->mss;
+}
+/*---------------------------------------------------------------------------*/
+void
+uip_tcp_window_sent(struct uip_conn *conn, const uint8_t *data, uint16_t len)
+{
+  struct rexmit_buf *buf;
+
+  buf = NULL;
+  if(nfree > 0) {
+    buf = memb_alloc(&rexmit_bufs);
+    memcpy(buf->data, data, len);
+    nfree--;
+  }
+
+  conn->seglen[conn->nseg] = len;
+  conn->segbuf[conn->nseg] = buf == NULL ? NULL : buf->data;
+  conn->nseg++;
+}
+/*---------------------------------------------------------------------------*/
+static void
+remove_segments(struct uip_conn *conn, uint8_t n)
+{
+  uint8_t i;
+
+  for(i = 0; i < n; i++) {
+    if(conn->segbuf[i] != NULL) {
+      memb_free(&rexmit_bufs, conn->segbuf[i]);
+      nfree++;
+    }
+  }
+  conn->nseg -= n;
+  memmove(&conn->seglen[0], &conn->seglen[n],
+          conn->nseg * sizeof(conn->seglen[0]));
+  memmove(&conn->segbuf[0], &conn->segbuf[n],
+          conn->nseg * sizeof(conn->segbuf[0]));
+}
+/*---------------------------------------------------------------------------*/
+uint16_t
+uip_tcp_window_acked(struct uip_conn *conn, const uint8_t *ackno)
+{
+  uint16_t acked;
+  uint8_t i;
+
+  acked = 0;
+  for(i = 0; i < conn->nseg; i++) {
+    acked += conn->seglen[i];
+    uip_add32(conn->snd_nxt, acked);
+    if(memcmp(ackno, uip_acc32, 4) == 0) {
+      memcpy(conn->snd_nxt, uip_acc32, 4);
+      conn->len -= acked;
+      remove_segments(conn, i + 1);
+      return acked;
+    }
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+uint16_t
+uip_tcp_window_rexmit(struct uip_conn *conn, uint8_t *data)
+{
+  if(conn->nseg == 0 || conn->segbuf[0] == NULL) {
+    return 0;
+  }
+  memcpy(data, conn->segbuf[0], conn->seglen[0]);
+  return conn->seglen[0];
+}
+/*---------------------------------------------------------------------------*/
+void
+uip_tcp_window_flush(struct uip_conn *conn)
+{
+  remove_segments(conn, conn->nseg);
+}
+/*---------------------------------------------------------------------------*/
+#endif /* UIP_TCP_WINDOW */
@@ -0,0 +1,101 @@
+/*
+ * Copyright (c) 2013, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Header file for the TCP send window
+ *
+ *         Keeps track of the segments that a TCP connection has in
+ *         flight when UIP_CONF_TCP_WINDOW_SEGMENTS is larger than
+ *         one, and of the retransmit buffers that hold their data.
+ *         Used by uip.c and uip6.c.
+ */
+
+#ifndef __UIP_TCP_WINDOW_H__
+#define __UIP_TCP_WINDOW_H__
+
+#include "net/uip.h"
+
+#if UIP_TCP_WINDOW
+
+/**
+ * \brief      Initialize the retransmit buffer pool
+ */
+void uip_tcp_window_init(void);
+
+/**
+ * \brief      Record a data segment that is being sent
+ * \param conn The connection
+ * \param data The data of the segment
+ * \param len  The length of the segment
+ *
+ *             The data is copied into a retransmit buffer if one is
+ *             free. The caller must have checked that
+ *             uip_tcp_window_room() allows the segment.
+ */
+void uip_tcp_window_sent(struct uip_conn *conn, const uint8_t *data,
+                         uint16_t len);
+
+/**
+ * \brief       Process an acknowledgement
+ * \param conn  The connection
+ * \param ackno The acknowledgement number of the incoming segment
+ * \return      The number of bytes acknowledged
+ *
+ *              If the acknowledgement number ends one of the segments
+ *              in flight, that segment and all segments before it
+ *              are removed, and the sequence number and the amount of
+ *              outstanding data of the connection are updated.
+ */
+uint16_t uip_tcp_window_acked(struct uip_conn *conn, const uint8_t *ackno);
+
+/**
+ * \brief      Get the first segment in flight for retransmission
+ * \param conn The connection
+ * \param data Where to copy the data of the segment
+ * \return     The length of the segment, or zero if the segment has
+ *             no retransmit buffer and the application has to
+ *             retransmit it
+ */
+uint16_t uip_tcp_window_rexmit(struct uip_conn *conn, uint8_t *data);
+
+/**
+ * \brief      Forget all segments in flight
+ * \param conn The connection
+ *
+ *             Called when a connection is closed, aborted or reset.
+ */
+void uip_tcp_window_flush(struct uip_conn *conn);
+
+#endif /* UIP_TCP_WINDOW */
+
+#endif /* __UIP_TCP_WINDOW_H__ */
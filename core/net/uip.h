@@ -798,6 +798,26 @@ CCIF void uip_send(const void *data, int len);
  */
 #define uip_mss()             (uip_conn->mss)
 
+/**
+ * Get the amount of new data that can be sent on the current
+ * connection.
+ *
+ * Without UIP_CONF_TCP_WINDOW_SEGMENTS, new data can only be sent
+ * when no data is outstanding. With it, the application may call
+ * uip_send() with new data whenever this is non-zero, also when
+ * earlier segments have not been acknowledged yet. uip_acked() is
+ * then set whenever one or more segments have been acknowledged, and
+ * the application can ask to be polled again with tcpip_poll_tcp()
+ * to fill the window.
+ *
+ * \hideinitializer
+ */
+#if UIP_TCP_WINDOW
+#define uip_window_room()     uip_tcp_window_room(uip_conn)
+#else /* UIP_TCP_WINDOW */
+#define uip_window_room()     (uip_outstanding(uip_conn) ? 0 : uip_mss())
+#endif /* UIP_TCP_WINDOW */
+
 /**
  * Set up a new UDP connection.
  *
@@ -1319,6 +1339,19 @@ struct uip_conn {
   uint8_t timer;         /**< The retransmission timer. */
   uint8_t nrtx;          /**< The number of retransmissions for the last
 			 segment sent. */
+#if UIP_TCP_REXMIT_CHKSUM
+  uint16_t datasum;      /**< Checksum of the data that was previously
+                         sent. */
+#endif /* UIP_TCP_REXMIT_CHKSUM */
+#if UIP_TCP_WINDOW
+  uint16_t snd_wnd;      /**< The window advertised by the remote host. */
+  uint8_t nseg;          /**< The number of data segments in flight. */
+  uint16_t seglen[UIP_TCP_WINDOW_SEGMENTS]; /**< The length of each
+                         segment in flight. */
+  uint8_t *segbuf[UIP_TCP_WINDOW_SEGMENTS]; /**< The retransmit buffer
+                         of each segment in flight, or NULL if the
+                         application retransmits it. */
+#endif /* UIP_TCP_WINDOW */
 
   /** The application state. */
   uip_tcp_appstate_t appstate;
@@ -2192,6 +2225,15 @@ uint16_t uip_udpchksum(void);
  */
 uint16_t uip_icmp6chksum(void);
 
+#if UIP_TCP_WINDOW
+/**
+ * Get the amount of new data that can be sent on a connection.
+ *
+ * \sa uip_window_room()
+ */
+uint16_t uip_tcp_window_room(struct uip_conn *conn);
+#endif /* UIP_TCP_WINDOW */
+
 
 #endif /* __UIP_H__ */
 
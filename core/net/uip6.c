@@ -75,6 +75,8 @@
 #include "net/uip-icmp6.h"
 #include "net/uip-nd6.h"
 #include "net/uip-ds6.h"
+#include "net/uip-chksum.h"
+#include "net/uip-tcp-window.h"
 
 #include <string.h>
 
@@ -243,6 +245,11 @@ static uint8_t iss[4];
 uint8_t uip_acc32[4];
 static uint8_t opt;
 static uint16_t tmp16;
+#if UIP_TCP_WINDOW
+/* The offset of the segment being sent from the first unacknowledged
+   byte of the connection. */
+static uint16_t seq_offset;
+#endif /* UIP_TCP_WINDOW */
 #endif /* UIP_TCP */
 /** @} */
 
@@ -299,41 +306,10 @@ uip_add32(uint8_t *op32, uint16_t op16)
 
 #if ! UIP_ARCH_CHKSUM
 /*---------------------------------------------------------------------------*/
-static uint16_t
-chksum(uint16_t sum, const uint8_t *data, uint16_t len)
-{
-  uint16_t t;
-  const uint8_t *dataptr;
-  const uint8_t *last_byte;
-
-  dataptr = data;
-  last_byte = data + len - 1;
-  
-  while(dataptr < last_byte) {   /* At least two more bytes */
-    t = (dataptr[0] << 8) + dataptr[1];
-    sum += t;
-    if(sum < t) {
-      sum++;      /* carry */
-    }
-    dataptr += 2;
-  }
-  
-  if(dataptr == last_byte) {
-    t = (dataptr[0] << 8) + 0;
-    sum += t;
-    if(sum < t) {
-      sum++;      /* carry */
-    }
-  }
-
-  /* Return sum in host byte order. */
-  return sum;
-}
-/*---------------------------------------------------------------------------*/
 uint16_t
 uip_chksum(uint16_t *data, uint16_t len)
 {
-  return uip_htons(chksum(0, (uint8_t *)data, len));
+  return uip_htons(uip_chksum_add(0, (uint8_t *)data, len));
 }
 /*---------------------------------------------------------------------------*/
 #ifndef UIP_ARCH_IPCHKSUM
@@ -342,7 +318,7 @@ uip_ipchksum(void)
 {
   uint16_t sum;
 
-  sum = chksum(0, &uip_buf[UIP_LLH_LEN], UIP_IPH_LEN);
+  sum = uip_chksum_add(0, &uip_buf[UIP_LLH_LEN], UIP_IPH_LEN);
   PRINTF("uip_ipchksum: sum 0x%04x\n", sum);
   return (sum == 0) ? 0xffff : uip_htons(sum);
 }
@@ -372,10 +348,10 @@ upper_layer_chksum(uint8_t proto)
   /* IP protocol and length fields. This addition cannot carry. */
   sum = upper_layer_len + proto;
   /* Sum IP source and destination addresses. */
-  sum = chksum(sum, (uint8_t *)&UIP_IP_BUF->srcipaddr, 2 * sizeof(uip_ipaddr_t));
+  sum = uip_chksum_add(sum, (uint8_t *)&UIP_IP_BUF->srcipaddr, 2 * sizeof(uip_ipaddr_t));
 
   /* Sum TCP header and data. */
-  sum = chksum(sum, &uip_buf[UIP_IPH_LEN + UIP_LLH_LEN + uip_ext_len],
+  sum = uip_chksum_add(sum, &uip_buf[UIP_IPH_LEN + UIP_LLH_LEN + uip_ext_len],
                upper_layer_len);
     
   return (sum == 0) ? 0xffff : uip_htons(sum);
@@ -396,6 +372,24 @@ uip_tcpchksum(void)
 }
 #endif /* UIP_TCP */
 /*---------------------------------------------------------------------------*/
+#if UIP_TCP && UIP_TCP_REXMIT_CHKSUM
+/* The TCP checksum of an outgoing segment without options, given the
+   sum of its data. The data sum is kept in the connection so that a
+   retransmission only has to sum the pseudo header and the header. */
+static uint16_t
+tcp_data_chksum(uint16_t datasum)
+{
+  uint16_t sum;
+
+  sum = uip_len - UIP_IPH_LEN + UIP_PROTO_TCP;
+  sum = uip_chksum_add(sum, (uint8_t *)&UIP_IP_BUF->srcipaddr, 2 * sizeof(uip_ipaddr_t));
+  sum = uip_chksum_add(sum, &uip_buf[UIP_IPH_LEN + UIP_LLH_LEN], UIP_TCPH_LEN);
+  sum = uip_chksum_combine(sum, datasum);
+
+  return (sum == 0) ? 0xffff : uip_htons(sum);
+}
+#endif /* UIP_TCP && UIP_TCP_REXMIT_CHKSUM */
+/*---------------------------------------------------------------------------*/
 #if UIP_UDP && UIP_UDP_CHECKSUMS
 uint16_t
 uip_udpchksum(void)
@@ -418,6 +412,9 @@ uip_init(void)
   for(c = 0; c < UIP_CONNS; ++c) {
     uip_conns[c].tcpstateflags = UIP_CLOSED;
   }
+#if UIP_TCP_WINDOW
+  uip_tcp_window_init();
+#endif /* UIP_TCP_WINDOW */
 #endif /* UIP_TCP */
 
 #if UIP_ACTIVE_OPEN || UIP_UDP
@@ -921,13 +918,21 @@ uip_process(uint8_t flag)
   }
 #endif /* UIP_UDP */
   uip_sappdata = uip_appdata = &uip_buf[UIP_IPTCPH_LEN + UIP_LLH_LEN];
+#if UIP_TCP_WINDOW
+  seq_offset = 0;
+#endif /* UIP_TCP_WINDOW */
    
   /* Check if we were invoked because of a poll request for a
      particular connection. */
   if(flag == UIP_POLL_REQUEST) {
 #if UIP_TCP
+#if UIP_TCP_WINDOW
+    if((uip_connr->tcpstateflags & UIP_TS_MASK) == UIP_ESTABLISHED &&
+       uip_tcp_window_room(uip_connr) > 0) {
+#else /* UIP_TCP_WINDOW */
     if((uip_connr->tcpstateflags & UIP_TS_MASK) == UIP_ESTABLISHED &&
        !uip_outstanding(uip_connr)) {
+#endif /* UIP_TCP_WINDOW */
       uip_flags = UIP_POLL;
       UIP_APPCALL();
       goto appsend;
@@ -981,6 +986,9 @@ uip_process(uint8_t flag)
                uip_connr->tcpstateflags == UIP_SYN_RCVD) &&
               uip_connr->nrtx == UIP_MAXSYNRTX)) {
             uip_connr->tcpstateflags = UIP_CLOSED;
+#if UIP_TCP_WINDOW
+            uip_tcp_window_flush(uip_connr);
+#endif /* UIP_TCP_WINDOW */
                   
             /*
              * We call UIP_APPCALL() with uip_flags set to
@@ -1023,6 +1031,17 @@ uip_process(uint8_t flag)
 #endif /* UIP_ACTIVE_OPEN */
                      
             case UIP_ESTABLISHED:
+#if UIP_TCP_WINDOW
+              /* Retransmit the first segment in flight from its
+                 retransmit buffer, if it has one. */
+              uip_len = uip_tcp_window_rexmit(uip_connr, uip_appdata);
+              if(uip_len > 0) {
+                uip_len += UIP_TCPIP_HLEN;
+                uip_flags = 0;
+                UIP_TCP_BUF->flags = TCP_ACK | TCP_PSH;
+                goto tcp_send_noopts;
+              }
+#endif /* UIP_TCP_WINDOW */
               /*
                * In the ESTABLISHED state, we call upon the application
                * to do the actual retransmit after which we jump into
@@ -1039,6 +1058,14 @@ uip_process(uint8_t flag)
               /* In all these states we should retransmit a FINACK. */
               goto tcp_send_finack;
           }
+#if UIP_TCP_WINDOW
+        } else if((uip_connr->tcpstateflags & UIP_TS_MASK) == UIP_ESTABLISHED &&
+                  uip_tcp_window_room(uip_connr) > 0) {
+          /* There is room for more data in the window. */
+          uip_flags = UIP_POLL;
+          UIP_APPCALL();
+          goto appsend;
+#endif /* UIP_TCP_WINDOW */
         }
       } else if((uip_connr->tcpstateflags & UIP_TS_MASK) == UIP_ESTABLISHED) {
         /*
@@ -1804,6 +1831,9 @@ uip_process(uint8_t flag)
      before we accept the reset. */
   if(UIP_TCP_BUF->flags & TCP_RST) {
     uip_connr->tcpstateflags = UIP_CLOSED;
+#if UIP_TCP_WINDOW
+    uip_tcp_window_flush(uip_connr);
+#endif /* UIP_TCP_WINDOW */
     UIP_LOG("tcp: got reset, aborting connection.");
     uip_flags = UIP_ABORT;
     UIP_APPCALL();
@@ -1843,19 +1873,40 @@ uip_process(uint8_t flag)
      data. If so, we update the sequence number, reset the length of
      the outstanding data, calculate RTT estimations, and reset the
      retransmission timer. */
+#if UIP_TCP_WINDOW
+  if(UIP_TCP_BUF->flags & TCP_ACK) {
+    uip_connr->snd_wnd = ((uint16_t)UIP_TCP_BUF->wnd[0] << 8) + UIP_TCP_BUF->wnd[1];
+  }
+#endif /* UIP_TCP_WINDOW */
   if((UIP_TCP_BUF->flags & TCP_ACK) && uip_outstanding(uip_connr)) {
-    uip_add32(uip_connr->snd_nxt, uip_connr->len);
-
-    if(UIP_TCP_BUF->ackno[0] == uip_acc32[0] &&
-       UIP_TCP_BUF->ackno[1] == uip_acc32[1] &&
-       UIP_TCP_BUF->ackno[2] == uip_acc32[2] &&
-       UIP_TCP_BUF->ackno[3] == uip_acc32[3]) {
-      /* Update sequence number. */
-      uip_connr->snd_nxt[0] = uip_acc32[0];
-      uip_connr->snd_nxt[1] = uip_acc32[1];
-      uip_connr->snd_nxt[2] = uip_acc32[2];
-      uip_connr->snd_nxt[3] = uip_acc32[3];
-   
+#if UIP_TCP_WINDOW
+    /* With data segments in flight, any of them may be acknowledged,
+       and the window code updates the sequence number and the length
+       of the outstanding data. */
+    if(uip_connr->nseg > 0) {
+      tmp16 = uip_tcp_window_acked(uip_connr, UIP_TCP_BUF->ackno);
+    } else
+#endif /* UIP_TCP_WINDOW */
+    {
+      uip_add32(uip_connr->snd_nxt, uip_connr->len);
+      tmp16 = 0;
+      if(UIP_TCP_BUF->ackno[0] == uip_acc32[0] &&
+         UIP_TCP_BUF->ackno[1] == uip_acc32[1] &&
+         UIP_TCP_BUF->ackno[2] == uip_acc32[2] &&
+         UIP_TCP_BUF->ackno[3] == uip_acc32[3]) {
+        /* Update sequence number. */
+        uip_connr->snd_nxt[0] = uip_acc32[0];
+        uip_connr->snd_nxt[1] = uip_acc32[1];
+        uip_connr->snd_nxt[2] = uip_acc32[2];
+        uip_connr->snd_nxt[3] = uip_acc32[3];
+        tmp16 = uip_connr->len;
+
+        /* Reset length of outstanding data. */
+        uip_connr->len = 0;
+      }
+    }
+
+    if(tmp16 > 0) {
       /* Do RTT estimation, unless we have done retransmissions. */
       if(uip_connr->nrtx == 0) {
         signed char m;
@@ -1875,9 +1926,6 @@ uip_process(uint8_t flag)
       uip_flags = UIP_ACKDATA;
       /* Reset the retransmission timer. */
       uip_connr->timer = uip_connr->rto;
-
-      /* Reset length of outstanding data. */
-      uip_connr->len = 0;
     }
     
   }
@@ -2077,12 +2125,20 @@ uip_process(uint8_t flag)
         if(uip_flags & UIP_ABORT) {
           uip_slen = 0;
           uip_connr->tcpstateflags = UIP_CLOSED;
+#if UIP_TCP_WINDOW
+          uip_tcp_window_flush(uip_connr);
+#endif /* UIP_TCP_WINDOW */
           UIP_TCP_BUF->flags = TCP_RST | TCP_ACK;
           goto tcp_send_nodata;
         }
 
         if(uip_flags & UIP_CLOSE) {
           uip_slen = 0;
+#if UIP_TCP_WINDOW
+          /* The application should not close the connection with
+             data in flight; that data is given up. */
+          uip_tcp_window_flush(uip_connr);
+#endif /* UIP_TCP_WINDOW */
           uip_connr->len = 1;
           uip_connr->tcpstateflags = UIP_FIN_WAIT_1;
           uip_connr->nrtx = 0;
@@ -2093,11 +2149,13 @@ uip_process(uint8_t flag)
         /* If uip_slen > 0, the application has data to be sent. */
         if(uip_slen > 0) {
 
+#if !UIP_TCP_WINDOW
           /* If the connection has acknowledged data, the contents of
              the ->len variable should be discarded. */
           if((uip_flags & UIP_ACKDATA) != 0) {
             uip_connr->len = 0;
           }
+#endif /* !UIP_TCP_WINDOW */
 
           /* If the ->len variable is non-zero the connection has
              already data in transit and cannot send anymore right
@@ -2114,6 +2172,22 @@ uip_process(uint8_t flag)
             /* Remember how much data we send out now so that we know
                when everything has been acknowledged. */
             uip_connr->len = uip_slen;
+#if UIP_TCP_WINDOW
+            uip_tcp_window_sent(uip_connr, uip_sappdata, uip_slen);
+          } else if((tmp16 = uip_tcp_window_room(uip_connr)) > 0) {
+            /* There is room in the window for a new segment after the
+               ones in flight. */
+            if(uip_slen > tmp16) {
+              uip_slen = tmp16;
+            }
+            seq_offset = uip_connr->len;
+            uip_connr->len += uip_slen;
+            uip_tcp_window_sent(uip_connr, uip_sappdata, uip_slen);
+          } else if(uip_connr->nseg > 1 || uip_connr->segbuf[0] != NULL) {
+            /* The window is full, and uIP retransmits the segments in
+               flight by itself, so the data is not sent. */
+            uip_slen = 0;
+#endif /* UIP_TCP_WINDOW */
           } else {
 
             /* If the application already had unacknowledged data, we
@@ -2130,7 +2204,11 @@ uip_process(uint8_t flag)
            packet had new data in it, we must send out a packet. */
         if(uip_slen > 0 && uip_connr->len > 0) {
           /* Add the length of the IP and TCP headers. */
+#if UIP_TCP_WINDOW
+          uip_len = uip_connr->len - seq_offset + UIP_TCPIP_HLEN;
+#else /* UIP_TCP_WINDOW */
           uip_len = uip_connr->len + UIP_TCPIP_HLEN;
+#endif /* UIP_TCP_WINDOW */
           /* We always set the ACK flag in response packets. */
           UIP_TCP_BUF->flags = TCP_ACK | TCP_PSH;
           /* Send the packet. */
@@ -2235,10 +2313,23 @@ uip_process(uint8_t flag)
   UIP_TCP_BUF->ackno[2] = uip_connr->rcv_nxt[2];
   UIP_TCP_BUF->ackno[3] = uip_connr->rcv_nxt[3];
   
+#if UIP_TCP_WINDOW
+  if(uip_connr->nseg > 0 && uip_len == UIP_IPTCPH_LEN) {
+    /* A segment without data carries the sequence number that
+       follows the segments in flight. */
+    seq_offset = uip_connr->len;
+  }
+  uip_add32(uip_connr->snd_nxt, seq_offset);
+  UIP_TCP_BUF->seqno[0] = uip_acc32[0];
+  UIP_TCP_BUF->seqno[1] = uip_acc32[1];
+  UIP_TCP_BUF->seqno[2] = uip_acc32[2];
+  UIP_TCP_BUF->seqno[3] = uip_acc32[3];
+#else /* UIP_TCP_WINDOW */
   UIP_TCP_BUF->seqno[0] = uip_connr->snd_nxt[0];
   UIP_TCP_BUF->seqno[1] = uip_connr->snd_nxt[1];
   UIP_TCP_BUF->seqno[2] = uip_connr->snd_nxt[2];
   UIP_TCP_BUF->seqno[3] = uip_connr->snd_nxt[3];
+#endif /* UIP_TCP_WINDOW */
 
   UIP_IP_BUF->proto = UIP_PROTO_TCP;
 
@@ -2271,7 +2362,22 @@ uip_process(uint8_t flag)
   
   /* Calculate TCP checksum. */
   UIP_TCP_BUF->tcpchksum = 0;
-  UIP_TCP_BUF->tcpchksum = ~(uip_tcpchksum());
+#if UIP_TCP_REXMIT_CHKSUM && !UIP_ARCH_CHKSUM
+  if(uip_len > UIP_IPTCPH_LEN &&
+     UIP_TCP_BUF->tcpoffset == (UIP_TCPH_LEN / 4) << 4) {
+    /* A data segment is sent from an established connection. The
+       application retransmits the same data, so the sum of the data
+       computed when it was first sent can be reused. */
+    if(!(uip_flags & UIP_REXMIT)) {
+      uip_connr->datasum = uip_chksum_add(0, &uip_buf[UIP_IPTCPH_LEN + UIP_LLH_LEN],
+                                          uip_len - UIP_IPTCPH_LEN);
+    }
+    UIP_TCP_BUF->tcpchksum = ~(tcp_data_chksum(uip_connr->datasum));
+  } else
+#endif /* UIP_TCP_REXMIT_CHKSUM && !UIP_ARCH_CHKSUM */
+  {
+    UIP_TCP_BUF->tcpchksum = ~(uip_tcpchksum());
+  }
   UIP_STAT(++uip_stat.tcp.sent);
 
 #endif /* UIP_TCP */
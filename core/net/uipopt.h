@@ -371,6 +371,23 @@
  */
 #define UIP_MAXSYNRTX      5
 
+/**
+ * Determines if the checksum of the data in a TCP segment should be
+ * kept, so that only the headers need to be summed when the segment
+ * is retransmitted.
+ *
+ * This relies on the application retransmitting exactly the same
+ * data, as required by uip_rexmit(). It costs two bytes of memory
+ * per TCP connection.
+ *
+ * \hideinitializer
+ */
+#ifdef UIP_CONF_TCP_REXMIT_CHKSUM
+#define UIP_TCP_REXMIT_CHKSUM (UIP_CONF_TCP_REXMIT_CHKSUM)
+#else /* UIP_CONF_TCP_REXMIT_CHKSUM */
+#define UIP_TCP_REXMIT_CHKSUM 0
+#endif /* UIP_CONF_TCP_REXMIT_CHKSUM */
+
 /**
  * The TCP maximum segment size.
  *
@@ -398,6 +415,40 @@
 #define UIP_RECEIVE_WINDOW (UIP_CONF_RECEIVE_WINDOW)
 #endif
 
+/**
+ * The number of TCP segments a connection may have in flight.
+ *
+ * With the default of one, uIP sends a segment and waits for it to
+ * be acknowledged before it accepts new data from the application. A
+ * larger value lets the application send new data while earlier
+ * segments are outstanding, as long as the receiver's window allows
+ * it. Segments sent this way are kept in retransmit buffers so that
+ * uIP can retransmit them without calling the application.
+ *
+ * \hideinitializer
+ */
+#ifdef UIP_CONF_TCP_WINDOW_SEGMENTS
+#define UIP_TCP_WINDOW_SEGMENTS (UIP_CONF_TCP_WINDOW_SEGMENTS)
+#else /* UIP_CONF_TCP_WINDOW_SEGMENTS */
+#define UIP_TCP_WINDOW_SEGMENTS 1
+#endif /* UIP_CONF_TCP_WINDOW_SEGMENTS */
+
+#define UIP_TCP_WINDOW (UIP_TCP_WINDOW_SEGMENTS > 1)
+
+/**
+ * The number of TCP retransmit buffers, shared by all connections.
+ *
+ * Each buffer holds UIP_TCP_MSS bytes. A connection that finds no
+ * free buffer falls back to sending one segment at a time.
+ *
+ * \hideinitializer
+ */
+#ifdef UIP_CONF_TCP_WINDOW_BUFS
+#define UIP_TCP_WINDOW_BUFS (UIP_CONF_TCP_WINDOW_BUFS)
+#else /* UIP_CONF_TCP_WINDOW_BUFS */
+#define UIP_TCP_WINDOW_BUFS (UIP_TCP_WINDOW_SEGMENTS)
+#endif /* UIP_CONF_TCP_WINDOW_BUFS */
+
 /**
  * How long a connection should stay in the TIME_WAIT state.
  *
@@ -468,6 +519,16 @@
 #define SICSLOWPAN_REASS_MAXAGE 20
 #endif
 
+/**
+ * Number of datagrams that can be reassembled at the same time at the
+ * 6lowpan layer. Each one needs a buffer of UIP_BUFSIZE bytes.
+ */
+#ifdef SICSLOWPAN_CONF_REASS_CONTEXTS
+#define SICSLOWPAN_REASS_CONTEXTS (SICSLOWPAN_CONF_REASS_CONTEXTS)
+#else
+#define SICSLOWPAN_REASS_CONTEXTS 1
+#endif
+
 /**
  * Do we compress the IP header or not (default: no)
  */
@@ -612,6 +673,21 @@ void uip_log(char *msg);
 #define UIP_BYTE_ORDER     (UIP_LITTLE_ENDIAN)
 #endif /* UIP_CONF_BYTE_ORDER */
 
+/**
+ * Compute the Internet checksum 32 bits at a time into a 64-bit
+ * accumulator instead of 16 bits at a time.
+ *
+ * This is faster on 32 and 64-bit CPUs, but not on 8 and 16-bit
+ * CPUs that lack 64-bit arithmetic.
+ *
+ * \hideinitializer
+ */
+#ifdef UIP_CONF_CHKSUM_WIDE
+#define UIP_CHKSUM_WIDE    (UIP_CONF_CHKSUM_WIDE)
+#else /* UIP_CONF_CHKSUM_WIDE */
+#define UIP_CHKSUM_WIDE    0
+#endif /* UIP_CONF_CHKSUM_WIDE */
+
 /** @} */
 /*------------------------------------------------------------------------------*/
 
@@ -54,6 +54,275 @@ static clock_time_t next_expiration;
 
 PROCESS(etimer_process, "Event timer");
 /*---------------------------------------------------------------------------*/
+#if ETIMER_HEAP
+/*
+ * The pending timers are kept in a pairing heap rooted at
+ * timerlist. Each timer points to its first child, its next sibling,
+ * and to either its previous sibling or, for the first child, its
+ * parent. The root has no siblings and no parent.
+ *
+ * An event timer that was never set may hold anything, for instance
+ * when it lives on the stack or in a memb block, so its links cannot
+ * tell whether it is in the heap. Timers in the heap are marked
+ * instead, and the mark is checked against the link that leads to the
+ * timer before the timer is unlinked.
+ */
+#define IN_HEAP 0x4845
+/*---------------------------------------------------------------------------*/
+static int
+expires_before(struct etimer *a, struct etimer *b)
+{
+  clock_time_t diff;
+
+  /* Compare the expiration times through their difference, so that
+     the order stays correct when the clock wraps. */
+  diff = (a->timer.start + a->timer.interval) -
+    (b->timer.start + b->timer.interval);
+  return diff > ((clock_time_t)~0 >> 1);
+}
+/*---------------------------------------------------------------------------*/
+static struct etimer *
+meld(struct etimer *a, struct etimer *b)
+{
+  struct etimer *t;
+
+  if(a == NULL) {
+    return b;
+  }
+  if(b == NULL) {
+    return a;
+  }
+
+  if(expires_before(b, a)) {
+    t = a;
+    a = b;
+    b = t;
+  }
+
+  /* Make b the first child of a. */
+  b->prev = a;
+  b->next = a->child;
+  if(a->child != NULL) {
+    a->child->prev = b;
+  }
+  a->child = b;
+
+  return a;
+}
+/*---------------------------------------------------------------------------*/
+static struct etimer *
+merge_pairs(struct etimer *first)
+{
+  struct etimer *a, *b, *pairs, *heap;
+
+  /* First pass: meld the siblings pairwise from left to right, and
+     stack the resulting heaps through their next pointers. */
+  pairs = NULL;
+  while(first != NULL) {
+    a = first;
+    b = a->next;
+    first = b != NULL ? b->next : NULL;
+    a->next = a->prev = NULL;
+    if(b != NULL) {
+      b->next = b->prev = NULL;
+    }
+    a = meld(a, b);
+    a->next = pairs;
+    pairs = a;
+  }
+
+  /* Second pass: meld the stacked heaps from right to left. */
+  heap = NULL;
+  while(pairs != NULL) {
+    a = pairs;
+    pairs = a->next;
+    a->next = NULL;
+    heap = meld(heap, a);
+  }
+
+  return heap;
+}
+/*---------------------------------------------------------------------------*/
+static void
+store_add(struct etimer *t)
+{
+  t->next = t->prev = t->child = NULL;
+  t->in_heap = IN_HEAP;
+  timerlist = meld(timerlist, t);
+}
+/*---------------------------------------------------------------------------*/
+static void
+store_remove(struct etimer *t)
+{
+  if(t == timerlist) {
+    timerlist = merge_pairs(t->child);
+  } else {
+    /* Unlink the subtree from its parent or previous sibling, and
+       meld what remains of it back into the heap. */
+    if(t->prev->child == t) {
+      t->prev->child = t->next;
+    } else {
+      t->prev->next = t->next;
+    }
+    if(t->next != NULL) {
+      t->next->prev = t->prev;
+    }
+    timerlist = meld(timerlist, merge_pairs(t->child));
+  }
+  t->next = t->prev = t->child = NULL;
+  t->in_heap = 0;
+}
+/*---------------------------------------------------------------------------*/
+static int
+store_contains(struct etimer *t)
+{
+  if(t->in_heap != IN_HEAP) {
+    return 0;
+  }
+  /* Only the root of the heap lacks a previous timer. */
+  if(t == timerlist) {
+    return 1;
+  }
+  return t->prev != NULL && (t->prev->child == t || t->prev->next == t);
+}
+/*---------------------------------------------------------------------------*/
+static struct etimer *
+store_walk(struct etimer *t)
+{
+  /* Pre-order traversal: go to the first child if there is one, or
+     else to the next sibling of the closest ancestor that has one. */
+  if(t->child != NULL) {
+    return t->child;
+  }
+  while(t != NULL && t->next == NULL) {
+    while(t->prev != NULL && t->prev->child != t) {
+      t = t->prev;
+    }
+    t = t->prev;
+  }
+  return t != NULL ? t->next : NULL;
+}
+/*---------------------------------------------------------------------------*/
+static void
+store_remove_process(struct process *p)
+{
+  struct etimer *t;
+
+  /* Removing a timer reshapes the heap, so the walk is restarted
+     after each removal. Processes seldom exit, so this is cheap
+     enough. */
+  t = timerlist;
+  while(t != NULL) {
+    if(t->p == p) {
+      store_remove(t);
+      t = timerlist;
+    } else {
+      t = store_walk(t);
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+update_time(void)
+{
+  if(timerlist == NULL) {
+    next_expiration = 0;
+  } else {
+    next_expiration = timerlist->timer.start + timerlist->timer.interval;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+expire_timers(void)
+{
+  struct etimer *t;
+
+  /* The root of the heap is always the first timer to expire. */
+  while(timerlist != NULL && timer_expired(&timerlist->timer)) {
+    t = timerlist;
+    if(process_post(t->p, PROCESS_EVENT_TIMER, t) == PROCESS_ERR_OK) {
+      /* Reset the process ID of the event timer, to signal that the
+	 etimer has expired. This is later checked in the
+	 etimer_expired() function. */
+      store_remove(t);
+      t->p = PROCESS_NONE;
+    } else {
+      etimer_request_poll();
+      break;
+    }
+  }
+  update_time();
+}
+/*---------------------------------------------------------------------------*/
+#else /* ETIMER_HEAP */
+/*---------------------------------------------------------------------------*/
+static void
+store_add(struct etimer *t)
+{
+  t->next = timerlist;
+  timerlist = t;
+}
+/*---------------------------------------------------------------------------*/
+static void
+store_remove(struct etimer *et)
+{
+  struct etimer *t;
+
+  /* First check if et is the first event timer on the list. */
+  if(et == timerlist) {
+    timerlist = timerlist->next;
+  } else {
+    /* Else walk through the list and try to find the item before the
+       et timer. */
+    for(t = timerlist; t != NULL && t->next != et; t = t->next);
+
+    if(t != NULL) {
+      /* We've found the item before the event timer that we are about
+	 to remove. We point the items next pointer to the event after
+	 the removed item. */
+      t->next = et->next;
+    }
+  }
+
+  /* Remove the next pointer from the item to be removed. */
+  et->next = NULL;
+}
+/*---------------------------------------------------------------------------*/
+static int
+store_contains(struct etimer *timer)
+{
+  struct etimer *t;
+
+  if(timer->p != PROCESS_NONE) {
+    for(t = timerlist; t != NULL; t = t->next) {
+      if(t == timer) {
+	return 1;
+      }
+    }
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static void
+store_remove_process(struct process *p)
+{
+  struct etimer *t;
+
+  while(timerlist != NULL && timerlist->p == p) {
+    timerlist = timerlist->next;
+  }
+
+  if(timerlist != NULL) {
+    t = timerlist;
+    while(t->next != NULL) {
+      if(t->next->p == p) {
+	t->next = t->next->next;
+      } else
+	t = t->next;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
 static void
 update_time(void)
 {
@@ -77,10 +346,43 @@ update_time(void)
   }
 }
 /*---------------------------------------------------------------------------*/
+static void
+expire_timers(void)
+{
+  struct etimer *t, *u, *next;
+
+  /* Posting an event does not touch the timer list, so all expired
+     timers can be removed in a single pass. */
+  u = NULL;
+  for(t = timerlist; t != NULL; t = next) {
+    next = t->next;
+    if(timer_expired(&t->timer)) {
+      if(process_post(t->p, PROCESS_EVENT_TIMER, t) == PROCESS_ERR_OK) {
+
+	/* Reset the process ID of the event timer, to signal that the
+	   etimer has expired. This is later checked in the
+	   etimer_expired() function. */
+	t->p = PROCESS_NONE;
+	if(u != NULL) {
+	  u->next = next;
+	} else {
+	  timerlist = next;
+	}
+	t->next = NULL;
+	continue;
+      } else {
+	etimer_request_poll();
+      }
+    }
+    u = t;
+  }
+  update_time();
+}
+/*---------------------------------------------------------------------------*/
+#endif /* ETIMER_HEAP */
+/*---------------------------------------------------------------------------*/
 PROCESS_THREAD(etimer_process, ev, data)
 {
-  struct etimer *t, *u;
-	
   PROCESS_BEGIN();
 
   timerlist = NULL;
@@ -89,53 +391,11 @@ PROCESS_THREAD(etimer_process, ev, data)
     PROCESS_YIELD();
 
     if(ev == PROCESS_EVENT_EXITED) {
-      struct process *p = data;
-
-      while(timerlist != NULL && timerlist->p == p) {
-	timerlist = timerlist->next;
-      }
-
-      if(timerlist != NULL) {
-	t = timerlist;
-	while(t->next != NULL) {
-	  if(t->next->p == p) {
-	    t->next = t->next->next;
-	  } else
-	    t = t->next;
-	}
-      }
-      continue;
-    } else if(ev != PROCESS_EVENT_POLL) {
-      continue;
-    }
-
-  again:
-    
-    u = NULL;
-    
-    for(t = timerlist; t != NULL; t = t->next) {
-      if(timer_expired(&t->timer)) {
-	if(process_post(t->p, PROCESS_EVENT_TIMER, t) == PROCESS_ERR_OK) {
-	  
-	  /* Reset the process ID of the event timer, to signal that the
-	     etimer has expired. This is later checked in the
-	     etimer_expired() function. */
-	  t->p = PROCESS_NONE;
-	  if(u != NULL) {
-	    u->next = t->next;
-	  } else {
-	    timerlist = t->next;
-	  }
-	  t->next = NULL;
-	  update_time();
-	  goto again;
-	} else {
-	  etimer_request_poll();
-	}
-      }
-      u = t;
+      store_remove_process(data);
+      update_time();
+    } else if(ev == PROCESS_EVENT_POLL) {
+      expire_timers();
     }
-    
   }
   
   PROCESS_END();
@@ -150,25 +410,16 @@ etimer_request_poll(void)
 static void
 add_timer(struct etimer *timer)
 {
-  struct etimer *t;
-
   etimer_request_poll();
 
-  if(timer->p != PROCESS_NONE) {
-    for(t = timerlist; t != NULL; t = t->next) {
-      if(t == timer) {
-	/* Timer already on list, bail out. */
-        timer->p = PROCESS_CURRENT();
-	update_time();
-	return;
-      }
-    }
+  if(store_contains(timer)) {
+    /* Timer already pending. Its expiration time may have changed, so
+       it is put back into the store. */
+    store_remove(timer);
   }
 
-  /* Timer not on list. */
   timer->p = PROCESS_CURRENT();
-  timer->next = timerlist;
-  timerlist = timer;
+  store_add(timer);
 
   update_time();
 }
@@ -197,7 +448,13 @@ etimer_restart(struct etimer *et)
 void
 etimer_adjust(struct etimer *et, int timediff)
 {
-  et->timer.start += timediff;
+  if(store_contains(et)) {
+    store_remove(et);
+    et->timer.start += timediff;
+    store_add(et);
+  } else {
+    et->timer.start += timediff;
+  }
   update_time();
 }
 /*---------------------------------------------------------------------------*/
@@ -234,29 +491,11 @@ etimer_next_expiration_time(void)
 void
 etimer_stop(struct etimer *et)
 {
-  struct etimer *t;
-
-  /* First check if et is the first event timer on the list. */
-  if(et == timerlist) {
-    timerlist = timerlist->next;
+  if(store_contains(et)) {
+    store_remove(et);
     update_time();
-  } else {
-    /* Else walk through the list and try to find the item before the
-       et timer. */
-    for(t = timerlist; t != NULL && t->next != et; t = t->next);
-
-    if(t != NULL) {
-      /* We've found the item before the event timer that we are about
-	 to remove. We point the items next pointer to the event after
-	 the removed item. */
-      t->next = et->next;
-
-      update_time();
-    }
   }
 
-  /* Remove the next pointer from the item to be removed. */
-  et->next = NULL;
   /* Set the timer as expired */
   et->p = PROCESS_NONE;
 }
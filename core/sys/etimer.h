@@ -65,6 +65,24 @@
 #include "sys/timer.h"
 #include "sys/process.h"
 
+/**
+ * \brief Keep pending event timers in a heap ordered on expiration time.
+ *
+ * By default, the pending event timers are kept on an unsorted list,
+ * which costs a full scan every time a timer is added or expires. When
+ * ETIMER_CONF_HEAP is set to 1, the timers are instead kept in a
+ * pairing heap keyed on their expiration time, making the next timer
+ * to expire available in constant time and insertion and removal
+ * logarithmic (amortized). This is useful on systems with many
+ * timers, such as gateways running on the native platform, at the
+ * price of two extra pointers and a marker per event timer.
+ */
+#ifdef ETIMER_CONF_HEAP
+#define ETIMER_HEAP ETIMER_CONF_HEAP
+#else /* ETIMER_CONF_HEAP */
+#define ETIMER_HEAP 0
+#endif /* ETIMER_CONF_HEAP */
+
 /**
  * A timer.
  *
@@ -77,6 +95,11 @@ struct etimer {
   struct timer timer;
   struct etimer *next;
   struct process *p;
+#if ETIMER_HEAP
+  struct etimer *child;
+  struct etimer *prev;
+  uint16_t in_heap;
+#endif /* ETIMER_HEAP */
 };
 
 /**
@@ -44,9 +44,13 @@
  */
 
 #include <stdio.h>
+#include <string.h>
 
 #include "sys/process.h"
 #include "sys/arg.h"
+#if PROCESS_PRIORITIES && PROCESS_CONF_STATS
+#include "sys/clock.h"
+#endif /* PROCESS_PRIORITIES && PROCESS_CONF_STATS */
 
 /*
  * Pointer to the currently running process structure.
@@ -63,13 +67,47 @@ struct event_data {
   process_event_t ev;
   process_data_t data;
   struct process *p;
+#if PROCESS_PRIORITIES && PROCESS_CONF_STATS
+  clock_time_t posted;
+#endif /* PROCESS_PRIORITIES && PROCESS_CONF_STATS */
 };
 
 static process_num_events_t nevents, fevent;
 static struct event_data events[PROCESS_CONF_NUMEVENTS];
 
+#if PROCESS_PRIORITIES
+/*
+ * Events to high-priority processes are kept on a queue of their
+ * own, and the processes that have requested a poll are kept on one
+ * list per priority class, linked through their nextpoll pointer.
+ */
+static process_num_events_t nhpevents, fhpevent;
+static struct event_data hpevents[PROCESS_CONF_NUMEVENTS_HIGH];
+
+static struct process *poll_list[PROCESS_PRIORITY_LEVELS];
+
+/*
+ * process_poll() may be called from interrupt handlers. Platforms
+ * that do so must make the poll list updates atomic by defining
+ * these to disable and enable interrupts.
+ */
+#ifdef PROCESS_CONF_POLL_LOCK
+#define POLL_LOCK()   PROCESS_CONF_POLL_LOCK()
+#define POLL_UNLOCK() PROCESS_CONF_POLL_UNLOCK()
+#else /* PROCESS_CONF_POLL_LOCK */
+#define POLL_LOCK()
+#define POLL_UNLOCK()
+#endif /* PROCESS_CONF_POLL_LOCK */
+#endif /* PROCESS_PRIORITIES */
+
 #if PROCESS_CONF_STATS
 process_num_events_t process_maxevents;
+#if PROCESS_PRIORITIES
+process_num_events_t process_maxevents_high;
+clock_time_t process_maxwait[PROCESS_PRIORITY_LEVELS];
+unsigned long process_totalwait[PROCESS_PRIORITY_LEVELS];
+unsigned long process_nwaits[PROCESS_PRIORITY_LEVELS];
+#endif /* PROCESS_PRIORITIES */
 #endif
 
 static volatile unsigned char poll_requested;
@@ -214,6 +252,17 @@ process_init(void)
   process_maxevents = 0;
 #endif /* PROCESS_CONF_STATS */
 
+#if PROCESS_PRIORITIES
+  nhpevents = fhpevent = 0;
+  poll_list[PROCESS_PRIORITY_NORMAL] = poll_list[PROCESS_PRIORITY_HIGH] = NULL;
+#if PROCESS_CONF_STATS
+  process_maxevents_high = 0;
+  memset(process_maxwait, 0, sizeof(process_maxwait));
+  memset(process_totalwait, 0, sizeof(process_totalwait));
+  memset(process_nwaits, 0, sizeof(process_nwaits));
+#endif /* PROCESS_CONF_STATS */
+#endif /* PROCESS_PRIORITIES */
+
   process_current = process_list = NULL;
 }
 /*---------------------------------------------------------------------------*/
@@ -221,6 +270,42 @@ process_init(void)
  * Call each process' poll handler.
  */
 /*---------------------------------------------------------------------------*/
+#if PROCESS_PRIORITIES
+static void
+do_poll(void)
+{
+  struct process *polled[PROCESS_PRIORITY_LEVELS];
+  struct process *p;
+  int i;
+
+  /* Take the current poll lists, so that processes that request
+     another poll from their poll handler are polled in the next
+     round, as with the process list scan below. */
+  POLL_LOCK();
+  poll_requested = 0;
+  for(i = 0; i < PROCESS_PRIORITY_LEVELS; i++) {
+    polled[i] = poll_list[i];
+    poll_list[i] = NULL;
+  }
+  POLL_UNLOCK();
+
+  /* Call the processes that needs to be polled, high priority
+     processes first. */
+  for(i = PROCESS_PRIORITY_LEVELS - 1; i >= 0; i--) {
+    while(polled[i] != NULL) {
+      p = polled[i];
+      polled[i] = p->nextpoll;
+      p->nextpoll = NULL;
+      p->needspoll = 0;
+      /* The process may have exited after it was polled. */
+      if(p->state != PROCESS_STATE_NONE) {
+	p->state = PROCESS_STATE_RUNNING;
+	call_process(p, PROCESS_EVENT_POLL, NULL);
+      }
+    }
+  }
+}
+#else /* PROCESS_PRIORITIES */
 static void
 do_poll(void)
 {
@@ -236,6 +321,54 @@ do_poll(void)
     }
   }
 }
+#endif /* PROCESS_PRIORITIES */
+/*---------------------------------------------------------------------------*/
+#if PROCESS_PRIORITIES
+#if PROCESS_CONF_STATS
+static void
+update_wait(unsigned char priority, struct event_data *e)
+{
+  clock_time_t wait;
+
+  wait = clock_time() - e->posted;
+  if(wait > process_maxwait[priority]) {
+    process_maxwait[priority] = wait;
+  }
+  process_totalwait[priority] += wait;
+  process_nwaits[priority]++;
+}
+#endif /* PROCESS_CONF_STATS */
+/*---------------------------------------------------------------------------*/
+/*
+ * Deliver all events in the high-priority queue. This is called
+ * between the deliveries of a broadcast event, so it must not use
+ * the static variables of do_event().
+ */
+static void
+do_high_events(void)
+{
+  process_event_t ev;
+  process_data_t data;
+  struct process *receiver;
+
+  while(nhpevents > 0) {
+    ev = hpevents[fhpevent].ev;
+    data = hpevents[fhpevent].data;
+    receiver = hpevents[fhpevent].p;
+#if PROCESS_CONF_STATS
+    update_wait(PROCESS_PRIORITY_HIGH, &hpevents[fhpevent]);
+#endif /* PROCESS_CONF_STATS */
+
+    fhpevent = (fhpevent + 1) % PROCESS_CONF_NUMEVENTS_HIGH;
+    --nhpevents;
+
+    if(ev == PROCESS_EVENT_INIT) {
+      receiver->state = PROCESS_STATE_RUNNING;
+    }
+    call_process(receiver, ev, data);
+  }
+}
+#endif /* PROCESS_PRIORITIES */
 /*---------------------------------------------------------------------------*/
 /*
  * Process the next event in the event queue and deliver it to
@@ -265,6 +398,9 @@ do_event(void)
     
     data = events[fevent].data;
     receiver = events[fevent].p;
+#if PROCESS_PRIORITIES && PROCESS_CONF_STATS
+    update_wait(PROCESS_PRIORITY_NORMAL, &events[fevent]);
+#endif /* PROCESS_PRIORITIES && PROCESS_CONF_STATS */
 
     /* Since we have seen the new event, we move pointer upwards
        and decrese the number of events. */
@@ -281,6 +417,13 @@ do_event(void)
 	if(poll_requested) {
 	  do_poll();
 	}
+#if PROCESS_PRIORITIES
+	/* Do not let high-priority events wait for the whole
+	   broadcast to be delivered. */
+	if(nhpevents > 0) {
+	  do_high_events();
+	}
+#endif /* PROCESS_PRIORITIES */
 	call_process(p, ev, data);
       }
     } else {
@@ -306,16 +449,26 @@ process_run(void)
     do_poll();
   }
 
+#if PROCESS_PRIORITIES
+  /* Process the high-priority events before the next ordinary
+     event. */
+  do_high_events();
+#endif /* PROCESS_PRIORITIES */
+
   /* Process one event from the queue */
   do_event();
 
-  return nevents + poll_requested;
+  return process_nevents();
 }
 /*---------------------------------------------------------------------------*/
 int
 process_nevents(void)
 {
+#if PROCESS_PRIORITIES
+  return nevents + nhpevents + poll_requested;
+#else /* PROCESS_PRIORITIES */
   return nevents + poll_requested;
+#endif /* PROCESS_PRIORITIES */
 }
 /*---------------------------------------------------------------------------*/
 int
@@ -332,6 +485,36 @@ process_post(struct process *p, process_event_t ev, process_data_t data)
 	   p == PROCESS_BROADCAST? "<broadcast>": PROCESS_NAME_STRING(p), nevents);
   }
   
+#if PROCESS_PRIORITIES
+  /* Events to high-priority processes go to the high-priority queue
+     only, so that they are delivered in the order they were posted. */
+  if(p != PROCESS_BROADCAST && p->priority == PROCESS_PRIORITY_HIGH) {
+    if(nhpevents == PROCESS_CONF_NUMEVENTS_HIGH) {
+#if DEBUG
+      printf("soft panic: high-priority event queue is full when event %d was posted to %s\n", ev, PROCESS_NAME_STRING(p));
+#endif /* DEBUG */
+      return PROCESS_ERR_FULL;
+    }
+    snum = (process_num_events_t)(fhpevent + nhpevents) %
+      PROCESS_CONF_NUMEVENTS_HIGH;
+    hpevents[snum].ev = ev;
+    hpevents[snum].data = data;
+    hpevents[snum].p = p;
+#if PROCESS_CONF_STATS
+    hpevents[snum].posted = clock_time();
+#endif /* PROCESS_CONF_STATS */
+    ++nhpevents;
+
+#if PROCESS_CONF_STATS
+    if(nhpevents > process_maxevents_high) {
+      process_maxevents_high = nhpevents;
+    }
+#endif /* PROCESS_CONF_STATS */
+
+    return PROCESS_ERR_OK;
+  }
+#endif /* PROCESS_PRIORITIES */
+
   if(nevents == PROCESS_CONF_NUMEVENTS) {
 #if DEBUG
     if(p == PROCESS_BROADCAST) {
@@ -347,6 +530,9 @@ process_post(struct process *p, process_event_t ev, process_data_t data)
   events[snum].ev = ev;
   events[snum].data = data;
   events[snum].p = p;
+#if PROCESS_PRIORITIES && PROCESS_CONF_STATS
+  events[snum].posted = clock_time();
+#endif /* PROCESS_PRIORITIES && PROCESS_CONF_STATS */
   ++nevents;
 
 #if PROCESS_CONF_STATS
@@ -373,12 +559,31 @@ process_poll(struct process *p)
   if(p != NULL) {
     if(p->state == PROCESS_STATE_RUNNING ||
        p->state == PROCESS_STATE_CALLED) {
+#if PROCESS_PRIORITIES
+      POLL_LOCK();
+      if(!p->needspoll) {
+	p->needspoll = 1;
+	p->nextpoll = poll_list[p->priority];
+	poll_list[p->priority] = p;
+      }
+      poll_requested = 1;
+      POLL_UNLOCK();
+#else /* PROCESS_PRIORITIES */
       p->needspoll = 1;
       poll_requested = 1;
+#endif /* PROCESS_PRIORITIES */
     }
   }
 }
 /*---------------------------------------------------------------------------*/
+#if PROCESS_PRIORITIES
+void
+process_set_priority(struct process *p, unsigned char priority)
+{
+  p->priority = priority;
+}
+#endif /* PROCESS_PRIORITIES */
+/*---------------------------------------------------------------------------*/
 int
 process_is_running(struct process *p)
 {
@@ -88,6 +88,37 @@ typedef unsigned char process_num_events_t;
 #define PROCESS_CONF_NUMEVENTS 32
 #endif /* PROCESS_CONF_NUMEVENTS */
 
+/**
+ * \name Process priorities
+ *
+ * When PROCESS_CONF_PRIORITIES is set to 1, every process belongs to
+ * one of two priority classes. Events posted to a high-priority
+ * process are put on a separate queue, which is served before the
+ * ordinary event queue and in between the deliveries of a broadcast
+ * event. Poll requests are kept on one list per class, so that
+ * polling costs time proportional to the number of polled processes
+ * rather than to the number of running processes, and high-priority
+ * processes are polled first.
+ *
+ * Processes start with normal priority; process_set_priority()
+ * changes the class of a process.
+ * @{
+ */
+#ifdef PROCESS_CONF_PRIORITIES
+#define PROCESS_PRIORITIES PROCESS_CONF_PRIORITIES
+#else /* PROCESS_CONF_PRIORITIES */
+#define PROCESS_PRIORITIES 0
+#endif /* PROCESS_CONF_PRIORITIES */
+
+#ifndef PROCESS_CONF_NUMEVENTS_HIGH
+#define PROCESS_CONF_NUMEVENTS_HIGH 8
+#endif /* PROCESS_CONF_NUMEVENTS_HIGH */
+
+#define PROCESS_PRIORITY_NORMAL 0
+#define PROCESS_PRIORITY_HIGH   1
+#define PROCESS_PRIORITY_LEVELS 2
+/** @} */
+
 #define PROCESS_EVENT_NONE            0x80
 #define PROCESS_EVENT_INIT            0x81
 #define PROCESS_EVENT_POLL            0x82
@@ -323,6 +354,10 @@ struct process {
   PT_THREAD((* thread)(struct pt *, process_event_t, process_data_t));
   struct pt pt;
   unsigned char state, needspoll;
+#if PROCESS_PRIORITIES
+  unsigned char priority;
+  struct process *nextpoll;
+#endif /* PROCESS_PRIORITIES */
 };
 
 /**
@@ -360,7 +395,8 @@ CCIF void process_start(struct process *p, const char *arg);
  * \retval PROCESS_ERR_OK The event could be posted.
  *
  * \retval PROCESS_ERR_FULL The event queue was full and the event could
- * not be posted.
+ * not be posted. Events to a high-priority process only use the
+ * high-priority queue.
  */
 CCIF int process_post(struct process *p, process_event_t ev, void* data);
 
@@ -452,6 +488,20 @@ process_current = p
  */
 CCIF process_event_t process_alloc_event(void);
 
+#if PROCESS_PRIORITIES
+/**
+ * \brief      Set the priority class of a process.
+ * \param p    A pointer to the process' process structure.
+ * \param priority PROCESS_PRIORITY_HIGH or PROCESS_PRIORITY_NORMAL.
+ *
+ *             Events posted to a high-priority process after this
+ *             call are delivered ahead of the ordinary event
+ *             queue. Typically called by a process for itself, right
+ *             after PROCESS_BEGIN(), or by the code that starts it.
+ */
+void process_set_priority(struct process *p, unsigned char priority);
+#endif /* PROCESS_PRIORITIES */
+
 /** @} */
 
 /**
@@ -521,6 +571,25 @@ int process_nevents(void);
 
 /** @} */
 
+#if PROCESS_CONF_STATS
+/** The largest number of events that have been waiting in the queue. */
+extern process_num_events_t process_maxevents;
+#if PROCESS_PRIORITIES
+#include "sys/clock.h"
+/** The largest number of events that have been waiting in the
+    high-priority queue. */
+extern process_num_events_t process_maxevents_high;
+/** The longest time, in clock ticks, that an event of each priority
+    class has waited in its queue. */
+extern clock_time_t process_maxwait[PROCESS_PRIORITY_LEVELS];
+/** The accumulated time, in clock ticks, that the events of each
+    priority class have waited in their queue. */
+extern unsigned long process_totalwait[PROCESS_PRIORITY_LEVELS];
+/** The number of delivered events of each priority class. */
+extern unsigned long process_nwaits[PROCESS_PRIORITY_LEVELS];
+#endif /* PROCESS_PRIORITIES */
+#endif /* PROCESS_CONF_STATS */
+
 CCIF extern struct process *process_list;
 
 #define PROCESS_LIST() process_list
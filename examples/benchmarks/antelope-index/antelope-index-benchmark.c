@@ -0,0 +1,222 @@
+/*
+ * Copyright (c) 2013, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Measures inserts, point lookups, and range lookups through
+ *         an index over the time attribute of a relation of 20000
+ *         rows. Build with "INDEX=maxheap" to compare the B+-tree
+ *         index with the MaxHeap index. A B+-tree index is then
+ *         released and loaded again from its file, and the point
+ *         lookups are repeated to check that nothing was lost.
+ */
+
+#include "contiki.h"
+#include "antelope.h"
+#include "index.h"
+#include "relation.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/time.h>
+
+#define CARDINALITY 20000
+#define POINT_LOOKUPS 1000
+#define RANGE_LOOKUPS 100
+#define RANGE_WIDTH 100
+
+#ifndef INDEX_TYPE
+#define INDEX_TYPE "BPLUSTREE"
+#endif
+/*---------------------------------------------------------------------------*/
+PROCESS(antelope_index_benchmark_process, "Antelope index benchmark");
+AUTOSTART_PROCESSES(&antelope_index_benchmark_process);
+/*---------------------------------------------------------------------------*/
+static unsigned long
+usec_now(void)
+{
+  struct timeval tv;
+
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec * 1000000UL + tv.tv_usec;
+}
+/*---------------------------------------------------------------------------*/
+static unsigned long
+per_second(unsigned long operations, unsigned long usec)
+{
+  return usec == 0 ? 0 : (unsigned long)((double)operations * 1000000 / usec);
+}
+/*---------------------------------------------------------------------------*/
+/* Run a query to completion and return the number of matching rows,
+   or -1 on failure. */
+static long
+run_query(const char *query, long min, long max)
+{
+  static db_handle_t handle;
+  db_result_t result;
+  long matching;
+
+  if(DB_ERROR(db_query(&handle, query, min, max))) {
+    db_free(&handle);
+    return -1;
+  }
+
+  matching = 0;
+  while(db_processing(&handle)) {
+    result = db_process(&handle);
+    if(result == DB_GOT_ROW) {
+      matching++;
+    } else if(result == DB_FINISHED || DB_ERROR(result)) {
+      db_free(&handle);
+      if(DB_ERROR(result)) {
+        return -1;
+      }
+      break;
+    }
+  }
+
+  return matching;
+}
+/*---------------------------------------------------------------------------*/
+/* Write the index back to its file and load it from there again. */
+static int
+reload_index(void)
+{
+  relation_t *rel;
+  attribute_t *attr;
+  int result;
+
+  rel = relation_load("samples");
+  if(rel == NULL) {
+    return 0;
+  }
+  attr = relation_attribute_get(rel, "time");
+  result = attr != NULL && attr->index != NULL &&
+    !DB_ERROR(index_release(attr->index)) &&
+    !DB_ERROR(index_load(rel, attr));
+  relation_release(rel);
+  return result;
+}
+/*---------------------------------------------------------------------------*/
+static int
+point_lookups(void)
+{
+  long time;
+  int i, errors;
+
+  /* Look up single rows spread over the whole relation. */
+  errors = 0;
+  for(i = 0; i < POINT_LOOKUPS; i++) {
+    time = (i * 7919L) % CARDINALITY;
+    if(run_query("SELECT time, value FROM samples WHERE time = %ld;",
+                 time, 0) != 1) {
+      errors++;
+    }
+  }
+  return errors;
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(antelope_index_benchmark_process, ev, data)
+{
+  static int i, errors;
+  static long time;
+  static unsigned long start, insert_time, point_time, range_time;
+  static unsigned long reload_time;
+
+  PROCESS_BEGIN();
+
+  printf("antelope index benchmark: %s index, %s\n", INDEX_TYPE,
+         DB_FEATURE_COFFEE ? "coffee" : "cfs-posix");
+
+  db_init();
+  errors = 0;
+
+  db_query(NULL, "REMOVE RELATION samples;");
+  if(DB_ERROR(db_query(NULL, "CREATE RELATION samples;")) ||
+     DB_ERROR(db_query(NULL, "CREATE ATTRIBUTE time DOMAIN LONG IN samples;")) ||
+     DB_ERROR(db_query(NULL, "CREATE ATTRIBUTE value DOMAIN INT IN samples;")) ||
+     DB_ERROR(db_query(NULL, "CREATE INDEX samples.time TYPE %s;",
+                       INDEX_TYPE))) {
+    printf("Failed to create the relation\n");
+    PROCESS_EXIT();
+  }
+
+  start = usec_now();
+  for(i = 0; i < CARDINALITY; i++) {
+    if(DB_ERROR(db_query(NULL, "INSERT (%d, %d) INTO samples;",
+                         i, i % 100))) {
+      errors++;
+    }
+  }
+  insert_time = usec_now() - start;
+
+  start = usec_now();
+  errors += point_lookups();
+  point_time = usec_now() - start;
+
+  /* Look up short time ranges. */
+  start = usec_now();
+  for(i = 0; i < RANGE_LOOKUPS; i++) {
+    time = (i * 7919L) % (CARDINALITY - RANGE_WIDTH);
+    if(run_query("SELECT time, value FROM samples "
+                 "WHERE time > %ld AND time < %ld;",
+                 time, time + RANGE_WIDTH + 1) != RANGE_WIDTH) {
+      errors++;
+    }
+  }
+  range_time = usec_now() - start;
+
+  /* The MaxHeap index does not keep its free slots across a reload. */
+  reload_time = 0;
+  if(strcmp(INDEX_TYPE, "BPLUSTREE") == 0) {
+    start = usec_now();
+    if(!reload_index()) {
+      printf("Failed to reload the index\n");
+      errors++;
+    }
+    reload_time = usec_now() - start;
+    errors += point_lookups();
+  }
+
+  printf("insert: %lu rows/s\n", per_second(CARDINALITY, insert_time));
+  printf("point lookup: %lu lookups/s\n",
+         per_second(POINT_LOOKUPS, point_time));
+  printf("range lookup (%u rows): %lu lookups/s\n", RANGE_WIDTH,
+         per_second(RANGE_LOOKUPS, range_time));
+  if(reload_time > 0) {
+    printf("reload: %lu us\n", reload_time);
+  }
+  printf("antelope index benchmark done, %d errors\n", errors);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
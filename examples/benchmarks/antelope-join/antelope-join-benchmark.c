@@ -0,0 +1,279 @@
+/*
+ * Copyright (c) 2013, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Joins two relations with a hash join that fits in the
+ *         in-memory table, with hash joins whose smaller relation is
+ *         several times larger than the table, and with a merge join.
+ *         The larger joins spill both relations to partition files,
+ *         and a partition with a frequent key has to be processed in
+ *         several chunks. Each result is checked against a
+ *         nested-loop join over the same keys.
+ */
+
+#include "contiki.h"
+#include "antelope.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+
+#if DB_JOIN_HASH_SIZE == 0
+#error "Set DB_JOIN_HASH_SIZE to build the hash join"
+#endif
+
+#define LEFT_CARDINALITY 1000
+#define MAX_PAIRS 4096
+
+enum join_case {
+  CASE_IN_MEMORY,
+  CASE_SPILL,
+  CASE_SKEW,
+  CASE_MERGE,
+  CASE_COUNT
+};
+
+static const char *case_names[CASE_COUNT] = {
+  "hash, in memory", "hash, spilled", "hash, spilled with a frequent key",
+  "merge"
+};
+
+static const int right_cardinality[CASE_COUNT] = {
+  DB_JOIN_HASH_SIZE / 2, 600, 400, 600
+};
+
+static long expected[MAX_PAIRS];
+static long joined[MAX_PAIRS];
+/*---------------------------------------------------------------------------*/
+PROCESS(antelope_join_benchmark_process, "Antelope join benchmark");
+AUTOSTART_PROCESSES(&antelope_join_benchmark_process);
+/*---------------------------------------------------------------------------*/
+static unsigned long
+usec_now(void)
+{
+  struct timeval tv;
+
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec * 1000000UL + tv.tv_usec;
+}
+/*---------------------------------------------------------------------------*/
+/* The merge join needs both relations in key order, the others get
+   their keys in a scattered order. */
+static long
+left_key(enum join_case c, int i)
+{
+  return c == CASE_MERGE ? i / 5 : (i * 7L) % 200;
+}
+/*---------------------------------------------------------------------------*/
+static long
+right_key(enum join_case c, int i)
+{
+  switch(c) {
+  case CASE_MERGE:
+    return i / 3;
+  case CASE_SKEW:
+    /* Every other row has the key 0. */
+    return (i & 1) ? (i * 13L) % 200 : 0;
+  default:
+    return (i * 13L) % 200;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static int
+compare_pairs(const void *a, const void *b)
+{
+  long x = *(const long *)a;
+  long y = *(const long *)b;
+
+  return x < y ? -1 : x > y;
+}
+/*---------------------------------------------------------------------------*/
+static int
+create_relations(enum join_case c)
+{
+  const char *index;
+  int i;
+
+  db_query(NULL, "REMOVE RELATION l;");
+  db_query(NULL, "REMOVE RELATION r;");
+  if(DB_ERROR(db_query(NULL, "CREATE RELATION l;")) ||
+     DB_ERROR(db_query(NULL, "CREATE ATTRIBUTE id DOMAIN INT IN l;")) ||
+     DB_ERROR(db_query(NULL, "CREATE ATTRIBUTE a DOMAIN INT IN l;")) ||
+     DB_ERROR(db_query(NULL, "CREATE RELATION r;")) ||
+     DB_ERROR(db_query(NULL, "CREATE ATTRIBUTE id DOMAIN INT IN r;")) ||
+     DB_ERROR(db_query(NULL, "CREATE ATTRIBUTE b DOMAIN INT IN r;"))) {
+    return 0;
+  }
+
+  /* Inline indexes keep both relations sorted on the join key. */
+  if(c == CASE_MERGE) {
+    index = "CREATE INDEX %s.id TYPE INLINE;";
+    if(DB_ERROR(db_query(NULL, index, "l")) ||
+       DB_ERROR(db_query(NULL, index, "r"))) {
+      return 0;
+    }
+  }
+
+  for(i = 0; i < LEFT_CARDINALITY; i++) {
+    if(DB_ERROR(db_query(NULL, "INSERT (%ld, %d) INTO l;",
+                         left_key(c, i), i))) {
+      return 0;
+    }
+  }
+  for(i = 0; i < right_cardinality[c]; i++) {
+    if(DB_ERROR(db_query(NULL, "INSERT (%ld, %d) INTO r;",
+                         right_key(c, i), i))) {
+      return 0;
+    }
+  }
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+/* Join the keys in a nested loop. Each result row is a pair of row
+   numbers, encoded as a * 65536 + b. */
+static int
+nested_loop_join(enum join_case c)
+{
+  int i, j, n;
+
+  n = 0;
+  for(i = 0; i < LEFT_CARDINALITY; i++) {
+    for(j = 0; j < right_cardinality[c]; j++) {
+      if(left_key(c, i) == right_key(c, j)) {
+        if(n == MAX_PAIRS) {
+          return -1;
+        }
+        expected[n++] = i * 65536L + j;
+      }
+    }
+  }
+  qsort(expected, n, sizeof(expected[0]), compare_pairs);
+  return n;
+}
+/*---------------------------------------------------------------------------*/
+/* Run the join in Antelope, or return -1 if it fails. */
+static int
+antelope_join(void)
+{
+  static db_handle_t handle;
+  attribute_value_t a, b;
+  db_result_t result;
+  int n;
+
+  if(DB_ERROR(db_query(&handle, "JOIN l, r ON id PROJECT a, b;"))) {
+    db_free(&handle);
+    return -1;
+  }
+
+  n = 0;
+  while(db_processing(&handle)) {
+    result = db_process(&handle);
+    if(result == DB_GOT_ROW) {
+      if(n == MAX_PAIRS ||
+         DB_ERROR(db_get_value(&a, &handle, 0)) ||
+         DB_ERROR(db_get_value(&b, &handle, 1))) {
+        db_free(&handle);
+        return -1;
+      }
+      joined[n++] = db_value_to_long(&a) * 65536L + db_value_to_long(&b);
+    } else if(result == DB_FINISHED || DB_ERROR(result)) {
+      if(DB_ERROR(db_free(&handle)) || DB_ERROR(result)) {
+        return -1;
+      }
+      break;
+    }
+  }
+
+  qsort(joined, n, sizeof(joined[0]), compare_pairs);
+  return n;
+}
+/*---------------------------------------------------------------------------*/
+static int
+run_case(enum join_case c)
+{
+  unsigned long start, usec;
+  int n, expected_n, i, errors;
+
+  if(!create_relations(c)) {
+    printf("%s: failed to create the relations\n", case_names[c]);
+    return 1;
+  }
+
+  start = usec_now();
+  n = antelope_join();
+  usec = usec_now() - start;
+
+  expected_n = nested_loop_join(c);
+  if(n < 0 || expected_n < 0) {
+    printf("%s: the join failed\n", case_names[c]);
+    return 1;
+  }
+
+  errors = n == expected_n ? 0 : 1;
+  for(i = 0; i < n && i < expected_n; i++) {
+    if(joined[i] != expected[i]) {
+      errors++;
+    }
+  }
+
+  printf("%s: %d x %d rows, %d result rows in %lu us, %d errors\n",
+         case_names[c], LEFT_CARDINALITY, right_cardinality[c], n, usec,
+         errors);
+  return errors;
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(antelope_join_benchmark_process, ev, data)
+{
+  static int errors;
+  int c;
+
+  PROCESS_BEGIN();
+
+  printf("antelope join benchmark: %u entries in the hash table, "
+         "%u partitions, %s\n", DB_JOIN_HASH_SIZE, DB_JOIN_PARTITIONS,
+         DB_FEATURE_COFFEE ? "coffee" : "cfs-posix");
+
+  db_init();
+  errors = 0;
+  for(c = 0; c < CASE_COUNT; c++) {
+    errors += run_case(c);
+  }
+
+  db_query(NULL, "REMOVE RELATION l;");
+  db_query(NULL, "REMOVE RELATION r;");
+
+  printf("antelope join benchmark done, %d errors\n", errors);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
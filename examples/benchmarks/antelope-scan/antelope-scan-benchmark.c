@@ -0,0 +1,180 @@
+/*
+ * Copyright (c) 2013, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Measures how many rows per second Antelope inserts and
+ *         scans in a relation of 20000 rows. Run it with and without
+ *         "ROWS=batch", and with and without "COFFEE=1", to compare
+ *         row-at-a-time and buffered storage on both file systems.
+ *         Build with "LVM=compile" to compare the costs of evaluating
+ *         query conditions.
+ */
+
+#include "contiki.h"
+#include "antelope.h"
+#include "cfs/cfs.h"
+
+#include <stdio.h>
+#include <sys/time.h>
+
+#define CARDINALITY 20000
+
+#ifndef DB_ROW_BUFFER_SIZE
+#define DB_ROW_BUFFER_SIZE 0
+#endif
+
+#ifndef LVM_COMPILE
+#define LVM_COMPILE 0
+#endif
+/*---------------------------------------------------------------------------*/
+PROCESS(antelope_scan_benchmark_process, "Antelope scan benchmark");
+AUTOSTART_PROCESSES(&antelope_scan_benchmark_process);
+/*---------------------------------------------------------------------------*/
+static unsigned long
+usec_now(void)
+{
+  struct timeval tv;
+
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec * 1000000UL + tv.tv_usec;
+}
+/*---------------------------------------------------------------------------*/
+static unsigned long
+rows_per_second(unsigned long rows, unsigned long usec)
+{
+  return usec == 0 ? 0 : (unsigned long)((double)rows * 1000000 / usec);
+}
+/*---------------------------------------------------------------------------*/
+/* Run a query to completion and return the number of matching rows,
+   or -1 on failure. */
+static long
+run_query(const char *query)
+{
+  static db_handle_t handle;
+  db_result_t result;
+  long matching;
+
+  if(DB_ERROR(db_query(&handle, query))) {
+    db_free(&handle);
+    return -1;
+  }
+
+  matching = 0;
+  while(db_processing(&handle)) {
+    result = db_process(&handle);
+    if(result == DB_GOT_ROW) {
+      matching++;
+    } else if(result == DB_FINISHED || DB_ERROR(result)) {
+      db_free(&handle);
+      if(DB_ERROR(result)) {
+        return -1;
+      }
+      break;
+    }
+  }
+
+  return matching;
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(antelope_scan_benchmark_process, ev, data)
+{
+  static int i, errors;
+  static long matching;
+  static unsigned long start, insert_time, select_time, filter_time;
+  static unsigned long copy_time;
+
+  PROCESS_BEGIN();
+
+  printf("antelope benchmark: row buffer %u bytes, %s, %s LVM\n",
+         (unsigned)DB_ROW_BUFFER_SIZE,
+         DB_FEATURE_COFFEE ? "coffee" : "cfs-posix",
+         LVM_COMPILE ? "compiled" : "interpreted");
+
+  db_init();
+  errors = 0;
+
+  db_query(NULL, "REMOVE RELATION samples;");
+  db_query(NULL, "REMOVE RELATION copy;");
+  if(DB_ERROR(db_query(NULL, "CREATE RELATION samples;")) ||
+     DB_ERROR(db_query(NULL, "CREATE ATTRIBUTE time DOMAIN INT IN samples;")) ||
+     DB_ERROR(db_query(NULL, "CREATE ATTRIBUTE value DOMAIN INT IN samples;"))) {
+    printf("Failed to create the relation\n");
+    PROCESS_EXIT();
+  }
+
+  start = usec_now();
+  for(i = 0; i < CARDINALITY; i++) {
+    if(DB_ERROR(db_query(NULL, "INSERT (%u, %u) INTO samples;",
+                         i, i % 100))) {
+      errors++;
+    }
+  }
+  insert_time = usec_now() - start;
+
+  /* A full scan that the LVM filters down to 10% of the rows. */
+  start = usec_now();
+  matching = run_query("SELECT time, value FROM samples WHERE value < 10;");
+  select_time = usec_now() - start;
+  if(matching != CARDINALITY / 10) {
+    errors++;
+  }
+
+  /* A full scan with a condition on both attributes. */
+  start = usec_now();
+  matching = run_query("SELECT time, value FROM samples "
+                       "WHERE value > 89 AND time < 10000;");
+  filter_time = usec_now() - start;
+  if(matching != CARDINALITY / 20) {
+    errors++;
+  }
+
+  /* A full scan that writes every row to a new relation. */
+  start = usec_now();
+  matching = run_query("copy <- SELECT time, value FROM samples;");
+  copy_time = usec_now() - start;
+  if(matching != CARDINALITY ||
+     run_query("SELECT time, value FROM copy WHERE value = 99;") !=
+     CARDINALITY / 100) {
+    errors++;
+  }
+
+  printf("insert: %lu rows/s\n", rows_per_second(CARDINALITY, insert_time));
+  printf("select: %lu rows/s\n", rows_per_second(CARDINALITY, select_time));
+  printf("select, 2 conditions: %lu rows/s\n",
+         rows_per_second(CARDINALITY, filter_time));
+  printf("select into: %lu rows/s\n", rows_per_second(CARDINALITY, copy_time));
+  printf("antelope benchmark done, %d errors\n", errors);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
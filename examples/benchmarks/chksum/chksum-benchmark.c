@@ -0,0 +1,196 @@
+/*
+ * Copyright (c) 2013, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Compares uip_chksum_add() with the byte-pair checksum loop
+ *         that uIP used before, and checks that the two agree for
+ *         all lengths and alignments. Also checks that
+ *         uip_chksum_update16() gives the same checksum as summing
+ *         the data again.
+ */
+
+#include "contiki.h"
+#include "net/uip-chksum.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#define MAX_LEN 1500
+#define ROUNDS  20000
+
+static uint8_t buf[MAX_LEN + 8];
+static const int lengths[] = {20, 40, 64, 128, 576, MAX_LEN};
+/*---------------------------------------------------------------------------*/
+PROCESS(chksum_benchmark_process, "Checksum benchmark");
+AUTOSTART_PROCESSES(&chksum_benchmark_process);
+/*---------------------------------------------------------------------------*/
+static unsigned long
+usec_now(void)
+{
+  struct timeval tv;
+
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec * 1000000UL + tv.tv_usec;
+}
+/*---------------------------------------------------------------------------*/
+/* The checksum loop of uip.c and uip6.c before uip-chksum.c. */
+static uint16_t
+legacy_chksum(uint16_t sum, const uint8_t *data, uint16_t len)
+{
+  uint16_t t;
+  const uint8_t *dataptr;
+  const uint8_t *last_byte;
+
+  dataptr = data;
+  last_byte = data + len - 1;
+
+  while(dataptr < last_byte) {
+    t = (dataptr[0] << 8) + dataptr[1];
+    sum += t;
+    if(sum < t) {
+      sum++;
+    }
+    dataptr += 2;
+  }
+
+  if(dataptr == last_byte) {
+    t = (dataptr[0] << 8) + 0;
+    sum += t;
+    if(sum < t) {
+      sum++;
+    }
+  }
+  return sum;
+}
+/*---------------------------------------------------------------------------*/
+static int
+check_sums(void)
+{
+  int len, off, errors;
+  uint16_t seed;
+
+  errors = 0;
+  for(off = 0; off < 8; off++) {
+    for(len = 0; len <= MAX_LEN; len++) {
+      seed = rand();
+      if(uip_chksum_add(seed, buf + off, len) !=
+         legacy_chksum(seed, buf + off, len)) {
+        if(errors++ < 10) {
+          printf("mismatch: offset %d length %d\n", off, len);
+        }
+      }
+    }
+  }
+  return errors;
+}
+/*---------------------------------------------------------------------------*/
+static int
+check_updates(void)
+{
+  int i, pos, errors;
+  uint16_t chksum, oldval, newval, expected;
+
+  errors = 0;
+  for(i = 0; i < 10000; i++) {
+    pos = (rand() % 20) & ~1;
+    memset(buf + 10, 0, 2);
+    chksum = ~uip_htons(uip_chksum_add(0, buf, 20));
+    memcpy(buf + 10, &chksum, 2);
+
+    memcpy(&oldval, buf + pos, 2);
+    newval = rand();
+    memcpy(buf + pos, &newval, 2);
+    if(pos == 10) {
+      /* The checksum field itself changed; nothing to check. */
+      continue;
+    }
+
+    memset(buf + 10, 0, 2);
+    expected = ~uip_htons(uip_chksum_add(0, buf, 20));
+    chksum = uip_chksum_update16(chksum, oldval, newval);
+    /* Both representations of zero are valid. */
+    if(chksum != expected &&
+       !((chksum == 0 || chksum == 0xffff) &&
+         (expected == 0 || expected == 0xffff))) {
+      if(errors++ < 10) {
+        printf("update mismatch: position %d 0x%04x != 0x%04x\n",
+               pos, chksum, expected);
+      }
+    }
+  }
+  return errors;
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(chksum_benchmark_process, ev, data)
+{
+  static int i, r, len;
+  static unsigned long start, legacy, module;
+  static volatile uint16_t sink;
+
+  PROCESS_BEGIN();
+
+  printf("chksum benchmark: %s loop\n", UIP_CHKSUM_WIDE ? "wide" : "byte-pair");
+
+  for(i = 0; i < sizeof(buf); i++) {
+    buf[i] = rand();
+  }
+
+  printf("sum check: %d errors\n", check_sums());
+  printf("update check: %d errors\n", check_updates());
+
+  for(r = 0; r < sizeof(lengths) / sizeof(lengths[0]); r++) {
+    len = lengths[r];
+
+    start = usec_now();
+    for(i = 0; i < ROUNDS; i++) {
+      sink = legacy_chksum(sink, buf, len);
+    }
+    legacy = usec_now() - start;
+
+    start = usec_now();
+    for(i = 0; i < ROUNDS; i++) {
+      sink = uip_chksum_add(sink, buf, len);
+    }
+    module = usec_now() - start;
+
+    printf("%d bytes: legacy %lu ns, uip_chksum_add %lu ns\n",
+           len, legacy * 1000 / ROUNDS, module * 1000 / ROUNDS);
+  }
+
+  printf("chksum benchmark done\n");
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
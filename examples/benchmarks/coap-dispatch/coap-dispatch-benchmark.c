@@ -0,0 +1,163 @@
+/*
+ * Copyright (c) 2013, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Measures how many CoAP requests per second are parsed and
+ *         dispatched to their resource handlers as the number of
+ *         activated resources grows. The requests are generated
+ *         in-process, so the network stack is not involved.
+ */
+
+#include "contiki.h"
+#include "er-coap-13.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/time.h>
+
+#define MAX_RESOURCES 512
+#define REQUESTS 200000
+#define TARGETS 64
+/*---------------------------------------------------------------------------*/
+PROCESS(coap_dispatch_benchmark_process, "CoAP dispatch benchmark");
+AUTOSTART_PROCESSES(&coap_dispatch_benchmark_process);
+/*---------------------------------------------------------------------------*/
+static resource_t resources[MAX_RESOURCES];
+static char urls[MAX_RESOURCES][24];
+static unsigned long handled;
+
+static uint8_t requests[TARGETS][COAP_MAX_PACKET_SIZE];
+static size_t request_lengths[TARGETS];
+static uint8_t request_buffer[COAP_MAX_PACKET_SIZE + 1];
+static uint8_t response_buffer[REST_MAX_CHUNK_SIZE];
+/*---------------------------------------------------------------------------*/
+static unsigned long
+usec_now(void)
+{
+  struct timeval tv;
+
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec * 1000000UL + tv.tv_usec;
+}
+/*---------------------------------------------------------------------------*/
+static void
+benchmark_handler(void *request, void *response, uint8_t *buffer,
+                  uint16_t preferred_size, int32_t *offset)
+{
+  handled++;
+  REST.set_response_payload(response, buffer, 0);
+}
+/*---------------------------------------------------------------------------*/
+/* Serialize GET requests with a few options that the handler does not
+   read, spread over the resources that have been activated. */
+static void
+generate_requests(int resource_count)
+{
+  static coap_packet_t request[1];
+  static const uint8_t token[4] = { 0xde, 0xad, 0xbe, 0xef };
+  static const uint8_t etag[2] = { 0x12, 0x34 };
+  int i;
+
+  for(i = 0; i < TARGETS; i++) {
+    coap_init_message(request, COAP_TYPE_CON, COAP_GET, i);
+    coap_set_header_token(request, token, sizeof(token));
+    coap_set_header_uri_host(request, "proxy.local");
+    coap_set_header_etag(request, etag, sizeof(etag));
+    coap_set_header_uri_path(request, urls[(i * 7919L) % resource_count]);
+    coap_set_header_accept(request, APPLICATION_JSON);
+    coap_set_header_uri_query(request, "unit=c");
+    request_lengths[i] = coap_serialize_message(request, requests[i]);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static unsigned long
+run_requests(void)
+{
+  static coap_packet_t request[1];
+  static coap_packet_t response[1];
+  unsigned long start;
+  unsigned long i;
+  int32_t offset;
+  int target;
+
+  handled = 0;
+  start = usec_now();
+  for(i = 0; i < REQUESTS; i++) {
+    target = i % TARGETS;
+    /* The parser works in place, so each request needs a fresh copy. */
+    memcpy(request_buffer, requests[target], request_lengths[target]);
+    if(coap_parse_message(request, request_buffer,
+                          request_lengths[target]) != NO_ERROR) {
+      continue;
+    }
+    coap_init_message(response, COAP_TYPE_ACK, CONTENT_2_05, request->mid);
+    offset = 0;
+    rest_invoke_restful_service(request, response, response_buffer,
+                                sizeof(response_buffer), &offset);
+  }
+  return usec_now() - start;
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(coap_dispatch_benchmark_process, ev, data)
+{
+  static int count, next;
+  static unsigned long time;
+
+  PROCESS_BEGIN();
+
+  printf("coap dispatch benchmark: %u hash buckets\n",
+         REST_RESOURCE_HASH_SIZE);
+
+  next = 0;
+  for(count = 16; count <= MAX_RESOURCES; count *= 2) {
+    for(; next < count; next++) {
+      snprintf(urls[next], sizeof(urls[next]), "dev/%d/value", next);
+      resources[next].flags = METHOD_GET;
+      resources[next].url = urls[next];
+      resources[next].attributes = "";
+      resources[next].handler = benchmark_handler;
+      rest_activate_resource(&resources[next]);
+    }
+
+    generate_requests(count);
+    time = run_requests();
+    printf("%d resources: %lu requests/s (%lu handled)\n", count,
+           time == 0 ? 0 : (unsigned long)((double)REQUESTS * 1000000 / time),
+           handled);
+  }
+
+  printf("coap dispatch benchmark done\n");
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
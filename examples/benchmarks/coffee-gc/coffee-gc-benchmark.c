@@ -0,0 +1,208 @@
+/*
+ * Copyright (c) 2013, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+
+/**
+ * \file
+ *         Rewrites a set of Coffee files over and over, yielding now
+ *         and then so that the background garbage collector can run
+ *         between the file operations. Every file is checked against
+ *         the data last written to it, and the time spent per rewrite
+ *         and the garbage collection pauses are reported. Run it once
+ *         with the default configuration and once with
+ *         "make BACKGROUND_GC=1" to compare the two collectors.
+ */
+
+#include "contiki.h"
+#include "cfs/cfs.h"
+#include "cfs/cfs-coffee.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/time.h>
+
+#ifndef COFFEE_BACKGROUND_GC
+#define COFFEE_BACKGROUND_GC 0
+#endif
+
+#define FILES        50
+#define FILE_SIZE    5000
+#define CYCLES       20000
+/* File operations between the pauses in which the collector may run */
+#define YIELD_EVERY  4
+
+static uint8_t version[FILES];
+static uint8_t buf[FILE_SIZE];
+/*---------------------------------------------------------------------------*/
+PROCESS(coffee_gc_benchmark_process, "Coffee GC benchmark");
+AUTOSTART_PROCESSES(&coffee_gc_benchmark_process);
+/*---------------------------------------------------------------------------*/
+static unsigned long
+usec_now(void)
+{
+  struct timeval tv;
+
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec * 1000000UL + tv.tv_usec;
+}
+/*---------------------------------------------------------------------------*/
+static char *
+file_name(int n)
+{
+  static char name[16];
+
+  snprintf(name, sizeof(name), "gc%d", n);
+  return name;
+}
+/*---------------------------------------------------------------------------*/
+static void
+fill(int n)
+{
+  int i;
+
+  /* Coffee finds the end of a file that is not open at its last
+     non-zero byte, so no byte is zero. */
+  for(i = 0; i < FILE_SIZE; i++) {
+    buf[i] = (uint8_t)(n + version[n] + i) | 1;
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Removes the file, reserves it anew and writes its next version */
+static int
+rewrite(int n)
+{
+  int fd, len;
+
+  cfs_remove(file_name(n));
+  if(cfs_coffee_reserve(file_name(n), FILE_SIZE) < 0) {
+    return -1;
+  }
+  fd = cfs_open(file_name(n), CFS_WRITE);
+  if(fd < 0) {
+    return -1;
+  }
+  version[n]++;
+  fill(n);
+  len = cfs_write(fd, buf, FILE_SIZE);
+  cfs_close(fd);
+  return len == FILE_SIZE ? 0 : -1;
+}
+/*---------------------------------------------------------------------------*/
+/* Checks that the file holds the version last written to it */
+static int
+verify(int n)
+{
+  static uint8_t read_buf[FILE_SIZE];
+  int fd, len;
+
+  fd = cfs_open(file_name(n), CFS_READ);
+  if(fd < 0) {
+    return -1;
+  }
+  len = cfs_read(fd, read_buf, FILE_SIZE);
+  cfs_close(fd);
+  fill(n);
+  return len == FILE_SIZE && memcmp(buf, read_buf, FILE_SIZE) == 0 ? 0 : -1;
+}
+/*---------------------------------------------------------------------------*/
+#if COFFEE_BACKGROUND_GC
+static void
+print_histogram(const char *name, const uint16_t *histogram)
+{
+  int i;
+
+  printf("%s pauses:", name);
+  for(i = 0; i < CFS_COFFEE_GC_HISTOGRAM_SIZE; i++) {
+    printf(" %u", histogram[i]);
+  }
+  printf("\n");
+}
+#endif /* COFFEE_BACKGROUND_GC */
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(coffee_gc_benchmark_process, ev, data)
+{
+  static int i, errors;
+  static unsigned long start, elapsed;
+#if COFFEE_BACKGROUND_GC
+  struct cfs_coffee_gc_stats stats;
+#endif /* COFFEE_BACKGROUND_GC */
+
+  PROCESS_BEGIN();
+
+  printf("coffee gc benchmark: background gc %s\n",
+         COFFEE_BACKGROUND_GC ? "on" : "off");
+
+  cfs_coffee_format();
+  errors = 0;
+  elapsed = 0;
+
+  for(i = 0; i < FILES; i++) {
+    if(rewrite(i) < 0) {
+      errors++;
+    }
+  }
+
+  for(i = 0; i < CYCLES; i++) {
+    /* Only the file operations are timed, not the pauses. */
+    start = usec_now();
+    if(rewrite(i % FILES) < 0) {
+      errors++;
+    }
+    elapsed += usec_now() - start;
+
+    if(i % YIELD_EVERY == YIELD_EVERY - 1) {
+      PROCESS_PAUSE();
+      /* The collector may have run, files must be intact */
+      if(verify((i * 7) % FILES) < 0) {
+        errors++;
+      }
+    }
+  }
+
+  for(i = 0; i < FILES; i++) {
+    if(verify(i) < 0) {
+      errors++;
+    }
+  }
+
+  printf("%d rewrites of %d bytes: %lu ns/rewrite\n",
+         CYCLES, FILE_SIZE, elapsed * 1000 / CYCLES);
+#if COFFEE_BACKGROUND_GC
+  cfs_coffee_get_gc_stats(&stats);
+  print_histogram("foreground", stats.foreground);
+  print_histogram("background", stats.background);
+#endif /* COFFEE_BACKGROUND_GC */
+  printf("coffee gc benchmark done, %d errors\n", errors);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
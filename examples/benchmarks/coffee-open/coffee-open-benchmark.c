@@ -0,0 +1,142 @@
+/*
+ * Copyright (c) 2013, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Measures the cost of opening and removing Coffee files that
+ *         are not in the open file cache, with 100, 1000 and 3000
+ *         files in the file system. Run it once with the default
+ *         configuration and once with "make NAME_INDEX=1" to compare
+ *         a flash scan with the file name index.
+ */
+
+#include "contiki.h"
+#include "cfs/cfs.h"
+#include "cfs/cfs-coffee.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+
+#ifndef COFFEE_NAME_INDEX
+#define COFFEE_NAME_INDEX 0
+#endif
+
+#define MAX_FILES 3000
+#define LOOKUPS   2000
+
+static const int rounds[] = {100, 1000, MAX_FILES};
+/*---------------------------------------------------------------------------*/
+PROCESS(coffee_open_benchmark_process, "Coffee open benchmark");
+AUTOSTART_PROCESSES(&coffee_open_benchmark_process);
+/*---------------------------------------------------------------------------*/
+static unsigned long
+usec_now(void)
+{
+  struct timeval tv;
+
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec * 1000000UL + tv.tv_usec;
+}
+/*---------------------------------------------------------------------------*/
+static char *
+file_name(int n)
+{
+  static char name[16];
+
+  snprintf(name, sizeof(name), "file%d", n);
+  return name;
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(coffee_open_benchmark_process, ev, data)
+{
+  static int r, i, n, files, fd, errors;
+  static unsigned long start, open_time, miss_time, remove_time;
+
+  PROCESS_BEGIN();
+
+  printf("coffee benchmark: name index %s\n",
+         COFFEE_NAME_INDEX ? "on" : "off");
+
+  cfs_coffee_format();
+  errors = 0;
+  files = 0;
+
+  for(r = 0; r < sizeof(rounds) / sizeof(rounds[0]); r++) {
+    n = rounds[r];
+    for(; files < n; files++) {
+      if(cfs_coffee_reserve(file_name(files), 0) < 0) {
+        errors++;
+      }
+    }
+
+    srand(n);
+    start = usec_now();
+    for(i = 0; i < LOOKUPS; i++) {
+      fd = cfs_open(file_name(rand() % n), CFS_READ);
+      if(fd < 0) {
+        errors++;
+      }
+      cfs_close(fd);
+    }
+    open_time = usec_now() - start;
+
+    start = usec_now();
+    for(i = 0; i < LOOKUPS; i++) {
+      if(cfs_open(file_name(n + i), CFS_READ) >= 0) {
+        errors++;
+      }
+    }
+    miss_time = usec_now() - start;
+
+    /* Remove and recreate a file per lookup to keep the file count. */
+    start = usec_now();
+    for(i = 0; i < LOOKUPS; i++) {
+      if(cfs_remove(file_name(i % n)) < 0 ||
+         cfs_coffee_reserve(file_name(i % n), 0) < 0) {
+        errors++;
+      }
+    }
+    remove_time = usec_now() - start;
+
+    printf("%d files: %lu ns/open, %lu ns/miss, %lu ns/remove+reserve\n",
+           n, open_time * 1000 / LOOKUPS, miss_time * 1000 / LOOKUPS,
+           remove_time * 1000 / LOOKUPS);
+
+    PROCESS_PAUSE();
+  }
+
+  printf("coffee benchmark done, %d errors\n", errors);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
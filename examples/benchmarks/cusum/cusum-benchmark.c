@@ -0,0 +1,278 @@
+/*
+ * Copyright (c) 2013, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Measures how many samples per second the CUSUM detectors
+ *         process, one at a time and in batches, and how many samples
+ *         after a change they raise their alarm. The traces are
+ *         synthetic unless a recorded one is given on the command line.
+ */
+
+#include "contiki.h"
+#include "cusum.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+
+#define TRACE_MAX 20000
+#define CHANGE_AT 10000
+#define PASSES 50
+#define BATCH 64
+
+#define MEAN_0 300
+#define STD_DEV_0 5
+#define MEAN_1 310
+#define STD_DEV_1 8
+
+extern int contiki_argc;
+extern char **contiki_argv;
+/*---------------------------------------------------------------------------*/
+PROCESS(cusum_benchmark_process, "CUSUM benchmark");
+AUTOSTART_PROCESSES(&cusum_benchmark_process);
+/*---------------------------------------------------------------------------*/
+static uint16_t trace[TRACE_MAX];
+static int trace_length;
+static int change_at;
+static unsigned long seed;
+/*---------------------------------------------------------------------------*/
+static unsigned long
+usec_now(void)
+{
+  struct timeval tv;
+
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec * 1000000UL + tv.tv_usec;
+}
+/*---------------------------------------------------------------------------*/
+static unsigned long
+samples_per_second(unsigned long samples, unsigned long usec)
+{
+  return usec == 0 ? 0 : (unsigned long)((double)samples * 1000000 / usec);
+}
+/*---------------------------------------------------------------------------*/
+/* Approximately normal noise with unit variance, from a fixed seed so
+   that every run replays the same trace. */
+static double
+noise(void)
+{
+  double sum = 0;
+  int i;
+
+  for(i = 0; i < 12; i++) {
+    seed = seed * 1103515245UL + 12345;
+    sum += ((seed >> 16) & 0x7fff) / 32768.0;
+  }
+  return sum - 6;
+}
+/*---------------------------------------------------------------------------*/
+static void
+generate_trace(uint16_t mean1, uint16_t std_dev_1)
+{
+  int i;
+
+  seed = 1;
+  for(i = 0; i < TRACE_MAX; i++) {
+    if(i < CHANGE_AT) {
+      trace[i] = MEAN_0 + STD_DEV_0 * noise() + 0.5;
+    } else {
+      trace[i] = mean1 + std_dev_1 * noise() + 0.5;
+    }
+  }
+  trace_length = TRACE_MAX;
+  change_at = CHANGE_AT;
+}
+/*---------------------------------------------------------------------------*/
+static int
+load_trace(const char *name)
+{
+  FILE *f;
+  unsigned value;
+
+  f = fopen(name, "r");
+  if(f == NULL) {
+    return 0;
+  }
+  trace_length = 0;
+  while(trace_length < TRACE_MAX && fscanf(f, "%u", &value) == 1) {
+    trace[trace_length++] = value;
+  }
+  fclose(f);
+  return trace_length > 0;
+}
+/*---------------------------------------------------------------------------*/
+/* The Gaussian detector in floating point, as a check of the delay of
+   the fixed-point one. The motes have no FPU, so its throughput on the
+   host says little about theirs. */
+static double reference_s;
+static int
+reference_update(uint16_t x)
+{
+  double d0 = (double)x - MEAN_0;
+  double d1 = (double)x - MEAN_1;
+
+  reference_s += log((double)STD_DEV_0 / STD_DEV_1) +
+    d0 * d0 / (2.0 * STD_DEV_0 * STD_DEV_0) -
+    d1 * d1 / (2.0 * STD_DEV_1 * STD_DEV_1);
+  if(reference_s < 0) {
+    reference_s = 0;
+  }
+  return reference_s >= 7;
+}
+/*---------------------------------------------------------------------------*/
+static void
+run_reference(void)
+{
+  unsigned long start, time;
+  int pass, i, delay;
+
+  delay = -1;
+  start = usec_now();
+  for(pass = 0; pass < PASSES; pass++) {
+    reference_s = 0;
+    for(i = 0; i < trace_length; i++) {
+      if(reference_update(trace[i])) {
+        if(pass == 0 && i >= change_at && delay < 0) {
+          delay = i - change_at;
+        }
+        reference_s = 0;
+      }
+    }
+  }
+  time = usec_now() - start;
+
+  printf("%-13s %9lu samples/s %9s          delay %d\n", "floating",
+         samples_per_second((unsigned long)PASSES * trace_length, time),
+         "", delay);
+}
+/*---------------------------------------------------------------------------*/
+/* Replays the trace through a copy of the detector, resetting it after
+   each alarm, and prints the throughput of both entry points along with
+   the false alarms before the change and the delay of the first alarm
+   after it. */
+static void
+run_detector(const char *name, const struct cusum *detector)
+{
+  static struct cusum c;
+  unsigned long start, single_time, batch_time;
+  int pass, i, n, false_alarms, delay;
+
+  false_alarms = 0;
+  delay = -1;
+  start = usec_now();
+  for(pass = 0; pass < PASSES; pass++) {
+    c = *detector;
+    for(i = 0; i < trace_length; i++) {
+      if(cusum_update(&c, trace[i])) {
+        if(pass == 0) {
+          if(i < change_at) {
+            false_alarms++;
+          } else if(delay < 0) {
+            delay = i - change_at;
+          }
+        }
+        cusum_reset(&c);
+      }
+    }
+  }
+  single_time = usec_now() - start;
+
+  start = usec_now();
+  for(pass = 0; pass < PASSES; pass++) {
+    c = *detector;
+    for(i = 0; i < trace_length; i += n) {
+      n = cusum_update_batch(&c, &trace[i],
+                             trace_length - i < BATCH ? trace_length - i : BATCH);
+      if(cusum_alarm(&c)) {
+        cusum_reset(&c);
+      }
+    }
+  }
+  batch_time = usec_now() - start;
+
+  printf("%-13s %9lu samples/s %9lu batched  delay %d, %d false alarms\n",
+         name,
+         samples_per_second((unsigned long)PASSES * trace_length, single_time),
+         samples_per_second((unsigned long)PASSES * trace_length, batch_time),
+         delay, false_alarms);
+}
+/*---------------------------------------------------------------------------*/
+static void
+run_all(void)
+{
+  static struct cusum detector;
+
+  cusum_init_plain(&detector, MEAN_0, MEAN_1, CUSUM_FIXED(60));
+  run_detector("plain", &detector);
+  cusum_init_gaussian(&detector, MEAN_0, STD_DEV_0, MEAN_1, STD_DEV_1,
+                      CUSUM_FIXED(7));
+  run_detector("gaussian", &detector);
+  run_reference();
+  cusum_init_adaptive(&detector, MEAN_0, STD_DEV_0, CUSUM_FIXED(1),
+                      CUSUM_FIXED(0.05), 0, 4096, CUSUM_FIXED(1),
+                      CUSUM_FIXED(20));
+  run_detector("adaptive", &detector);
+  cusum_init_page_hinkley(&detector, CUSUM_FIXED(2), 6, 0, CUSUM_FIXED(60));
+  run_detector("page-hinkley", &detector);
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(cusum_benchmark_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+  if(contiki_argc >= 3) {
+    if(!load_trace(contiki_argv[1])) {
+      printf("Failed to read the trace %s\n", contiki_argv[1]);
+      PROCESS_EXIT();
+    }
+    change_at = atoi(contiki_argv[2]);
+    printf("cusum benchmark: %s, %d samples, change at %d\n",
+           contiki_argv[1], trace_length, change_at);
+    run_all();
+  } else {
+    generate_trace(MEAN_1, STD_DEV_0);
+    printf("cusum benchmark: mean %d -> %d\n", MEAN_0, MEAN_1);
+    run_all();
+
+    generate_trace(MEAN_0, STD_DEV_1);
+    printf("cusum benchmark: standard deviation %d -> %d\n",
+           STD_DEV_0, STD_DEV_1);
+    run_all();
+  }
+
+  printf("cusum benchmark done\n");
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
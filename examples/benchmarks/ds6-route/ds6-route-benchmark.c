@@ -0,0 +1,148 @@
+/*
+ * Copyright (c) 2013, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Measures the cost of uip_ds6_route_lookup() with 100, 1000
+ *         and 10000 host routes, as on an RPL root in storing mode.
+ *         Run it once with the default route table and once with
+ *         "make ROUTE=hash" to compare the two.
+ */
+
+#include "contiki.h"
+#include "net/uip-ds6.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#define NUM_NEIGHBORS 16
+#define LOOKUPS       100000
+
+static const int rounds[] = {100, 1000, 10000};
+/*---------------------------------------------------------------------------*/
+PROCESS(ds6_route_benchmark_process, "Route table benchmark");
+AUTOSTART_PROCESSES(&ds6_route_benchmark_process);
+/*---------------------------------------------------------------------------*/
+static unsigned long
+usec_now(void)
+{
+  struct timeval tv;
+
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec * 1000000UL + tv.tv_usec;
+}
+/*---------------------------------------------------------------------------*/
+static void
+neighbor_addr(uip_ipaddr_t *ipaddr, uip_lladdr_t *lladdr, int n)
+{
+  memset(lladdr, 0, sizeof(*lladdr));
+  lladdr->addr[sizeof(*lladdr) - 1] = n + 1;
+  uip_ip6addr(ipaddr, 0xfe80, 0, 0, 0, 0, 0, 0, 0);
+  uip_ds6_set_addr_iid(ipaddr, lladdr);
+}
+/*---------------------------------------------------------------------------*/
+static void
+host_addr(uip_ipaddr_t *ipaddr, int n)
+{
+  uip_ip6addr(ipaddr, 0xaaaa, 0, 0, 0, 0x0212, 0x7400, n >> 16, n & 0xffff);
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(ds6_route_benchmark_process, ev, data)
+{
+  static int r, i, n, errors;
+  static unsigned long start, hit, miss;
+  uip_ipaddr_t ipaddr, nexthop;
+  uip_lladdr_t lladdr;
+  uip_ds6_route_t *route;
+
+  PROCESS_BEGIN();
+
+  printf("ds6 route benchmark: %s route table\n",
+         UIP_DS6_ROUTE_HASH ? "hashed" : "linear");
+
+  for(i = 0; i < NUM_NEIGHBORS; i++) {
+    neighbor_addr(&ipaddr, &lladdr, i);
+    uip_ds6_nbr_add(&ipaddr, &lladdr, 0, NBR_REACHABLE);
+  }
+
+  /* Two prefix routes, as learned from DAOs for other prefixes. */
+  neighbor_addr(&nexthop, &lladdr, 0);
+  uip_ip6addr(&ipaddr, 0xcccc, 0, 0, 0, 0, 0, 0, 0);
+  uip_ds6_route_add(&ipaddr, 16, &nexthop);
+  uip_ip6addr(&ipaddr, 0xbbbb, 0x1, 0, 0, 0, 0, 0, 0);
+  uip_ds6_route_add(&ipaddr, 64, &nexthop);
+
+  n = 0;
+  errors = 0;
+  for(r = 0; r < sizeof(rounds) / sizeof(rounds[0]); r++) {
+    for(; n < rounds[r]; n++) {
+      host_addr(&ipaddr, n);
+      neighbor_addr(&nexthop, &lladdr, n % NUM_NEIGHBORS);
+      if(uip_ds6_route_add(&ipaddr, 128, &nexthop) == NULL) {
+        printf("could not add route %d\n", n);
+        PROCESS_EXIT();
+      }
+    }
+
+    start = usec_now();
+    for(i = 0; i < LOOKUPS; i++) {
+      host_addr(&ipaddr, rand() % n);
+      route = uip_ds6_route_lookup(&ipaddr);
+      if(route == NULL || !uip_ipaddr_cmp(&route->ipaddr, &ipaddr)) {
+        errors++;
+      }
+    }
+    hit = usec_now() - start;
+
+    /* Addresses with no host route fall back to the prefix routes. */
+    start = usec_now();
+    for(i = 0; i < LOOKUPS; i++) {
+      uip_ip6addr(&ipaddr, 0xbbbb, 0x1, 0, 0, 0, 0, 0, rand());
+      route = uip_ds6_route_lookup(&ipaddr);
+      if(route == NULL || route->length != 64) {
+        errors++;
+      }
+    }
+    miss = usec_now() - start;
+
+    printf("%d routes: %lu ns/lookup (host route), %lu ns/lookup (prefix)\n",
+           uip_ds6_route_num_routes(), hit * 1000 / LOOKUPS,
+           miss * 1000 / LOOKUPS);
+  }
+
+  printf("ds6 route benchmark done, %d errors\n", errors);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,102 @@
+/*
+ * Copyright (c) 2013, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Measures the cost of setting and expiring event timers with
+ *         10, 100 and 10000 pending timers. Run it once with the
+ *         default timer list and once with "make ETIMER=heap" to
+ *         compare the two timer stores.
+ */
+
+#include "contiki.h"
+
+#include <stdio.h>
+#include <sys/time.h>
+
+#define MAX_TIMERS 10000
+
+static struct etimer timers[MAX_TIMERS];
+static const int rounds[] = {10, 100, MAX_TIMERS};
+/*---------------------------------------------------------------------------*/
+PROCESS(etimer_benchmark_process, "Event timer benchmark");
+AUTOSTART_PROCESSES(&etimer_benchmark_process);
+/*---------------------------------------------------------------------------*/
+static unsigned long
+usec_now(void)
+{
+  struct timeval tv;
+
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec * 1000000UL + tv.tv_usec;
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(etimer_benchmark_process, ev, data)
+{
+  static int r, i, n, expired;
+  static unsigned long start, set_time, first, last;
+  static clock_time_t deadline;
+
+  PROCESS_BEGIN();
+
+  printf("etimer benchmark: store %s\n", ETIMER_HEAP ? "heap" : "list");
+
+  for(r = 0; r < sizeof(rounds) / sizeof(rounds[0]); r++) {
+    n = rounds[r];
+
+    /* Let all timers expire on the same tick, so that the time from
+       the first to the last expiration is spent dispatching them. */
+    deadline = clock_time() + CLOCK_SECOND;
+    start = usec_now();
+    for(i = 0; i < n; i++) {
+      etimer_set(&timers[i], deadline - clock_time());
+    }
+    set_time = usec_now() - start;
+
+    for(expired = 0; expired < n;) {
+      PROCESS_WAIT_EVENT_UNTIL(ev == PROCESS_EVENT_TIMER);
+      if(expired == 0) {
+        first = usec_now();
+      }
+      expired++;
+    }
+    last = usec_now();
+
+    printf("%d timers: %lu ns/set, %lu ns/expiry (%lu us dispatch)\n",
+           n, set_time * 1000 / n, (last - first) * 1000 / n, last - first);
+  }
+
+  printf("etimer benchmark done\n");
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
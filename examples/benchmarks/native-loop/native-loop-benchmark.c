@@ -0,0 +1,102 @@
+/*
+ * Copyright (c) 2013, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Exercises the main loop of the native platform with a
+ *         periodic event timer and reports how late the timer events
+ *         reach their process. Built with SELECT_CONF_STATS, so the
+ *         main loop also reports its wakeups per second. Run it
+ *         with TARGET=native and type lines on stdin to exercise the
+ *         file descriptor path.
+ */
+
+#include "contiki.h"
+#include "dev/serial-line.h"
+
+#include <stdio.h>
+#include <time.h>
+
+#define PERIOD      (CLOCK_SECOND / 10)
+#define REPORT_EVERY 100
+/*---------------------------------------------------------------------------*/
+PROCESS(native_loop_benchmark_process, "Native loop benchmark");
+AUTOSTART_PROCESSES(&native_loop_benchmark_process);
+/*---------------------------------------------------------------------------*/
+static unsigned long
+usec_now(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000UL + ts.tv_nsec / 1000;
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(native_loop_benchmark_process, ev, data)
+{
+  static struct etimer et;
+  static unsigned long deadline, latency, sum, max;
+  static int n;
+
+  PROCESS_BEGIN();
+
+  /* The timer is due a period after it is set, and etimer_reset()
+     keeps the following periods from drifting. */
+  etimer_set(&et, PERIOD);
+  deadline = usec_now() + PERIOD * (1000000UL / CLOCK_SECOND);
+  while(1) {
+    PROCESS_WAIT_EVENT();
+
+    if(ev == PROCESS_EVENT_TIMER && data == &et) {
+      latency = usec_now() - deadline;
+      if((long)latency < 0) {
+        latency = 0;
+      }
+      sum += latency;
+      if(latency > max) {
+        max = latency;
+      }
+      if(++n == REPORT_EVERY) {
+        printf("timer event to handler: avg %lu us max %lu us\n",
+               sum / n, max);
+        sum = max = n = 0;
+      }
+      etimer_reset(&et);
+      deadline += PERIOD * (1000000UL / CLOCK_SECOND);
+    } else if(ev == serial_line_event_message) {
+      printf("line: %s\n", (char *)data);
+    }
+  }
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,156 @@
+/*
+ * Copyright (c) 2013, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Measures nbr_table_get_from_lladdr() on a full neighbor table
+ *         and checks that lookups stay right while neighbors change
+ *         their link-layer address, as in ND6, and are evicted.  Run it
+ *         once with the default table and once with "make NBR=hash".
+ */
+
+#include "contiki.h"
+#include "net/nbr-table.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#define ROUNDS  20
+#define LOOKUPS 100000
+
+struct neighbor {
+  int id;
+};
+
+NBR_TABLE(struct neighbor, neighbors);
+/*---------------------------------------------------------------------------*/
+PROCESS(nbr_table_benchmark_process, "Neighbor table benchmark");
+AUTOSTART_PROCESSES(&nbr_table_benchmark_process);
+/*---------------------------------------------------------------------------*/
+static unsigned long
+usec_now(void)
+{
+  struct timeval tv;
+
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec * 1000000UL + tv.tv_usec;
+}
+/*---------------------------------------------------------------------------*/
+/* Addresses of generation g: every round changes the address of all
+   neighbors once and then replaces them with new ones */
+static void
+lladdr_of(rimeaddr_t *lladdr, int g, int i)
+{
+  memset(lladdr, 0, sizeof(*lladdr));
+  lladdr->u8[0] = g + 1;
+  lladdr->u8[sizeof(*lladdr) - 1] = i + 1;
+}
+/*---------------------------------------------------------------------------*/
+static int
+check(int g, int present)
+{
+  rimeaddr_t lladdr;
+  struct neighbor *n;
+  int i, errors;
+
+  errors = 0;
+  for(i = 0; i < NBR_TABLE_MAX_NEIGHBORS; i++) {
+    lladdr_of(&lladdr, g, i);
+    n = nbr_table_get_from_lladdr(neighbors, &lladdr);
+    if(present ? n == NULL || n->id != g * NBR_TABLE_MAX_NEIGHBORS + i : n != NULL) {
+      errors++;
+    }
+  }
+  return errors;
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(nbr_table_benchmark_process, ev, data)
+{
+  static int g, i, errors;
+  static unsigned long start;
+  rimeaddr_t lladdr;
+  struct neighbor *n;
+
+  PROCESS_BEGIN();
+
+  printf("nbr-table benchmark: %s index, %d neighbors\n",
+         NBR_TABLE_HASH ? "hashed" : "linear", NBR_TABLE_MAX_NEIGHBORS);
+
+  nbr_table_register(neighbors, NULL);
+
+  errors = 0;
+  for(g = 0; g < 2 * ROUNDS; g += 2) {
+    for(i = 0; i < NBR_TABLE_MAX_NEIGHBORS; i++) {
+      lladdr_of(&lladdr, g, i);
+      n = nbr_table_add_lladdr(neighbors, &lladdr);
+      if(n == NULL) {
+        printf("could not add neighbor %d\n", i);
+        PROCESS_EXIT();
+      }
+      n->id = g * NBR_TABLE_MAX_NEIGHBORS + i;
+    }
+    errors += check(g, 1);
+    if(g > 0) {
+      errors += check(g - 1, 0);
+    }
+
+    /* Every neighbor announces a new address */
+    for(i = 0; i < NBR_TABLE_MAX_NEIGHBORS; i++) {
+      lladdr_of(&lladdr, g, i);
+      n = nbr_table_get_from_lladdr(neighbors, &lladdr);
+      lladdr_of(&lladdr, g + 1, i);
+      if(n == NULL || !nbr_table_update_lladdr(neighbors, n, &lladdr)) {
+        errors++;
+        continue;
+      }
+      n->id = (g + 1) * NBR_TABLE_MAX_NEIGHBORS + i;
+    }
+    errors += check(g, 0);
+    errors += check(g + 1, 1);
+  }
+
+  start = usec_now();
+  for(i = 0; i < LOOKUPS; i++) {
+    lladdr_of(&lladdr, g - 1, rand() % NBR_TABLE_MAX_NEIGHBORS);
+    if(nbr_table_get_from_lladdr(neighbors, &lladdr) == NULL) {
+      errors++;
+    }
+  }
+  printf("%lu ns/lookup\n", (usec_now() - start) * 1000 / LOOKUPS);
+
+  printf("nbr-table benchmark done, %d errors\n", errors);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,281 @@
+/*
+ * Copyright (c) 2013, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Compares the text messages the sensor applications used to send
+ *         with the binary records of apps/global-sensor/sensor-record.h:
+ *         bytes per frame, frames encoded per second, and frames parsed
+ *         per second at the sink.
+ */
+
+#include "contiki.h"
+#include "sensor-record.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#define FRAMES 200000
+#define FRAME_MAX 128
+#define VALUES_MAX 50
+/*---------------------------------------------------------------------------*/
+PROCESS(sensor_record_benchmark_process, "Sensor record benchmark");
+AUTOSTART_PROCESSES(&sensor_record_benchmark_process);
+/*---------------------------------------------------------------------------*/
+static uint16_t values[VALUES_MAX];
+static uint16_t parsed[VALUES_MAX];
+static char text[FRAME_MAX * 2];
+static uint8_t frame[FRAME_MAX];
+static unsigned long checksum;
+/*---------------------------------------------------------------------------*/
+static unsigned long
+usec_now(void)
+{
+  struct timeval tv;
+
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec * 1000000UL + tv.tv_usec;
+}
+/*---------------------------------------------------------------------------*/
+static unsigned long
+per_second(unsigned long n, unsigned long usec)
+{
+  return usec == 0 ? 0 : (unsigned long)((double)n * 1000000 / usec);
+}
+/*---------------------------------------------------------------------------*/
+/* The text messages, as tool-sample-stats, mean-shift and
+   grad-desc-localization built them with itoa() and strcat(). The
+   first two sent their whole buffer, padding included. */
+static int
+text_encode(uint8_t kind, int count)
+{
+  int i, len;
+
+  switch(kind) {
+  case SENSOR_RECORD_STATS:
+    memset(text, 0, 29);
+    sprintf(text, "sample_mean = %u\nstd_dev = %u\n", values[0], values[1]);
+    return 29;
+  case SENSOR_RECORD_MEAN_SHIFT:
+    memset(text, 0, 52);
+    sprintf(text, "\nmean_0 = %u\ndifference = %u\nst. dev. = %u\n",
+            values[0], values[1], values[2]);
+    return 52;
+  default:
+    len = 0;
+    for(i = 0; i < count; i++) {
+      len += sprintf(text + len, i == 0 ? "%u" : " %u", values[i]);
+    }
+    return len;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static int
+text_parse(uint8_t kind, int count)
+{
+  char *token;
+  int i;
+
+  if(kind == SENSOR_RECORD_SAMPLES) {
+    token = strtok(text, " ");
+  } else {
+    /* Each line of the stats messages is "name = value" */
+    token = strtok(text, "=");
+    token = strtok(NULL, "\n");
+  }
+  for(i = 0; i < count && token != NULL; i++) {
+    parsed[i] = atoi(token);
+    if(kind == SENSOR_RECORD_SAMPLES) {
+      token = strtok(NULL, " ");
+    } else {
+      token = strtok(NULL, "=");
+      token = strtok(NULL, "\n");
+    }
+  }
+  return i;
+}
+/*---------------------------------------------------------------------------*/
+static void
+run(const char *name, uint8_t kind, int count)
+{
+  struct sensor_record r;
+  unsigned long start, encode_time, parse_time;
+  char packet[sizeof(text)];
+  int text_length, record_length;
+  long i;
+
+  r.kind = kind;
+  r.sensor = 'l';
+  r.node[0] = 14;
+  r.node[1] = 0;
+  r.seqno = 0;
+  r.time = 3600;
+  r.count = count;
+  r.values = values;
+
+  /* Text */
+  start = usec_now();
+  for(i = 0; i < FRAMES; i++) {
+    values[0] += i & 1;
+    text_length = text_encode(kind, count);
+    checksum += text[text_length - 2];
+  }
+  encode_time = usec_now() - start;
+
+  /* Both parsers take the frame out of a packet buffer first, which
+     strtok() needs anyway as it writes into the message */
+  memcpy(packet, text, text_length);
+  start = usec_now();
+  for(i = 0; i < FRAMES; i++) {
+    memcpy(text, packet, text_length);
+    checksum += text_parse(kind, count) + parsed[0];
+  }
+  parse_time = usec_now() - start;
+  printf("%-12s text   %3d bytes %9lu encodes/s %9lu parses/s\n", name,
+         text_length, per_second(FRAMES, encode_time),
+         per_second(FRAMES, parse_time));
+
+  /* Binary */
+  start = usec_now();
+  for(i = 0; i < FRAMES; i++) {
+    values[0] += i & 1;
+    r.seqno++;
+    record_length = sensor_record_encode(&r, frame, sizeof(frame));
+    checksum += frame[record_length - 1];
+  }
+  encode_time = usec_now() - start;
+
+  r.values = parsed;
+  memcpy(packet, frame, record_length);
+  start = usec_now();
+  for(i = 0; i < FRAMES; i++) {
+    memcpy(frame, packet, record_length);
+    checksum += sensor_record_decode(&r, frame, record_length, VALUES_MAX) +
+      parsed[0];
+  }
+  parse_time = usec_now() - start;
+  printf("%-12s record %3d bytes %9lu encodes/s %9lu parses/s\n", name,
+         record_length, per_second(FRAMES, encode_time),
+         per_second(FRAMES, parse_time));
+  if(memcmp(parsed, values, count * sizeof(values[0])) != 0) {
+    printf("%-12s record does not decode to its values\n", name);
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* The sinks tell records from text with sensor_record_decode(), so text
+   and records with extra bytes must not decode */
+static void
+check_strict(void)
+{
+  static const char *texts[] = {
+    "31.2 C, 40.5 %, 1.0 V, light 480 lux, solar 120, node 9.0\n",
+    "mean_0 = 312\nst. dev. = 4\n",
+  };
+  struct sensor_record r;
+  int i, length, errors;
+
+  errors = 0;
+  r.values = parsed;
+  for(i = 0; i < sizeof(texts) / sizeof(texts[0]); i++) {
+    if(sensor_record_decode(&r, (const uint8_t *)texts[i], strlen(texts[i]),
+                            VALUES_MAX) >= 0) {
+      printf("text %d decodes as a record\n", i);
+      errors++;
+    }
+  }
+
+  r.kind = SENSOR_RECORD_STATS;
+  r.sensor = 'l';
+  r.node[0] = 14;
+  r.node[1] = 0;
+  r.seqno = 0;
+  r.time = 3600;
+  values[0] = 312;
+  values[1] = 4;
+  r.values = values;
+  r.count = 2;
+  length = sensor_record_encode(&r, frame, sizeof(frame) - 1);
+  r.values = parsed;
+  if(sensor_record_decode(&r, frame, length, VALUES_MAX) != 2) {
+    printf("record does not decode\n");
+    errors++;
+  }
+  frame[length] = '\n';
+  if(sensor_record_decode(&r, frame, length + 1, VALUES_MAX) >= 0) {
+    printf("record with a trailing byte decodes\n");
+    errors++;
+  }
+  printf("strict decoding: %d errors\n", errors);
+}
+/*---------------------------------------------------------------------------*/
+static void
+series(int count)
+{
+  char name[16];
+  int i;
+
+  /* Light readings that drift slowly, as along the chain of nodes */
+  for(i = 0; i < count; i++) {
+    values[i] = 480 + (i * 37) % 23;
+  }
+  snprintf(name, sizeof(name), "samples %d", count);
+  run(name, SENSOR_RECORD_SAMPLES, count);
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(sensor_record_benchmark_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+  printf("sensor-record benchmark: %d frames per test\n", FRAMES);
+
+  values[0] = 312;
+  values[1] = 4;
+  run("stats", SENSOR_RECORD_STATS, 2);
+
+  values[0] = 312;
+  values[1] = 9;
+  values[2] = 4;
+  run("mean-shift", SENSOR_RECORD_MEAN_SHIFT, 3);
+
+  series(7);
+  series(20);
+  series(VALUES_MAX);
+
+  check_strict();
+
+  printf("sensor-record benchmark done (%lu)\n", checksum & 0xff);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
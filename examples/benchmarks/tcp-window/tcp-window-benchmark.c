@@ -0,0 +1,143 @@
+/*
+ * Copyright (c) 2013, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Measures TCP send throughput. The benchmark listens on port
+ *         8080 and sends 256 kilobytes to every host that connects,
+ *         for example with "nc <address> 8080 > /dev/null". Run it
+ *         once as it is and once with "make WINDOW=4" to compare
+ *         stop-and-wait with a window of four segments.
+ */
+
+#include "contiki.h"
+#include "contiki-net.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/time.h>
+
+#define PORT       8080
+#define TOTAL_LEN  (256UL * 1024)
+
+static unsigned long sent, acked, start;
+static uint16_t lastlen;
+static uint8_t data[UIP_TCP_MSS];
+/*---------------------------------------------------------------------------*/
+PROCESS(tcp_window_benchmark_process, "TCP window benchmark");
+AUTOSTART_PROCESSES(&tcp_window_benchmark_process);
+/*---------------------------------------------------------------------------*/
+static unsigned long
+usec_now(void)
+{
+  struct timeval tv;
+
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec * 1000000UL + tv.tv_usec;
+}
+/*---------------------------------------------------------------------------*/
+static void
+send_data(void)
+{
+  uint16_t len;
+
+  if(uip_rexmit()) {
+    /* Only the segment without a retransmit buffer is retransmitted
+       by the application, and it is the last one sent. */
+    uip_send(data, lastlen);
+    return;
+  }
+
+  len = uip_window_room();
+  if(len == 0 || sent == TOTAL_LEN) {
+    return;
+  }
+  if(len > TOTAL_LEN - sent) {
+    len = TOTAL_LEN - sent;
+  }
+  uip_send(data, len);
+  lastlen = len;
+  sent += len;
+
+  /* Ask to be called again, to fill the window. */
+  tcpip_poll_tcp(uip_conn);
+}
+/*---------------------------------------------------------------------------*/
+static void
+handle_event(void)
+{
+  unsigned long usecs;
+
+  if(uip_connected()) {
+    sent = acked = 0;
+    start = usec_now();
+  }
+
+  if(uip_acked()) {
+    acked = sent - uip_outstanding(uip_conn);
+    if(acked == TOTAL_LEN) {
+      usecs = usec_now() - start;
+      printf("%lu bytes in %lu ms: %lu kbyte/s (%d segments in flight)\n",
+             acked, usecs / 1000, acked * 1000 / (usecs + 1),
+             UIP_TCP_WINDOW_SEGMENTS);
+      uip_close();
+      return;
+    }
+  }
+
+  if(uip_aborted() || uip_timedout() || uip_closed()) {
+    if(acked < TOTAL_LEN) {
+      printf("connection lost after %lu bytes\n", acked);
+    }
+    return;
+  }
+
+  send_data();
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(tcp_window_benchmark_process, ev, ev_data)
+{
+  PROCESS_BEGIN();
+
+  memset(data, 'x', sizeof(data));
+  tcp_listen(UIP_HTONS(PORT));
+  printf("tcp window benchmark: listening on port %d, mss %d\n",
+         PORT, UIP_TCP_MSS);
+
+  while(1) {
+    PROCESS_WAIT_EVENT_UNTIL(ev == tcpip_event);
+    handle_event();
+  }
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
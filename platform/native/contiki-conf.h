@@ -70,6 +70,10 @@ typedef unsigned short uip_stats_t;
 #define UIP_CONF_MAX_LISTENPORTS 40
 #define UIP_CONF_BUFFER_SIZE     420
 #define UIP_CONF_BYTE_ORDER      UIP_LITTLE_ENDIAN
+#ifndef UIP_CONF_CHKSUM_WIDE
+#define UIP_CONF_CHKSUM_WIDE     1
+#endif /* UIP_CONF_CHKSUM_WIDE */
+#define UIP_CONF_TCP_REXMIT_CHKSUM 1
 #define UIP_CONF_TCP       1
 #define UIP_CONF_TCP_SPLIT       0
 #define UIP_CONF_LOGGING         0
@@ -32,9 +32,13 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <errno.h>
 #include <sys/select.h>
+#include <sys/time.h>
+#include <time.h>
 
 #ifdef __CYGWIN__
 #include "net/wpcap-drv.h"
@@ -66,6 +70,33 @@
 #define SELECT_MAX 8
 #endif
 
+/* Wait for file descriptors with epoll rather than select() when
+   available. */
+#ifdef SELECT_CONF_EPOLL
+#define SELECT_EPOLL SELECT_CONF_EPOLL
+#elif defined(__linux__)
+#define SELECT_EPOLL 1
+#else
+#define SELECT_EPOLL 0
+#endif
+
+/* Periodically print the number of main loop wakeups per second and
+   how late the event timers are noticed. */
+#ifdef SELECT_CONF_STATS
+#define SELECT_STATS SELECT_CONF_STATS
+#else
+#define SELECT_STATS 0
+#endif
+
+#if SELECT_EPOLL
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#endif /* SELECT_EPOLL */
+
+/* The GUI needs to check for console resizes now and then. */
+#define GUI_TIMEOUT_MS 100
+#define STATS_INTERVAL 10
+
 static const struct select_callback *select_callback[SELECT_MAX];
 static int select_max = 0;
 
@@ -116,9 +147,14 @@ static void
 stdin_handle_fd(fd_set *rset, fd_set *wset)
 {
   char c;
+  int n;
   if(FD_ISSET(STDIN_FILENO, rset)) {
-    if(read(STDIN_FILENO, &c, 1) > 0) {
+    n = read(STDIN_FILENO, &c, 1);
+    if(n > 0) {
       serial_line_input_byte(c);
+    } else if(n == 0) {
+      /* End of file: stop waiting for input that never comes. */
+      select_set_callback(STDIN_FILENO, NULL);
     }
   }
 }
@@ -126,6 +162,303 @@ const static struct select_callback stdin_fd = {
   stdin_set_fd, stdin_handle_fd
 };
 /*---------------------------------------------------------------------------*/
+/*
+ * Return the number of milliseconds until the next event timer
+ * expires, zero if it already has expired, or -1 if there are no
+ * pending event timers.
+ */
+static int
+next_timeout(void)
+{
+  long remaining;
+
+  if(!etimer_pending()) {
+    return -1;
+  }
+  remaining = (long)(etimer_next_expiration_time() - clock_time());
+  if(remaining <= 0) {
+    return 0;
+  }
+  return (remaining * 1000 + CLOCK_SECOND - 1) / CLOCK_SECOND;
+}
+/*---------------------------------------------------------------------------*/
+static int
+collect_fds(fd_set *fdr, fd_set *fdw)
+{
+  int maxfd;
+  int i;
+
+  FD_ZERO(fdr);
+  FD_ZERO(fdw);
+  maxfd = 0;
+  for(i = 0; i <= select_max; i++) {
+    if(select_callback[i] != NULL && select_callback[i]->set_fd(fdr, fdw)) {
+      maxfd = i;
+    }
+  }
+  return maxfd;
+}
+/*---------------------------------------------------------------------------*/
+#if SELECT_EPOLL
+static int epfd = -1;
+/* The file descriptors registered with epoll, and those that epoll
+   refuses (such as regular files) and thus always are ready. */
+static fd_set epoll_rset, epoll_wset, always_ready;
+static int epoll_maxfd = -1;
+
+/* A timer file descriptor that wakes us up when the next event timer
+   expires, with better than millisecond precision. */
+static int tfd = -1;
+static clock_time_t tfd_expiration;
+static int tfd_armed;
+/*---------------------------------------------------------------------------*/
+static void
+arm_timerfd(void)
+{
+  struct itimerspec its;
+  long remaining;
+
+  if(etimer_pending() == tfd_armed &&
+     (!tfd_armed || etimer_next_expiration_time() == tfd_expiration)) {
+    return;
+  }
+
+  /* The timer is armed relative to the current clock tick, so nothing
+     is assumed about what the clock counts from, and it never fires
+     before the tick is reached. A zero time disarms the timer, so a
+     timer that already has expired gets the shortest time instead. */
+  memset(&its, 0, sizeof(its));
+  tfd_armed = etimer_pending();
+  if(tfd_armed) {
+    tfd_expiration = etimer_next_expiration_time();
+    remaining = (long)(tfd_expiration - clock_time());
+    if(remaining <= 0) {
+      its.it_value.tv_nsec = 1;
+    } else {
+      its.it_value.tv_sec = remaining / CLOCK_SECOND;
+      its.it_value.tv_nsec = (remaining % CLOCK_SECOND) *
+        (1000000000L / CLOCK_SECOND);
+    }
+  }
+  timerfd_settime(tfd, 0, &its, NULL);
+}
+/*---------------------------------------------------------------------------*/
+static void
+update_interest(int fd, fd_set *fdr, fd_set *fdw)
+{
+  struct epoll_event event;
+  int want, have, op;
+
+  want = (FD_ISSET(fd, fdr) ? EPOLLIN : 0) | (FD_ISSET(fd, fdw) ? EPOLLOUT : 0);
+  have = (FD_ISSET(fd, &epoll_rset) ? EPOLLIN : 0) |
+    (FD_ISSET(fd, &epoll_wset) ? EPOLLOUT : 0);
+  if(want == have) {
+    return;
+  }
+
+  memset(&event, 0, sizeof(event));
+  event.events = want;
+  event.data.fd = fd;
+  op = want == 0 ? EPOLL_CTL_DEL : (have == 0 ? EPOLL_CTL_ADD : EPOLL_CTL_MOD);
+  if(epoll_ctl(epfd, op, fd, &event) < 0) {
+    /* The descriptor may have been closed and reopened behind our
+       back, which drops or keeps its registration. */
+    if(errno == EEXIST) {
+      epoll_ctl(epfd, EPOLL_CTL_MOD, fd, &event);
+    } else if(errno == ENOENT && want != 0) {
+      epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &event);
+    } else if(errno == EPERM) {
+      FD_SET(fd, &always_ready);
+    }
+  }
+
+  FD_CLR(fd, &epoll_rset);
+  FD_CLR(fd, &epoll_wset);
+  if(want & EPOLLIN) {
+    FD_SET(fd, &epoll_rset);
+  }
+  if(want & EPOLLOUT) {
+    FD_SET(fd, &epoll_wset);
+  }
+  if(want == 0) {
+    FD_CLR(fd, &always_ready);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static int
+wait_fds(int maxfd, fd_set *fdr, fd_set *fdw, int timeout)
+{
+  struct epoll_event events[SELECT_MAX + 1];
+  uint64_t expirations;
+  int fd, n, i, ready, nready;
+
+  if(epfd < 0) {
+    struct epoll_event event;
+
+    epfd = epoll_create(SELECT_MAX + 1);
+    tfd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK);
+    if(epfd < 0 || tfd < 0) {
+      perror("epoll_create");
+      exit(1);
+    }
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN;
+    event.data.fd = tfd;
+    epoll_ctl(epfd, EPOLL_CTL_ADD, tfd, &event);
+    FD_ZERO(&epoll_rset);
+    FD_ZERO(&epoll_wset);
+    FD_ZERO(&always_ready);
+  }
+
+  arm_timerfd();
+
+  /* Only the changes in the interest sets result in system calls. */
+  ready = 0;
+  for(fd = 0; fd <= maxfd || fd <= epoll_maxfd; fd++) {
+    update_interest(fd, fdr, fdw);
+    if(FD_ISSET(fd, &always_ready)) {
+      ready = 1;
+    }
+  }
+  epoll_maxfd = maxfd;
+
+  /* The timeout only is a fallback, as the timer descriptor wakes us
+     up in time for the next event timer. */
+  n = epoll_wait(epfd, events, SELECT_MAX + 1, ready ? 0 : timeout);
+  if(n < 0) {
+    /* A signal, such as the rtimer alarm, woke us up. */
+    return errno == EINTR ? 0 : -1;
+  }
+
+  FD_ZERO(fdr);
+  FD_ZERO(fdw);
+  nready = 0;
+  for(i = 0; i < n; i++) {
+    if(events[i].data.fd == tfd) {
+      /* Clear the expiration count so that the descriptor is not
+         reported again, and rearm it for the next event timer. */
+      read(tfd, &expirations, sizeof(expirations));
+      tfd_armed = 0;
+      continue;
+    }
+    nready++;
+    if(events[i].events & (EPOLLIN | EPOLLERR | EPOLLHUP)) {
+      FD_SET(events[i].data.fd, fdr);
+    }
+    if(events[i].events & EPOLLOUT) {
+      FD_SET(events[i].data.fd, fdw);
+    }
+  }
+  for(fd = 0; fd <= maxfd; fd++) {
+    if(FD_ISSET(fd, &always_ready)) {
+      if(FD_ISSET(fd, &epoll_rset)) {
+        FD_SET(fd, fdr);
+      }
+      if(FD_ISSET(fd, &epoll_wset)) {
+        FD_SET(fd, fdw);
+      }
+      nready++;
+    }
+  }
+  return nready;
+}
+#else /* SELECT_EPOLL */
+/*---------------------------------------------------------------------------*/
+static int
+wait_fds(int maxfd, fd_set *fdr, fd_set *fdw, int timeout)
+{
+  struct timeval tv;
+  int retval;
+
+  tv.tv_sec = timeout / 1000;
+  tv.tv_usec = (timeout % 1000) * 1000;
+
+  retval = select(maxfd + 1, fdr, fdw, NULL, timeout < 0 ? NULL : &tv);
+  if(retval < 0 && errno == EINTR) {
+    return 0;
+  }
+  return retval;
+}
+#endif /* SELECT_EPOLL */
+/*---------------------------------------------------------------------------*/
+#if SELECT_STATS
+static unsigned long wakeups, timer_wakeups;
+static unsigned long latency_sum, latency_max;
+static unsigned long stats_start;
+/* The next event timer, and when it is due on the monotonic clock */
+static clock_time_t stats_expiration;
+static unsigned long stats_deadline;
+static int stats_pending;
+
+static unsigned long
+usec_now(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000UL + ts.tv_nsec / 1000;
+}
+/*---------------------------------------------------------------------------*/
+static void
+stats_sleep(void)
+{
+  long remaining;
+
+  /* The clock may count from anywhere, so the time until the next
+     expiration is taken once, when the loop first sees it. */
+  if(!etimer_pending() || (stats_pending &&
+     etimer_next_expiration_time() == stats_expiration)) {
+    return;
+  }
+  stats_expiration = etimer_next_expiration_time();
+  remaining = (long)(stats_expiration - clock_time());
+  stats_deadline = usec_now();
+  if(remaining > 0) {
+    stats_deadline += remaining * (1000000UL / CLOCK_SECOND);
+  }
+  stats_pending = 1;
+}
+/*---------------------------------------------------------------------------*/
+static void
+stats_timer(void)
+{
+  unsigned long latency;
+
+  if(!stats_pending) {
+    return;
+  }
+  stats_pending = 0;
+  latency = usec_now() - stats_deadline;
+  if((long)latency < 0) {
+    latency = 0;
+  }
+  latency_sum += latency;
+  if(latency > latency_max) {
+    latency_max = latency;
+  }
+  timer_wakeups++;
+}
+/*---------------------------------------------------------------------------*/
+static void
+stats_wakeup(int slept)
+{
+  unsigned long elapsed;
+
+  if(slept) {
+    wakeups++;
+  }
+  elapsed = usec_now() - stats_start;
+  if(elapsed >= STATS_INTERVAL * 1000000UL) {
+    printf("main loop: %lu wakeups/s, timer latency avg %lu us max %lu us\n",
+           wakeups * 1000000UL / elapsed,
+           timer_wakeups > 0 ? latency_sum / timer_wakeups : 0,
+           latency_max);
+    wakeups = timer_wakeups = latency_sum = latency_max = 0;
+    stats_start = usec_now();
+  }
+}
+#endif /* SELECT_STATS */
+/*---------------------------------------------------------------------------*/
 static void
 set_rime_addr(void)
 {
@@ -235,29 +568,34 @@ main(int argc, char **argv)
   setvbuf(stdout, (char *)NULL, _IONBF, 0);
 
   select_set_callback(STDIN_FILENO, &stdin_fd);
+#if SELECT_STATS
+  stats_start = usec_now();
+#endif /* SELECT_STATS */
   while(1) {
     fd_set fdr;
     fd_set fdw;
     int maxfd;
     int i;
     int retval;
-    struct timeval tv;
+    int timeout;
 
     retval = process_run();
 
-    tv.tv_sec = 0;
-    tv.tv_usec = retval ? 1 : 1000;
-
-    FD_ZERO(&fdr);
-    FD_ZERO(&fdw);
-    maxfd = 0;
-    for(i = 0; i <= select_max; i++) {
-      if(select_callback[i] != NULL && select_callback[i]->set_fd(&fdr, &fdw)) {
-        maxfd = i;
-      }
+    /* Sleep until the next event timer expires, unless there are
+       more events to process. */
+    timeout = retval ? 0 : next_timeout();
+#if WITH_GUI
+    if(timeout < 0 || timeout > GUI_TIMEOUT_MS) {
+      timeout = GUI_TIMEOUT_MS;
     }
+#endif /* WITH_GUI */
 
-    retval = select(maxfd + 1, &fdr, &fdw, NULL, &tv);
+    maxfd = collect_fds(&fdr, &fdw);
+
+#if SELECT_STATS
+    stats_sleep();
+#endif /* SELECT_STATS */
+    retval = wait_fds(maxfd, &fdr, &fdw, timeout);
     if(retval < 0) {
       perror("select");
     } else if(retval > 0) {
@@ -269,7 +607,16 @@ main(int argc, char **argv)
       }
     }
 
-    etimer_request_poll();
+#if SELECT_STATS
+    stats_wakeup(timeout != 0);
+#endif /* SELECT_STATS */
+
+    if(next_timeout() == 0) {
+#if SELECT_STATS
+      stats_timer();
+#endif /* SELECT_STATS */
+      etimer_request_poll();
+    }
 
 #if WITH_GUI
     if(console_resize()) {
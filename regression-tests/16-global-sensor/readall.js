@@ -0,0 +1,54 @@
+/*
+ * Node 1 reads all nodes with sensor-readall a number of times and
+ * reports the share of answers it got and the time the last one took.
+ * The links are lossy and broadcasts are not retried, so the test passes
+ * when 95% of the answers the radio medium lets through arrive.  A
+ * query and its answer each cross a link at the edge of the range at
+ * worst.
+ */
+TIMEOUT(600000, log.log("last message: " + msg + "\n"));
+
+queries = 5;
+nrNodes = sim.getMotesCount();
+querier = sim.getMoteWithID(1);
+medium = sim.getRadioMedium();
+delivery = Math.pow(medium.SUCCESS_RATIO_TX * medium.SUCCESS_RATIO_RX, 2);
+
+/* Wait until all nodes have started */
+booted = 0;
+while(booted < nrNodes) {
+  YIELD_THEN_WAIT_UNTIL(msg.startsWith('readall-node started'));
+  booted++;
+}
+
+GENERATE_MSG(5000, "setall");
+YIELD_THEN_WAIT_UNTIL(msg.equals("setall"));
+write(querier, "sensor-setall v");
+GENERATE_MSG(5000, "query");
+YIELD_THEN_WAIT_UNTIL(msg.equals("query"));
+
+total_answers = 0;
+total_latency = 0;
+for(q = 1; q <= queries; q++) {
+  write(querier, "sensor-readall");
+
+  /* "readall epoch E: N answers, last after T ms" */
+  YIELD_THEN_WAIT_UNTIL(id == 1 && msg.startsWith('readall epoch'));
+  fields = msg.split(" ");
+  answers = parseInt(fields[3]);
+  latency = parseInt(fields[7]);
+  log.log("Query " + q + ": " + answers + "/" + (nrNodes - 1) +
+          " answers, last after " + latency + " ms\n");
+  total_answers += answers;
+  total_latency += latency;
+}
+
+completeness = total_answers / (queries * (nrNodes - 1));
+log.log("Nodes " + nrNodes + ": completeness " + (100 * completeness) +
+        "% of " + (100 * delivery) + "% delivered, mean latency " +
+        (total_latency / queries) + " ms\n");
+if(completeness >= 0.95 * delivery) {
+  log.testOK();
+} else {
+  log.testFailed();
+}
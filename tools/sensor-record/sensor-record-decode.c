@@ -0,0 +1,143 @@
+/*
+ * Copyright (c) 2013, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Reads the serial output of a node and replaces each line
+ *         "SR <hex>" with the sensor record it holds, in text. Other
+ *         lines are copied as they are.
+ */
+
+#include "sensor-record.h"
+
+#include <ctype.h>
+#include <stdio.h>
+#include <string.h>
+
+#define RECORD_MAX 128
+#define VALUES_MAX 255
+
+static const char *kinds[] = {
+  "samples", "stats", "mean-shift", "change", "average"
+};
+/*---------------------------------------------------------------------------*/
+static int
+hex_value(char c)
+{
+  if(c >= '0' && c <= '9') {
+    return c - '0';
+  }
+  if(c >= 'a' && c <= 'f') {
+    return c - 'a' + 10;
+  }
+  if(c >= 'A' && c <= 'F') {
+    return c - 'A' + 10;
+  }
+  return -1;
+}
+/*---------------------------------------------------------------------------*/
+/* Returns the number of bytes in the hex string, or -1 if it is not one */
+static int
+parse_hex(const char *s, uint8_t *buf, int size)
+{
+  int len, high, low;
+
+  for(len = 0; len < size; len++) {
+    high = hex_value(s[0]);
+    if(high < 0) {
+      break;
+    }
+    low = hex_value(s[1]);
+    if(low < 0) {
+      return -1;
+    }
+    buf[len] = (high << 4) | low;
+    s += 2;
+  }
+  return hex_value(*s) < 0 ? len : -1;
+}
+/*---------------------------------------------------------------------------*/
+static void
+print_record(const struct sensor_record *r, int count)
+{
+  int i;
+
+  printf("node %u.%u seqno %u time %lu sensor %c ",
+         r->node[0], r->node[1], r->seqno, (unsigned long)r->time,
+         isgraph(r->sensor) ? r->sensor : '-');
+  if(r->kind < sizeof(kinds) / sizeof(kinds[0])) {
+    printf("%s:", kinds[r->kind]);
+  } else {
+    printf("kind %u:", r->kind);
+  }
+  for(i = 0; i < count; i++) {
+    if(r->values[i] == SENSOR_RECORD_MISSING) {
+      printf(" -");
+    } else {
+      printf(" %u", r->values[i]);
+    }
+  }
+  printf("\n");
+}
+/*---------------------------------------------------------------------------*/
+int
+main(int argc, char **argv)
+{
+  static char line[1024];
+  static uint8_t buf[RECORD_MAX];
+  static uint16_t values[VALUES_MAX];
+  struct sensor_record r;
+  char *hex;
+  int len, count;
+
+  r.values = values;
+  while(fgets(line, sizeof(line), stdin) != NULL) {
+    /* serialdump and the shell may prefix the line */
+    hex = strstr(line, "SR ");
+    if(hex != NULL) {
+      hex += 3;
+      hex[strcspn(hex, "\r\n")] = '\0';
+      len = parse_hex(hex, buf, sizeof(buf));
+      count = len < 0 ? -1 : sensor_record_decode(&r, buf, len, VALUES_MAX);
+      if(count >= 0) {
+        print_record(&r, count);
+        continue;
+      }
+      hex[-3] = '\0';
+      printf("%sSR %s (malformed record)\n", line, hex);
+      continue;
+    }
+    fputs(line, stdout);
+  }
+
+  return 0;
+}